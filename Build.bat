@@ -43,7 +43,7 @@ REM --------------------
 
 REM SRC FILES
 set GL_srcFiles= ../ext/imgui_plot/imgui_plot.cpp  ../src/GL_Helpers/GL_Mesh.cpp  ../src/GL_Helpers/GL_Shader.cpp ../src/GL_Helpers/Util.cpp ../src/GL_Helpers/GL_Camera.cpp
-set demoFiles= ../src/Demos/ImageLab/ImageLab.cpp ../src/Demos/AudioLab/AudioLab.cpp
+set demoFiles= ../src/Demos/ImageLab/ImageLab.cpp ../src/Demos/ImageLab/Convolution.cpp ../src/Demos/ImageLab/RecursiveGaussian.cpp ../src/Demos/ImageLab/Morphology.cpp ../src/Demos/ImageLab/DistanceTransform.cpp ../src/Demos/ImageLab/Median.cpp ../src/Demos/ImageLab/SummedAreaTable.cpp ../src/Demos/ImageLab/Histogram.cpp ../src/Demos/ImageLab/Canny.cpp ../src/Demos/ImageLab/Resample.cpp ../src/Demos/ImageLab/Pyramid.cpp ../src/Demos/ImageLab/Dither.cpp ../src/Demos/ImageLab/Color.cpp ../src/Demos/ImageLab/Bilateral.cpp ../src/Demos/ImageLab/EdgeAware.cpp ../src/Demos/ImageLab/ImageLoader.cpp ../src/Demos/ImageLab/ImageExport.cpp ../src/Demos/ImageLab/RawImage.cpp ../src/Demos/ImageLab/StageCache.cpp ../src/Demos/ImageLab/ImageBuffer.cpp ../src/Demos/ImageLab/FrameArena.cpp ../src/Demos/ImageLab/Sequence.cpp ../src/Demos/AudioLab/AudioLab.cpp
 set demoFiles= %demoFiles% %dearimguiSrc%
 
 REM --------------------
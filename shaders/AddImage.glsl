@@ -9,9 +9,11 @@ layout ( local_size_x = 32 , local_size_y = 32) in;
 
 uniform float multiplier;
 uniform ivec2 offset;
+//first pixel of the texture to add that lands in the output
+uniform ivec2 start;
 void main()
 {
-    ivec2 pixelCoord = ivec2 ( gl_GlobalInvocationID.xy );
+    ivec2 pixelCoord = ivec2 ( gl_GlobalInvocationID.xy ) + start;
     // vec3 color = imageLoad(textureIn, pixelCoord).rgb;
     
     //if the current pixel is less than the size of the texture to add
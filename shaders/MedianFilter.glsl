@@ -36,8 +36,8 @@ void main()
     vec4 c0 = imageLoad(textureIn, pixelCoord + ivec2(-2,0) );
     vec4 c1 = imageLoad(textureIn, pixelCoord + ivec2(-1,0) );
     vec4 c2 = imageLoad(textureIn, pixelCoord + ivec2( 0,0) );
-    vec4 c3 = imageLoad(textureIn, pixelCoord + ivec2(-1,0) );
-    vec4 c4 = imageLoad(textureIn, pixelCoord + ivec2(-2,0) );
+    vec4 c3 = imageLoad(textureIn, pixelCoord + ivec2( 1,0) );
+    vec4 c4 = imageLoad(textureIn, pixelCoord + ivec2( 2,0) );
     
     vec4 c5 = imageLoad(textureIn, pixelCoord + ivec2(0,-2) );
     vec4 c6 = imageLoad(textureIn, pixelCoord + ivec2(0,-1) );
@@ -0,0 +1,202 @@
+#include "Bilateral.hpp"
+#include "Parallel.hpp"
+#include "Color.hpp"
+
+#include <xmmintrin.h>
+#include <algorithm>
+#include <cmath>
+
+static inline __m128 Load(const glm::vec4 &v) { return _mm_loadu_ps(&v.x); }
+static inline __m128 Lerp(__m128 a, __m128 b, __m128 t) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)); }
+
+//[1 4 6 4 1] / 16 along one axis of the grid, cells outside of it are empty.
+//Cells along the axis are stride apart, lines start at lineStart(i) and have length cells.
+template<typename LineStart>
+static void BlurGridAxis(const glm::vec4 *input, glm::vec4 *output, int numLines, int length, size_t stride, LineStart lineStart)
+{
+    const __m128 one = _mm_set1_ps(1.0f / 16.0f);
+    const __m128 four = _mm_set1_ps(4.0f / 16.0f);
+    const __m128 six = _mm_set1_ps(6.0f / 16.0f);
+    const __m128 zero = _mm_setzero_ps();
+    ParallelForChunks(0, numLines, [&](int startLine, int endLine)
+    {
+        for(int line=startLine; line<endLine; line++)
+        {
+            size_t start = lineStart(line);
+            const glm::vec4 *in = input + start;
+            glm::vec4 *out = output + start;
+            auto Tap = [&](int i) { return (i >= 0 && i < length) ? Load(in[i * stride]) : zero; };
+            for(int i=0; i<length; i++)
+            {
+                __m128 sum = _mm_mul_ps(_mm_add_ps(Tap(i-2), Tap(i+2)), one);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_add_ps(Tap(i-1), Tap(i+1)), four));
+                sum = _mm_add_ps(sum, _mm_mul_ps(Load(in[i * stride]), six));
+                _mm_storeu_ps(&out[i * stride].x, sum);
+            }
+        }
+    }, 16);
+}
+
+void BilateralGrid::Filter(const ConstImageView &input, const ImageView &output, float sigmaSpatial, float sigmaRange)
+{
+    int width = input.width;
+    int height = input.height;
+    if(input.Empty()) return;
+    float spatialSampling = (std::max)(sigmaSpatial, 1.0f);
+    float rangeSampling = (std::max)(sigmaRange, 1e-3f);
+    float inverseRangeSampling = 1.0f / rangeSampling;
+    size_t numPixels = (size_t)width * height;
+
+    //Gray scale, and its extent so that the grid only covers the values present
+    grays.resize(numPixels);
+    std::vector<glm::vec2> rowExtents(height);
+    ParallelFor(0, height, [&](int y)
+    {
+        glm::vec2 extent(1e30f, -1e30f);
+        const glm::vec4 *inRow = input.Row(y);
+        float *grayRow = grays.data() + (size_t)y * width;
+        for(int x=0; x<width; x++)
+        {
+            grayRow[x] = RGBToGray(inRow[x]);
+            extent.x = (std::min)(extent.x, grayRow[x]);
+            extent.y = (std::max)(extent.y, grayRow[x]);
+        }
+        rowExtents[y] = extent;
+    }, 8);
+    float minGray = 1e30f, maxGray = -1e30f;
+    for(int y=0; y<height; y++)
+    {
+        minGray = (std::min)(minGray, rowExtents[y].x);
+        maxGray = (std::max)(maxGray, rowExtents[y].y);
+    }
+
+    //One more cell than the last sample on each axis, so that interpolation can always read the next cell
+    gridWidth = (int)((width-1) / spatialSampling) + 2;
+    gridHeight = (int)((height-1) / spatialSampling) + 2;
+    gridDepth = (int)((maxGray - minGray) / rangeSampling) + 2;
+    size_t sliceSize = (size_t)gridDepth * gridWidth;
+    grid.assign((size_t)gridHeight * sliceSize, glm::vec4(0));
+    blurred.resize(grid.size());
+
+    //Cell and weight of the next cell along x, the same for every row
+    std::vector<int> cellX(width);
+    std::vector<float> weightX(width);
+    for(int x=0; x<width; x++)
+    {
+        float position = x / spatialSampling;
+        cellX[x] = (std::min)((int)position, gridWidth-2);
+        weightX[x] = position - cellX[x];
+    }
+
+    //Splat : each row of the grid gathers the image rows within one cell of it, so that no two threads write the same cell
+    ParallelFor(0, gridHeight, [&](int gy)
+    {
+        int startRow = (std::max)((int)std::ceil((gy-1) * spatialSampling), 0);
+        int endRow = (std::min)((int)std::floor((gy+1) * spatialSampling), height-1);
+        glm::vec4 *gridRow = grid.data() + gy * sliceSize;
+        for(int y=startRow; y<=endRow; y++)
+        {
+            float weightY = 1.0f - std::abs(y / spatialSampling - gy);
+            if(weightY <= 0) continue;
+            const glm::vec4 *inRow = input.Row(y);
+            const float *grayRow = grays.data() + (size_t)y * width;
+            for(int x=0; x<width; x++)
+            {
+                float position = (grayRow[x] - minGray) * inverseRangeSampling;
+                int z = (std::min)((int)position, gridDepth-2);
+                float weightZ = position - z;
+                __m128 value = _mm_mul_ps(_mm_setr_ps(inRow[x].r, inRow[x].g, inRow[x].b, 1.0f), _mm_set1_ps(weightY));
+                __m128 below = _mm_mul_ps(value, _mm_set1_ps(1.0f - weightZ));
+                __m128 above = _mm_mul_ps(value, _mm_set1_ps(weightZ));
+                __m128 right = _mm_set1_ps(weightX[x]);
+                __m128 left = _mm_set1_ps(1.0f - weightX[x]);
+                glm::vec4 *cell = gridRow + (size_t)z * gridWidth + cellX[x];
+                _mm_storeu_ps(&cell[0].x, _mm_add_ps(Load(cell[0]), _mm_mul_ps(below, left)));
+                _mm_storeu_ps(&cell[1].x, _mm_add_ps(Load(cell[1]), _mm_mul_ps(below, right)));
+                cell += gridWidth;
+                _mm_storeu_ps(&cell[0].x, _mm_add_ps(Load(cell[0]), _mm_mul_ps(above, left)));
+                _mm_storeu_ps(&cell[1].x, _mm_add_ps(Load(cell[1]), _mm_mul_ps(above, right)));
+            }
+        }
+    }, 1);
+
+    //Separable blur, x then y then z, ending in blurred
+    BlurGridAxis(grid.data(), blurred.data(), gridHeight * gridDepth, gridWidth, 1, [&](int line) { return (size_t)line * gridWidth; });
+    BlurGridAxis(blurred.data(), grid.data(), gridDepth * gridWidth, gridHeight, sliceSize, [&](int line) { return (size_t)line; });
+    BlurGridAxis(grid.data(), blurred.data(), gridHeight * gridWidth, gridDepth, gridWidth, [&](int line) { return (line / gridWidth) * sliceSize + line % gridWidth; });
+
+    //Slice : trilinear interpolation at each pixel, normalized by the interpolated weight
+    ParallelForChunks(0, height, [&](int startRow, int endRow)
+    {
+        for(int y=startRow; y<endRow; y++)
+        {
+            float positionY = y / spatialSampling;
+            int gy = (std::min)((int)positionY, gridHeight-2);
+            __m128 weightY = _mm_set1_ps(positionY - gy);
+            const glm::vec4 *gridRow = blurred.data() + gy * sliceSize;
+            const glm::vec4 *inRow = input.Row(y);
+            const float *grayRow = grays.data() + (size_t)y * width;
+            glm::vec4 *outRow = output.Row(y);
+            for(int x=0; x<width; x++)
+            {
+                float position = (grayRow[x] - minGray) * inverseRangeSampling;
+                int z = (std::min)((int)position, gridDepth-2);
+                __m128 weightZ = _mm_set1_ps(position - z);
+                __m128 weight = _mm_set1_ps(weightX[x]);
+                const glm::vec4 *cell = gridRow + (size_t)z * gridWidth + cellX[x];
+                __m128 c00 = Lerp(Load(cell[0]), Load(cell[1]), weight);
+                __m128 c01 = Lerp(Load(cell[gridWidth]), Load(cell[gridWidth+1]), weight);
+                cell += sliceSize;
+                __m128 c10 = Lerp(Load(cell[0]), Load(cell[1]), weight);
+                __m128 c11 = Lerp(Load(cell[gridWidth]), Load(cell[gridWidth+1]), weight);
+                __m128 value = Lerp(Lerp(c00, c01, weightZ), Lerp(c10, c11, weightZ), weightY);
+
+                glm::vec4 result;
+                _mm_storeu_ps(&result.x, value);
+                if(result.a > 0) outRow[x] = glm::vec4(glm::vec3(result) / result.a, inRow[x].a);
+                else outRow[x] = inRow[x];
+            }
+        }
+    }, 8);
+}
+
+void BilateralFilterReference(const ConstImageView &input, const ImageView &output, float sigmaSpatial, float sigmaRange)
+{
+    int width = input.width;
+    int height = input.height;
+    int radius = (int)std::ceil(3 * sigmaSpatial);
+    int size = 2 * radius + 1;
+    std::vector<float> spatialWeights(size * size);
+    for(int dy=-radius; dy<=radius; dy++)
+    {
+        for(int dx=-radius; dx<=radius; dx++)
+        {
+            spatialWeights[(dy + radius) * size + dx + radius] = std::exp(-(float)(dx * dx + dy * dy) / (2 * sigmaSpatial * sigmaSpatial));
+        }
+    }
+    float rangeFactor = -1.0f / (2 * sigmaRange * sigmaRange);
+
+    ParallelFor(0, height, [&](int y)
+    {
+        for(int x=0; x<width; x++)
+        {
+            glm::vec4 center = input.At(x, y);
+            float centerGray = RGBToGray(center);
+            glm::vec3 sum(0);
+            float weightSum=0;
+            for(int wy=(std::max)(y-radius, 0); wy<=(std::min)(y+radius, height-1); wy++)
+            {
+                const glm::vec4 *row = input.Row(wy);
+                const float *weights = spatialWeights.data() + (wy - y + radius) * size + radius - x;
+                for(int wx=(std::max)(x-radius, 0); wx<=(std::min)(x+radius, width-1); wx++)
+                {
+                    float difference = RGBToGray(row[wx]) - centerGray;
+                    float weight = weights[wx] * std::exp(difference * difference * rangeFactor);
+                    sum += glm::vec3(row[wx]) * weight;
+                    weightSum += weight;
+                }
+            }
+            output.At(x, y) = glm::vec4(sum / weightSum, center.a);
+        }
+    });
+}
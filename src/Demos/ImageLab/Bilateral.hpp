@@ -0,0 +1,39 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+//Bilateral filter on the gray scale of the image : each pixel is the average of the colors around it, weighted by a gaussian
+//of the distance (sigmaSpatial, in pixels) and a gaussian of the gray difference (sigmaRange). Alpha is copied.
+//The bilateral grid (Chen, Paris, Durand 2007) samples the (x, y, gray) space every sigma, splats the pixels in it
+//with trilinear weights, blurs it with a [1 4 6 4 1] / 16 kernel along each axis, and slices it back at each pixel.
+//The cost is linear in the number of pixels, and the grid gets smaller as sigmaSpatial grows.
+//The views can be crops or have padded rows, input and output must not overlap.
+struct BilateralGrid
+{
+    void Filter(const ConstImageView &input, const ImageView &output, float sigmaSpatial, float sigmaRange);
+    void Filter(const glm::vec4 *input, glm::vec4 *output, int width, int height, float sigmaSpatial, float sigmaRange)
+    {
+        Filter(ConstImageView(input, width, height), ImageView(output, width, height), sigmaSpatial, sigmaRange);
+    }
+
+    int gridWidth=0;
+    int gridHeight=0;
+    int gridDepth=0;
+    //Sum of the colors in rgb, sum of the weights in a
+    std::vector<glm::vec4> grid;
+
+    //Rows of the grid are stored one after the other, each as gridDepth slices of gridWidth cells
+    glm::vec4 &At(int x, int y, int z) { return grid[((size_t)y * gridDepth + z) * gridWidth + x]; }
+
+private:
+    std::vector<glm::vec4> blurred;
+    std::vector<float> grays;
+};
+
+//Direct evaluation over a window of 3 sigmaSpatial, for comparison with the grid. The cost grows with sigmaSpatial squared.
+void BilateralFilterReference(const ConstImageView &input, const ImageView &output, float sigmaSpatial, float sigmaRange);
+inline void BilateralFilterReference(const glm::vec4 *input, glm::vec4 *output, int width, int height, float sigmaSpatial, float sigmaRange)
+{
+    BilateralFilterReference(ConstImageView(input, width, height), ImageView(output, width, height), sigmaSpatial, sigmaRange);
+}
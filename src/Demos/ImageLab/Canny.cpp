@@ -0,0 +1,292 @@
+#include "Canny.hpp"
+#include "Parallel.hpp"
+#include "Color.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+//Direction of the gradient, quantized to the 4 pairs of neighbours compared by the non maximum suppression
+enum GradientDirection : uint8_t
+{
+    Horizontal=0,
+    Diagonal=1,     //Along (1, 1)
+    Vertical=2,
+    AntiDiagonal=3  //Along (1, -1)
+};
+
+//Rows y0 to y1 of the image, with their blurred gray scale, gradient and direction kept in ring buffers
+struct CannyBand
+{
+    ConstImageView input;
+    int width, height;
+    int radius;
+    const float *kernel;
+
+    //Horizontally blurred rows, 2 * radius + 1 of them
+    std::vector<float> horizontal;
+    std::vector<int> horizontalRows;
+    //Blurred rows padded by one pixel on each side for the Sobel operator, 3 of them
+    std::vector<float> blurred;
+    int blurredRows[3];
+    //Gradient magnitude and direction, 3 rows
+    std::vector<float> magnitude;
+    std::vector<uint8_t> direction;
+    std::vector<float> grayRow;
+    std::vector<float> zeros;
+
+    const float *HorizontalRow(int y)
+    {
+        int diameter = 2 * radius + 1;
+        int slot = y % diameter;
+        float *row = horizontal.data() + (size_t)slot * width;
+        if(horizontalRows[slot]==y) return row;
+        horizontalRows[slot] = y;
+
+        //Gray scale padded by the kernel radius with the edge pixels
+        const glm::vec4 *inRow = input.Row(y);
+        for(int x=-radius; x<width+radius; x++)
+        {
+            const glm::vec4 &pixel = inRow[(std::min)((std::max)(x, 0), width-1)];
+            grayRow[x + radius] = RGBToGray(pixel);
+        }
+        for(int x=0; x<width; x++)
+        {
+            const float *center = grayRow.data() + x + radius;
+            float sum = kernel[0] * center[0];
+            for(int i=1; i<=radius; i++) sum += kernel[i] * (center[-i] + center[i]);
+            row[x] = sum;
+        }
+        return row;
+    }
+
+    const float *BlurredRow(int y)
+    {
+        int slot = y % 3;
+        float *row = blurred.data() + (size_t)slot * (width+2);
+        if(blurredRows[slot]==y) return row;
+        blurredRows[slot] = y;
+
+        float *out = row + 1;
+        const float *center = HorizontalRow(y);
+        for(int x=0; x<width; x++) out[x] = kernel[0] * center[x];
+        for(int i=1; i<=radius; i++)
+        {
+            const float *above = HorizontalRow((std::max)(y-i, 0));
+            const float *below = HorizontalRow((std::min)(y+i, height-1));
+            float weight = kernel[i];
+            for(int x=0; x<width; x++) out[x] += weight * (above[x] + below[x]);
+        }
+        out[-1] = out[0];
+        out[width] = out[width-1];
+        return row;
+    }
+
+    //Sobel on the blurred rows, written to the magnitude and angle images when the row belongs to the band
+    void GradientRow(int y, float *outMagnitude, float *outAngle, float *outBlurred)
+    {
+        const float *above = BlurredRow((std::max)(y-1, 0)) + 1;
+        const float *center = BlurredRow(y) + 1;
+        const float *below = BlurredRow((std::min)(y+1, height-1)) + 1;
+        if(outBlurred) std::copy(center, center + width, outBlurred);
+
+        float *magnitudeRow = magnitude.data() + (size_t)(y % 3) * width;
+        uint8_t *directionRow = direction.data() + (size_t)(y % 3) * width;
+        const float tan22 = 0.41421356f;
+        for(int x=0; x<width; x++)
+        {
+            float dx = (above[x+1] + 2 * center[x+1] + below[x+1]) - (above[x-1] + 2 * center[x-1] + below[x-1]);
+            float dy = (below[x-1] + 2 * below[x] + below[x+1]) - (above[x-1] + 2 * above[x] + above[x+1]);
+            float m = std::sqrt(dx * dx + dy * dy);
+            magnitudeRow[x] = m;
+
+            float ax = std::abs(dx);
+            float ay = std::abs(dy);
+            if(ay <= tan22 * ax) directionRow[x] = Horizontal;
+            else if(ax <= tan22 * ay) directionRow[x] = Vertical;
+            else directionRow[x] = ((dx > 0) == (dy > 0)) ? Diagonal : AntiDiagonal;
+
+            if(outMagnitude)
+            {
+                outMagnitude[x] = m;
+                outAngle[x] = std::atan2(dy, dx);
+            }
+        }
+    }
+
+    const float *MagnitudeRow(int y)
+    {
+        if(y < 0 || y >= height) return zeros.data();
+        return magnitude.data() + (size_t)(y % 3) * width;
+    }
+
+    //Non maximum suppression and double threshold of row y, its neighbours outside the image have a magnitude of 0
+    void SuppressRow(int y, float lowThreshold, float highThreshold, uint8_t *outFlags)
+    {
+        const float *above = MagnitudeRow(y-1);
+        const float *center = MagnitudeRow(y);
+        const float *below = MagnitudeRow(y+1);
+        const uint8_t *directionRow = direction.data() + (size_t)(y % 3) * width;
+        for(int x=0; x<width; x++)
+        {
+            float left = (x > 0) ? center[x-1] : 0;
+            float right = (x < width-1) ? center[x+1] : 0;
+            float q, r;
+            switch(directionRow[x])
+            {
+            case Horizontal:
+                q = left;
+                r = right;
+                break;
+            case Diagonal:
+                q = (x > 0) ? above[x-1] : 0;
+                r = (x < width-1) ? below[x+1] : 0;
+                break;
+            case Vertical:
+                q = above[x];
+                r = below[x];
+                break;
+            default:
+                q = (x < width-1) ? above[x+1] : 0;
+                r = (x > 0) ? below[x-1] : 0;
+                break;
+            }
+
+            float m = center[x];
+            uint8_t flag=0;
+            if(m >= q && m >= r)
+            {
+                flag = CANNY_MAXIMUM;
+                if(m > highThreshold) flag |= CANNY_STRONG;
+                else if(m > lowThreshold) flag |= CANNY_WEAK;
+            }
+            outFlags[x] = flag;
+        }
+    }
+
+    void Process(int y0, int y1, float lowThreshold, float highThreshold, float *outMagnitude, float *outAngle, uint8_t *outFlags, float *outBlurred)
+    {
+        horizontal.resize((size_t)(2 * radius + 1) * width);
+        horizontalRows.assign(2 * radius + 1, -1);
+        blurred.resize((size_t)3 * (width+2));
+        blurredRows[0] = blurredRows[1] = blurredRows[2] = -1;
+        magnitude.resize((size_t)3 * width);
+        direction.resize((size_t)3 * width);
+        grayRow.resize(width + 2 * radius);
+        zeros.assign(width, 0);
+
+        //The suppression of a row needs the gradient of the rows around it, which may belong to the neighbouring bands
+        int first = (std::max)(y0-1, 0);
+        int last = (std::min)(y1, height-1);
+        for(int y=first; y<=last; y++)
+        {
+            bool inBand = y >= y0 && y < y1;
+            GradientRow(y, inBand ? outMagnitude + (size_t)y * width : nullptr, inBand ? outAngle + (size_t)y * width : nullptr,
+                        (inBand && outBlurred) ? outBlurred + (size_t)y * width : nullptr);
+            if(y-1 >= y0) SuppressRow(y-1, lowThreshold, highThreshold, outFlags + (size_t)(y-1) * width);
+        }
+        if(y1==height) SuppressRow(height-1, lowThreshold, highThreshold, outFlags + (size_t)(height-1) * width);
+    }
+};
+
+void CannyEdges::Detect(const ConstImageView &input, float sigma, float lowThreshold, float highThreshold, bool keepBlurred)
+{
+    int width = input.width;
+    int height = input.height;
+    this->width = width;
+    this->height = height;
+    size_t count = (size_t)width * height;
+    magnitude.resize(count);
+    angle.resize(count);
+    flags.resize(count);
+    if(keepBlurred) blurred.resize(count);
+    else blurred.clear();
+    if(width <= 0 || height <= 0) return;
+
+    //Half of a normalized gaussian kernel of size 2 * ceil(3 sigma) + 1
+    int radius = (int)std::ceil(3 * (std::max)(sigma, 0.01f));
+    radius = (std::min)(radius, (std::max)(width, height));
+    std::vector<float> kernel(radius+1);
+    float sum=0;
+    for(int i=0; i<=radius; i++)
+    {
+        kernel[i] = std::exp(-(float)(i * i) / (2 * sigma * sigma));
+        sum += (i==0) ? kernel[i] : 2 * kernel[i];
+    }
+    for(int i=0; i<=radius; i++) kernel[i] /= sum;
+
+    //Bands are large enough that recomputing the rows around them stays cheap
+    int numBands = (std::min)(GetNumThreads(), (height + 31) / 32);
+    auto BandStart = [&](int band)
+    {
+        return (int)((int64_t)height * band / numBands);
+    };
+
+    ParallelFor(0, numBands, [&](int band)
+    {
+        CannyBand cannyBand;
+        cannyBand.input = input;
+        cannyBand.width = width;
+        cannyBand.height = height;
+        cannyBand.radius = radius;
+        cannyBand.kernel = kernel.data();
+        cannyBand.Process(BandStart(band), BandStart(band+1), lowThreshold, highThreshold, magnitude.data(), angle.data(), flags.data(), keepBlurred ? blurred.data() : nullptr);
+    });
+
+    //Hysteresis. Each band only writes its own rows, the pixels reached in the other bands are passed on at the next round
+    std::vector<std::vector<size_t>> seeds(numBands);
+    std::vector<std::vector<size_t>> toPrevious(numBands);
+    std::vector<std::vector<size_t>> toNext(numBands);
+    bool first=true;
+    bool remaining=true;
+    while(remaining)
+    {
+        ParallelFor(0, numBands, [&](int band)
+        {
+            int y0 = BandStart(band);
+            int y1 = BandStart(band+1);
+            std::vector<size_t> &stack = seeds[band];
+            if(first)
+            {
+                for(size_t i=(size_t)y0 * width; i<(size_t)y1 * width; i++)
+                {
+                    if(flags[i] & CANNY_STRONG) stack.push_back(i);
+                }
+            }
+
+            while(!stack.empty())
+            {
+                size_t i = stack.back();
+                stack.pop_back();
+                if((flags[i] & CANNY_EDGE) || !(flags[i] & (CANNY_WEAK | CANNY_STRONG))) continue;
+                flags[i] |= CANNY_EDGE;
+
+                int x = (int)(i % width);
+                int y = (int)(i / width);
+                for(int ny=(std::max)(y-1, 0); ny<=(std::min)(y+1, height-1); ny++)
+                {
+                    for(int nx=(std::max)(x-1, 0); nx<=(std::min)(x+1, width-1); nx++)
+                    {
+                        size_t neighbour = (size_t)ny * width + nx;
+                        if(ny < y0) toPrevious[band].push_back(neighbour);
+                        else if(ny >= y1) toNext[band].push_back(neighbour);
+                        else if((flags[neighbour] & (CANNY_WEAK | CANNY_EDGE)) == CANNY_WEAK) stack.push_back(neighbour);
+                    }
+                }
+            }
+        });
+        first=false;
+
+        remaining=false;
+        for(int band=0; band<numBands; band++)
+        {
+            if(band > 0) seeds[band].insert(seeds[band].end(), toNext[band-1].begin(), toNext[band-1].end());
+            if(band < numBands-1) seeds[band].insert(seeds[band].end(), toPrevious[band+1].begin(), toPrevious[band+1].end());
+            remaining |= !seeds[band].empty();
+        }
+        for(int band=0; band<numBands; band++)
+        {
+            toPrevious[band].clear();
+            toNext[band].clear();
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+#include <stdint.h>
+
+//Bits of CannyEdges::flags
+#define CANNY_MAXIMUM 1
+#define CANNY_WEAK 2
+#define CANNY_STRONG 4
+#define CANNY_EDGE 8
+
+//Canny edge detector on the gray scale (average of RGB) of an image.
+//Each thread streams a band of rows through ring buffers of a few lines, so that the gaussian blur, the Sobel
+//gradient, the non maximum suppression and the double threshold are fused in a single pass without full size intermediates.
+//Hysteresis then grows the strong pixels through the connected weak ones, each band flood fills its own rows and
+//hands the pixels that cross its borders to the neighbouring bands, until no band has anything left to grow.
+struct CannyEdges
+{
+    //keepBlurred also fills blurred with the blurred gray scale the gradient is computed on.
+    //The input view can be a crop or have padded rows, the results are packed.
+    void Detect(const ConstImageView &input, float sigma, float lowThreshold, float highThreshold, bool keepBlurred=false);
+    void Detect(const glm::vec4 *input, int width, int height, float sigma, float lowThreshold, float highThreshold, bool keepBlurred=false)
+    {
+        Detect(ConstImageView(input, width, height), sigma, lowThreshold, highThreshold, keepBlurred);
+    }
+
+    bool IsEdge(int x, int y) const { return (flags[(size_t)y * width + x] & CANNY_EDGE) != 0; }
+
+    int width=0;
+    int height=0;
+    //Planar, width * height. The angle is atan2(dy, dx) of the gradient, in [-pi, pi]
+    std::vector<float> magnitude;
+    std::vector<float> angle;
+    std::vector<uint8_t> flags;
+    std::vector<float> blurred;
+};
@@ -0,0 +1,409 @@
+#include "Color.hpp"
+#include "Parallel.hpp"
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static float SRGBToLinearExact(float x)
+{
+    return (x <= 0.04045f) ? x / 12.92f : std::pow((x + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSRGBExact(float x)
+{
+    return (x <= 0.0031308f) ? x * 12.92f : 1.055f * std::pow(x, 1.0f / 2.4f) - 0.055f;
+}
+
+//f(t) of CIELAB, cube root with a linear segment near 0
+static float LabCurveExact(float t)
+{
+    const float delta = 6.0f / 29.0f;
+    return (t > delta * delta * delta) ? std::cbrt(t) : t / (3 * delta * delta) + 4.0f / 29.0f;
+}
+
+//Curve sampled on [0, range] and linearly interpolated, values outside of it are computed
+struct CurveTable
+{
+    CurveTable(float (*exact)(float), float range, int size=4096) : exact(exact), range(range), scale(size / range)
+    {
+        values.resize(size + 1);
+        for(int i=0; i<=size; i++) values[i] = exact(i / scale);
+    }
+
+    float Lookup(float x) const
+    {
+        if(!(x >= 0 && x < range)) return exact(x);
+        float position = x * scale;
+        int i = (int)position;
+        float t = position - i;
+        return values[i] + t * (values[i+1] - values[i]);
+    }
+
+    __m128 Lookup(__m128 x) const
+    {
+        float v[4];
+        _mm_storeu_ps(v, x);
+        for(int i=0; i<4; i++) v[i] = Lookup(v[i]);
+        return _mm_loadu_ps(v);
+    }
+
+    float (*exact)(float);
+    float range;
+    float scale;
+    std::vector<float> values;
+};
+
+static const CurveTable &SRGBToLinearTable()
+{
+    static CurveTable table(SRGBToLinearExact, 1);
+    return table;
+}
+
+static const CurveTable &LinearToSRGBTable()
+{
+    static CurveTable table(LinearToSRGBExact, 1);
+    return table;
+}
+
+static const CurveTable &LabCurveTable()
+{
+    static CurveTable table(LabCurveExact, 1.1f);
+    return table;
+}
+
+//Same channel of 4 pixels in each register
+struct ColorChannels
+{
+    __m128 x, y, z;
+};
+
+static inline __m128 Dot(const float *row, const ColorChannels &c)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(row[0]), c.x), _mm_mul_ps(_mm_set1_ps(row[1]), c.y)), _mm_mul_ps(_mm_set1_ps(row[2]), c.z));
+}
+
+static inline ColorChannels Multiply(const float matrix[3][3], const ColorChannels &c)
+{
+    return {Dot(matrix[0], c), Dot(matrix[1], c), Dot(matrix[2], c)};
+}
+
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 Clamp01(__m128 x)
+{
+    return _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1));
+}
+
+//sRGB to XYZ (D65), rows divided by the white point so that white maps to (1, 1, 1)
+static const float RGBToXYZ[3][3] =
+{
+    {0.4124564f / 0.95047f, 0.3575761f / 0.95047f, 0.1804375f / 0.95047f},
+    {0.2126729f,            0.7151522f,            0.0721750f},
+    {0.0193339f / 1.08883f, 0.1191920f / 1.08883f, 0.9503041f / 1.08883f}
+};
+
+static const float XYZToRGB[3][3] =
+{
+    { 3.2404542f * 0.95047f, -1.5371385f, -0.4985314f * 1.08883f},
+    {-0.9692660f * 0.95047f,  1.8760108f,  0.0415560f * 1.08883f},
+    { 0.0556434f * 0.95047f, -0.2040259f,  1.0572252f * 1.08883f}
+};
+
+static void RGBToHSV(ColorChannels &c)
+{
+    __m128 maximum = _mm_max_ps(c.x, _mm_max_ps(c.y, c.z));
+    __m128 minimum = _mm_min_ps(c.x, _mm_min_ps(c.y, c.z));
+    __m128 chroma = _mm_sub_ps(maximum, minimum);
+    __m128 zero = _mm_setzero_ps();
+    __m128 gray = _mm_cmple_ps(chroma, zero);
+    __m128 inverseChroma = _mm_div_ps(_mm_set1_ps(1), Select(gray, _mm_set1_ps(1), chroma));
+
+    //Sector of the hue given by the largest channel, red first
+    __m128 hueR = _mm_mul_ps(_mm_sub_ps(c.y, c.z), inverseChroma);
+    __m128 hueG = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(c.z, c.x), inverseChroma), _mm_set1_ps(2));
+    __m128 hueB = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(c.x, c.y), inverseChroma), _mm_set1_ps(4));
+    __m128 hue = Select(_mm_cmpeq_ps(maximum, c.x), hueR, Select(_mm_cmpeq_ps(maximum, c.y), hueG, hueB));
+    hue = _mm_mul_ps(hue, _mm_set1_ps(1.0f / 6.0f));
+    hue = _mm_add_ps(hue, _mm_and_ps(_mm_cmplt_ps(hue, zero), _mm_set1_ps(1)));
+    hue = _mm_andnot_ps(gray, hue);
+
+    __m128 positive = _mm_cmpgt_ps(maximum, zero);
+    __m128 saturation = _mm_and_ps(positive, _mm_div_ps(chroma, Select(positive, maximum, _mm_set1_ps(1))));
+    c = {hue, saturation, maximum};
+}
+
+static void HSVToRGB(ColorChannels &c)
+{
+    //Pure hue from the distance to each primary, then mixed with white and scaled by the value
+    __m128 h6 = _mm_mul_ps(c.x, _mm_set1_ps(6));
+    __m128 one = _mm_set1_ps(1);
+    __m128 two = _mm_set1_ps(2);
+    __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 r = Clamp01(_mm_sub_ps(_mm_and_ps(_mm_sub_ps(h6, _mm_set1_ps(3)), absMask), one));
+    __m128 g = Clamp01(_mm_sub_ps(two, _mm_and_ps(_mm_sub_ps(h6, two), absMask)));
+    __m128 b = Clamp01(_mm_sub_ps(two, _mm_and_ps(_mm_sub_ps(h6, _mm_set1_ps(4)), absMask)));
+    auto Mix = [&](__m128 hue)
+    {
+        return _mm_mul_ps(c.z, _mm_sub_ps(one, _mm_mul_ps(c.y, _mm_sub_ps(one, hue))));
+    };
+    c = {Mix(r), Mix(g), Mix(b)};
+}
+
+static void RGBToYCbCr(ColorChannels &c)
+{
+    static const float matrix[3][3] =
+    {
+        { 0.299f,     0.587f,     0.114f},
+        {-0.168736f, -0.331264f,  0.5f},
+        { 0.5f,      -0.418688f, -0.081312f}
+    };
+    c = Multiply(matrix, c);
+    c.y = _mm_add_ps(c.y, _mm_set1_ps(0.5f));
+    c.z = _mm_add_ps(c.z, _mm_set1_ps(0.5f));
+}
+
+static void YCbCrToRGB(ColorChannels &c)
+{
+    static const float matrix[3][3] =
+    {
+        {1,  0,          1.402f},
+        {1, -0.344136f, -0.714136f},
+        {1,  1.772f,     0}
+    };
+    c.y = _mm_sub_ps(c.y, _mm_set1_ps(0.5f));
+    c.z = _mm_sub_ps(c.z, _mm_set1_ps(0.5f));
+    c = Multiply(matrix, c);
+}
+
+static void RGBToLab(ColorChannels &c)
+{
+    const CurveTable &toLinear = SRGBToLinearTable();
+    const CurveTable &curve = LabCurveTable();
+    ColorChannels linear = {toLinear.Lookup(c.x), toLinear.Lookup(c.y), toLinear.Lookup(c.z)};
+    ColorChannels xyz = Multiply(RGBToXYZ, linear);
+    __m128 fx = curve.Lookup(xyz.x);
+    __m128 fy = curve.Lookup(xyz.y);
+    __m128 fz = curve.Lookup(xyz.z);
+    c.x = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(116), fy), _mm_set1_ps(16));
+    c.y = _mm_mul_ps(_mm_set1_ps(500), _mm_sub_ps(fx, fy));
+    c.z = _mm_mul_ps(_mm_set1_ps(200), _mm_sub_ps(fy, fz));
+}
+
+static void LabToRGB(ColorChannels &c)
+{
+    __m128 fy = _mm_mul_ps(_mm_add_ps(c.x, _mm_set1_ps(16)), _mm_set1_ps(1.0f / 116.0f));
+    __m128 fx = _mm_add_ps(fy, _mm_mul_ps(c.y, _mm_set1_ps(1.0f / 500.0f)));
+    __m128 fz = _mm_sub_ps(fy, _mm_mul_ps(c.z, _mm_set1_ps(1.0f / 200.0f)));
+
+    //Inverse of the Lab curve is a polynomial, no need for a table
+    const float delta = 6.0f / 29.0f;
+    auto InverseCurve = [&](__m128 f)
+    {
+        __m128 cube = _mm_mul_ps(_mm_mul_ps(f, f), f);
+        __m128 linear = _mm_mul_ps(_mm_set1_ps(3 * delta * delta), _mm_sub_ps(f, _mm_set1_ps(4.0f / 29.0f)));
+        return Select(_mm_cmpgt_ps(f, _mm_set1_ps(delta)), cube, linear);
+    };
+    ColorChannels xyz = {InverseCurve(fx), InverseCurve(fy), InverseCurve(fz)};
+    ColorChannels linear = Multiply(XYZToRGB, xyz);
+
+    const CurveTable &toSRGB = LinearToSRGBTable();
+    c = {toSRGB.Lookup(linear.x), toSRGB.Lookup(linear.y), toSRGB.Lookup(linear.z)};
+}
+
+static void ToRGB(ColorChannels &c, ColorSpace from)
+{
+    switch(from)
+    {
+    case ColorSpace::Gray:
+        c.y = c.z = c.x;
+        break;
+    case ColorSpace::HSV:
+        HSVToRGB(c);
+        break;
+    case ColorSpace::YCbCr:
+        YCbCrToRGB(c);
+        break;
+    case ColorSpace::LinearRGB:
+    {
+        const CurveTable &toSRGB = LinearToSRGBTable();
+        c = {toSRGB.Lookup(c.x), toSRGB.Lookup(c.y), toSRGB.Lookup(c.z)};
+        break;
+    }
+    case ColorSpace::Lab:
+        LabToRGB(c);
+        break;
+    default:
+        break;
+    }
+}
+
+static void FromRGB(ColorChannels &c, ColorSpace to)
+{
+    switch(to)
+    {
+    case ColorSpace::Gray:
+        c.x = c.y = c.z = _mm_mul_ps(_mm_add_ps(_mm_add_ps(c.x, c.y), c.z), _mm_set1_ps(0.33333f));
+        break;
+    case ColorSpace::HSV:
+        RGBToHSV(c);
+        break;
+    case ColorSpace::YCbCr:
+        RGBToYCbCr(c);
+        break;
+    case ColorSpace::LinearRGB:
+    {
+        const CurveTable &toLinear = SRGBToLinearTable();
+        c = {toLinear.Lookup(c.x), toLinear.Lookup(c.y), toLinear.Lookup(c.z)};
+        break;
+    }
+    case ColorSpace::Lab:
+        RGBToLab(c);
+        break;
+    default:
+        break;
+    }
+}
+
+static inline void Convert(ColorChannels &c, ColorSpace from, ColorSpace to)
+{
+    ToRGB(c, from);
+    FromRGB(c, to);
+}
+
+glm::vec3 ConvertColor(const glm::vec3 &color, ColorSpace from, ColorSpace to)
+{
+    ColorChannels c = {_mm_set1_ps(color.x), _mm_set1_ps(color.y), _mm_set1_ps(color.z)};
+    Convert(c, from, to);
+    return glm::vec3(_mm_cvtss_f32(c.x), _mm_cvtss_f32(c.y), _mm_cvtss_f32(c.z));
+}
+
+//4 interleaved pixels, transposed to channels and back
+static inline void ConvertPixels(const glm::vec4 *input, glm::vec4 *output, ColorSpace from, ColorSpace to)
+{
+    __m128 p0 = _mm_loadu_ps(&input[0].x);
+    __m128 p1 = _mm_loadu_ps(&input[1].x);
+    __m128 p2 = _mm_loadu_ps(&input[2].x);
+    __m128 p3 = _mm_loadu_ps(&input[3].x);
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    ColorChannels c = {p0, p1, p2};
+    Convert(c, from, to);
+    p0 = c.x;
+    p1 = c.y;
+    p2 = c.z;
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    _mm_storeu_ps(&output[0].x, p0);
+    _mm_storeu_ps(&output[1].x, p1);
+    _mm_storeu_ps(&output[2].x, p2);
+    _mm_storeu_ps(&output[3].x, p3);
+}
+
+//On the calling thread : whole groups of 8 pixels, the remaining ones go through a padded copy
+static void ConvertSpan(const glm::vec4 *input, glm::vec4 *output, size_t count, ColorSpace from, ColorSpace to)
+{
+    if(from==to)
+    {
+        if(input != output) std::copy(input, input + count, output);
+        return;
+    }
+
+    size_t done=0;
+    for(; done+8<=count; done+=8)
+    {
+        ConvertPixels(input + done, output + done, from, to);
+        ConvertPixels(input + done + 4, output + done + 4, from, to);
+    }
+    if(done < count)
+    {
+        glm::vec4 tail[8];
+        std::fill(tail, tail + 8, glm::vec4(0));
+        std::copy(input + done, input + count, tail);
+        ConvertPixels(tail, tail, from, to);
+        ConvertPixels(tail + 4, tail + 4, from, to);
+        std::copy(tail, tail + (count - done), output + done);
+    }
+}
+
+void ConvertColors(const glm::vec4 *input, glm::vec4 *output, size_t count, ColorSpace from, ColorSpace to)
+{
+    if(from==to)
+    {
+        if(input != output) std::copy(input, input + count, output);
+        return;
+    }
+
+    //Whole groups of 8 pixels, the remaining ones go through a padded copy
+    int numGroups = (int)(count / 8);
+    ParallelForChunks(0, numGroups, [&](int start, int end)
+    {
+        for(int group=start; group<end; group++)
+        {
+            size_t i = (size_t)group * 8;
+            ConvertPixels(input + i, output + i, from, to);
+            ConvertPixels(input + i + 4, output + i + 4, from, to);
+        }
+    }, 512);
+
+    size_t done = (size_t)numGroups * 8;
+    if(done < count) ConvertSpan(input + done, output + done, count - done, from, to);
+}
+
+void ConvertColors(const ConstImageView &input, const ImageView &output, ColorSpace from, ColorSpace to)
+{
+    if(input.IsPacked() && output.IsPacked())
+    {
+        ConvertColors(input.pixels, output.pixels, input.NumPixels(), from, to);
+        return;
+    }
+
+    ParallelForChunks(0, input.height, [&](int start, int end)
+    {
+        for(int y=start; y<end; y++) ConvertSpan(input.Row(y), output.Row(y), (size_t)input.width, from, to);
+    }, (std::max)(1, 4096 / (std::max)(input.width, 1)));
+}
+
+static inline void ConvertPlanarPixels(const float *const input[3], float *const output[3], size_t i, ColorSpace from, ColorSpace to)
+{
+    ColorChannels c = {_mm_loadu_ps(input[0] + i), _mm_loadu_ps(input[1] + i), _mm_loadu_ps(input[2] + i)};
+    Convert(c, from, to);
+    _mm_storeu_ps(output[0] + i, c.x);
+    _mm_storeu_ps(output[1] + i, c.y);
+    _mm_storeu_ps(output[2] + i, c.z);
+}
+
+void ConvertColorsPlanar(const float *const input[3], float *const output[3], size_t count, ColorSpace from, ColorSpace to)
+{
+    if(from==to)
+    {
+        for(int c=0; c<3; c++) if(input[c] != output[c]) std::copy(input[c], input[c] + count, output[c]);
+        return;
+    }
+
+    int numGroups = (int)(count / 8);
+    ParallelForChunks(0, numGroups, [&](int start, int end)
+    {
+        for(int group=start; group<end; group++)
+        {
+            size_t i = (size_t)group * 8;
+            ConvertPlanarPixels(input, output, i, from, to);
+            ConvertPlanarPixels(input, output, i + 4, from, to);
+        }
+    }, 512);
+
+    size_t done = (size_t)numGroups * 8;
+    if(done < count)
+    {
+        float tail[3][8] = {};
+        for(int c=0; c<3; c++) std::copy(input[c] + done, input[c] + count, tail[c]);
+        const float *tailInput[3] = {tail[0], tail[1], tail[2]};
+        float *tailOutput[3] = {tail[0], tail[1], tail[2]};
+        ConvertPlanarPixels(tailInput, tailOutput, 0, from, to);
+        ConvertPlanarPixels(tailInput, tailOutput, 4, from, to);
+        for(int c=0; c<3; c++) std::copy(tail[c], tail[c] + (count - done), output[c] + done);
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <cstddef>
+
+//RGB is the sRGB encoded color stored in the textures, every other space is converted from it.
+//Gray is the average of the channels, HSV and YCbCr (BT.601, full range) are in [0, 1],
+//Lab is CIELAB with the D65 white point, L in [0, 100].
+enum class ColorSpace
+{
+    RGB=0,
+    Gray=1,
+    HSV=2,
+    YCbCr=3,
+    LinearRGB=4,
+    Lab=5
+};
+
+//Typical extent of the channels, for thresholds on distances that should not depend on the space
+inline float ColorSpaceScale(ColorSpace space)
+{
+    return (space==ColorSpace::Lab) ? 100.0f : 1.0f;
+}
+
+inline float RGBToGray(const glm::vec3 &color)
+{
+    return (color.r + color.g + color.b) * 0.33333f;
+}
+
+//Converting to Gray sets the three channels to the gray value.
+//The sRGB and Lab curves are read from tables built on first use, and computed exactly outside of the tables.
+glm::vec3 ConvertColor(const glm::vec3 &color, ColorSpace from, ColorSpace to);
+
+//Whole image conversions, in parallel and 8 pixels per iteration. Alpha is copied as is, output may be input.
+void ConvertColors(const glm::vec4 *input, glm::vec4 *output, size_t count, ColorSpace from, ColorSpace to);
+//Row by row, for crops and padded rows
+void ConvertColors(const ConstImageView &input, const ImageView &output, ColorSpace from, ColorSpace to);
+//Same with each channel in its own array
+void ConvertColorsPlanar(const float *const input[3], float *const output[3], size_t count, ColorSpace from, ColorSpace to);
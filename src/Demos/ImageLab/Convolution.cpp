@@ -0,0 +1,482 @@
+#include "Convolution.hpp"
+#include "Parallel.hpp"
+
+#include <fftw3.h>
+#include <xmmintrin.h>
+#include <mutex>
+#include <cmath>
+#include <algorithm>
+
+//The fftw planner is not thread safe, plan execution is.
+static std::mutex fftwPlannerMutex;
+
+struct ConvolutionFFTCache
+{
+    struct Entry
+    {
+        int sizeX, sizeY;
+        fftw_plan forwardPlan;
+        fftw_plan inversePlan;
+        fftw_complex *kernelSpectrum;
+    };
+    std::vector<Entry> entries;
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(fftwPlannerMutex);
+        for(size_t i=0; i<entries.size(); i++)
+        {
+            fftw_destroy_plan(entries[i].forwardPlan);
+            fftw_destroy_plan(entries[i].inversePlan);
+            fftw_free(entries[i].kernelSpectrum);
+        }
+        entries.clear();
+    }
+
+    ~ConvolutionFFTCache()
+    {
+        Clear();
+    }
+};
+
+const char *ConvolutionMethodName(ConvolutionMethod method)
+{
+    switch (method)
+    {
+    case ConvolutionMethod::Auto: return "Auto";
+    case ConvolutionMethod::Direct: return "Direct";
+    case ConvolutionMethod::Separable: return "Separable";
+    case ConvolutionMethod::FFT: return "FFT";
+    }
+    return "";
+}
+
+//dst[x] += weight * src[clamp(x + offset)]
+static void AccumulateShiftedRow(glm::vec4 *dst, const glm::vec4 *src, int width, int offset, float weight)
+{
+    __m128 w = _mm_set1_ps(weight);
+    int start = (std::min)(width, (std::max)(0, -offset));
+    int end = (std::max)(start, (std::min)(width, width - offset));
+
+    __m128 first = _mm_mul_ps(w, _mm_loadu_ps(&src[0].x));
+    for(int x=0; x<start; x++)
+    {
+        _mm_storeu_ps(&dst[x].x, _mm_add_ps(_mm_loadu_ps(&dst[x].x), first));
+    }
+
+    const glm::vec4 *shiftedSrc = src + offset;
+    for(int x=start; x<end; x++)
+    {
+        __m128 s = _mm_loadu_ps(&shiftedSrc[x].x);
+        _mm_storeu_ps(&dst[x].x, _mm_add_ps(_mm_loadu_ps(&dst[x].x), _mm_mul_ps(w, s)));
+    }
+
+    __m128 last = _mm_mul_ps(w, _mm_loadu_ps(&src[width-1].x));
+    for(int x=end; x<width; x++)
+    {
+        _mm_storeu_ps(&dst[x].x, _mm_add_ps(_mm_loadu_ps(&dst[x].x), last));
+    }
+}
+
+ConvolutionEngine::ConvolutionEngine()
+{
+    fftCache = std::make_shared<ConvolutionFFTCache>();
+}
+
+void ConvolutionEngine::SetKernel(const float *newKernel, int newSizeX, int newSizeY)
+{
+    bool same = (newSizeX == sizeX && newSizeY == sizeY);
+    for(int i=0; same && i<sizeX * sizeY; i++)
+    {
+        same = (kernel[i] == newKernel[i]);
+    }
+    if(same) return;
+
+    sizeX = newSizeX;
+    sizeY = newSizeY;
+    kernel.assign(newKernel, newKernel + sizeX * sizeY);
+
+    //Copies of the engine would share the cache, give this one its own
+    fftCache = std::make_shared<ConvolutionFFTCache>();
+
+    Decompose();
+}
+
+void ConvolutionEngine::Decompose()
+{
+    separableTerms.clear();
+    separable=false;
+
+    std::vector<double> residual(kernel.begin(), kernel.end());
+    double energy=0;
+    for(size_t i=0; i<residual.size(); i++) energy += residual[i] * residual[i];
+    if(energy==0)
+    {
+        separable=true;
+        return;
+    }
+
+    //Deflation : extract the dominant singular triplet of the residual with power iterations on R^T R,
+    //until the residual energy is small enough.
+    std::vector<double> u(sizeY), v(sizeX), tmp(sizeX);
+    for(int rank=0; rank < maxRank; rank++)
+    {
+        for(int i=0; i<sizeX; i++) v[i] = 1.0 + 0.01 * i;
+
+        double sigma=0;
+        for(int iteration=0; iteration<200; iteration++)
+        {
+            //u = R v
+            for(int y=0; y<sizeY; y++)
+            {
+                double sum=0;
+                for(int x=0; x<sizeX; x++) sum += residual[y * sizeX + x] * v[x];
+                u[y] = sum;
+            }
+            //v = R^T u
+            std::fill(tmp.begin(), tmp.end(), 0.0);
+            for(int y=0; y<sizeY; y++)
+            {
+                for(int x=0; x<sizeX; x++) tmp[x] += residual[y * sizeX + x] * u[y];
+            }
+            double norm=0;
+            for(int x=0; x<sizeX; x++) norm += tmp[x] * tmp[x];
+            norm = sqrt(norm);
+            if(norm == 0) break;
+
+            double change=0;
+            for(int x=0; x<sizeX; x++)
+            {
+                double newV = tmp[x] / norm;
+                change += std::abs(newV - v[x]);
+                v[x] = newV;
+            }
+            if(change < 1e-12) break;
+        }
+
+        //sigma u = R v
+        for(int y=0; y<sizeY; y++)
+        {
+            double sum=0;
+            for(int x=0; x<sizeX; x++) sum += residual[y * sizeX + x] * v[x];
+            u[y] = sum;
+            sigma += sum * sum;
+        }
+        sigma = sqrt(sigma);
+        if(sigma==0) break;
+
+        SeparableTerm term;
+        term.row.resize(sizeX);
+        term.column.resize(sizeY);
+        double sqrtSigma = sqrt(sigma);
+        for(int x=0; x<sizeX; x++) term.row[x] = (float)(v[x] * sqrtSigma);
+        for(int y=0; y<sizeY; y++) term.column[y] = (float)(u[y] / sqrtSigma);
+        separableTerms.push_back(term);
+
+        double residualEnergy=0;
+        for(int y=0; y<sizeY; y++)
+        {
+            for(int x=0; x<sizeX; x++)
+            {
+                residual[y * sizeX + x] -= u[y] * v[x];
+                residualEnergy += residual[y * sizeX + x] * residual[y * sizeX + x];
+            }
+        }
+
+        if(residualEnergy <= separableTolerance * separableTolerance * energy)
+        {
+            separable=true;
+            break;
+        }
+    }
+
+    if(!separable) separableTerms.clear();
+}
+
+//Rough costs per pixel, in units of a 4 channel multiply add
+float ConvolutionEngine::FFTCost(int width, int height, int numChannels, int &bestSizeX, int &bestSizeY)
+{
+    //Tiles must be at least twice the kernel size so that only neighbouring tiles overlap
+    auto BestSize = [](int imageSize, int kernelSize)
+    {
+        int minSize = (std::max)(16, 2 * kernelSize);
+        int bestSize = minSize;
+        float bestCost = 1e30f;
+        for(int n=16; n < 2 * (imageSize + 2 * kernelSize); n*=2)
+        {
+            if(n < minSize) continue;
+            int blockSize = n - kernelSize + 1;
+            int numTiles = (imageSize + kernelSize - 1 + blockSize-1) / blockSize;
+            float cost = (float)numTiles * (float)n * std::log2((float)n);
+            if(cost < bestCost)
+            {
+                bestCost = cost;
+                bestSize = n;
+            }
+        }
+        return bestSize;
+    };
+    bestSizeX = BestSize(width, sizeX);
+    bestSizeY = BestSize(height, sizeY);
+
+    int blockSizeX = bestSizeX - sizeX + 1;
+    int blockSizeY = bestSizeY - sizeY + 1;
+    int numTiles = ((width + sizeX - 1 + blockSizeX-1) / blockSizeX) * ((height + sizeY - 1 + blockSizeY-1) / blockSizeY);
+    float n = (float)bestSizeX * (float)bestSizeY;
+
+    //Forward and inverse real transforms + spectrum product + tile copies, for each channel
+    float tileCost = numChannels * (1.25f * n * std::log2(n) + 3.5f * n);
+    return numTiles * tileCost / (float)(width * height);
+}
+
+ConvolutionMethod ConvolutionEngine::ChooseMethod(int width, int height, int numChannels)
+{
+    if(method == ConvolutionMethod::Direct || method == ConvolutionMethod::FFT) return method;
+    if(method == ConvolutionMethod::Separable && separable) return method;
+
+    float directCost = (float)(sizeX * sizeY);
+    float separableCost = separable ? (float)(separableTerms.size() * (sizeX + sizeY + 2)) : 1e30f;
+    float fftCost = FFTCost(width, height, numChannels, fftSizeX, fftSizeY);
+
+    if(directCost <= separableCost && directCost <= fftCost) return ConvolutionMethod::Direct;
+    if(separableCost <= fftCost) return ConvolutionMethod::Separable;
+    return ConvolutionMethod::FFT;
+}
+
+void ConvolutionEngine::Convolve(const ConstImageView &input, const ImageView &output, int numChannels)
+{
+    if(sizeX==0 || sizeY==0 || input.Empty()) return;
+    int width = input.width;
+    int height = input.height;
+
+    lastMethod = ChooseMethod(width, height, numChannels);
+    if(lastMethod==ConvolutionMethod::Direct) ConvolveDirect(input, output);
+    else if(lastMethod==ConvolutionMethod::Separable) ConvolveSeparable(input, output);
+    else ConvolveFFT(input, output, numChannels);
+
+    //Channels that are not convolved are passed through
+    if(numChannels < 4)
+    {
+        ParallelFor(0, height, [&](int y)
+        {
+            const glm::vec4 *inputRow = input.Row(y);
+            glm::vec4 *outputRow = output.Row(y);
+            for(int x=0; x<width; x++)
+            {
+                for(int c=numChannels; c<4; c++) outputRow[x][c] = inputRow[x][c];
+            }
+        }, 16);
+    }
+}
+
+void ConvolutionEngine::ConvolveDirect(const ConstImageView &input, const ImageView &output)
+{
+    int width = input.width;
+    int height = input.height;
+    int halfSizeX = sizeX/2;
+    int halfSizeY = sizeY/2;
+    ParallelFor(0, height, [&](int y)
+    {
+        glm::vec4 *outputRow = output.Row(y);
+        std::fill(outputRow, outputRow + width, glm::vec4(0));
+        for(int j=0; j<sizeY; j++)
+        {
+            const glm::vec4 *inputRow = input.ClampedRow(y + j - halfSizeY);
+            for(int i=0; i<sizeX; i++)
+            {
+                float weight = kernel[j * sizeX + i];
+                if(weight==0) continue;
+                AccumulateShiftedRow(outputRow, inputRow, width, i - halfSizeX, weight);
+            }
+        }
+    }, 4);
+}
+
+void ConvolutionEngine::ConvolveSeparable(const ConstImageView &input, const ImageView &output)
+{
+    int width = input.width;
+    int height = input.height;
+    int halfSizeX = sizeX/2;
+    int halfSizeY = sizeY/2;
+    tmpData.resize((size_t)width * height);
+
+    ParallelFor(0, height, [&](int y)
+    {
+        std::fill(output.Row(y), output.Row(y) + width, glm::vec4(0));
+    }, 16);
+
+    for(size_t t=0; t<separableTerms.size(); t++)
+    {
+        const SeparableTerm &term = separableTerms[t];
+
+        //Horizontal pass
+        ParallelFor(0, height, [&](int y)
+        {
+            glm::vec4 *tmpRow = tmpData.data() + (size_t)y * width;
+            const glm::vec4 *inputRow = input.Row(y);
+            std::fill(tmpRow, tmpRow + width, glm::vec4(0));
+            for(int i=0; i<sizeX; i++)
+            {
+                if(term.row[i]==0) continue;
+                AccumulateShiftedRow(tmpRow, inputRow, width, i - halfSizeX, term.row[i]);
+            }
+        }, 4);
+
+        //Vertical pass, accumulated in the output
+        ParallelFor(0, height, [&](int y)
+        {
+            glm::vec4 *outputRow = output.Row(y);
+            for(int j=0; j<sizeY; j++)
+            {
+                if(term.column[j]==0) continue;
+                int sourceY = glm::clamp(y + j - halfSizeY, 0, height-1);
+                AccumulateShiftedRow(outputRow, tmpData.data() + (size_t)sourceY * width, width, 0, term.column[j]);
+            }
+        }, 4);
+    }
+}
+
+void ConvolutionEngine::ConvolveFFT(const ConstImageView &input, const ImageView &output, int numChannels)
+{
+    int width = input.width;
+    int height = input.height;
+    FFTCost(width, height, numChannels, fftSizeX, fftSizeY);
+    int nx = fftSizeX;
+    int ny = fftSizeY;
+    int spectrumWidth = nx/2+1;
+    double normalization = 1.0 / ((double)nx * (double)ny);
+
+    //Find or create the plans and the kernel spectrum for this tile size
+    ConvolutionFFTCache::Entry *entry=nullptr;
+    for(size_t i=0; i<fftCache->entries.size(); i++)
+    {
+        if(fftCache->entries[i].sizeX == nx && fftCache->entries[i].sizeY == ny) entry = &fftCache->entries[i];
+    }
+    if(entry==nullptr)
+    {
+        double *realData = (double*) fftw_malloc(sizeof(double) * nx * ny);
+        fftw_complex *complexData = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * ny * spectrumWidth);
+
+        ConvolutionFFTCache::Entry newEntry;
+        newEntry.sizeX = nx;
+        newEntry.sizeY = ny;
+        newEntry.kernelSpectrum = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * ny * spectrumWidth);
+        {
+            std::lock_guard<std::mutex> lock(fftwPlannerMutex);
+            newEntry.forwardPlan = fftw_plan_dft_r2c_2d(ny, nx, realData, complexData, FFTW_ESTIMATE);
+            newEntry.inversePlan = fftw_plan_dft_c2r_2d(ny, nx, complexData, realData, FFTW_ESTIMATE);
+        }
+
+        //Correlation is a convolution with the flipped kernel. Normalization of the inverse transform is folded in.
+        std::fill(realData, realData + nx * ny, 0.0);
+        for(int j=0; j<sizeY; j++)
+        {
+            for(int i=0; i<sizeX; i++)
+            {
+                realData[j * nx + i] = kernel[(sizeY-1-j) * sizeX + (sizeX-1-i)] * normalization;
+            }
+        }
+        fftw_execute_dft_r2c(newEntry.forwardPlan, realData, newEntry.kernelSpectrum);
+
+        fftw_free(realData);
+        fftw_free(complexData);
+        fftCache->entries.push_back(newEntry);
+        entry = &fftCache->entries.back();
+    }
+
+    //Overlap-add : the clamped padded image is cut into blocks, each block is convolved in a tile of size nx * ny
+    //and accumulated in the output. Blocks are at least kernel size wide, so only neighbouring tiles overlap,
+    //and tiles with the same (x%2, y%2) parity can be processed in parallel.
+    int halfSizeX = sizeX/2;
+    int halfSizeY = sizeY/2;
+    int paddedWidth = width + sizeX - 1;
+    int paddedHeight = height + sizeY - 1;
+    int blockSizeX = nx - sizeX + 1;
+    int blockSizeY = ny - sizeY + 1;
+    int numTilesX = (paddedWidth + blockSizeX-1) / blockSizeX;
+    int numTilesY = (paddedHeight + blockSizeY-1) / blockSizeY;
+
+    ParallelFor(0, height, [&](int y)
+    {
+        glm::vec4 *outputRow = output.Row(y);
+        for(int x=0; x<width; x++)
+        {
+            for(int c=0; c<numChannels; c++) outputRow[x][c] = 0;
+        }
+    }, 16);
+
+    const fftw_complex *kernelSpectrum = entry->kernelSpectrum;
+    fftw_plan forwardPlan = entry->forwardPlan;
+    fftw_plan inversePlan = entry->inversePlan;
+
+    for(int parity=0; parity<4; parity++)
+    {
+        std::vector<glm::ivec2> tiles;
+        for(int ty=parity/2; ty<numTilesY; ty+=2)
+        {
+            for(int tx=parity%2; tx<numTilesX; tx+=2)
+            {
+                tiles.push_back(glm::ivec2(tx, ty));
+            }
+        }
+
+        ParallelForChunks(0, (int)tiles.size(), [&](int start, int end)
+        {
+            double *realData = (double*) fftw_malloc(sizeof(double) * nx * ny);
+            fftw_complex *complexData = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * ny * spectrumWidth);
+
+            for(int t=start; t<end; t++)
+            {
+                int blockX = tiles[t].x * blockSizeX;
+                int blockY = tiles[t].y * blockSizeY;
+                int blockWidth = (std::min)(blockSizeX, paddedWidth - blockX);
+                int blockHeight = (std::min)(blockSizeY, paddedHeight - blockY);
+
+                for(int c=0; c<numChannels; c++)
+                {
+                    std::fill(realData, realData + nx * ny, 0.0);
+                    for(int j=0; j<blockHeight; j++)
+                    {
+                        const glm::vec4 *inputRow = input.ClampedRow(blockY + j - halfSizeY);
+                        double *tileRow = realData + j * nx;
+                        for(int i=0; i<blockWidth; i++)
+                        {
+                            int sourceX = glm::clamp(blockX + i - halfSizeX, 0, width-1);
+                            tileRow[i] = inputRow[sourceX][c];
+                        }
+                    }
+
+                    fftw_execute_dft_r2c(forwardPlan, realData, complexData);
+                    for(int i=0; i<ny * spectrumWidth; i++)
+                    {
+                        double re = complexData[i][0] * kernelSpectrum[i][0] - complexData[i][1] * kernelSpectrum[i][1];
+                        double im = complexData[i][0] * kernelSpectrum[i][1] + complexData[i][1] * kernelSpectrum[i][0];
+                        complexData[i][0] = re;
+                        complexData[i][1] = im;
+                    }
+                    fftw_execute_dft_c2r(inversePlan, complexData, realData);
+
+                    //Full convolution sample u maps to output pixel u - (size-1)
+                    int resultWidth = blockWidth + sizeX - 1;
+                    int resultHeight = blockHeight + sizeY - 1;
+                    for(int j=0; j<resultHeight; j++)
+                    {
+                        int outputY = blockY + j - (sizeY - 1);
+                        if(outputY < 0 || outputY >= height) continue;
+                        glm::vec4 *outputRow = output.Row(outputY);
+                        const double *tileRow = realData + j * nx;
+                        for(int i=0; i<resultWidth; i++)
+                        {
+                            int outputX = blockX + i - (sizeX - 1);
+                            if(outputX < 0 || outputX >= width) continue;
+                            outputRow[outputX][c] += (float)tileRow[i];
+                        }
+                    }
+                }
+            }
+
+            fftw_free(realData);
+            fftw_free(complexData);
+        });
+    }
+}
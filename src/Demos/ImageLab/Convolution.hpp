@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <glm/glm.hpp>
+#include "ImageView.hpp"
+
+enum class ConvolutionMethod
+{
+    Auto=0,
+    Direct=1,
+    Separable=2,
+    FFT=3
+};
+
+struct ConvolutionFFTCache;
+
+//CPU 2D correlation with clamp to edge borders, same convention as the filter shaders :
+//output(x, y) = sum kernel[j * sizeX + i] * input(x + i - sizeX/2, y + j - sizeY/2)
+//
+//When the kernel is set, it is decomposed into a sum of separable terms using its singular vectors.
+//At evaluation, a cost model picks between :
+//  Direct    : sizeX * sizeY operations per pixel
+//  Separable : rank * (sizeX + sizeY) operations per pixel
+//  FFT       : overlap-add of FFT tiles, roughly constant per pixel for any kernel size
+struct ConvolutionEngine
+{
+    ConvolutionEngine();
+
+    void SetKernel(const float *kernel, int sizeX, int sizeY);
+    //The views can be crops or have padded rows, input and output must not overlap
+    void Convolve(const ConstImageView &input, const ImageView &output, int numChannels=3);
+    void Convolve(const glm::vec4 *input, glm::vec4 *output, int width, int height, int numChannels=3)
+    {
+        Convolve(ConstImageView(input, width, height), ImageView(output, width, height), numChannels);
+    }
+
+    ConvolutionMethod ChooseMethod(int width, int height, int numChannels=3);
+
+    //Forced method, or Auto to use the cost model
+    ConvolutionMethod method = ConvolutionMethod::Auto;
+    //Method used by the last call to Convolve
+    ConvolutionMethod lastMethod = ConvolutionMethod::Direct;
+
+    int sizeX=0;
+    int sizeY=0;
+    std::vector<float> kernel;
+
+    //Separable decomposition : kernel = sum(columns[i] * rows[i]^T)
+    struct SeparableTerm
+    {
+        std::vector<float> row;
+        std::vector<float> column;
+    };
+    std::vector<SeparableTerm> separableTerms;
+    bool separable=false;
+    int maxRank = 4;
+    float separableTolerance = 1e-4f;
+
+    //FFT tile size picked by the last call
+    int fftSizeX=0;
+    int fftSizeY=0;
+
+private:
+    void Decompose();
+    float FFTCost(int width, int height, int numChannels, int &bestSizeX, int &bestSizeY);
+
+    void ConvolveDirect(const ConstImageView &input, const ImageView &output);
+    void ConvolveSeparable(const ConstImageView &input, const ImageView &output);
+    void ConvolveFFT(const ConstImageView &input, const ImageView &output, int numChannels);
+
+    std::shared_ptr<ConvolutionFFTCache> fftCache;
+    std::vector<glm::vec4> tmpData;
+};
+
+const char *ConvolutionMethodName(ConvolutionMethod method);
@@ -0,0 +1,108 @@
+#include "DistanceTransform.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+
+//1D squared distance transform of the sampled function f : d[q] = min_p (q - p)^2 + f[p]
+//v and z are scratch buffers of size n and n+1. If argmin is not null, it receives the minimizing p of each q.
+static void DistanceTransform1D(const float *f, float *d, int n, int *v, float *z, int *argmin=nullptr)
+{
+    int k=0;
+    v[0] = 0;
+    z[0] = -DISTANCE_TRANSFORM_INF;
+    z[1] = DISTANCE_TRANSFORM_INF;
+    for(int q=1; q<n; q++)
+    {
+        float s = ((f[q] + (float)q*q) - (f[v[k]] + (float)v[k]*v[k])) / (float)(2*q - 2*v[k]);
+        while(s <= z[k])
+        {
+            k--;
+            s = ((f[q] + (float)q*q) - (f[v[k]] + (float)v[k]*v[k])) / (float)(2*q - 2*v[k]);
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k+1] = DISTANCE_TRANSFORM_INF;
+    }
+
+    k=0;
+    for(int q=0; q<n; q++)
+    {
+        while(z[k+1] < (float)q) k++;
+        float diff = (float)(q - v[k]);
+        d[q] = diff * diff + f[v[k]];
+        if(argmin) argmin[q] = v[k];
+    }
+}
+
+void SquaredDistanceTransform(const uint8_t *features, const GrayImageView &squaredDistances)
+{
+    int width = squaredDistances.width;
+    int height = squaredDistances.height;
+
+    //Columns
+    ParallelForChunks(0, width, [&](int start, int end)
+    {
+        std::vector<float> f(height), d(height), z(height+1);
+        std::vector<int> v(height);
+        for(int x=start; x<end; x++)
+        {
+            for(int y=0; y<height; y++) f[y] = features[(size_t)y * width + x] ? 0 : DISTANCE_TRANSFORM_INF;
+            DistanceTransform1D(f.data(), d.data(), height, v.data(), z.data());
+            for(int y=0; y<height; y++) squaredDistances.At(x, y) = d[y];
+        }
+    });
+
+    //Rows
+    ParallelForChunks(0, height, [&](int start, int end)
+    {
+        std::vector<float> f(width), z(width+1);
+        std::vector<int> v(width);
+        for(int y=start; y<end; y++)
+        {
+            float *row = squaredDistances.Row(y);
+            std::copy(row, row + width, f.begin());
+            DistanceTransform1D(f.data(), row, width, v.data(), z.data());
+        }
+    });
+}
+
+void SquaredDistanceTransform(const std::vector<uint8_t> &features, int width, int height, std::vector<float> &squaredDistances, std::vector<int64_t> &nearestFeatures)
+{
+    squaredDistances.resize((size_t)width * height);
+    nearestFeatures.resize((size_t)width * height);
+
+    //Columns, nearestFeatures holds the closest feature of the column
+    ParallelForChunks(0, width, [&](int start, int end)
+    {
+        std::vector<float> f(height), d(height), z(height+1);
+        std::vector<int> v(height), argmin(height);
+        for(int x=start; x<end; x++)
+        {
+            for(int y=0; y<height; y++) f[y] = features[(size_t)y * width + x] ? 0 : DISTANCE_TRANSFORM_INF;
+            DistanceTransform1D(f.data(), d.data(), height, v.data(), z.data(), argmin.data());
+            for(int y=0; y<height; y++)
+            {
+                squaredDistances[(size_t)y * width + x] = d[y];
+                nearestFeatures[(size_t)y * width + x] = (d[y] < DISTANCE_TRANSFORM_INF) ? (int64_t)argmin[y] * width + x : -1;
+            }
+        }
+    });
+
+    //Rows, the closest feature is the one of the column that minimizes the distance
+    ParallelForChunks(0, height, [&](int start, int end)
+    {
+        std::vector<float> f(width), z(width+1);
+        std::vector<int> v(width), argmin(width);
+        std::vector<int64_t> columnFeatures(width);
+        for(int y=start; y<end; y++)
+        {
+            float *row = squaredDistances.data() + (size_t)y * width;
+            int64_t *nearestRow = nearestFeatures.data() + (size_t)y * width;
+            std::copy(row, row + width, f.begin());
+            std::copy(nearestRow, nearestRow + width, columnFeatures.begin());
+            DistanceTransform1D(f.data(), row, width, v.data(), z.data(), argmin.data());
+            for(int x=0; x<width; x++) nearestRow[x] = (row[x] < DISTANCE_TRANSFORM_INF) ? columnFeatures[argmin[x]] : -1;
+        }
+    });
+}
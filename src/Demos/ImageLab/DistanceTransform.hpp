@@ -0,0 +1,19 @@
+#pragma once
+#include "ImageView.hpp"
+#include <vector>
+#include <stdint.h>
+
+//Squared euclidean distance from each pixel to the closest feature pixel (features[i] != 0),
+//computed with the lower envelope of parabolas of Felzenszwalb and Huttenlocher, separably on columns then rows.
+//Pixels with no feature in the image get DISTANCE_TRANSFORM_INF.
+#define DISTANCE_TRANSFORM_INF 1e20f
+//features is packed, width * height. squaredDistances is the same size, its view can be a crop or have padded rows.
+void SquaredDistanceTransform(const uint8_t *features, const GrayImageView &squaredDistances);
+inline void SquaredDistanceTransform(const std::vector<uint8_t> &features, int width, int height, std::vector<float> &squaredDistances)
+{
+    squaredDistances.resize((size_t)width * height);
+    SquaredDistanceTransform(features.data(), GrayImageView(squaredDistances.data(), width, height));
+}
+
+//Same, and the index y * width + x of the closest feature pixel in nearestFeatures (feature transform), -1 when there is none
+void SquaredDistanceTransform(const std::vector<uint8_t> &features, int width, int height, std::vector<float> &squaredDistances, std::vector<int64_t> &nearestFeatures);
@@ -0,0 +1,251 @@
+#include "Dither.hpp"
+#include "Parallel.hpp"
+#include "Color.hpp"
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <random>
+
+static void ThresholdsFromRanks(const std::vector<int> &ranks, std::vector<float> &thresholds)
+{
+    thresholds.resize(ranks.size());
+    for(size_t i=0; i<ranks.size(); i++) thresholds[i] = (ranks[i] + 0.5f) / (float)ranks.size();
+}
+
+void ThresholdTile::BuildBayer(int order)
+{
+    //M(2n) = [4 M(n), 4 M(n) + 2; 4 M(n) + 3, 4 M(n) + 1]
+    std::vector<int> ranks = {0};
+    int n=1;
+    for(int i=0; i<order; i++)
+    {
+        std::vector<int> next(4 * n * n);
+        for(int y=0; y<n; y++)
+        {
+            for(int x=0; x<n; x++)
+            {
+                int rank = 4 * ranks[y * n + x];
+                next[y * 2*n + x] = rank;
+                next[y * 2*n + x + n] = rank + 2;
+                next[(y + n) * 2*n + x] = rank + 3;
+                next[(y + n) * 2*n + x + n] = rank + 1;
+            }
+        }
+        ranks = next;
+        n *= 2;
+    }
+    size = n;
+    ThresholdsFromRanks(ranks, thresholds);
+}
+
+void ThresholdTile::BuildClusteredDot(int cellSize)
+{
+    size = (std::max)(cellSize, 1);
+    int count = size * size;
+    std::vector<float> distances(count);
+    for(int y=0; y<size; y++)
+    {
+        for(int x=0; x<size; x++)
+        {
+            glm::vec2 p = (glm::vec2(x, y) + 0.5f) / (float)size - 0.5f;
+            distances[y * size + x] = glm::dot(p, p);
+        }
+    }
+    std::vector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return distances[a] < distances[b]; });
+    std::vector<int> ranks(count);
+    for(int rank=0; rank<count; rank++) ranks[order[rank]] = rank;
+    ThresholdsFromRanks(ranks, thresholds);
+}
+
+void ThresholdTile::BuildBlueNoise(int size, const std::string &cacheFile)
+{
+    this->size = size;
+    int count = size * size;
+    if(cacheFile != "")
+    {
+        std::ifstream file(cacheFile, std::ios::binary);
+        int cachedSize=0;
+        if(file.read((char*)&cachedSize, sizeof(int)) && cachedSize==size)
+        {
+            thresholds.resize(count);
+            if(file.read((char*)thresholds.data(), count * sizeof(float))) return;
+        }
+    }
+
+    //Gaussian energy of a point, wrapping around the tile
+    const float sigma = 1.5f;
+    std::vector<float> gaussian(count);
+    for(int y=0; y<size; y++)
+    {
+        for(int x=0; x<size; x++)
+        {
+            int dx = (std::min)(x, size-x);
+            int dy = (std::min)(y, size-y);
+            gaussian[y * size + x] = std::exp(-(float)(dx * dx + dy * dy) / (2 * sigma * sigma));
+        }
+    }
+
+    std::vector<uint8_t> pattern(count, 0);
+    std::vector<float> energy(count, 0);
+    auto Toggle = [&](int point, bool set)
+    {
+        pattern[point] = set;
+        float sign = set ? 1.0f : -1.0f;
+        int px = point % size;
+        int py = point / size;
+        for(int y=0; y<size; y++)
+        {
+            const float *gaussianRow = gaussian.data() + ((y - py + size) % size) * size;
+            float *energyRow = energy.data() + y * size;
+            for(int x=0; x<size; x++) energyRow[x] += sign * gaussianRow[(x - px + size) % size];
+        }
+    };
+    //Set point with the highest energy, and unset point with the lowest
+    auto TightestCluster = [&]()
+    {
+        int best=-1;
+        for(int i=0; i<count; i++) if(pattern[i] && (best < 0 || energy[i] > energy[best])) best = i;
+        return best;
+    };
+    auto LargestVoid = [&]()
+    {
+        int best=-1;
+        for(int i=0; i<count; i++) if(!pattern[i] && (best < 0 || energy[i] < energy[best])) best = i;
+        return best;
+    };
+
+    //Initial pattern : a tenth of the points set at random, then moved from the tightest clusters to the largest voids until stable
+    std::mt19937 random(1);
+    int numSet = (std::max)(count / 10, 1);
+    for(int i=0; i<numSet;)
+    {
+        int point = random() % count;
+        if(pattern[point]) continue;
+        Toggle(point, true);
+        i++;
+    }
+    for(int iteration=0; iteration<count; iteration++)
+    {
+        int cluster = TightestCluster();
+        Toggle(cluster, false);
+        int largestVoid = LargestVoid();
+        Toggle(largestVoid, true);
+        if(largestVoid==cluster) break;
+    }
+    std::vector<uint8_t> initialPattern = pattern;
+    std::vector<float> initialEnergy = energy;
+
+    //Points of the initial pattern are ranked by removing the tightest clusters, the others by filling the largest voids.
+    //Filling the largest void of the set points is the same as taking the tightest cluster of the unset ones, as their energies sum to a constant
+    std::vector<int> ranks(count);
+    for(int rank=numSet-1; rank>=0; rank--)
+    {
+        int cluster = TightestCluster();
+        Toggle(cluster, false);
+        ranks[cluster] = rank;
+    }
+    pattern = initialPattern;
+    energy = initialEnergy;
+    for(int rank=numSet; rank<count; rank++)
+    {
+        int largestVoid = LargestVoid();
+        Toggle(largestVoid, true);
+        ranks[largestVoid] = rank;
+    }
+    ThresholdsFromRanks(ranks, thresholds);
+
+    if(cacheFile != "")
+    {
+        std::ofstream file(cacheFile, std::ios::binary);
+        file.write((const char*)&size, sizeof(int));
+        file.write((const char*)thresholds.data(), count * sizeof(float));
+    }
+}
+
+void ThresholdTile::BuildFromValues(int size, const std::vector<float> &values)
+{
+    this->size = size;
+    thresholds = values;
+    thresholds.resize(size * size, 0.5f);
+}
+
+void DitherImage(const ConstImageView &input, const ImageView &output, const ThresholdTile &tile, int levels, bool grayScale, glm::vec3 angles)
+{
+    int width = input.width;
+    int height = input.height;
+    if(tile.size <= 0) return;
+    levels = (std::max)(levels, 2);
+    int tileSize = tile.size;
+    int numChannels = grayScale ? 1 : 3;
+    bool rotated=false;
+    for(int c=0; c<numChannels; c++) rotated |= angles[c] != 0;
+
+    //Tile coordinates of the pixels, rotated around the center of the image, are stepped along each row
+    glm::vec2 center(width * 0.5f, height * 0.5f);
+    glm::vec2 stepX[3], stepY[3];
+    for(int c=0; c<3; c++)
+    {
+        float theta = glm::radians(angles[c]);
+        stepX[c] = glm::vec2(std::cos(theta), -std::sin(theta));
+        stepY[c] = glm::vec2(std::sin(theta), std::cos(theta));
+    }
+
+    const __m128 maxLevel = _mm_set1_ps((float)(levels-1));
+    const __m128 invMaxLevel = _mm_set1_ps(1.0f / (float)(levels-1));
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    ParallelForChunks(0, height, [&](int startRow, int endRow)
+    {
+        glm::vec2 coords[3];
+        float thresholds[4] = {0, 0, 0, 0};
+        for(int y=startRow; y<endRow; y++)
+        {
+            const glm::vec4 *inRow = input.Row(y);
+            glm::vec4 *outRow = output.Row(y);
+            const float *tileRow = tile.thresholds.data() + (y % tileSize) * tileSize;
+            //Kept inside the tile as they are stepped, so that truncating them gives the texel
+            for(int c=0; c<numChannels; c++)
+            {
+                coords[c] = center + stepX[c] * (-center.x) + stepY[c] * (y - center.y);
+                coords[c] -= glm::floor(coords[c] / (float)tileSize) * (float)tileSize;
+            }
+
+            for(int x=0; x<width; x++)
+            {
+                __m128 threshold;
+                if(!rotated) threshold = _mm_set1_ps(tileRow[x % tileSize]);
+                else
+                {
+                    for(int c=0; c<numChannels; c++)
+                    {
+                        int tx = (std::min)((int)coords[c].x, tileSize-1);
+                        int ty = (std::min)((int)coords[c].y, tileSize-1);
+                        thresholds[c] = tile.At(tx, ty);
+                        coords[c] += stepX[c];
+                        if(coords[c].x >= tileSize) coords[c].x -= tileSize;
+                        else if(coords[c].x < 0) coords[c].x += tileSize;
+                        if(coords[c].y >= tileSize) coords[c].y -= tileSize;
+                        else if(coords[c].y < 0) coords[c].y += tileSize;
+                    }
+                    threshold = grayScale ? _mm_set1_ps(thresholds[0]) : _mm_loadu_ps(thresholds);
+                }
+
+                const glm::vec4 &pixel = inRow[x];
+                __m128 value = grayScale ? _mm_set1_ps(RGBToGray(pixel)) : _mm_loadu_ps(&pixel.x);
+
+                //Level below the value, plus one where the remainder is above the threshold
+                __m128 scaled = _mm_min_ps(_mm_max_ps(_mm_mul_ps(value, maxLevel), zero), maxLevel);
+                __m128 level = _mm_cvtepi32_ps(_mm_cvttps_epi32(scaled));
+                __m128 up = _mm_and_ps(_mm_cmpgt_ps(_mm_sub_ps(scaled, level), threshold), one);
+                _mm_storeu_ps(&outRow[x].x, _mm_mul_ps(_mm_add_ps(level, up), invMaxLevel));
+                outRow[x].a = 1;
+            }
+        }
+    }, 8);
+}
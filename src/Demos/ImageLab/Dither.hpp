@@ -0,0 +1,35 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+//Square threshold matrix repeated over the image, values in (0, 1).
+//Pixels are ranked inside the tile, the threshold of rank r being (r + 0.5) / (size * size)
+struct ThresholdTile
+{
+    //Recursive Bayer matrix of size 2^order
+    void BuildBayer(int order);
+    //Round dots growing from the center of cells of cellSize pixels
+    void BuildClusteredDot(int cellSize);
+    //Void and cluster blue noise (Ulichney). Generating it takes a while, so it is read from cacheFile
+    //when that file holds a tile of the same size, and written there otherwise
+    void BuildBlueNoise(int size, const std::string &cacheFile="");
+    //Custom matrix, values in [0, 1]
+    void BuildFromValues(int size, const std::vector<float> &values);
+
+    float At(int x, int y) const { return thresholds[y * size + x]; }
+
+    int size=0;
+    std::vector<float> thresholds;
+};
+
+//Quantizes each channel to levels evenly spaced values, rounding up where the fractional part is above the threshold of the tile.
+//The tile is rotated by angles (in degrees, one per channel) around the center of the image.
+//With grayScale, the average of the channels is dithered with the first angle.
+//The views can be crops or have padded rows, output can be the same view as input.
+void DitherImage(const ConstImageView &input, const ImageView &output, const ThresholdTile &tile, int levels, bool grayScale, glm::vec3 angles=glm::vec3(0));
+inline void DitherImage(const glm::vec4 *input, glm::vec4 *output, int width, int height, const ThresholdTile &tile, int levels, bool grayScale, glm::vec3 angles=glm::vec3(0))
+{
+    DitherImage(ConstImageView(input, width, height), ImageView(output, width, height), tile, levels, grayScale, angles);
+}
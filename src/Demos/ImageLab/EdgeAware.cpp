@@ -0,0 +1,266 @@
+#include "EdgeAware.hpp"
+#include "Parallel.hpp"
+#include "Color.hpp"
+#include "Resample.hpp"
+
+#include <xmmintrin.h>
+#include <algorithm>
+#include <cmath>
+
+static inline __m128 Load(const glm::vec4 &v) { return _mm_loadu_ps(&v.x); }
+
+void BoxFilterImage(const ConstImageView &input, const ImageView &output, int radius, std::vector<glm::vec4> &tmpData)
+{
+    int width = input.width;
+    int height = input.height;
+    tmpData.resize((size_t)width * height);
+    radius = (std::max)(radius, 0);
+
+    ParallelForChunks(0, height, [&](int startRow, int endRow)
+    {
+        for(int y=startRow; y<endRow; y++)
+        {
+            const glm::vec4 *inRow = input.Row(y);
+            glm::vec4 *outRow = tmpData.data() + (size_t)y * width;
+            glm::dvec4 sum(0);
+            for(int x=0; x<(std::min)(radius, width); x++) sum += glm::dvec4(inRow[x]);
+            for(int x=0; x<width; x++)
+            {
+                if(x + radius < width) sum += glm::dvec4(inRow[x + radius]);
+                if(x - radius - 1 >= 0) sum -= glm::dvec4(inRow[x - radius - 1]);
+                int count = (std::min)(x + radius, width-1) - (std::max)(x - radius, 0) + 1;
+                outRow[x] = glm::vec4(sum / (double)count);
+            }
+        }
+    }, 8);
+
+    //Strips of columns, each sliding its sums down the rows
+    ParallelForChunks(0, width, [&](int startColumn, int endColumn)
+    {
+        int numColumns = endColumn - startColumn;
+        std::vector<glm::dvec4> sums(numColumns, glm::dvec4(0));
+        for(int y=0; y<(std::min)(radius, height); y++)
+        {
+            const glm::vec4 *row = tmpData.data() + (size_t)y * width + startColumn;
+            for(int x=0; x<numColumns; x++) sums[x] += glm::dvec4(row[x]);
+        }
+        for(int y=0; y<height; y++)
+        {
+            if(y + radius < height)
+            {
+                const glm::vec4 *row = tmpData.data() + (size_t)(y + radius) * width + startColumn;
+                for(int x=0; x<numColumns; x++) sums[x] += glm::dvec4(row[x]);
+            }
+            if(y - radius - 1 >= 0)
+            {
+                const glm::vec4 *row = tmpData.data() + (size_t)(y - radius - 1) * width + startColumn;
+                for(int x=0; x<numColumns; x++) sums[x] -= glm::dvec4(row[x]);
+            }
+            double inverseCount = 1.0 / (double)((std::min)(y + radius, height-1) - (std::max)(y - radius, 0) + 1);
+            glm::vec4 *outRow = output.Row(y) + startColumn;
+            for(int x=0; x<numColumns; x++) outRow[x] = glm::vec4(sums[x] * inverseCount);
+        }
+    }, 64);
+}
+
+void GuidedImageFilter::Filter(const ConstImageView &guide, const ConstImageView &input, const ImageView &output, int radius, float epsilon, int subsampling)
+{
+    int width = input.width;
+    int height = input.height;
+    if(input.Empty()) return;
+    subsampling = (std::max)(subsampling, 1);
+    int lowWidth = (std::max)((width + subsampling-1) / subsampling, 1);
+    int lowHeight = (std::max)((height + subsampling-1) / subsampling, 1);
+    int lowRadius = (std::max)((int)std::round((float)radius / (float)subsampling), 1);
+    size_t lowSize = (size_t)lowWidth * lowHeight;
+
+    ConstImageView fitGuide = guide;
+    ConstImageView fitInput = input;
+    if(subsampling > 1)
+    {
+        lowGuide.resize(lowSize);
+        lowInput.resize(lowSize);
+        fitGuide = ImageView(lowGuide.data(), lowWidth, lowHeight);
+        fitInput = ImageView(lowInput.data(), lowWidth, lowHeight);
+        ResampleImage(guide, ImageView(lowGuide.data(), lowWidth, lowHeight), ResampleFilter::Box);
+        ResampleImage(input, ImageView(lowInput.data(), lowWidth, lowHeight), ResampleFilter::Box);
+    }
+
+    //Window means of I, p, I * p and I * I
+    coefficientsA.resize(lowSize);
+    coefficientsB.resize(lowSize);
+    ParallelForChunks(0, lowHeight, [&](int startRow, int endRow)
+    {
+        for(int y=startRow; y<endRow; y++)
+        {
+            const glm::vec4 *guideRow = fitGuide.Row(y);
+            const glm::vec4 *inRow = fitInput.Row(y);
+            size_t offset = (size_t)y * lowWidth;
+            for(int x=0; x<lowWidth; x++)
+            {
+                float gray = RGBToGray(guideRow[x]);
+                glm::vec3 color(inRow[x]);
+                coefficientsA[offset + x] = glm::vec4(color, gray);
+                coefficientsB[offset + x] = glm::vec4(color * gray, gray * gray);
+            }
+        }
+    }, 8);
+    BoxFilterImage(coefficientsA.data(), coefficientsA.data(), lowWidth, lowHeight, lowRadius, tmpData);
+    BoxFilterImage(coefficientsB.data(), coefficientsB.data(), lowWidth, lowHeight, lowRadius, tmpData);
+
+    //a = cov(I, p) / (var(I) + epsilon), b = mean(p) - a * mean(I), then averaged over the windows that contain each pixel
+    ParallelForChunks(0, lowHeight, [&](int startRow, int endRow)
+    {
+        for(size_t i=(size_t)startRow * lowWidth; i<(size_t)endRow * lowWidth; i++)
+        {
+            glm::vec4 means = coefficientsA[i];
+            glm::vec4 products = coefficientsB[i];
+            float variance = products.a - means.a * means.a;
+            glm::vec3 a = (glm::vec3(products) - glm::vec3(means) * means.a) / (variance + epsilon);
+            coefficientsA[i] = glm::vec4(a, 0);
+            coefficientsB[i] = glm::vec4(glm::vec3(means) - a * means.a, 0);
+        }
+    }, 8);
+    BoxFilterImage(coefficientsA.data(), coefficientsA.data(), lowWidth, lowHeight, lowRadius, tmpData);
+    BoxFilterImage(coefficientsB.data(), coefficientsB.data(), lowWidth, lowHeight, lowRadius, tmpData);
+
+    //q = a * I + b with the full resolution guide, coefficients interpolated bilinearly
+    float scaleX = (float)lowWidth / (float)width;
+    float scaleY = (float)lowHeight / (float)height;
+    std::vector<int> columns(width);
+    std::vector<float> columnWeights(width);
+    for(int x=0; x<width; x++)
+    {
+        float position = glm::clamp((x + 0.5f) * scaleX - 0.5f, 0.0f, (float)(lowWidth-1));
+        columns[x] = (std::min)((int)position, (std::max)(lowWidth-2, 0));
+        columnWeights[x] = position - columns[x];
+    }
+    int nextColumn = lowWidth > 1 ? 1 : 0;
+    ParallelForChunks(0, height, [&](int startRow, int endRow)
+    {
+        for(int y=startRow; y<endRow; y++)
+        {
+            float position = glm::clamp((y + 0.5f) * scaleY - 0.5f, 0.0f, (float)(lowHeight-1));
+            int row = (std::min)((int)position, (std::max)(lowHeight-2, 0));
+            size_t nextRow = lowHeight > 1 ? lowWidth : 0;
+            __m128 weightY = _mm_set1_ps(position - row);
+            const glm::vec4 *rowA = coefficientsA.data() + (size_t)row * lowWidth;
+            const glm::vec4 *rowB = coefficientsB.data() + (size_t)row * lowWidth;
+            const glm::vec4 *guideRow = guide.Row(y);
+            const glm::vec4 *inRow = input.Row(y);
+            glm::vec4 *outRow = output.Row(y);
+            for(int x=0; x<width; x++)
+            {
+                const glm::vec4 *a = rowA + columns[x];
+                const glm::vec4 *b = rowB + columns[x];
+                __m128 weightX = _mm_set1_ps(columnWeights[x]);
+                auto Bilinear = [&](const glm::vec4 *c)
+                {
+                    __m128 top = _mm_add_ps(Load(c[0]), _mm_mul_ps(_mm_sub_ps(Load(c[nextColumn]), Load(c[0])), weightX));
+                    __m128 bottom = _mm_add_ps(Load(c[nextRow]), _mm_mul_ps(_mm_sub_ps(Load(c[nextRow + nextColumn]), Load(c[nextRow])), weightX));
+                    return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), weightY));
+                };
+                __m128 value = _mm_add_ps(_mm_mul_ps(Bilinear(a), _mm_set1_ps(RGBToGray(guideRow[x]))), Bilinear(b));
+                float alpha = inRow[x].a;
+                _mm_storeu_ps(&outRow[x].x, value);
+                outRow[x].a = alpha;
+            }
+        }
+    }, 8);
+}
+
+void DomainTransform::Filter(const ConstImageView &guide, const ConstImageView &input, const ImageView &output, float sigmaSpatial, float sigmaRange, int iterations)
+{
+    int width = input.width;
+    int height = input.height;
+    size_t numPixels = (size_t)width * height;
+    iterations = (std::max)(iterations, 1);
+    float ratio = sigmaSpatial / (std::max)(sigmaRange, 1e-4f);
+    horizontalDistances.resize(numPixels);
+    verticalDistances.resize(numPixels);
+    feedbacks.resize(numPixels);
+
+    ParallelForChunks(0, height, [&](int startRow, int endRow)
+    {
+        for(int y=startRow; y<endRow; y++)
+        {
+            const glm::vec4 *guideRow = guide.Row(y);
+            const glm::vec4 *guideAbove = guide.ClampedRow(y-1);
+            float *horizontal = horizontalDistances.data() + (size_t)y * width;
+            float *vertical = verticalDistances.data() + (size_t)y * width;
+            for(int x=0; x<width; x++)
+            {
+                glm::vec3 dx = (x > 0) ? glm::vec3(guideRow[x]) - glm::vec3(guideRow[x-1]) : glm::vec3(0);
+                glm::vec3 dy = (y > 0) ? glm::vec3(guideRow[x]) - glm::vec3(guideAbove[x]) : glm::vec3(0);
+                horizontal[x] = 1 + ratio * (std::abs(dx.r) + std::abs(dx.g) + std::abs(dx.b));
+                vertical[x] = 1 + ratio * (std::abs(dy.r) + std::abs(dy.g) + std::abs(dy.b));
+            }
+        }
+    }, 8);
+
+    if(output.pixels != input.pixels)
+    {
+        for(int y=0; y<height; y++) std::copy(input.Row(y), input.Row(y) + width, output.Row(y));
+    }
+    for(int iteration=0; iteration<iterations; iteration++)
+    {
+        //Spatial extent of this iteration, so that all of them add up to sigmaSpatial
+        float sigma = sigmaSpatial * std::sqrt(3.0f) * std::pow(2.0f, (float)(iterations - iteration - 1)) / std::sqrt(std::pow(4.0f, (float)iterations) - 1);
+        float logFeedback = -std::sqrt(2.0f) / (std::max)(sigma, 1e-4f);
+
+        //Feedback toward the previous pixel is a^d
+        ParallelForChunks(0, height, [&](int startRow, int endRow)
+        {
+            for(size_t i=(size_t)startRow * width; i<(size_t)endRow * width; i++) feedbacks[i] = std::exp(horizontalDistances[i] * logFeedback);
+        }, 8);
+        ParallelForChunks(0, height, [&](int startRow, int endRow)
+        {
+            for(int y=startRow; y<endRow; y++)
+            {
+                glm::vec4 *row = output.Row(y);
+                const float *feedback = feedbacks.data() + (size_t)y * width;
+                for(int x=1; x<width; x++)
+                {
+                    __m128 current = Load(row[x]);
+                    _mm_storeu_ps(&row[x].x, _mm_add_ps(current, _mm_mul_ps(_mm_sub_ps(Load(row[x-1]), current), _mm_set1_ps(feedback[x]))));
+                }
+                for(int x=width-2; x>=0; x--)
+                {
+                    __m128 current = Load(row[x]);
+                    _mm_storeu_ps(&row[x].x, _mm_add_ps(current, _mm_mul_ps(_mm_sub_ps(Load(row[x+1]), current), _mm_set1_ps(feedback[x+1]))));
+                }
+            }
+        }, 8);
+
+        ParallelForChunks(0, height, [&](int startRow, int endRow)
+        {
+            for(size_t i=(size_t)startRow * width; i<(size_t)endRow * width; i++) feedbacks[i] = std::exp(verticalDistances[i] * logFeedback);
+        }, 8);
+        //Strips of columns go down then up the rows, so that memory is still read along rows
+        ParallelForChunks(0, width, [&](int startColumn, int endColumn)
+        {
+            for(int y=1; y<height; y++)
+            {
+                glm::vec4 *row = output.Row(y);
+                const glm::vec4 *previous = output.Row(y-1);
+                const float *feedback = feedbacks.data() + (size_t)y * width;
+                for(int x=startColumn; x<endColumn; x++)
+                {
+                    __m128 current = Load(row[x]);
+                    _mm_storeu_ps(&row[x].x, _mm_add_ps(current, _mm_mul_ps(_mm_sub_ps(Load(previous[x]), current), _mm_set1_ps(feedback[x]))));
+                }
+            }
+            for(int y=height-2; y>=0; y--)
+            {
+                glm::vec4 *row = output.Row(y);
+                const glm::vec4 *next = output.Row(y+1);
+                const float *feedback = feedbacks.data() + (size_t)(y+1) * width;
+                for(int x=startColumn; x<endColumn; x++)
+                {
+                    __m128 current = Load(row[x]);
+                    _mm_storeu_ps(&row[x].x, _mm_add_ps(current, _mm_mul_ps(_mm_sub_ps(Load(next[x]), current), _mm_set1_ps(feedback[x]))));
+                }
+            }
+        }, 64);
+    }
+}
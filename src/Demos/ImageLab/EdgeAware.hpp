@@ -0,0 +1,55 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+//Mean over a (2 * radius + 1) square, clipped to the image. Sliding sums are kept in double precision
+//so the cost does not depend on the radius. Output can be the same view as input.
+void BoxFilterImage(const ConstImageView &input, const ImageView &output, int radius, std::vector<glm::vec4> &tmpData);
+inline void BoxFilterImage(const glm::vec4 *input, glm::vec4 *output, int width, int height, int radius, std::vector<glm::vec4> &tmpData)
+{
+    BoxFilterImage(ConstImageView(input, width, height), ImageView(output, width, height), radius, tmpData);
+}
+
+//Guided filter (He, Sun, Tang 2010) with the gray scale of the guide : in each window the output is a linear function
+//a * guide + b of the guide that best fits the input, epsilon penalizing large a, so flat areas of the guide are
+//smoothed and its edges transferred to the output. Every channel of the input is filtered, alpha is copied.
+//With subsampling above 1, the coefficients are fitted on the image reduced by that factor and interpolated back
+//(fast guided filter, He and Sun 2015). The cost does not depend on the radius.
+//The views can be crops or have padded rows, input and output must not overlap.
+struct GuidedImageFilter
+{
+    void Filter(const ConstImageView &guide, const ConstImageView &input, const ImageView &output, int radius, float epsilon, int subsampling=1);
+    void Filter(const glm::vec4 *guide, const glm::vec4 *input, glm::vec4 *output, int width, int height, int radius, float epsilon, int subsampling=1)
+    {
+        Filter(ConstImageView(guide, width, height), ConstImageView(input, width, height), ImageView(output, width, height), radius, epsilon, subsampling);
+    }
+
+private:
+    std::vector<glm::vec4> lowGuide;
+    std::vector<glm::vec4> lowInput;
+    //Input and guide * input in rgb, guide and guide squared in a, then the a and b coefficients
+    std::vector<glm::vec4> coefficientsA;
+    std::vector<glm::vec4> coefficientsB;
+    std::vector<glm::vec4> tmpData;
+};
+
+//Recursive filter of the domain transform (Gastal and Oliveira 2011) : the image is smoothed along rows then columns
+//by a first order recursive filter whose feedback decays with the distance sigmaSpatial / sigmaRange * |guide'|
+//between pixels, so that it does not cross the edges of the guide (L1 over its rgb channels).
+//Each iteration halves the spatial extent of the passes. Rows, then strips of columns, are filtered in parallel.
+//The views can be crops or have padded rows, output can be the same view as input.
+struct DomainTransform
+{
+    void Filter(const ConstImageView &guide, const ConstImageView &input, const ImageView &output, float sigmaSpatial, float sigmaRange, int iterations=3);
+    void Filter(const glm::vec4 *guide, const glm::vec4 *input, glm::vec4 *output, int width, int height, float sigmaSpatial, float sigmaRange, int iterations=3)
+    {
+        Filter(ConstImageView(guide, width, height), ConstImageView(input, width, height), ImageView(output, width, height), sigmaSpatial, sigmaRange, iterations);
+    }
+
+private:
+    //Distance from the previous pixel of the row, and of the column
+    std::vector<float> horizontalDistances;
+    std::vector<float> verticalDistances;
+    std::vector<float> feedbacks;
+};
@@ -0,0 +1,74 @@
+#include "FrameArena.hpp"
+
+#include <algorithm>
+#include <new>
+
+FrameArena::FrameArena(size_t chunkBytes) : chunkBytes(chunkBytes)
+{
+}
+
+FrameArena::~FrameArena()
+{
+    for(Chunk &chunk : chunks) ::operator delete(chunk.data);
+}
+
+size_t FrameArena::Reserved() const
+{
+    size_t total=0;
+    for(const Chunk &chunk : chunks) total += chunk.size;
+    return total;
+}
+
+void FrameArena::Reset()
+{
+    //Chunks added during the frame are merged into one that fits it all, the next frames then stay in a single chunk
+    if(chunks.size() > 1 && current > 0)
+    {
+        size_t total = Reserved();
+        for(Chunk &chunk : chunks) ::operator delete(chunk.data);
+        chunks.clear();
+        Chunk chunk;
+        chunk.data = (uint8_t*)::operator new(total);
+        chunk.size = total;
+        chunks.push_back(chunk);
+    }
+    current=0;
+    offset=0;
+    used=0;
+    peak=0;
+}
+
+void *FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+    bytes = (std::max)(bytes, (size_t)1);
+    while(current < chunks.size())
+    {
+        Chunk &chunk = chunks[current];
+        uintptr_t address = (uintptr_t)(chunk.data + offset);
+        size_t padding = (alignment - address % alignment) % alignment;
+        if(offset + padding + bytes <= chunk.size)
+        {
+            offset += padding + bytes;
+            used += padding + bytes;
+            peak = (std::max)(peak, used);
+            return (void*)(address + padding);
+        }
+        //The end of the chunk is lost until the next reset
+        current++;
+        offset=0;
+    }
+
+    //Growing geometrically keeps the number of chunks low when a frame needs a lot more than usual
+    Chunk chunk;
+    chunk.size = (std::max)((std::max)(chunkBytes, bytes + alignment), chunks.empty() ? 0 : chunks.back().size * 2);
+    chunk.data = (uint8_t*)::operator new(chunk.size);
+    chunks.push_back(chunk);
+    current = chunks.size()-1;
+
+    uintptr_t address = (uintptr_t)chunk.data;
+    size_t padding = (alignment - address % alignment) % alignment;
+    offset = padding + bytes;
+    used += padding + bytes;
+    peak = (std::max)(peak, used);
+    return (void*)(address + padding);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <stack>
+#include <vector>
+
+//Bump allocator for the temporaries of the processes : allocating is moving an offset, freeing does nothing,
+//and everything is dropped at once when the stack resets it after each stage.
+//Chunks are kept between evaluations, and merged into one when a stage needed several, so a stack that runs
+//again on the same image allocates nothing. Used from the thread that runs the stack only.
+class FrameArena : public std::pmr::memory_resource
+{
+public:
+    FrameArena(size_t chunkBytes = (size_t)1 << 20);
+    ~FrameArena();
+    FrameArena(const FrameArena&) = delete;
+    FrameArena &operator=(const FrameArena&) = delete;
+
+    //Everything allocated since the last reset becomes invalid
+    void Reset();
+
+    //Bytes handed out since the last reset, and the most there was at once
+    size_t Used() const { return used; }
+    size_t Peak() const { return peak; }
+    size_t Reserved() const;
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    struct Chunk
+    {
+        uint8_t *data=nullptr;
+        size_t size=0;
+    };
+    std::vector<Chunk> chunks;
+    size_t chunkBytes;
+    //Chunk being filled, and the offset of the next allocation in it
+    size_t current=0;
+    size_t offset=0;
+    size_t used=0;
+    size_t peak=0;
+};
+
+//Containers on an arena, built with the arena as their allocator : ArenaVector<int> v(&arena);
+template<typename T> using ArenaVector = std::pmr::vector<T>;
+template<typename T> using ArenaStack = std::stack<T, std::pmr::vector<T>>;
+
+template<typename T>
+ArenaStack<T> MakeArenaStack(FrameArena &arena)
+{
+    return ArenaStack<T>(std::pmr::vector<T>(&arena));
+}
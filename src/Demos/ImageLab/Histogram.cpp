@@ -0,0 +1,263 @@
+#include "Histogram.hpp"
+#include "Parallel.hpp"
+#include "Color.hpp"
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <algorithm>
+#include <cmath>
+
+//Adds the pixels of [x0, x1) x [y0, y1) to the 4 histograms of counts
+static void AccumulateRegion(const ConstImageView &image, int x0, int y0, int x1, int y1, int numBins, uint32_t *counts)
+{
+    uint32_t *red = counts;
+    uint32_t *green = counts + numBins;
+    uint32_t *blue = counts + 2 * numBins;
+    uint32_t *gray = counts + 3 * numBins;
+
+    __m128 scale = _mm_set1_ps((float)numBins);
+    __m128 third = _mm_set1_ps(0.33333f);
+    __m128 zero = _mm_setzero_ps();
+    __m128 lastBin = _mm_set1_ps((float)(numBins-1));
+    //max returns its second operand for NaN, so NaN goes to bin 0
+    auto Bins = [&](__m128 values, int32_t *bins)
+    {
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(values, scale), zero), lastBin);
+        _mm_storeu_si128((__m128i*)bins, _mm_cvttps_epi32(b));
+    };
+
+    int32_t bins[4][4];
+    for(int y=y0; y<y1; y++)
+    {
+        const glm::vec4 *row = image.Row(y);
+        int x=x0;
+        for(; x+4<=x1; x+=4)
+        {
+            //4 pixels to 4 vectors of R, G, B, A
+            __m128 p0 = _mm_loadu_ps(&row[x].x);
+            __m128 p1 = _mm_loadu_ps(&row[x+1].x);
+            __m128 p2 = _mm_loadu_ps(&row[x+2].x);
+            __m128 p3 = _mm_loadu_ps(&row[x+3].x);
+            _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+            __m128 grayScale = _mm_mul_ps(_mm_add_ps(_mm_add_ps(p0, p1), p2), third);
+
+            Bins(p0, bins[0]);
+            Bins(p1, bins[1]);
+            Bins(p2, bins[2]);
+            Bins(grayScale, bins[3]);
+            for(int i=0; i<4; i++)
+            {
+                red[bins[0][i]]++;
+                green[bins[1][i]]++;
+                blue[bins[2][i]]++;
+                gray[bins[3][i]]++;
+            }
+        }
+        for(; x<x1; x++)
+        {
+            float grayScale = RGBToGray(row[x]);
+            Bins(_mm_setr_ps(row[x].r, row[x].g, row[x].b, grayScale), bins[0]);
+            red[bins[0][0]]++;
+            green[bins[0][1]]++;
+            blue[bins[0][2]]++;
+            gray[bins[0][3]]++;
+        }
+    }
+}
+
+void Histogram::Compute(const ConstImageView &image, int numBins)
+{
+    int width = image.width;
+    int height = image.height;
+    this->numBins = numBins;
+    total = (uint32_t)image.NumPixels();
+    size_t size = (size_t)4 * numBins;
+    counts.assign(size, 0);
+    if(width <= 0 || height <= 0) return;
+
+    //Private histograms per thread, merged at the end
+    int numChunks = (std::min)(GetNumThreads(), (height + 15) / 16);
+    std::vector<std::vector<uint32_t>> privateCounts(numChunks);
+    ParallelFor(0, numChunks, [&](int chunk)
+    {
+        int y0 = (int)((int64_t)height * chunk / numChunks);
+        int y1 = (int)((int64_t)height * (chunk+1) / numChunks);
+        privateCounts[chunk].assign(size, 0);
+        AccumulateRegion(image, 0, y0, width, y1, numBins, privateCounts[chunk].data());
+    });
+
+    ParallelForChunks(0, (int)size, [&](int start, int end)
+    {
+        for(int chunk=0; chunk<numChunks; chunk++)
+        {
+            const uint32_t *source = privateCounts[chunk].data();
+            for(int i=start; i<end; i++) counts[i] += source[i];
+        }
+    }, 4096);
+}
+
+void Histogram::ComputeRegion(const glm::vec4 *data, int width, int x0, int y0, int x1, int y1, int numBins)
+{
+    this->numBins = numBins;
+    total = (uint32_t)((size_t)(std::max)(x1 - x0, 0) * (size_t)(std::max)(y1 - y0, 0));
+    counts.assign((size_t)4 * numBins, 0);
+    AccumulateRegion(ConstImageView(data, width, y1), x0, y0, x1, y1, numBins, counts.data());
+}
+
+int Histogram::Bin(float value) const
+{
+    if(!(value > 0)) return 0;
+    return (std::min)((int)(value * numBins), numBins-1);
+}
+
+uint32_t Histogram::MaxCount(int channel, int firstBin) const
+{
+    const uint32_t *bins = Channel(channel);
+    uint32_t result=0;
+    for(int i=firstBin; i<numBins; i++) result = (std::max)(result, bins[i]);
+    return result;
+}
+
+float Histogram::Percentile(int channel, float fraction) const
+{
+    const uint32_t *bins = Channel(channel);
+    double target = (double)fraction * total;
+    double sum=0;
+    for(int i=0; i<numBins; i++)
+    {
+        sum += bins[i];
+        if(sum > target) return (i + 0.5f) / numBins;
+    }
+    return 1;
+}
+
+float Histogram::OtsuThreshold(int channel, float previous, float tolerance) const
+{
+    const uint32_t *bins = Channel(channel);
+    double sum=0;
+    for(int i=0; i<numBins; i++) sum += (double)i * bins[i];
+
+    double sumBackground=0;
+    double weightBackground=0;
+    double maxVariance=-1;
+    int threshold=0;
+    //Bin of the previous threshold, as returned below
+    int previousBin = (previous >= 0) ? (int)std::lround(previous * numBins) - 1 : -1;
+    double previousVariance=-1;
+    for(int i=0; i<numBins; i++)
+    {
+        weightBackground += bins[i];
+        if(weightBackground==0) continue;
+        double weightForeground = (double)total - weightBackground;
+        if(weightForeground==0) break;
+
+        sumBackground += (double)i * bins[i];
+        double meanBackground = sumBackground / weightBackground;
+        double meanForeground = (sum - sumBackground) / weightForeground;
+        double variance = weightBackground * weightForeground * (meanBackground - meanForeground) * (meanBackground - meanForeground);
+        if(i == previousBin) previousVariance = variance;
+        if(variance > maxVariance)
+        {
+            maxVariance = variance;
+            threshold = i;
+        }
+    }
+    if(previousVariance >= 0 && previousVariance >= (1.0 - tolerance) * maxVariance) threshold = previousBin;
+    //Bins up to threshold are below
+    return (float)(threshold+1) / (float)numBins;
+}
+
+void Histogram::EqualizationLut(int channel, std::vector<float> &lut) const
+{
+    const uint32_t *bins = Channel(channel);
+    lut.resize(numBins);
+    double cumulative=0;
+    double minimum=-1;
+    for(int i=0; i<numBins; i++)
+    {
+        cumulative += bins[i];
+        if(minimum < 0 && cumulative > 0) minimum = cumulative;
+        lut[i] = (float)cumulative;
+    }
+    double range = (double)total - minimum;
+    for(int i=0; i<numBins; i++)
+    {
+        lut[i] = (range > 0) ? (float)(((double)lut[i] - minimum) / range) : (float)i / (float)(numBins-1);
+        lut[i] = (std::max)(lut[i], 0.0f);
+    }
+}
+
+void ContrastLimitedEqualize(const glm::vec4 *input, glm::vec4 *output, int width, int height, int tilesX, int tilesY, float clipLimit, int numBins, bool color)
+{
+    if(width <= 0 || height <= 0) return;
+    tilesX = (std::min)((std::max)(tilesX, 1), width);
+    tilesY = (std::min)((std::max)(tilesY, 1), height);
+    int numChannels = color ? 3 : 1;
+
+    //Lookup tables of each tile and channel
+    std::vector<float> luts((size_t)tilesX * tilesY * numChannels * numBins);
+    ParallelFor(0, tilesX * tilesY, [&](int tile)
+    {
+        int tx = tile % tilesX;
+        int ty = tile / tilesX;
+        int x0 = (int)((int64_t)width * tx / tilesX);
+        int x1 = (int)((int64_t)width * (tx+1) / tilesX);
+        int y0 = (int)((int64_t)height * ty / tilesY);
+        int y1 = (int)((int64_t)height * (ty+1) / tilesY);
+        Histogram histogram;
+        histogram.ComputeRegion(input, width, x0, y0, x1, y1, numBins);
+
+        double limit = (std::max)(1.0, (double)clipLimit * histogram.total / numBins);
+        for(int c=0; c<numChannels; c++)
+        {
+            const uint32_t *bins = histogram.Channel(color ? c : HISTOGRAM_GRAY);
+            double excess=0;
+            for(int i=0; i<numBins; i++) excess += (std::max)(0.0, (double)bins[i] - limit);
+            double redistributed = excess / numBins;
+
+            float *lut = luts.data() + ((size_t)tile * numChannels + c) * numBins;
+            double cumulative=0;
+            for(int i=0; i<numBins; i++)
+            {
+                cumulative += (std::min)((double)bins[i], limit) + redistributed;
+                lut[i] = (float)(cumulative / histogram.total);
+            }
+        }
+    });
+
+    //Each pixel between the centers of the 4 closest tiles
+    float tileWidth = (float)width / tilesX;
+    float tileHeight = (float)height / tilesY;
+    float scale = (float)numBins;
+    ParallelFor(0, height, [&](int y)
+    {
+        float fy = (y + 0.5f) / tileHeight - 0.5f;
+        int ty0 = (std::min)((std::max)((int)std::floor(fy), 0), tilesY-1);
+        int ty1 = (std::min)(ty0+1, tilesY-1);
+        float ay = (std::min)((std::max)(fy - ty0, 0.0f), 1.0f);
+        for(int x=0; x<width; x++)
+        {
+            float fx = (x + 0.5f) / tileWidth - 0.5f;
+            int tx0 = (std::min)((std::max)((int)std::floor(fx), 0), tilesX-1);
+            int tx1 = (std::min)(tx0+1, tilesX-1);
+            float ax = (std::min)((std::max)(fx - tx0, 0.0f), 1.0f);
+
+            const glm::vec4 &pixel = input[(size_t)y * width + x];
+            glm::vec4 result(0, 0, 0, pixel.a);
+            for(int c=0; c<numChannels; c++)
+            {
+                float value = color ? pixel[c] : RGBToGray(pixel);
+                int bin = (value > 0) ? (std::min)((int)(value * scale), numBins-1) : 0;
+                auto Lut = [&](int tx, int ty)
+                {
+                    return luts[((size_t)(ty * tilesX + tx) * numChannels + c) * numBins + bin];
+                };
+                float top = Lut(tx0, ty0) + (Lut(tx1, ty0) - Lut(tx0, ty0)) * ax;
+                float bottom = Lut(tx0, ty1) + (Lut(tx1, ty1) - Lut(tx0, ty1)) * ax;
+                result[c] = top + (bottom - top) * ay;
+            }
+            if(!color) result.g = result.b = result.r;
+            output[(size_t)y * width + x] = result;
+        }
+    }, 8);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+#include <stdint.h>
+
+#define HISTOGRAM_RED 0
+#define HISTOGRAM_GREEN 1
+#define HISTOGRAM_BLUE 2
+#define HISTOGRAM_GRAY 3
+
+//Histograms of the R, G, B channels and of the gray scale (average of RGB), for values in [0, 1].
+//Compute splits the rows between threads, each one bins 4 pixels at a time with SSE into its own
+//histograms, which are summed at the end.
+struct Histogram
+{
+    //numBins is usually 256, 4096 or 65536
+    void Compute(const ConstImageView &image, int numBins=256);
+    void Compute(const glm::vec4 *data, int width, int height, int numBins=256) { Compute(ConstImageView(data, width, height), numBins); }
+    //Histogram of the rectangle [x0, x1) x [y0, y1) of an image, on the calling thread
+    void ComputeRegion(const glm::vec4 *data, int width, int x0, int y0, int x1, int y1, int numBins=256);
+
+    int Bin(float value) const;
+    const uint32_t *Channel(int channel) const { return counts.data() + (size_t)channel * numBins; }
+    uint32_t MaxCount(int channel, int firstBin=0) const;
+    //Lowest value such that at least fraction of the pixels are below it
+    float Percentile(int channel, float fraction) const;
+    //Threshold that maximizes the variance between the two classes (Otsu).
+    //A previous threshold, when not negative, is kept as long as its variance is within tolerance of the maximum,
+    //so that frames of a sequence do not jump between two almost equal splits
+    float OtsuThreshold(int channel, float previous=-1, float tolerance=0) const;
+    //numBins values, the normalized cumulative distribution
+    void EqualizationLut(int channel, std::vector<float> &lut) const;
+
+    int numBins=256;
+    uint32_t total=0;
+    //4 * numBins, channel c at counts[c * numBins + bin]
+    std::vector<uint32_t> counts;
+};
+
+//Contrast limited adaptive histogram equalization : one histogram per tile, clipped at clipLimit times the
+//average bin count with the excess spread over all bins, and each pixel interpolated bilinearly between
+//the lookup tables of the 4 closest tiles. Equalizes R, G and B separately if color is set, otherwise outputs the gray scale.
+void ContrastLimitedEqualize(const glm::vec4 *input, glm::vec4 *output, int width, int height, int tilesX, int tilesY, float clipLimit, int numBins=256, bool color=false);
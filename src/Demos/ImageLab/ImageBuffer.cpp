@@ -0,0 +1,116 @@
+#include "ImageBuffer.hpp"
+
+#include <algorithm>
+#include <new>
+
+ScratchPool::~ScratchPool()
+{
+    Clear();
+}
+
+void *ScratchPool::Acquire(size_t bytes)
+{
+    if(bytes >= minBytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        //Most recently released first, it is the most likely to still be in cache
+        for(auto block = blocks.rbegin(); block != blocks.rend(); ++block)
+        {
+            if(block->first != bytes) continue;
+            void *data = block->second;
+            pooledBytes -= bytes;
+            blocks.erase(std::next(block).base());
+            return data;
+        }
+        numAllocations++;
+    }
+    //Operator new is aligned on 16 bytes on all the platforms we build for
+    return ::operator new(bytes);
+}
+
+void ScratchPool::Release(void *block, size_t bytes)
+{
+    if(block == nullptr) return;
+    if(bytes < minBytes)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    blocks.emplace_back(bytes, block);
+    pooledBytes += bytes;
+    Trim();
+}
+
+void ScratchPool::SetCapacity(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = bytes;
+    Trim();
+}
+
+void ScratchPool::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto &block : blocks) ::operator delete(block.second);
+    blocks.clear();
+    pooledBytes = 0;
+}
+
+size_t ScratchPool::PooledBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pooledBytes;
+}
+
+uint64_t ScratchPool::NumAllocations()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return numAllocations;
+}
+
+void ScratchPool::Trim()
+{
+    while(pooledBytes > capacity && !blocks.empty())
+    {
+        pooledBytes -= blocks.front().first;
+        ::operator delete(blocks.front().second);
+        blocks.pop_front();
+    }
+}
+
+ScratchPool &GetScratchPool()
+{
+    static ScratchPool pool;
+    return pool;
+}
+
+ImageBuffer::ImageBuffer(int width, int height)
+{
+    Overwrite(width, height);
+}
+
+glm::vec4 *ImageBuffer::MutableData()
+{
+    if(!storage) return nullptr;
+    if(storage.use_count() > 1)
+    {
+        std::shared_ptr<Storage> copy = std::make_shared<Storage>();
+        copy->pixels.Resize(storage->pixels.size());
+        copy->width = storage->width;
+        copy->height = storage->height;
+        std::copy(storage->pixels.begin(), storage->pixels.end(), copy->pixels.begin());
+        storage = std::move(copy);
+    }
+    return storage->pixels.data();
+}
+
+glm::vec4 *ImageBuffer::Overwrite(int width, int height)
+{
+    if(!storage || storage.use_count() > 1) storage = std::make_shared<Storage>();
+    storage->pixels.Resize((size_t)(std::max)(width, 0) * (std::max)(height, 0));
+    storage->width = width;
+    storage->height = height;
+    return storage->pixels.data();
+}
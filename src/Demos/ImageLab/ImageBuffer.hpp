@@ -0,0 +1,152 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+//Large blocks released by the processes, handed back to the next request of the same size.
+//The stack evaluates the same sizes over and over, so once every size was seen evaluations stop allocating.
+//Blocks smaller than minBytes are not worth keeping and go straight to the allocator.
+class ScratchPool
+{
+public:
+    ~ScratchPool();
+
+    //bytes bytes aligned for SSE, contents unspecified
+    void *Acquire(size_t bytes);
+    void Release(void *block, size_t bytes);
+
+    //Released blocks past capacity are freed, the oldest first
+    void SetCapacity(size_t bytes);
+    void Clear();
+
+    size_t PooledBytes();
+    //Blocks that had to be allocated because none of their size was free, stays constant in steady state
+    uint64_t NumAllocations();
+
+    static const size_t minBytes = 64 * 1024;
+
+private:
+    void Trim();
+
+    std::mutex mutex;
+    //Oldest first
+    std::deque<std::pair<size_t, void*>> blocks;
+    size_t capacity = (size_t)512 << 20;
+    size_t pooledBytes=0;
+    uint64_t numAllocations=0;
+};
+
+//Shared by all the processes
+ScratchPool &GetScratchPool();
+
+//Array of count T from the pool, returned to it when destroyed. Move only.
+//Unlike std::vector the elements are not initialized, Fill them when the previous contents matter.
+template<typename T>
+class ScratchBuffer
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Scratch buffers hold plain data");
+public:
+    ScratchBuffer() = default;
+    explicit ScratchBuffer(size_t count, ScratchPool &pool = GetScratchPool()) : pool(&pool) { Resize(count); }
+    ~ScratchBuffer() { Reset(); }
+
+    ScratchBuffer(const ScratchBuffer&) = delete;
+    ScratchBuffer &operator=(const ScratchBuffer&) = delete;
+    ScratchBuffer(ScratchBuffer &&other) : items(other.items), count(other.count), pool(other.pool)
+    {
+        other.items = nullptr;
+        other.count = 0;
+    }
+    ScratchBuffer &operator=(ScratchBuffer &&other)
+    {
+        if(this != &other)
+        {
+            Reset();
+            items = other.items;
+            count = other.count;
+            pool = other.pool;
+            other.items = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+
+    //The contents are not kept
+    void Resize(size_t newCount)
+    {
+        if(newCount == count) return;
+        Reset();
+        if(newCount == 0) return;
+        items = (T*)pool->Acquire(newCount * sizeof(T));
+        count = newCount;
+    }
+    void Reset()
+    {
+        if(items != nullptr) pool->Release(items, count * sizeof(T));
+        items = nullptr;
+        count = 0;
+    }
+    void Fill(const T &value) { std::fill(items, items + count, value); }
+
+    T *data() { return items; }
+    const T *data() const { return items; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T &operator[](size_t i) { return items[i]; }
+    const T &operator[](size_t i) const { return items[i]; }
+    T *begin() { return items; }
+    T *end() { return items + count; }
+    const T *begin() const { return items; }
+    const T *end() const { return items + count; }
+
+private:
+    T *items=nullptr;
+    size_t count=0;
+    ScratchPool *pool = &GetScratchPool();
+};
+
+//RGBA float image with copy on write pixels : copies share them, and the first write through a shared buffer copies them.
+//Moves hand them over, so an image can go from a stage to the next or to another thread without a copy.
+//Only the owner writes, the others may read from any thread while it does.
+class ImageBuffer
+{
+public:
+    ImageBuffer() = default;
+    ImageBuffer(int width, int height);
+
+    int Width() const { return storage ? storage->width : 0; }
+    int Height() const { return storage ? storage->height : 0; }
+    size_t NumPixels() const { return storage ? storage->pixels.size() : 0; }
+    bool Empty() const { return NumPixels() == 0; }
+    //Other buffers see the same pixels
+    bool IsShared() const { return storage && storage.use_count() > 1; }
+
+    const glm::vec4 *Data() const { return storage ? storage->pixels.data() : nullptr; }
+    const glm::vec4 &operator[](size_t i) const { return storage->pixels[i]; }
+    ConstImageView View() const { return ConstImageView(Data(), Width(), Height()); }
+
+    //Pixels to modify, copied first if they are shared
+    glm::vec4 *MutableData();
+    ImageView MutableView() { glm::vec4 *pixels = MutableData(); return ImageView(pixels, Width(), Height()); }
+    //Pixels to overwrite entirely at width x height : shared pixels are left to the other buffers instead of being copied,
+    //and the storage is kept when the size does not change. Contents unspecified
+    glm::vec4 *Overwrite(int width, int height);
+
+    void Reset() { storage.reset(); }
+
+private:
+    struct Storage
+    {
+        ScratchBuffer<glm::vec4> pixels;
+        int width=0;
+        int height=0;
+    };
+    std::shared_ptr<Storage> storage;
+};
@@ -0,0 +1,657 @@
+#include "ImageExport.hpp"
+#include "Parallel.hpp"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+//Position of the dot of the extension, npos when the file name has none
+static size_t ExtensionDot(const std::string &fileName)
+{
+    size_t dot = fileName.find_last_of('.');
+    size_t separator = fileName.find_last_of("/\\");
+    if(dot == std::string::npos || (separator != std::string::npos && dot < separator) || dot+1 == fileName.size()) return std::string::npos;
+    return dot;
+}
+
+ExportFormat ExportFormatFromPath(const std::string &fileName)
+{
+    size_t dot = ExtensionDot(fileName);
+    if(dot == std::string::npos) return ExportFormat::PNG;
+    std::string extension = fileName.substr(dot+1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+    if(extension == "qoi") return ExportFormat::QOI;
+    if(extension == "ppm") return ExportFormat::PPM;
+    if(extension == "pam") return ExportFormat::PAM;
+    if(extension == "pfm") return ExportFormat::PFM;
+    return ExportFormat::PNG;
+}
+
+const char *ExportFormatExtension(ExportFormat format)
+{
+    switch(format)
+    {
+    case ExportFormat::QOI: return "qoi";
+    case ExportFormat::PPM: return "ppm";
+    case ExportFormat::PAM: return "pam";
+    case ExportFormat::PFM: return "pfm";
+    default: return "png";
+    }
+}
+
+std::string WithExportExtension(const std::string &fileName, ExportFormat format)
+{
+    if(ExtensionDot(fileName) != std::string::npos) return fileName;
+    //A trailing dot is kept, "image." becomes "image.png"
+    if(!fileName.empty() && fileName.back() == '.') return fileName + ExportFormatExtension(format);
+    return fileName + "." + ExportFormatExtension(format);
+}
+
+void ConvertFloatToU8(const glm::vec4 *input, uint8_t *output, size_t numPixels)
+{
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 zero = _mm_setzero_ps();
+    ParallelForChunks(0, (int)((numPixels + 3) / 4), [&](int start, int end)
+    {
+        for(int group=start; group<end; group++)
+        {
+            size_t i = (size_t)group * 4;
+            if(i + 4 > numPixels)
+            {
+                for(; i<numPixels; i++)
+                {
+                    for(int c=0; c<4; c++) output[i*4 + c] = (uint8_t)glm::clamp((int32_t)(input[i][c] * 255.0f), 0, 255);
+                }
+                break;
+            }
+            //Negative values clamped before truncation, saturating packs clamp above 255
+            __m128i a = _mm_cvttps_epi32(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&input[i+0].x), scale), zero));
+            __m128i b = _mm_cvttps_epi32(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&input[i+1].x), scale), zero));
+            __m128i c = _mm_cvttps_epi32(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&input[i+2].x), scale), zero));
+            __m128i d = _mm_cvttps_epi32(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(&input[i+3].x), scale), zero));
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+            _mm_storeu_si128((__m128i*)(output + i*4), packed);
+        }
+    }, 4096);
+}
+
+//
+//------------------------------------------------------------------------
+static uint32_t crcTable[256];
+static void BuildCrcTable()
+{
+    static bool built=false;
+    if(built) return;
+    for(uint32_t n=0; n<256; n++)
+    {
+        uint32_t c = n;
+        for(int k=0; k<8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        crcTable[n] = c;
+    }
+    built=true;
+}
+
+static uint32_t Crc32(const uint8_t *data, size_t size, uint32_t crc=0)
+{
+    crc = ~crc;
+    for(size_t i=0; i<size; i++) crc = crcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static const uint32_t adlerBase = 65521;
+static uint32_t Adler32(const uint8_t *data, size_t size)
+{
+    uint32_t a=1, b=0;
+    while(size > 0)
+    {
+        //Largest run that cannot overflow before the modulo
+        size_t run = (std::min)(size, (size_t)5552);
+        for(size_t i=0; i<run; i++)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= adlerBase;
+        b %= adlerBase;
+        data += run;
+        size -= run;
+    }
+    return (b << 16) | a;
+}
+
+//Checksum of the concatenation of two buffers, from their checksums and the length of the second (as in zlib)
+static uint32_t Adler32Combine(uint32_t adler1, uint32_t adler2, size_t length2)
+{
+    uint32_t remainder = (uint32_t)(length2 % adlerBase);
+    uint32_t sum1 = adler1 & 0xffff;
+    uint32_t sum2 = (uint32_t)(((uint64_t)remainder * sum1) % adlerBase);
+    sum1 += (adler2 & 0xffff) + adlerBase - 1;
+    sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + adlerBase - remainder;
+    if(sum1 >= adlerBase) sum1 -= adlerBase;
+    if(sum1 >= adlerBase) sum1 -= adlerBase;
+    if(sum2 >= (adlerBase << 1)) sum2 -= (adlerBase << 1);
+    if(sum2 >= adlerBase) sum2 -= adlerBase;
+    return sum1 | (sum2 << 16);
+}
+
+//Deflate bit stream, least significant bit first
+struct BitWriter
+{
+    std::vector<uint8_t> &bytes;
+    uint64_t buffer=0;
+    int numBits=0;
+
+    BitWriter(std::vector<uint8_t> &bytes) : bytes(bytes) {}
+
+    void Write(uint32_t value, int count)
+    {
+        buffer |= (uint64_t)value << numBits;
+        numBits += count;
+        while(numBits >= 8)
+        {
+            bytes.push_back((uint8_t)buffer);
+            buffer >>= 8;
+            numBits -= 8;
+        }
+    }
+    //Huffman codes are stored most significant bit first
+    void WriteCode(uint32_t code, int count)
+    {
+        uint32_t reversed=0;
+        for(int i=0; i<count; i++) reversed |= ((code >> i) & 1) << (count-1-i);
+        Write(reversed, count);
+    }
+    void Align()
+    {
+        if(numBits > 0) Write(0, 8 - numBits);
+    }
+};
+
+static const int lengthBases[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+static const int lengthExtraBits[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+static const int distanceBases[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+static const int distanceExtraBits[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+
+//Fixed Huffman code of a literal or length symbol
+static void WriteSymbol(BitWriter &writer, int symbol)
+{
+    if(symbol < 144) writer.WriteCode(0x30 + symbol, 8);
+    else if(symbol < 256) writer.WriteCode(0x190 + symbol - 144, 9);
+    else if(symbol < 280) writer.WriteCode(symbol - 256, 7);
+    else writer.WriteCode(0xc0 + symbol - 280, 8);
+}
+
+static void WriteMatch(BitWriter &writer, int length, int distance)
+{
+    int code=0;
+    while(code < 28 && lengthBases[code+1] <= length) code++;
+    WriteSymbol(writer, 257 + code);
+    if(lengthExtraBits[code]) writer.Write(length - lengthBases[code], lengthExtraBits[code]);
+    code=0;
+    while(code < 29 && distanceBases[code+1] <= distance) code++;
+    writer.WriteCode(code, 5);
+    if(distanceExtraBits[code]) writer.Write(distance - distanceBases[code], distanceExtraBits[code]);
+}
+
+//One strip of the zlib stream, as a single fixed Huffman block with matches from hash chains whose depth grows with level.
+//Strips other than the last end with a sync flush, the last one is the final block.
+static void DeflateStrip(const uint8_t *data, size_t size, int level, bool last, std::vector<uint8_t> &output)
+{
+    BitWriter writer(output);
+    if(level <= 0)
+    {
+        //Stored blocks are byte aligned already
+        size_t position=0;
+        do
+        {
+            size_t length = (std::min)(size - position, (size_t)65535);
+            bool final = last && position + length == size;
+            writer.Write(final ? 1 : 0, 1);
+            writer.Write(0, 2);
+            writer.Align();
+            writer.Write((uint32_t)length, 16);
+            writer.Write((uint32_t)(~length & 0xffff), 16);
+            output.insert(output.end(), data + position, data + position + length);
+            position += length;
+        } while(position < size);
+        return;
+    }
+
+    const int windowSize = 32768;
+    const int hashBits = 15;
+    const int maxChain = 1 << (std::min)(level, 9);
+    std::vector<int> head(1 << hashBits, -1);
+    std::vector<int> previous(windowSize, -1);
+    auto Hash = [&](size_t i) { return (int)(((data[i] << 10) ^ (data[i+1] << 5) ^ data[i+2]) & ((1 << hashBits) - 1)); };
+    auto Insert = [&](size_t i)
+    {
+        if(i + 2 >= size) return;
+        int hash = Hash(i);
+        previous[i & (windowSize-1)] = head[hash];
+        head[hash] = (int)i;
+    };
+
+    writer.Write(last ? 1 : 0, 1);
+    writer.Write(1, 2);
+    size_t i=0;
+    while(i < size)
+    {
+        int bestLength=0, bestDistance=0;
+        if(i + 2 < size)
+        {
+            int candidate = head[Hash(i)];
+            int maxLength = (int)(std::min)(size - i, (size_t)258);
+            for(int chain=0; chain<maxChain && candidate >= 0 && i - candidate <= (size_t)windowSize; chain++)
+            {
+                const uint8_t *a = data + candidate;
+                const uint8_t *b = data + i;
+                if(a[bestLength] == b[bestLength])
+                {
+                    int length=0;
+                    while(length < maxLength && a[length] == b[length]) length++;
+                    if(length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = (int)(i - candidate);
+                        if(length == maxLength) break;
+                    }
+                }
+                int next = previous[candidate & (windowSize-1)];
+                if(next >= candidate) break;
+                candidate = next;
+            }
+        }
+
+        if(bestLength >= 3)
+        {
+            WriteMatch(writer, bestLength, bestDistance);
+            for(int k=0; k<bestLength; k++) Insert(i + k);
+            i += bestLength;
+        }
+        else
+        {
+            WriteSymbol(writer, data[i]);
+            Insert(i);
+            i++;
+        }
+    }
+    WriteSymbol(writer, 256);
+
+    if(!last)
+    {
+        //Empty stored block
+        writer.Write(0, 3);
+        writer.Align();
+        writer.Write(0x0000, 16);
+        writer.Write(0xffff, 16);
+    }
+    writer.Align();
+}
+
+static uint8_t Paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if(pa <= pb && pa <= pc) return (uint8_t)a;
+    if(pb <= pc) return (uint8_t)b;
+    return (uint8_t)c;
+}
+
+//Tries the 5 PNG filters on the row and keeps the one with the smallest sum of absolute values
+static void FilterRow(const uint8_t *row, const uint8_t *above, int rowSize, uint8_t *output, std::vector<uint8_t> &candidate)
+{
+    candidate.resize(rowSize);
+    int bestFilter=0;
+    uint64_t bestScore = UINT64_MAX;
+    for(int filter=0; filter<5; filter++)
+    {
+        if(above == nullptr && (filter == 2 || filter == 4)) continue;
+        uint64_t score=0;
+        for(int x=0; x<rowSize; x++)
+        {
+            int left = x >= 4 ? row[x-4] : 0;
+            int up = above ? above[x] : 0;
+            int upLeft = (above && x >= 4) ? above[x-4] : 0;
+            uint8_t value=0;
+            switch(filter)
+            {
+                case 0: value = row[x]; break;
+                case 1: value = (uint8_t)(row[x] - left); break;
+                case 2: value = (uint8_t)(row[x] - up); break;
+                case 3: value = (uint8_t)(row[x] - ((left + up) >> 1)); break;
+                case 4: value = (uint8_t)(row[x] - Paeth(left, up, upLeft)); break;
+            }
+            candidate[x] = value;
+            score += (uint64_t)std::abs((int8_t)value);
+        }
+        if(score < bestScore)
+        {
+            bestScore = score;
+            bestFilter = filter;
+            memcpy(output + 1, candidate.data(), rowSize);
+        }
+    }
+    output[0] = (uint8_t)bestFilter;
+}
+
+static void WriteBigEndian(std::vector<uint8_t> &bytes, uint32_t value)
+{
+    bytes.push_back((uint8_t)(value >> 24));
+    bytes.push_back((uint8_t)(value >> 16));
+    bytes.push_back((uint8_t)(value >> 8));
+    bytes.push_back((uint8_t)value);
+}
+
+//Chunk type and data are in chunk, preceded by 4 bytes left for the length
+static void FinishChunk(std::vector<uint8_t> &chunk)
+{
+    uint32_t length = (uint32_t)(chunk.size() - 8);
+    chunk[0] = (uint8_t)(length >> 24);
+    chunk[1] = (uint8_t)(length >> 16);
+    chunk[2] = (uint8_t)(length >> 8);
+    chunk[3] = (uint8_t)length;
+    WriteBigEndian(chunk, Crc32(chunk.data() + 4, chunk.size() - 4));
+}
+
+static std::vector<uint8_t> StartChunk(const char *type)
+{
+    std::vector<uint8_t> chunk = {0, 0, 0, 0};
+    chunk.insert(chunk.end(), type, type + 4);
+    return chunk;
+}
+
+bool WritePNG(const std::string &fileName, const glm::vec4 *pixels, int width, int height, int level)
+{
+    BuildCrcTable();
+    int rowSize = width * 4;
+    std::vector<uint8_t> bytes((size_t)rowSize * height);
+    ConvertFloatToU8(pixels, bytes.data(), (size_t)width * height);
+
+    //Strips of rows, a few per thread so that they balance
+    int numStrips = (std::max)(1, (std::min)(height, GetNumThreads() * 4));
+    int rowsPerStrip = (height + numStrips-1) / numStrips;
+    numStrips = (height + rowsPerStrip-1) / rowsPerStrip;
+    std::vector<std::vector<uint8_t>> chunks(numStrips);
+    std::vector<uint32_t> adlers(numStrips);
+    std::vector<size_t> filteredSizes(numStrips);
+    ParallelFor(0, numStrips, [&](int strip)
+    {
+        int startRow = strip * rowsPerStrip;
+        int endRow = (std::min)(height, startRow + rowsPerStrip);
+        std::vector<uint8_t> filtered((size_t)(endRow - startRow) * (rowSize + 1));
+        std::vector<uint8_t> candidate;
+        for(int y=startRow; y<endRow; y++)
+        {
+            const uint8_t *above = y > 0 ? bytes.data() + (size_t)(y-1) * rowSize : nullptr;
+            FilterRow(bytes.data() + (size_t)y * rowSize, above, rowSize, filtered.data() + (size_t)(y - startRow) * (rowSize + 1), candidate);
+        }
+        adlers[strip] = Adler32(filtered.data(), filtered.size());
+        filteredSizes[strip] = filtered.size();
+
+        std::vector<uint8_t> &chunk = chunks[strip];
+        chunk = StartChunk("IDAT");
+        //zlib header : deflate with a 32K window, no dictionary
+        if(strip == 0)
+        {
+            chunk.push_back(0x78);
+            chunk.push_back(0x01);
+        }
+        DeflateStrip(filtered.data(), filtered.size(), level, strip == numStrips-1, chunk);
+        FinishChunk(chunk);
+    }, 1);
+
+    uint32_t adler = adlers[0];
+    for(int strip=1; strip<numStrips; strip++) adler = Adler32Combine(adler, adlers[strip], filteredSizes[strip]);
+
+    std::ofstream file(fileName, std::ios::binary);
+    if(!file) return false;
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    file.write((const char*)signature, 8);
+
+    std::vector<uint8_t> header = StartChunk("IHDR");
+    WriteBigEndian(header, width);
+    WriteBigEndian(header, height);
+    //8 bits, RGBA, deflate, adaptive filtering, not interlaced
+    const uint8_t format[5] = {8, 6, 0, 0, 0};
+    header.insert(header.end(), format, format + 5);
+    FinishChunk(header);
+    file.write((const char*)header.data(), header.size());
+
+    for(int strip=0; strip<numStrips; strip++) file.write((const char*)chunks[strip].data(), chunks[strip].size());
+
+    //The checksum of the zlib stream goes in a last IDAT of its own
+    std::vector<uint8_t> trailer = StartChunk("IDAT");
+    WriteBigEndian(trailer, adler);
+    FinishChunk(trailer);
+    file.write((const char*)trailer.data(), trailer.size());
+
+    std::vector<uint8_t> end = StartChunk("IEND");
+    FinishChunk(end);
+    file.write((const char*)end.data(), end.size());
+    return (bool)file;
+}
+
+bool WriteQOI(const std::string &fileName, const glm::vec4 *pixels, int width, int height)
+{
+    size_t numPixels = (size_t)width * height;
+    std::vector<uint8_t> bytes(numPixels * 4);
+    ConvertFloatToU8(pixels, bytes.data(), numPixels);
+
+    std::vector<uint8_t> output;
+    output.reserve(14 + numPixels * 5 + 8);
+    const char magic[4] = {'q', 'o', 'i', 'f'};
+    output.insert(output.end(), magic, magic + 4);
+    WriteBigEndian(output, width);
+    WriteBigEndian(output, height);
+    output.push_back(4);
+    output.push_back(0);
+
+    struct RGBA { uint8_t r, g, b, a; };
+    RGBA seen[64];
+    memset(seen, 0, sizeof(seen));
+    RGBA previous = {0, 0, 0, 255};
+    int run=0;
+    const RGBA *rgba = (const RGBA*)bytes.data();
+    for(size_t i=0; i<numPixels; i++)
+    {
+        RGBA pixel = rgba[i];
+        if(memcmp(&pixel, &previous, 4) == 0)
+        {
+            run++;
+            if(run == 62 || i == numPixels-1)
+            {
+                output.push_back((uint8_t)(0xc0 | (run-1)));
+                run=0;
+            }
+            continue;
+        }
+        if(run > 0)
+        {
+            output.push_back((uint8_t)(0xc0 | (run-1)));
+            run=0;
+        }
+
+        int hash = (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+        if(memcmp(&seen[hash], &pixel, 4) == 0) output.push_back((uint8_t)hash);
+        else
+        {
+            seen[hash] = pixel;
+            if(pixel.a == previous.a)
+            {
+                int dr = (int8_t)(pixel.r - previous.r);
+                int dg = (int8_t)(pixel.g - previous.g);
+                int db = (int8_t)(pixel.b - previous.b);
+                int drg = dr - dg;
+                int dbg = db - dg;
+                if(dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                {
+                    output.push_back((uint8_t)(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+                }
+                else if(drg >= -8 && drg <= 7 && dg >= -32 && dg <= 31 && dbg >= -8 && dbg <= 7)
+                {
+                    output.push_back((uint8_t)(0x80 | (dg + 32)));
+                    output.push_back((uint8_t)(((drg + 8) << 4) | (dbg + 8)));
+                }
+                else
+                {
+                    const uint8_t op[4] = {0xfe, pixel.r, pixel.g, pixel.b};
+                    output.insert(output.end(), op, op + 4);
+                }
+            }
+            else
+            {
+                const uint8_t op[5] = {0xff, pixel.r, pixel.g, pixel.b, pixel.a};
+                output.insert(output.end(), op, op + 5);
+            }
+        }
+        previous = pixel;
+    }
+    const uint8_t end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    output.insert(output.end(), end, end + 8);
+
+    std::ofstream file(fileName, std::ios::binary);
+    if(!file) return false;
+    file.write((const char*)output.data(), output.size());
+    return (bool)file;
+}
+
+static bool WriteNetpbm(const std::string &fileName, const std::string &header, const glm::vec4 *pixels, int width, int height, int numChannels)
+{
+    size_t numPixels = (size_t)width * height;
+    std::vector<uint8_t> bytes(numPixels * 4);
+    ConvertFloatToU8(pixels, bytes.data(), numPixels);
+    if(numChannels == 3)
+    {
+        for(size_t i=0; i<numPixels; i++) memmove(bytes.data() + i * 3, bytes.data() + i * 4, 3);
+        bytes.resize(numPixels * 3);
+    }
+
+    std::ofstream file(fileName, std::ios::binary);
+    if(!file) return false;
+    file.write(header.data(), header.size());
+    file.write((const char*)bytes.data(), bytes.size());
+    return (bool)file;
+}
+
+bool WritePPM(const std::string &fileName, const glm::vec4 *pixels, int width, int height)
+{
+    std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    return WriteNetpbm(fileName, header, pixels, width, height, 3);
+}
+
+bool WritePAM(const std::string &fileName, const glm::vec4 *pixels, int width, int height)
+{
+    std::string header = "P7\nWIDTH " + std::to_string(width) + "\nHEIGHT " + std::to_string(height) + "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+    return WriteNetpbm(fileName, header, pixels, width, height, 4);
+}
+
+bool WritePFM(const std::string &fileName, const glm::vec4 *pixels, int width, int height)
+{
+    //Negative scale for little endian, rows from the bottom up
+    std::vector<float> values((size_t)width * height * 3);
+    ParallelFor(0, height, [&](int y)
+    {
+        const glm::vec4 *row = pixels + (size_t)(height-1-y) * width;
+        float *out = values.data() + (size_t)y * width * 3;
+        for(int x=0; x<width; x++)
+        {
+            out[x*3 + 0] = row[x].r;
+            out[x*3 + 1] = row[x].g;
+            out[x*3 + 2] = row[x].b;
+        }
+    }, 64);
+
+    std::ofstream file(fileName, std::ios::binary);
+    if(!file) return false;
+    std::string header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + "\n-1.0\n";
+    file.write(header.data(), header.size());
+    file.write((const char*)values.data(), values.size() * sizeof(float));
+    return (bool)file;
+}
+
+bool WriteImage(const std::string &fileName, const glm::vec4 *pixels, int width, int height, ExportFormat format, int pngLevel)
+{
+    switch(format)
+    {
+        case ExportFormat::QOI: return WriteQOI(fileName, pixels, width, height);
+        case ExportFormat::PPM: return WritePPM(fileName, pixels, width, height);
+        case ExportFormat::PAM: return WritePAM(fileName, pixels, width, height);
+        case ExportFormat::PFM: return WritePFM(fileName, pixels, width, height);
+        default: return WritePNG(fileName, pixels, width, height, pngLevel);
+    }
+}
+
+//
+//------------------------------------------------------------------------
+ImageExporter::ImageExporter()
+{
+    thread = std::thread([this]() { Worker(); });
+}
+
+ImageExporter::~ImageExporter()
+{
+    //Queued exports are still written
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping=true;
+    }
+    condition.notify_all();
+    thread.join();
+}
+
+void ImageExporter::Export(const std::string &fileName, ImageBuffer pixels, ExportFormat format, int pngLevel)
+{
+    Job job;
+    job.fileName = fileName;
+    job.pixels = std::move(pixels);
+    job.format = format;
+    job.pngLevel = pngLevel;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+        numPending++;
+    }
+    condition.notify_one();
+}
+
+int ImageExporter::Pending()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return numPending;
+}
+
+bool ImageExporter::LastResult(ExportResult &result)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    result = lastResult;
+    return hasResult;
+}
+
+void ImageExporter::Worker()
+{
+    while(true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if(jobs.empty()) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        ExportResult result;
+        result.fileName = job.fileName;
+        result.succeeded = WriteImage(job.fileName, job.pixels.Data(), job.pixels.Width(), job.pixels.Height(), job.format, job.pngLevel);
+        result.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        lastResult = result;
+        hasResult=true;
+        numPending--;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "ImageBuffer.hpp"
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class ExportFormat
+{
+    PNG=0,
+    QOI=1,
+    PPM=2,
+    PAM=3,
+    PFM=4
+};
+
+//From the extension of the file, PNG when it is not one of the others
+ExportFormat ExportFormatFromPath(const std::string &fileName);
+//Without the dot
+const char *ExportFormatExtension(ExportFormat format);
+//fileName with the extension of format appended when it has none
+std::string WithExportExtension(const std::string &fileName, ExportFormat format);
+
+//Floats in [0, 1] to bytes, truncated, 4 pixels per iteration with SSE
+void ConvertFloatToU8(const glm::vec4 *input, uint8_t *output, size_t numPixels);
+
+//PNG, 8 bit RGBA. Rows are filtered and deflated in parallel strips, each strip ending on a byte boundary with a sync flush
+//so that they can be concatenated into one zlib stream. level 0 stores the rows, 1 to 9 trade speed for size.
+bool WritePNG(const std::string &fileName, const glm::vec4 *pixels, int width, int height, int level=6);
+//Quite OK Image format, 8 bit RGBA. The encoder is sequential by nature, only the conversion to bytes is parallel
+bool WriteQOI(const std::string &fileName, const glm::vec4 *pixels, int width, int height);
+//Uncompressed 8 bit netpbm, RGB for PPM and RGBA for PAM
+bool WritePPM(const std::string &fileName, const glm::vec4 *pixels, int width, int height);
+bool WritePAM(const std::string &fileName, const glm::vec4 *pixels, int width, int height);
+//32 bit float RGB, little endian, exact copy of the pipeline values except alpha
+bool WritePFM(const std::string &fileName, const glm::vec4 *pixels, int width, int height);
+
+bool WriteImage(const std::string &fileName, const glm::vec4 *pixels, int width, int height, ExportFormat format, int pngLevel=6);
+
+struct ExportResult
+{
+    std::string fileName;
+    bool succeeded=false;
+    float milliseconds=0;
+};
+
+//Writes images on a background thread, in the order they were queued.
+//The job shares the pixels of the caller, who can keep working on them : its next write gets its own copy.
+class ImageExporter
+{
+public:
+    ImageExporter();
+    ~ImageExporter();
+
+    void Export(const std::string &fileName, ImageBuffer pixels, ExportFormat format, int pngLevel);
+    //Jobs queued or being written
+    int Pending();
+    //Last finished export, false if there was none yet
+    bool LastResult(ExportResult &result);
+
+private:
+    struct Job
+    {
+        std::string fileName;
+        ImageBuffer pixels;
+        ExportFormat format=ExportFormat::PNG;
+        int pngLevel=6;
+    };
+    void Worker();
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Job> jobs;
+    int numPending=0;
+    bool hasResult=false;
+    ExportResult lastResult;
+    bool stopping=false;
+    std::thread thread;
+};
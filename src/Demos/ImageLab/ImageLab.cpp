@@ -3,9 +3,12 @@
 #include "glad/gl.h"
 
 #include "GL_Helpers/Util.hpp"
+#include "Parallel.hpp"
 #include <fstream>
 #include <sstream>
 #include <random>
+#include <chrono>
+#include <climits>
 
 #include "imgui.h"
 
@@ -25,18 +28,133 @@
 #define MODE 2
 #define DEBUG_INPAINTING 0
 
-float Color2GrayScale(glm::vec3 color)
+glm::vec4 GrayScale2Color(float grayScale, float alpha=0)
 {
-    return (color.r + color.g + color.b) * 0.33333f;
+    return glm::vec4(grayScale,grayScale,grayScale, alpha);
 }
 
-glm::vec4 GrayScale2Color(float grayScale, float alpha=0)
+bool RenderConvolutionGui(ConvolutionEngine &convolution)
 {
-    return glm::vec4(grayScale,grayScale,grayScale, alpha);
+    bool changed=false;
+    changed |= ImGui::Combo("Method", (int*)&convolution.method, "Auto\0Direct\0Separable\0FFT\0\0");
+    if(convolution.lastMethod == ConvolutionMethod::FFT)
+        ImGui::Text("Using FFT, %d x %d tiles", convolution.fftSizeX, convolution.fftSizeY);
+    else if(convolution.lastMethod == ConvolutionMethod::Separable)
+        ImGui::Text("Using Separable, rank %d", (int)convolution.separableTerms.size());
+    else
+        ImGui::Text("Using Direct");
+    return changed;
+}
+
+bool RenderStructuringElementGui(StructuringElement &element, int maxSize)
+{
+    bool changed=false;
+    changed |= ImGui::DragInt("Size", &element.size, 2, 1, maxSize);
+    changed |= ImGui::Combo("Shape", (int*)&element.shape, "Circle\0Diamond\0Line\0Octagon\0Square\0Custom\0\0");
+
+    if(element.shape == StructuringElementShape::Line)
+    {
+        changed |= ImGui::SliderFloat("Rotation", &element.rotation, -180, 180);
+    }
+    if(element.shape == StructuringElementShape::Square)
+    {
+        changed |= ImGui::DragInt("Square Size", &element.subSize, 1, 1, element.size);
+    }
+    if(changed || element.mask.size() != element.size * element.size) element.BuildMask();
+
+    //Editing the mask turns the element into a custom one
+    if(element.size <= 32)
+    {
+        for(int y=0; y<element.size; y++)
+        {
+            for(int x=0; x<element.size; x++)
+            {
+                int flatInx = y * element.size + x;
+                ImGui::PushID(flatInx);
+                ImGui::SetNextItemWidth(20);
+                if(ImGui::DragFloat("", &element.mask[flatInx]))
+                {
+                    element.shape = StructuringElementShape::Custom;
+                    changed=true;
+                }
+                ImGui::PopID();
+                if(x < element.size-1) ImGui::SameLine();
+            }
+        }
+    }
+    return changed;
+}
+
+//The element at the resolution process runs at. On a proxy its sizes are scaled, keeping their parity so that it stays centered
+const StructuringElement &ScaledStructuringElement(const ImageProcess &process, const StructuringElement &element, StructuringElement &scaled)
+{
+    if(process.proxyLevel == 0) return element;
+    scaled = element;
+    scaled.size = process.Scaled(element.size) | (element.size & 1);
+    scaled.subSize = (std::min)(process.Scaled(element.subSize) | (element.subSize & 1), scaled.size);
+    if(element.shape == StructuringElementShape::Custom)
+    {
+        //A proxy pixel is covered when any of the pixels it stands for is
+        scaled.mask.assign(scaled.size * scaled.size, 0.0f);
+        for(int y=0; y<element.size; y++)
+        {
+            for(int x=0; x<element.size; x++)
+            {
+                if(element.mask[y * element.size + x] <= 0) continue;
+                scaled.mask[(y * scaled.size / element.size) * scaled.size + x * scaled.size / element.size] = 1;
+            }
+        }
+    }
+    else scaled.BuildMask();
+    return scaled;
+}
+
+bool RenderHistogramBinsGui(int &numBins)
+{
+    static const int binCounts[] = {256, 4096, 65536};
+    static const char *binNames[] = {"256", "4096", "65536"};
+    int current=0;
+    for(int i=0; i<3; i++) if(binCounts[i]==numBins) current=i;
+    bool changed = ImGui::Combo("Bins", &current, binNames, IM_ARRAYSIZE(binNames));
+    numBins = binCounts[current];
+    return changed;
+}
+
+bool RenderColorSpaceGui(ColorSpace &space)
+{
+    return ImGui::Combo("Color Space", (int*)&space, "RGB\0Gray\0HSV\0YCbCr\0Linear RGB\0Lab\0\0");
+}
+
+//Queues fileName on the loader, releasing the file that was loading before if any
+void RequestTexture(ImageLoader &loader, std::shared_ptr<ImageLoadRequest> &request, const std::string &fileName)
+{
+    loader.Release(request);
+    request = loader.Load(fileName);
 }
 
+//Replaces texture with the decoded file once the request completes, and hands out the decoded pixels if asked. Returns true when it did
+bool ReceiveTexture(ImageLoader &loader, std::shared_ptr<ImageLoadRequest> &request, GL_TextureFloat &texture, std::shared_ptr<const DecodedImage> *image=nullptr)
+{
+    if(!request || !request->Finished()) return false;
+    bool received = request->state == ImageLoadState::Done;
+    if(received)
+    {
+        TextureCreateInfo tci = {};
+        tci.generateMipmaps =false;
+        tci.minFilter = GL_LINEAR;
+        tci.magFilter = GL_LINEAR;        
+
+        if(texture.loaded) texture.Unload();
+        texture = GL_TextureFloat(request->image->width, request->image->height, request->image->pixels.data(), tci);
+        texture.filename = request->fileName;
+        if(image != nullptr) *image = request->image;
+    }
+    loader.Release(request);
+    request.reset();
+    return received;
+}
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void Curve::BuildPath()
 {
     path.resize(numEval);
@@ -277,9 +395,9 @@ void DrawLine(glm::ivec2 x0, glm::ivec2 x1, std::vector<glm::vec4> &image, int w
     int y = x0.y; 
     for (int x=x0.x; x<=x1.x; x++) { 
         if (steep) { 
-            if((x * width + y) >=0 && (x * width + y) < image.size()) image[x * width + y] = color;
+            if((x * width + y) >=0 && (x * width + y) < image.size()) image[(size_t)x * width + y] = color;
         } else { 
-            if((y * width + x) >= 0 && (y * width + x) < image.size())  image[y * width + x] = color;
+            if((y * width + x) >= 0 && (y * width + x) < image.size())  image[(size_t)y * width + x] = color;
         } 
         error += derror; 
         if (error>.5) { 
@@ -340,6 +458,7 @@ void ImageProcessStack::Resize(int newWidth, int newHeight)
         this->width = newWidth;
         this->height = newHeight;
     }
+    MarkChanged(0);
 }
 
 
@@ -347,7 +466,7 @@ ImageProcessStack::ImageProcessStack()
 {
     struct HistogramBuffer 
     {
-        glm::ivec4 histogramGray[255];
+        glm::ivec4 histogramGray[256];
     } histogramData;
     struct BoundsBuffer 
     {
@@ -372,8 +491,6 @@ ImageProcessStack::ImageProcessStack()
     tci.magFilter = GL_LINEAR;
     histogramTexture = GL_TextureFloat(256, 256, tci);
 
-    CreateComputeShader("shaders/Histogram.glsl", &histogramShader);
-    CreateComputeShader("shaders/ResetHistogram.glsl", &resetHistogramShader);
     CreateComputeShader("shaders/RenderHistogram.glsl", &renderHistogramShader);
     CreateComputeShader("shaders/ClearTexture.glsl", &clearTextureShader);
 
@@ -384,11 +501,40 @@ void ImageProcessStack::AddProcess(ImageProcess* imageProcess)
 {
     imageProcess->imageProcessStack = this;
     imageProcesses.push_back(imageProcess);
+    MarkChanged((int)imageProcesses.size()-1);
 
     changed=true;
 }
 
+void ImageProcessStack::MarkChanged(int processIndex)
+{
+    firstChangedProcess = (std::min)(firstChangedProcess, processIndex);
+    std::fill(validTiles.begin(), validTiles.end(), 0);
+}
+
+
+
+const SummedAreaTable &ImageProcessStack::GetSummedAreaTable(GLuint texture, int width, int height)
+{
+    if(summedAreaTableValid && summedAreaTableTexture == texture && summedAreaTable.width == width && summedAreaTable.height == height)
+    {
+        return summedAreaTable;
+    }
+
+    summedAreaTableData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    summedAreaTableData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
+    summedAreaTable.Build(summedAreaTableData.data(), width, height);
+    summedAreaTableTexture = texture;
+    summedAreaTableValid = true;
+    return summedAreaTable;
+}
 
 void ImageProcessStack::RenderHistogram()
 {
@@ -413,97 +559,364 @@ void ImageProcessStack::RenderHistogram()
     glMemoryBarrier(GL_ALL_BARRIER_BITS);        
 }
 
-GLuint ImageProcessStack::Process()
+int ImageProcessStack::ChooseProxyLevel(const std::vector<ImageProcess*> &activeProcesses, int firstStage)
+{
+    if(!proxyMode) return 0;
+    for(int i=0; i<activeProcesses.size(); i++)
+    {
+        if(!activeProcesses[i]->SupportsProxy()) return 0;
+    }
+
+    for(int level=0; level<maxProxyLevel; level++)
+    {
+        //Cached outputs only match the level of the last evaluation, all the stages run on the others
+        int start = (level == proxyLevel) ? firstStage : 0;
+        float cost=0;
+        for(int i=start; i<activeProcesses.size(); i++) cost += activeProcesses[i]->costPerPixel;
+        size_t numPixels = (size_t)(std::max)(1, width >> level) * (size_t)(std::max)(1, height >> level);
+        if(cost * numPixels <= latencyBudget) return level;
+        //Not below 64 pixels
+        if((width >> (level+1)) < 64 || (height >> (level+1)) < 64) return level;
+    }
+    return maxProxyLevel;
+}
+
+void ImageProcessStack::ClearTexture(GLuint texture, int textureWidth, int textureHeight)
 {
-    //Clear the input texture
     glUseProgram(clearTextureShader);
     glUniform1i(glGetUniformLocation(clearTextureShader, "textureOut"), 0); //program must be active
-    glBindImageTexture(0, tex0.glTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-    glDispatchCompute(tex0.width/32+1, tex0.height/32+1, 1);
+    glBindImageTexture(0, texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glDispatchCompute(textureWidth/32+1, textureHeight/32+1, 1);
     glUseProgram(0);
     glMemoryBarrier(GL_ALL_BARRIER_BITS);     
+}
 
-    std::vector<ImageProcess*> activeProcesses;
-    activeProcesses.reserve(imageProcesses.size());
-    for(int i=0; i<imageProcesses.size(); i++)
+GLuint ImageProcessStack::RunStages(const std::vector<ImageProcess*> &activeProcesses, int firstStage, GLuint texture0, GLuint texture1, int textureWidth, int textureHeight, bool storeStages)
+{
+    profile.resize(activeProcesses.size());
+    for(int i=0; i<activeProcesses.size(); i++)
     {
-        if(imageProcesses[i]->enabled) activeProcesses.push_back(imageProcesses[i]);
+        profile[i].name = activeProcesses[i]->name;
+        profile[i].milliseconds = 0;
+        profile[i].cached = i < firstStage;
+        profile[i].arenaBytes = 0;
+    }
+
+    auto processStart = std::chrono::high_resolution_clock::now();
+    for(int i=firstStage; i<activeProcesses.size(); i++)
+    {
+        //The input of this stage is the output of the previous one
+        summedAreaTableValid=false;
+        bool pairPass = i % 2 == 0;
+        GLuint textureOut = pairPass ? texture1 : texture0;
+        auto start = std::chrono::high_resolution_clock::now();
+        activeProcesses[i]->Process(
+                                pairPass ? texture0 : texture1, 
+                                textureOut, 
+                                textureWidth, 
+                                textureHeight);
+        //Shaders run asynchronously, waiting for them keeps their time in their stage
+        glFinish();
+        profile[i].milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        activeProcesses[i]->costPerPixel = profile[i].milliseconds / (float)((size_t)textureWidth * textureHeight);
+        //Nothing a stage allocated on the arena outlives it
+        profile[i].arenaBytes = arena.Peak();
+        arena.Reset();
+
+        if(storeStages)
+        {
+            //Same half floats as the texture, no conversion
+            glBindTexture(GL_TEXTURE_2D, textureOut);
+            glGetTexImage (GL_TEXTURE_2D,
+                            0,
+                            GL_RGBA, // GL will convert to this format
+                            GL_HALF_FLOAT,   // Using this data type per-pixel
+                            stageCache.Store(i, textureWidth, textureHeight));
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
     }
+    processTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - processStart).count();
 
-    for(int i=0; i<activeProcesses.size(); i++)
+    return (activeProcesses.size() % 2 == 0) ? texture0 : texture1;
+}
+
+void ImageProcessStack::UpdateHistogram(const ConstImageView &image)
+{
+    histogram.Compute(image, 256);
+    {
+        //Black is not displayed
+        glm::ivec4 histogramData[256];
+        glm::ivec4 maxBound(0);
+        for(int i=0; i<256; i++)
+        {
+            for(int c=0; c<4; c++) histogramData[i][c] = (i==0) ? 0 : (int)histogram.Channel(c)[i];
+            maxBound = glm::max(maxBound, histogramData[i]);
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogramBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(histogramData), histogramData, GL_DYNAMIC_COPY); 
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(glm::ivec4), &maxBound, GL_DYNAMIC_COPY); 
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    
+    RenderHistogram();
+}
+
+void ImageProcessStack::ResizeTiles()
+{
+    int numTilesX = (width + tileSize-1) / tileSize;
+    int numTilesY = (height + tileSize-1) / tileSize;
+    if(numTilesX != tilesX || numTilesY != tilesY)
+    {
+        tilesX = numTilesX;
+        tilesY = numTilesY;
+        validTiles.assign((size_t)tilesX * tilesY, 0);
+    }
+
+    if(!regionTexture.loaded || regionTexture.width != width || regionTexture.height != height)
+    {
+        if(regionTexture.loaded) regionTexture.Unload();
+        TextureCreateInfo tci = {};
+        tci.minFilter = GL_NEAREST;
+        tci.magFilter = GL_NEAREST;
+        regionTexture = GL_TextureFloat(width, height, tci);
+        std::fill(validTiles.begin(), validTiles.end(), 0);
+    }
+}
+
+ImageRegion ImageProcessStack::MissingTiles()
+{
+    ResizeTiles();
+    ImageRegion visible = view.Expanded(0, width, height);
+    if(visible.Empty()) return ImageRegion();
+
+    //Bounds of the invalid tiles under the view
+    int tileX0 = INT_MAX, tileY0 = INT_MAX, tileX1 = -1, tileY1 = -1;
+    for(int tileY = visible.y0 / tileSize; tileY <= (visible.y1-1) / tileSize; tileY++)
+    {
+        for(int tileX = visible.x0 / tileSize; tileX <= (visible.x1-1) / tileSize; tileX++)
+        {
+            if(validTiles[tileY * tilesX + tileX]) continue;
+            tileX0 = (std::min)(tileX0, tileX);
+            tileY0 = (std::min)(tileY0, tileY);
+            tileX1 = (std::max)(tileX1, tileX);
+            tileY1 = (std::max)(tileY1, tileY);
+        }
+    }
+    if(tileX1 < 0) return ImageRegion();
+
+    ImageRegion missing;
+    missing.x0 = tileX0 * tileSize;
+    missing.y0 = tileY0 * tileSize;
+    missing.x1 = (std::min)((tileX1+1) * tileSize, width);
+    missing.y1 = (std::min)((tileY1+1) * tileSize, height);
+    return missing;
+}
+
+bool ImageProcessStack::TilesMissing()
+{
+    return regionEvaluated && !MissingTiles().Empty();
+}
+
+GLuint ImageProcessStack::ProcessRegion(const std::vector<ImageProcess*> &activeProcesses, int firstStage, const ImageRegion &region, int footprint)
+{
+    regionEvaluated=true;
+    proxyLevel=0;
+    outputWidth=width;
+    outputHeight=height;
+    ResizeTiles();
+    if(outputImage.Width() != width || outputImage.Height() != height) outputImage.Overwrite(width, height);
+
+    //The stages that did not change keep their full resolution outputs in the cache, the first one that changed reads its input from there
+    const uint16_t *cachedInput=nullptr;
+    while(firstStage > 0 && (cachedInput = stageCache.Find(firstStage-1, width, height)) == nullptr) firstStage--;
+    stageCache.Invalidate(firstStage);
+    firstChangedProcess = INT_MAX;
+
+    //Every stage runs on the input region, the part of it that a stage gets wrong because the crop cut its footprint
+    //grows by that footprint, and the margin is the sum of them so the tiles stay exact
+    ImageRegion input = region.Expanded(footprint, width, height);
+    lastRegion = region;
+    lastRegionInput = input;
+    if(!region.Empty())
     {
-        if(i==0)
+        int inputWidth = input.Width();
+        int inputHeight = input.Height();
+        if(!regionTex0.loaded || regionTex0.width != inputWidth || regionTex0.height != inputHeight)
+        {
+            if(regionTex1.loaded) regionTex1.Unload();
+            if(regionTex0.loaded) regionTex0.Unload();
+
+            TextureCreateInfo tci = {};
+            tci.minFilter = GL_NEAREST;
+            tci.magFilter = GL_NEAREST;
+            regionTex1 = GL_TextureFloat(inputWidth, inputHeight, tci);
+            regionTex0 = GL_TextureFloat(inputWidth, inputHeight, tci);
+        }
+
+        if(cachedInput != nullptr)
         {
-            activeProcesses[i]->Process(
-                                    tex0.glTex,
-                                    tex1.glTex,
-                                    width, 
-                                    height);
+            //Rows of the region, straight from the full image
+            glBindTexture(GL_TEXTURE_2D, (firstStage % 2 == 0) ? regionTex0.glTex : regionTex1.glTex);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, inputWidth, inputHeight, GL_RGBA, GL_HALF_FLOAT, cachedInput + ((size_t)input.y0 * width + input.x0) * 4);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glBindTexture(GL_TEXTURE_2D, 0);
         }
         else
         {
-            bool pairPass = i % 2 == 0;
-            activeProcesses[i]->Process(
-                                    pairPass ? tex0.glTex : tex1.glTex, 
-                                    pairPass ? tex1.glTex : tex0.glTex, 
-                                    width, 
-                                    height);
+            ClearTexture(regionTex0.glTex, inputWidth, inputHeight);
+        }
+
+        for(int i=0; i<activeProcesses.size(); i++) activeProcesses[i]->regionOrigin = glm::ivec2(input.x0, input.y0);
+        GLuint resultTexture = RunStages(activeProcesses, firstStage, regionTex0.glTex, regionTex1.glTex, inputWidth, inputHeight, false);
+        for(int i=0; i<activeProcesses.size(); i++) activeProcesses[i]->regionOrigin = glm::ivec2(0);
+
+        //Only the tiles are kept
+        glCopyImageSubData(resultTexture, GL_TEXTURE_2D, 0, region.x0 - input.x0, region.y0 - input.y0, 0,
+                           regionTexture.glTex, GL_TEXTURE_2D, 0, region.x0, region.y0, 0,
+                           region.Width(), region.Height(), 1);
+
+        regionData.resize((size_t)inputWidth * inputHeight);
+        glBindTexture(GL_TEXTURE_2D, resultTexture);
+        glGetTexImage (GL_TEXTURE_2D,
+                        0,
+                        GL_RGBA, // GL will convert to this format
+                        GL_FLOAT,   // Using this data type per-pixel
+                        regionData.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glm::vec4 *output = outputImage.MutableData();
+        for(int y=region.y0; y<region.y1; y++)
+        {
+            const glm::vec4 *row = regionData.data() + (size_t)(y - input.y0) * inputWidth + (region.x0 - input.x0);
+            std::copy(row, row + region.Width(), output + (size_t)y * width + region.x0);
+        }
+
+        for(int tileY = region.y0 / tileSize; tileY < (region.y1 + tileSize-1) / tileSize; tileY++)
+        {
+            for(int tileX = region.x0 / tileSize; tileX < (region.x1 + tileSize-1) / tileSize; tileX++)
+            {
+                validTiles[tileY * tilesX + tileX] = 1;
+            }
+        }
+    }
+    else
+    {
+        //All the visible tiles are valid, only the histogram is updated
+        profile.resize(activeProcesses.size());
+        for(int i=0; i<activeProcesses.size(); i++)
+        {
+            profile[i].name = activeProcesses[i]->name;
+            profile[i].milliseconds = 0;
+            profile[i].cached = true;
+            profile[i].arenaBytes = 0;
         }
+        processTime = 0;
     }
 
+    //Histograms of the visible part, the rest of the output may not be computed
+    ImageRegion visible = view.Expanded(0, width, height);
+    UpdateHistogram(outputImage.View().Crop(visible.x0, visible.y0, visible.x1, visible.y1));
+
+    return regionTexture.glTex;
+}
 
-    GLuint resultTexture = (activeProcesses.size() % 2 == 0) ? tex0.glTex : tex1.glTex;
-    if(activeProcesses.size() == 0)
+GLuint ImageProcessStack::Process(bool interactive)
+{
+    std::vector<ImageProcess*> activeProcesses;
+    activeProcesses.reserve(imageProcesses.size());
+    //Stages before the first changed process have the same input and parameters as in the last evaluation
+    int firstStage=0;
+    for(int i=0; i<imageProcesses.size(); i++)
     {
-        resultTexture = tex0.glTex;
+        if(!imageProcesses[i]->enabled) continue;
+        activeProcesses.push_back(imageProcesses[i]);
+        if(i < firstChangedProcess) firstStage++;
     }
-    
-    //Pass to reset histograms
+    stageCache.SetBudget((size_t)stageCacheBudget << 20);
+    if(!cacheStages) stageCache.Invalidate(0);
+
+    if(interactive && regionMode)
     {
-        glUseProgram(resetHistogramShader);
-        
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogramBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, histogramBuffer);
-        
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, boundsBuffer);
+        //Footprints are at full resolution, regions are not evaluated on proxies
+        int footprint=0;
+        for(int i=0; i<activeProcesses.size() && footprint >= 0; i++)
+        {
+            activeProcesses[i]->proxyLevel = 0;
+            int processFootprint = activeProcesses[i]->Footprint();
+            footprint = (processFootprint < 0) ? -1 : footprint + processFootprint;
+        }
 
-        glDispatchCompute(1, 1, 1);
-        glUseProgram(0);
-        glMemoryBarrier(GL_ALL_BARRIER_BITS);        
+        ImageRegion region = MissingTiles();
+        ImageRegion input = region.Expanded(footprint, width, height);
+        //Past half of the image, the full evaluation that can run on a proxy is faster
+        bool viewed = !view.Expanded(0, width, height).Empty();
+        if(footprint >= 0 && viewed && (size_t)input.Width() * input.Height() * 2 <= (size_t)width * height)
+        {
+            return ProcessRegion(activeProcesses, firstStage, region, footprint);
+        }
     }
+    regionEvaluated=false;
 
-    //Pass to calculate histograms
+    proxyLevel = interactive ? ChooseProxyLevel(activeProcesses, firstStage) : 0;
+    outputWidth = (std::max)(1, width >> proxyLevel);
+    outputHeight = (std::max)(1, height >> proxyLevel);
+    if(proxyLevel > 0 && (!proxyTex0.loaded || proxyTex0.width != outputWidth || proxyTex0.height != outputHeight))
     {
-        glUseProgram(histogramShader);
+        if(proxyTex1.loaded) proxyTex1.Unload();
+        if(proxyTex0.loaded) proxyTex0.Unload();
 
-        glUniform1i(glGetUniformLocation(histogramShader, "textureIn"), 0); //program must be active
-        glBindImageTexture(0, resultTexture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+        TextureCreateInfo tci = {};
+        tci.minFilter = GL_NEAREST;
+        tci.magFilter = GL_NEAREST;
+        proxyTex1 = GL_TextureFloat(outputWidth, outputHeight, tci);
+        proxyTex0 = GL_TextureFloat(outputWidth, outputHeight, tci);
+    }
+    GL_TextureFloat &texture0 = (proxyLevel > 0) ? proxyTex0 : tex0;
+    GL_TextureFloat &texture1 = (proxyLevel > 0) ? proxyTex1 : tex1;
+    for(int i=0; i<activeProcesses.size(); i++) activeProcesses[i]->proxyLevel = proxyLevel;
 
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogramBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, histogramBuffer);
-        
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, boundsBuffer);
-	
-        glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-        glUseProgram(0);
-        glMemoryBarrier(GL_ALL_BARRIER_BITS);        
+    //Resumes from the output of the last unchanged stage, spilled ones are uploaded straight from their mapping
+    const uint16_t *cachedInput=nullptr;
+    while(firstStage > 0 && (cachedInput = stageCache.Find(firstStage-1, outputWidth, outputHeight)) == nullptr) firstStage--;
+    stageCache.Invalidate(firstStage);
+    firstChangedProcess = INT_MAX;
+
+    if(cachedInput != nullptr)
+    {
+        glBindTexture(GL_TEXTURE_2D, (firstStage % 2 == 0) ? texture0.glTex : texture1.glTex);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, outputWidth, outputHeight, GL_RGBA, GL_HALF_FLOAT, cachedInput);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    else
+    {
+        //Clear the input texture
+        ClearTexture(texture0.glTex, texture0.width, texture0.height);
     }
-    
-    
-    RenderHistogram();
 
+    GLuint resultTexture = RunStages(activeProcesses, firstStage, texture0.glTex, texture1.glTex, outputWidth, outputHeight, cacheStages);
+    
     //Read back from texture
-    if(outputImage.size() != width * height) outputImage.resize(width*height); 
     glBindTexture(GL_TEXTURE_2D, resultTexture);
     glGetTexImage (GL_TEXTURE_2D,
                     0,
                     GL_RGBA, // GL will convert to this format
                     GL_FLOAT,   // Using this data type per-pixel
-                    outputImage.data());
+                    outputImage.Overwrite(outputWidth, outputHeight));
     glBindTexture(GL_TEXTURE_2D, 0);    
 
+    //Histograms of the result, computed from the read back data
+    UpdateHistogram(outputImage.View());
+
+    if(regionMode && proxyLevel == 0)
+    {
+        //All the tiles are valid, panning does not compute anything until the next change
+        ResizeTiles();
+        glCopyImageSubData(resultTexture, GL_TEXTURE_2D, 0, 0, 0, 0, regionTexture.glTex, GL_TEXTURE_2D, 0, 0, 0, 0, width, height, 1);
+        std::fill(validTiles.begin(), validTiles.end(), 1);
+    }
+
     return resultTexture;
 }
 
@@ -516,6 +929,36 @@ bool ImageProcessStack::RenderGUI()
     changed |= ImGui::Checkbox("G", &histogramG); ImGui::SameLine();
     changed |= ImGui::Checkbox("B", &histogramB); ImGui::SameLine();
     changed |= ImGui::Checkbox("Gray", &histogramGray);
+
+    ImGui::Checkbox("Cache stage outputs", &cacheStages);
+    ImGui::SliderInt("Stage cache budget (MB)", &stageCacheBudget, 0, 8192);
+    ImGui::Text("Stage cache : %d in memory (%.1f MB), %d on disk (%.1f MB)", stageCache.NumResident(), (float)stageCache.ResidentBytes() / (1024.0f * 1024.0f),
+                                                                             stageCache.NumSpilled(), (float)stageCache.SpilledBytes() / (1024.0f * 1024.0f));
+    ImGui::Text("Scratch pool : %.1f MB free, %d allocations", (float)GetScratchPool().PooledBytes() / (1024.0f * 1024.0f), (int)GetScratchPool().NumAllocations());
+
+    ImGui::Checkbox("Proxy while editing", &proxyMode);
+    if(proxyMode)
+    {
+        ImGui::SliderFloat("Latency budget (ms)", &latencyBudget, 5, 500);
+        ImGui::SliderFloat("Full resolution after (s)", &idleDelay, 0, 5);
+        ImGui::SliderInt("Max proxy level", &maxProxyLevel, 1, 6);
+    }
+    ImGui::Checkbox("Only compute visible tiles when zoomed in", &regionMode);
+    if(ImGui::CollapsingHeader("Profiler"))
+    {
+        ImGui::Text("Last evaluation : %.1f ms at %d x %d (1/%d)", processTime, outputWidth, outputHeight, 1 << proxyLevel);
+        if(regionEvaluated)
+        {
+            ImGui::Text("Tiles of %d x %d at %d, %d from an input of %d x %d", lastRegion.Width(), lastRegion.Height(), lastRegion.x0, lastRegion.y0,
+                                                                              lastRegionInput.Width(), lastRegionInput.Height());
+        }
+        for(int i=0; i<profile.size(); i++)
+        {
+            if(profile[i].cached) ImGui::Text("%s : cached", profile[i].name.c_str());
+            else if(profile[i].arenaBytes > 0) ImGui::Text("%s : %.2f ms, %.1f KB of temporaries", profile[i].name.c_str(), profile[i].milliseconds, (float)profile[i].arenaBytes / 1024.0f);
+            else ImGui::Text("%s : %.2f ms", profile[i].name.c_str(), profile[i].milliseconds);
+        }
+    }
     
     ImGui::Button("+");
     if (ImGui::BeginPopupContextItem("HBEFKWJJNFOIKWEJNF", 0))
@@ -535,11 +978,15 @@ bool ImageProcessStack::RenderGUI()
         if(ImGui::Button("SharpenFilter")) AddProcess(new SharpenFilter(true));
         if(ImGui::Button("SobelFilter")) AddProcess(new SobelFilter(true));
         if(ImGui::Button("MedianFilter")) AddProcess(new MedianFilter(true));
+        if(ImGui::Button("BilateralFilter")) AddProcess(new BilateralFilter(true));
+        if(ImGui::Button("GuidedFilter")) AddProcess(new GuidedFilter(true));
+        if(ImGui::Button("DomainTransformFilter")) AddProcess(new DomainTransformFilter(true));
         if(ImGui::Button("MinMaxFilter")) AddProcess(new MinMaxFilter(true));
         if(ImGui::Button("ArbitraryFilter")) AddProcess(new ArbitraryFilter(true));
         if(ImGui::Button("GaussianBlur")) AddProcess(new GaussianBlur(true));
         if(ImGui::Button("GammaCorrection")) AddProcess(new GammaCorrection(true));
         if(ImGui::Button("Equalize")) AddProcess(new Equalize(true));        
+        if(ImGui::Button("CLAHE")) AddProcess(new CLAHE(true));        
         if(ImGui::Button("FFT Blur")) AddProcess(new FFTBlur(true));        
         if(ImGui::Button("Gradient")) AddProcess(new Gradient(true));        
         if(ImGui::Button("LaplacianOfGaussian")) AddProcess(new LaplacianOfGaussian(true));        
@@ -560,6 +1007,8 @@ bool ImageProcessStack::RenderGUI()
         if(ImGui::Button("SuperPixelsCluster")) AddProcess(new SuperPixelsCluster(true));
         if(ImGui::Button("Erosion")) AddProcess(new Erosion(true));
         if(ImGui::Button("Dilation")) AddProcess(new Dilation(true));
+        if(ImGui::Button("Morphology")) AddProcess(new Morphology(true));
+        if(ImGui::Button("DistanceTransform")) AddProcess(new DistanceTransform(true));
         if(ImGui::Button("RegionProperties")) AddProcess(new RegionProperties(true));
         if(ImGui::Button("HalfToning")) AddProcess(new HalfToning(true));
         if(ImGui::Button("Dithering")) AddProcess(new Dithering(true));
@@ -579,13 +1028,26 @@ bool ImageProcessStack::RenderGUI()
     ImGui::Text("Post Processes");
 	ImGui::Separator();
 
+    for (int n = 0; n < imageProcesses.size(); n++)
+    {
+        if(imageProcesses[n]->Update())
+        {
+            MarkChanged(n);
+            changed=true;
+        }
+    }
+
     static ImageProcess *selectedImageProcess=nullptr;
     for (int n = 0; n < imageProcesses.size(); n++)
     {
         ImageProcess *item = imageProcesses[n];
         
         ImGui::PushID(n * 2 + 0);
-        changed |= ImGui::Checkbox("", &imageProcesses[n]->enabled);
+        if(ImGui::Checkbox("", &imageProcesses[n]->enabled))
+        {
+            MarkChanged(n);
+            changed=true;
+        }
         ImGui::PopID();
         ImGui::SameLine();
         bool isSelected=false;
@@ -606,6 +1068,8 @@ bool ImageProcessStack::RenderGUI()
                 imageProcesses[n] = imageProcesses[n_next];
                 imageProcesses[n_next] = item;
                 ImGui::ResetMouseDragDelta();
+                MarkChanged((std::min)(n, n_next));
+                changed=true;
             }
         }
 
@@ -615,9 +1079,11 @@ bool ImageProcessStack::RenderGUI()
 
 	ImGui::Separator();
     
-    if(selectedImageProcess != nullptr)
+    if(selectedImageProcess != nullptr && selectedImageProcess->RenderGui())
     {
-        changed |= selectedImageProcess->RenderGui();
+        int selectedIndex = (int)(std::find(imageProcesses.begin(), imageProcesses.end(), selectedImageProcess) - imageProcesses.begin());
+        MarkChanged(selectedIndex);
+        changed=true;
     }
 
     return changed;
@@ -625,8 +1091,6 @@ bool ImageProcessStack::RenderGUI()
 
 void ImageProcessStack::Unload()
 {
-    glDeleteProgram(histogramShader);
-    glDeleteProgram(resetHistogramShader);
     glDeleteProgram(renderHistogramShader);
     
     glDeleteBuffers(1, &boundsBuffer);
@@ -775,151 +1239,119 @@ void CurveGrading::Unload()
 
 //
 //------------------------------------------------------------------------
-Equalize::Equalize(bool enabled) : ImageProcess("Equalize", "shaders/Equalize.glsl", enabled)
+Equalize::Equalize(bool enabled) : ImageProcess("Equalize", "", enabled)
 {
-    std::vector<glm::ivec4> lutData(255);
-    glGenBuffers(1, (GLuint*)&lutBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, lutBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, lutData.size() * sizeof(glm::ivec4), lutData.data(), GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lutBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0); 
-
-    std::vector<glm::vec4> pdfData(255);
-    glGenBuffers(1, (GLuint*)&pdfBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, pdfBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, pdfData.size() * sizeof(glm::vec4), pdfData.data(), GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pdfBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0); 
-
-    struct HistogramBuffer 
-    {
-        glm::ivec4 histogramGray[255];
-    } histogramData;
-    struct BoundsBuffer 
-    {
-        // glm::ivec4 minBound;
-        glm::ivec4 maxBound;
-    } boundsData;
-
-    glGenBuffers(1, (GLuint*)&histogramBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogramBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(HistogramBuffer), &histogramData, GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, histogramBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);     
-
-    glGenBuffers(1, (GLuint*)&boundsBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(BoundsBuffer), &boundsData, GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, boundsBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0); 
-
-    CreateComputeShader("shaders/EqualizeBuildPdf.glsl", &buildPdfShader);
-    CreateComputeShader("shaders/EqualizeBuildLut.glsl", &buildLutShader);
-    CreateComputeShader("shaders/ResetHistogram.glsl", &resetHistogramShader);
-    CreateComputeShader("shaders/Histogram.glsl", &histogramShader);
 }
 
 void Equalize::SetUniforms()
 {
-    glUniform1i(glGetUniformLocation(shader, "equalizeColor"), (int)color); //program must be active
 }
 
 void Equalize::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    
-    //Reset histogram
-    {
-        glUseProgram(resetHistogramShader);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogramBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, histogramBuffer);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, boundsBuffer);
-        glDispatchCompute(1, 1, 1);
-        glUseProgram(0);
-        glMemoryBarrier(GL_ALL_BARRIER_BITS);        
-    }
-
-    //Pass to calculate histogram of the input image
-    {
-        glUseProgram(histogramShader);
-
-        glUniform1i(glGetUniformLocation(histogramShader, "textureIn"), 0); //program must be active
-        glBindImageTexture(0, textureIn, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
-
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogramBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, histogramBuffer);
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, boundsBuffer);
-	
-        glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-        glUseProgram(0);
-        glMemoryBarrier(GL_ALL_BARRIER_BITS);        
+    Histogram histogram;
+    histogram.Compute(inputData.data(), width, height, numBins);
+    std::vector<float> luts[3];
+    if(color)
+    {
+        for(int c=0; c<3; c++) histogram.EqualizationLut(c, luts[c]);
     }
-    
-    
-    { //build lut
-        glUseProgram(buildLutShader);
-        
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogramBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, histogramBuffer);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-        
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pdfBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, pdfBuffer);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-        
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lutBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, lutBuffer);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-        
-        glUniform1f(glGetUniformLocation(buildLutShader, "textureSize"), (float)(width * height)); //program must be active
-        
-        glDispatchCompute(1, 1, 1);
-        glUseProgram(0);
-        glMemoryBarrier(GL_ALL_BARRIER_BITS);            
+    else
+    {
+        histogram.EqualizationLut(HISTOGRAM_GRAY, luts[0]);
     }
 
-    
-    { //correction pass
-        glUseProgram(shader);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lutBuffer);
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, lutBuffer);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-        
-        SetUniforms();
+    ParallelForChunks(0, height, [&](int startRow, int endRow)
+    {
+        for(int y=startRow; y<endRow; y++)
+        {
+            size_t row = (size_t)y * width;
+            for(int x=0; x<width; x++)
+            {
+                size_t i = row + x;
+                const glm::vec4 &pixel = inputData[i];
+                if(color)
+                {
+                    for(int c=0; c<3; c++) outputData[i][c] = luts[c][histogram.Bin(pixel[c])];
+                }
+                else
+                {
+                    float value = luts[0][histogram.Bin(RGBToGray(pixel))];
+                    outputData[i] = glm::vec4(value);
+                }
+                outputData[i].a = 1;
+            }
+        }
+    }, 8);
 
-        glUniform1i(glGetUniformLocation(shader, "textureIn"), 0); //program must be active
-        glBindImageTexture(0, textureIn, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
-        
-        glUniform1i(glGetUniformLocation(shader, "textureOut"), 1); //program must be active
-        glBindImageTexture(1, textureOut, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-        
-        glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-        glUseProgram(0);
-        glMemoryBarrier(GL_ALL_BARRIER_BITS);    
-    }
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 bool Equalize::RenderGui()
 {
     bool changed=false;
     changed |= ImGui::Checkbox("Color", &color);
+    changed |= RenderHistogramBinsGui(numBins);
     return changed;
 }
 
 void Equalize::Unload()
 {
-    glDeleteBuffers(1, &lutBuffer);
-    glDeleteBuffers(1, &pdfBuffer);
-    glDeleteBuffers(1, &histogramBuffer);
-    glDeleteBuffers(1, &boundsBuffer);
-    
-    
-    glDeleteProgram(resetHistogramShader);
-    glDeleteProgram(histogramShader);
-    glDeleteProgram(buildPdfShader);
-    glDeleteProgram(buildLutShader);    
+}
+
+//
+
+//
+//------------------------------------------------------------------------
+CLAHE::CLAHE(bool enabled) : ImageProcess("CLAHE", "", enabled)
+{
+}
+
+void CLAHE::SetUniforms()
+{
+}
+
+void CLAHE::Process(GLuint textureIn, GLuint textureOut, int width, int height)
+{
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    ContrastLimitedEqualize(inputData.data(), outputData.data(), width, height, tilesX, tilesY, clipLimit, numBins, color);
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool CLAHE::RenderGui()
+{
+    bool changed=false;
+    changed |= ImGui::Checkbox("Color", &color);
+    changed |= ImGui::SliderInt("Tiles X", &tilesX, 1, 64);
+    changed |= ImGui::SliderInt("Tiles Y", &tilesY, 1, 64);
+    changed |= ImGui::SliderFloat("Clip Limit", &clipLimit, 1, 16);
+    changed |= RenderHistogramBinsGui(numBins);
+    return changed;
 }
 
 //
@@ -930,6 +1362,35 @@ ColorContrastStretch::ColorContrastStretch(bool enabled) : ImageProcess("ColorCo
 {
 }
 
+void ColorContrastStretch::Process(GLuint textureIn, GLuint textureOut, int width, int height)
+{
+    if(automatic)
+    {
+        //Bounds from the percentiles of the input, clipPercent of the pixels saturate at each end
+        inputData.resize((size_t)width * height);
+        glBindTexture(GL_TEXTURE_2D, textureIn);
+        glGetTexImage (GL_TEXTURE_2D,
+                        0,
+                        GL_RGBA, // GL will convert to this format
+                        GL_FLOAT,   // Using this data type per-pixel
+                        inputData.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        Histogram histogram;
+        histogram.Compute(inputData.data(), width, height, 4096);
+        float fraction = clipPercent / 100.0f;
+        for(int c=0; c<3; c++)
+        {
+            lowerBound[c] = histogram.Percentile(c, fraction);
+            upperBound[c] = (std::max)(histogram.Percentile(c, 1 - fraction), lowerBound[c] + 1.0f / 4096.0f);
+        }
+        globalLowerBound = histogram.Percentile(HISTOGRAM_GRAY, fraction);
+        globalUpperBound = (std::max)(histogram.Percentile(HISTOGRAM_GRAY, 1 - fraction), globalLowerBound + 1.0f / 4096.0f);
+    }
+
+    ImageProcess::Process(textureIn, textureOut, width, height);
+}
+
 void ColorContrastStretch::SetUniforms()
 {
     if(global)
@@ -961,8 +1422,12 @@ bool ColorContrastStretch::RenderGui()
         changed |= ImGui::DragFloatRange2("Range Blue", &lowerBound.z, &upperBound.z, 0.01f, 0, 1);
     }
 
-    
-    return changed;    
+    changed |= ImGui::Checkbox("Automatic", &automatic);
+    if(automatic)
+    {
+        changed |= ImGui::SliderFloat("Clip Percent", &clipPercent, 0, 25);
+    }
+    return changed;
 }
 //
 
@@ -980,24 +1445,56 @@ bool Negative::RenderGui()
 
 //
 //------------------------------------------------------------------------
-LocalThreshold::LocalThreshold(bool enabled) : ImageProcess("LocalThreshold", "shaders/LocalThreshold.glsl", enabled)
+LocalThreshold::LocalThreshold(bool enabled) : ImageProcess("LocalThreshold", "", enabled)
 {
     
 }
 
-void LocalThreshold::SetUniforms()
+void LocalThreshold::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    glUniform1i(glGetUniformLocation(shader, "size"), size);  
-    glUniform1f(glGetUniformLocation(shader, "a"), a);  
-    glUniform1f(glGetUniformLocation(shader, "b"), b);  
+    const SummedAreaTable &table = imageProcessStack->GetSummedAreaTable(textureIn, width, height);
+    const std::vector<glm::vec4> &inputData = imageProcessStack->summedAreaTableData;
+    outputData.resize((size_t)width * height);
+
+    int halfSize = Scaled(size)/2;
+    ParallelFor(0, height, [&](int y)
+    {
+        for(int x=0; x<width; x++)
+        {
+            glm::vec4 mean;
+            float deviation;
+            table.MeanAndGrayDeviation(x - halfSize, y - halfSize, x + halfSize, y + halfSize, mean, deviation);
+
+            glm::vec4 color = inputData[(size_t)y * width + x];
+            float grayScale = RGBToGray(color);
+            if(method == Method::Deviation)
+            {
+                if(std::abs(grayScale - mean.w) >= deviation) color = glm::vec4(0);
+            }
+            else
+            {
+                float threshold = mean.w - k;
+                if(method == Method::Niblack) threshold = mean.w + k * deviation;
+                else if(method == Method::Sauvola) threshold = mean.w * (1 + k * (deviation / dynamicRange - 1));
+                color = glm::vec4(grayScale > threshold ? 1.0f : 0.0f);
+            }
+            color.a = 1;
+            outputData[(size_t)y * width + x] = color;
+        }
+    }, 8);
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 bool LocalThreshold::RenderGui()
 { 
     bool changed=false;
-    changed |= ImGui::SliderInt("Size", &size, 0, 33);
-    changed |= ImGui::DragFloat("A", &a, 0.001f);
-    changed |= ImGui::DragFloat("B", &b, 0.001f);
+    changed |= ImGui::Combo("Method", (int*)&method, "Deviation\0Niblack\0Sauvola\0Mean\0\0");
+    changed |= ImGui::SliderInt("Size", &size, 0, 512);
+    if(method != Method::Deviation) changed |= ImGui::DragFloat("K", &k, 0.001f);
+    if(method == Method::Sauvola) changed |= ImGui::DragFloat("Dynamic Range", &dynamicRange, 0.001f, 0.001f, 1);
     return changed;
 }
 //
@@ -1063,12 +1560,20 @@ bool Quantization::RenderGui()
 
 //
 //------------------------------------------------------------------------
-Transform::Transform(bool enabled) : ImageProcess("Transform", "shaders/Transform.glsl", enabled)
+Transform::Transform(bool enabled) : ImageProcess("Transform", "", enabled)
 {}
 
-void Transform::SetUniforms()
+void Transform::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    glm::mat3 transform(1);
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
     float cosTheta = cos(glm::radians(theta));
     float sinTheta = sin(glm::radians(theta));
@@ -1080,8 +1585,8 @@ void Transform::SetUniforms()
     rotationMatrix[1][1] = cosTheta;
 
     glm::mat3 translationMatrix(1);
-    translationMatrix[2][0] = translation.x;
-    translationMatrix[2][1] = translation.y;
+    translationMatrix[2][0] = translation.x * ResolutionScale();
+    translationMatrix[2][1] = translation.y * ResolutionScale();
 
     glm::mat3 shearMatrix(1);
     shearMatrix[1][0] = shear.x;
@@ -1091,15 +1596,35 @@ void Transform::SetUniforms()
     scaleMatrix[0][0] = scale.x;
     scaleMatrix[1][1] = scale.y;
     
-    
-    transform = rotationMatrix * shearMatrix * scaleMatrix * translationMatrix;
-    transform = glm::inverse(transform);    
+    //The transform is around the center of the image
+    glm::mat3 toCenter(1);
+    toCenter[2][0] = -width * 0.5f;
+    toCenter[2][1] = -height * 0.5f;
+    glm::mat3 fromCenter(1);
+    fromCenter[2][0] = width * 0.5f;
+    fromCenter[2][1] = height * 0.5f;
 
-    glUniformMatrix3fv(glGetUniformLocation(shader, "transformMatrix"), 1, GL_FALSE, glm::value_ptr(transform));
-    glUniform1i(glGetUniformLocation(shader, "interpolation"), interpolation);
-    
-    glUniform1i(glGetUniformLocation(shader, "flipX"), (int)flipX);
-    glUniform1i(glGetUniformLocation(shader, "flipY"), (int)flipY);
+    glm::mat3 flipMatrix(1);
+    if(flipX)
+    {
+        flipMatrix[0][0] = -1;
+        flipMatrix[2][0] = (float)(width-1);
+    }
+    if(flipY)
+    {
+        flipMatrix[1][1] = -1;
+        flipMatrix[2][1] = (float)(height-1);
+    }
+
+    glm::mat3 transform = rotationMatrix * shearMatrix * scaleMatrix * translationMatrix;
+    glm::mat3 outputToInput = fromCenter * glm::inverse(transform) * toCenter * flipMatrix;
+
+    WarpAffine(inputData.data(), width, height, outputData.data(), width, height, outputToInput, filter);
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 bool Transform::RenderGui()
@@ -1111,7 +1636,7 @@ bool Transform::RenderGui()
     changed |= ImGui::DragFloat2("Scale", &scale[0], 0.1f);
     changed |= ImGui::DragFloat2("Shear", &shear[0], 0.01f);
 
-    changed |= ImGui::Combo("Render Mode", &interpolation, "Nearest\0Bilinear\0Bicubic\0\0");
+    changed |= ImGui::Combo("Render Mode", (int*)&filter, "Nearest\0Box\0Bilinear\0Bicubic\0Lanczos 3\0\0");
 
     changed |= ImGui::Checkbox("Flip X", &flipX);
     changed |= ImGui::Checkbox("Flip Y", &flipY);
@@ -1122,18 +1647,41 @@ bool Transform::RenderGui()
 
 //
 //------------------------------------------------------------------------
-Resampling::Resampling(bool enabled) : ImageProcess("Resampling", "shaders/Resampling.glsl", enabled)
+Resampling::Resampling(bool enabled) : ImageProcess("Resampling", "", enabled)
 {}
 
-void Resampling::SetUniforms()
+void Resampling::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    glUniform1i(glGetUniformLocation(shader, "pixelSize"), pixelSize);
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    //Reduce by pixelSize, then back to the size of the image
+    int scaledPixelSize = Scaled(pixelSize);
+    int reducedWidth = (std::max)(1, (width + scaledPixelSize/2) / scaledPixelSize);
+    int reducedHeight = (std::max)(1, (height + scaledPixelSize/2) / scaledPixelSize);
+    reducedData.resize((size_t)reducedWidth * reducedHeight);
+    ResampleImage(inputData.data(), width, height, reducedData.data(), reducedWidth, reducedHeight, downFilter);
+    ResampleImage(reducedData.data(), reducedWidth, reducedHeight, outputData.data(), width, height, upFilter);
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 bool Resampling::RenderGui()
 {
     bool changed=false;
     changed |= ImGui::SliderInt("Pixel Size", &pixelSize, 1, 255);
+    changed |= ImGui::Combo("Down Filter", (int*)&downFilter, "Nearest\0Box\0Bilinear\0Bicubic\0Lanczos 3\0\0");
+    changed |= ImGui::Combo("Up Filter", (int*)&upFilter, "Nearest\0Box\0Bilinear\0Bicubic\0Lanczos 3\0\0");
     return changed;
 }
 //
@@ -1163,18 +1711,33 @@ bool AddNoise::RenderGui()
 
 //
 //------------------------------------------------------------------------
-SmoothingFilter::SmoothingFilter(bool enabled) : ImageProcess("SmoothingFilter", "shaders/SmoothingFilter.glsl", enabled)
+SmoothingFilter::SmoothingFilter(bool enabled) : ImageProcess("SmoothingFilter", "", enabled)
 {}
 
-void SmoothingFilter::SetUniforms()
+void SmoothingFilter::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    glUniform1i(glGetUniformLocation(shader, "size"), size);
+    const SummedAreaTable &table = imageProcessStack->GetSummedAreaTable(textureIn, width, height);
+    outputData.resize((size_t)width * height);
+
+    int halfSize = Scaled(size)/2;
+    ParallelFor(0, height, [&](int y)
+    {
+        for(int x=0; x<width; x++)
+        {
+            glm::vec4 mean = table.Mean(x - halfSize, y - halfSize, x + halfSize, y + halfSize);
+            outputData[(size_t)y * width + x] = glm::vec4(glm::vec3(mean), 1);
+        }
+    }, 8);
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 bool SmoothingFilter::RenderGui()
 {
     bool changed=false;
-    changed |= ImGui::SliderInt("Size", &size, 0, 128);
+    changed |= ImGui::SliderInt("Size", &size, 0, 512);
     return changed;
 }
 //
@@ -1203,9 +1766,239 @@ void MedianFilter::SetUniforms()
 {
 }
 
+void MedianFilter::Process(GLuint textureIn, GLuint textureOut, int width, int height)
+{
+    if(cross)
+    {
+        ImageProcess::Process(textureIn, textureOut, width, height);
+        return;
+    }
+
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    MedianFilterSquare(inputData.data(), outputData.data(), width, height, Scaled(radius));
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 bool MedianFilter::RenderGui()
 {
-    return false;
+    bool changed=false;
+    changed |= ImGui::Checkbox("Cross", &cross);
+    if(!cross) changed |= ImGui::SliderInt("Radius", &radius, 1, MEDIAN_MAX_RADIUS);
+    return changed;
+}
+//
+
+//
+//------------------------------------------------------------------------
+BilateralFilter::BilateralFilter(bool enabled) : ImageProcess("BilateralFilter", "", enabled)
+{}
+
+void BilateralFilter::Process(GLuint textureIn, GLuint textureOut, int width, int height)
+{
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if(bruteForce) BilateralFilterReference(inputData.data(), outputData.data(), width, height, Scaled(sigmaSpatial, 1.0f), sigmaRange);
+    else grid.Filter(inputData.data(), outputData.data(), width, height, Scaled(sigmaSpatial, 1.0f), sigmaRange);
+    processTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool BilateralFilter::RenderGui()
+{
+    bool changed=false;
+    changed |= ImGui::SliderFloat("Sigma Spatial", &sigmaSpatial, 1, 64);
+    changed |= ImGui::SliderFloat("Sigma Range", &sigmaRange, 0.01f, 1);
+    changed |= ImGui::Checkbox("Brute Force", &bruteForce);
+    if(bruteForce) ImGui::Text("Brute force : %.1f ms", processTime);
+    else ImGui::Text("Grid %d x %d x %d : %.1f ms", grid.gridWidth, grid.gridHeight, grid.gridDepth, processTime);
+    return changed;
+}
+//
+
+//
+//------------------------------------------------------------------------
+bool GuideImage::RenderGui()
+{
+    bool changed=false;
+    ImGui::Text("Guide : %s", file ? fileName.c_str() : loadRequest ? "Loading..." : "Input");
+    if(ImGui::Button("Load Guide"))
+    {
+        nfdchar_t *LoadPath = 0;
+        nfdresult_t Result = NFD_OpenDialog(NULL, NULL, &LoadPath);
+        if(Result == NFD_OKAY)
+        {
+            fileName = std::string(LoadPath);
+            filenameChanged=true;
+        }        
+    }
+    if(file)
+    {
+        ImGui::SameLine();
+        if(ImGui::Button("Use Input"))
+        {
+            file.reset();
+            changed=true;
+        }
+    }
+    return changed;
+}
+
+bool GuideImage::Update(ImageLoader &loader)
+{
+    if(filenameChanged)
+    {
+        loader.Release(loadRequest);
+        loadRequest = loader.Load(fileName);
+        filenameChanged = false;
+    }
+    if(!loadRequest || !loadRequest->Finished()) return false;
+
+    //The guide is only read on the CPU, so the decoded pixels are used as they are
+    bool received = loadRequest->state == ImageLoadState::Done;
+    if(received)
+    {
+        file = loadRequest->image;
+        guideChanged=true;
+    }
+    loader.Release(loadRequest);
+    loadRequest.reset();
+    return received;
+}
+
+const glm::vec4 *GuideImage::Get(const std::vector<glm::vec4> &input, int width, int height)
+{
+    if(!file) return input.data();
+
+    if(guideChanged || guideData.size() != input.size())
+    {
+        guideData.resize(input.size());
+        ResampleImage(file->pixels.data(), file->width, file->height, guideData.data(), width, height, ResampleFilter::Triangle);
+        guideChanged=false;
+    }
+    return guideData.data();
+}
+
+void GuideImage::Unload(ImageLoader &loader)
+{
+    loader.Release(loadRequest);
+}
+//
+
+//
+//------------------------------------------------------------------------
+GuidedFilter::GuidedFilter(bool enabled) : ImageProcess("GuidedFilter", "", enabled)
+{}
+
+void GuidedFilter::Process(GLuint textureIn, GLuint textureOut, int width, int height)
+{
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    filter.Filter(guide.Get(inputData, width, height), inputData.data(), outputData.data(), width, height, Scaled(radius), epsilon, Scaled(subsampling));
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool GuidedFilter::RenderGui()
+{
+    bool changed=false;
+    changed |= ImGui::SliderInt("Radius", &radius, 1, 128);
+    changed |= ImGui::DragFloat("Epsilon", &epsilon, 0.0001f, 0.00001f, 1, "%.5f");
+    changed |= ImGui::SliderInt("Subsampling", &subsampling, 1, 16);
+    changed |= guide.RenderGui();
+    return changed;
+}
+
+bool GuidedFilter::Update()
+{
+    return guide.Update(imageProcessStack->imageLoader);
+}
+
+void GuidedFilter::Unload()
+{
+    guide.Unload(imageProcessStack->imageLoader);
+}
+//
+
+//
+//------------------------------------------------------------------------
+DomainTransformFilter::DomainTransformFilter(bool enabled) : ImageProcess("DomainTransformFilter", "", enabled)
+{}
+
+void DomainTransformFilter::Process(GLuint textureIn, GLuint textureOut, int width, int height)
+{
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    filter.Filter(guide.Get(inputData, width, height), inputData.data(), outputData.data(), width, height, Scaled(sigmaSpatial, 1.0f), sigmaRange, iterations);
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool DomainTransformFilter::RenderGui()
+{
+    bool changed=false;
+    changed |= ImGui::SliderFloat("Sigma Spatial", &sigmaSpatial, 1, 200);
+    changed |= ImGui::SliderFloat("Sigma Range", &sigmaRange, 0.01f, 2);
+    changed |= ImGui::SliderInt("Iterations", &iterations, 1, 5);
+    changed |= guide.RenderGui();
+    return changed;
+}
+
+bool DomainTransformFilter::Update()
+{
+    return guide.Update(imageProcessStack->imageLoader);
+}
+
+void DomainTransformFilter::Unload()
+{
+    guide.Unload(imageProcessStack->imageLoader);
 }
 //
 
@@ -1229,20 +2022,34 @@ bool SobelFilter::RenderGui()
 
 //
 //------------------------------------------------------------------------
-MinMaxFilter::MinMaxFilter(bool enabled) : ImageProcess("MinMaxFilter", "shaders/MinMaxFilter.glsl", enabled)
+MinMaxFilter::MinMaxFilter(bool enabled) : ImageProcess("MinMaxFilter", "", enabled)
 {}
 
-void MinMaxFilter::SetUniforms()
+void MinMaxFilter::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    glUniform1i(glGetUniformLocation(shader, "size"), size);
-    glUniform1i(glGetUniformLocation(shader, "doMin"), doMin);
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    MinMaxFilterSquare(inputData.data(), outputData.data(), width, height, Scaled(size), doMin);
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 bool MinMaxFilter::RenderGui()
 {
     bool changed=false;
     changed |= ImGui::Checkbox("Min", &doMin);
-    changed |= ImGui::SliderInt("size", &size, 1, 32);
+    changed |= ImGui::SliderInt("size", &size, 1, 256);
     return changed;
 }
 //
@@ -1279,89 +2086,68 @@ bool Gradient::RenderGui()
 
 //
 //------------------------------------------------------------------------
-GaussianBlur::GaussianBlur(bool enabled) : ImageProcess("GaussianBlur", "shaders/GaussianBlur.glsl", enabled)
+GaussianBlur::GaussianBlur(bool enabled) : ImageProcess("GaussianBlur", "", enabled)
 {
-    kernel.resize(maxSize * maxSize);
-    glGenBuffers(1, (GLuint*)&kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, kernel.size() * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);     
 }
 
-void GaussianBlur::RecalculateKernel()
+void GaussianBlur::UpdateFilter()
 {
-    int halfSize = (int)std::floor(size / 2.0f);
-    double r, s = 2.0 * sigma * sigma;
-    double sum = 0.0;
-    
-    for (int x = -halfSize; x <= halfSize; x++) {
-        for (int y = -halfSize; y <= halfSize; y++) {
-            int flatInx = (y + halfSize) * size + (x + halfSize);
-            r = (float)sqrt(x * x + y * y);
-			double num = (exp(-(r * r) / s));
-			double denom = (PI * s);
-            kernel[flatInx] =  (float)(num / denom);
-            sum += kernel[flatInx];
-        }
-    }
+    filter.sigma = Scaled(sigma, 0.5f);
+    filter.firSize = (filter.method == GaussianMethod::FIR) ? Scaled(size) : 0;
+}
 
-    // normalising the Kernel
-    for (int i = 0; i < size; ++i)
-    {
-        for (int j = 0; j < size; ++j)
-        {
-            int flatInx = (i) * size + (j);
-            kernel[flatInx] /= (float)sum;
-        }
-    }
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, kernel.size() * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+void GaussianBlur::Blur(const glm::vec4 *input, glm::vec4 *output, int width, int height)
+{
+    UpdateFilter();
+    filter.Blur(input, output, width, height);
+}
 
-    shouldRecalculateKernel=false;
+int GaussianBlur::Footprint()
+{
+    UpdateFilter();
+    return filter.Radius();
 }
 
-void GaussianBlur::SetUniforms()
+void GaussianBlur::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    if(shouldRecalculateKernel) RecalculateKernel();
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    glUniform1i(glGetUniformLocation(shader, "size"), size);
-    
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
+    Blur(inputData.data(), outputData.data(), width, height);
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 bool GaussianBlur::RenderGui()
 {
     bool changed=false;
-    shouldRecalculateKernel |= ImGui::SliderInt("Size", &size, 1, maxSize);
-    shouldRecalculateKernel |= ImGui::SliderFloat("Sigma", &sigma, 1, 10);
-
-    changed |= shouldRecalculateKernel;
+    changed |= ImGui::Combo("Method", (int*)&filter.method, "Auto\0Recursive\0FIR\0\0");
+    changed |= ImGui::SliderFloat("Sigma", &sigma, 0.5f, 50);
+    if(filter.method == GaussianMethod::FIR) changed |= ImGui::SliderInt("Size", &size, 1, maxSize);
+    ImGui::Text("Using %s", filter.lastMethod == GaussianMethod::Recursive ? "Recursive" : "FIR");
     return changed;
 }
-
-void GaussianBlur::Unload()
-{
-    glDeleteBuffers(1, &kernelBuffer);
-}
 //
 
 //
 //------------------------------------------------------------------------
-HalfToning::HalfToning(bool enabled) : ImageProcess("HalfToning", "shaders/HalfToning.glsl", enabled)
-{
-    H.resize(5 * 5);
-    glGenBuffers(1, (GLuint*)&HBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, HBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, H.size() * sizeof(float), H.data(), GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, HBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);     
-}
+HalfToning::HalfToning(bool enabled) : ImageProcess("HalfToning", "", enabled)
+{}
 
 void HalfToning::RecalculateKernel()
 {
+    std::vector<float> H;
+    int size;
     if(maskType==0)
     {
         float t = 1 / 255.0f;
@@ -1375,7 +2161,7 @@ void HalfToning::RecalculateKernel()
         };
         size = 5;
     }
-    else if(maskType==1)
+    else
     {
         float t = 16 / 255.0f;
         H = 
@@ -1388,64 +2174,38 @@ void HalfToning::RecalculateKernel()
         size = 4;
     }
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, HBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, H.size() * sizeof(float), H.data(), GL_DYNAMIC_COPY); 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    //value + intensity * H > 1 is a binary dither with the threshold 1 - intensity * H
+    for(size_t i=0; i<H.size(); i++) H[i] = 1 - intensity * H[i];
+    tile.BuildFromValues(size, H);
 
     shouldRecalculateH=false;
 }
 
-glm::mat3 HalfToning::CalculateTransform(float theta)
-{
-    glm::mat3 transform;
-    float cosTheta = cos(glm::radians(theta));
-    float sinTheta = sin(glm::radians(theta));
-
-    glm::mat3 rotationMatrix(1);
-    rotationMatrix[0][0] = cosTheta;
-    rotationMatrix[1][0] = -sinTheta;
-    rotationMatrix[0][1] = sinTheta;
-    rotationMatrix[1][1] = cosTheta;
-    
-    transform = rotationMatrix;
-    transform = glm::inverse(transform);    
-    return transform;
-
-}
-
-void HalfToning::SetUniforms()
+void HalfToning::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
     if(shouldRecalculateH) RecalculateKernel();
 
-    if(grayScale)
-    {
-        transformR = CalculateTransform(rotation.r);
-        glUniformMatrix3fv(glGetUniformLocation(shader, "rotation"), 1, GL_FALSE, glm::value_ptr(transformR));
-    }
-    else
-    {
-        transformR = CalculateTransform(rotation.r);
-        transformG = CalculateTransform(rotation.g);
-        transformB = CalculateTransform(rotation.b);
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-        glUniformMatrix3fv(glGetUniformLocation(shader, "rotationR"), 1, GL_FALSE, glm::value_ptr(transformR));
-        glUniformMatrix3fv(glGetUniformLocation(shader, "rotationG"), 1, GL_FALSE, glm::value_ptr(transformG));
-        glUniformMatrix3fv(glGetUniformLocation(shader, "rotationB"), 1, GL_FALSE, glm::value_ptr(transformB));
-    }
-    
+    DitherImage(inputData.data(), outputData.data(), width, height, tile, 2, grayScale, rotation);
 
-    glUniform1i(glGetUniformLocation(shader, "grayScale"), (int)grayScale);
-    glUniform1i(glGetUniformLocation(shader, "size"), size);
-    glUniform1f(glGetUniformLocation(shader, "intensity"), intensity);
-    
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, HBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, HBuffer);
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 bool HalfToning::RenderGui()
 {
     bool changed=false;
-    changed |= ImGui::DragFloat("Intensity", &intensity, 0.01f);
+    shouldRecalculateH |= ImGui::DragFloat("Intensity", &intensity, 0.01f);
     
     changed |= ImGui::Checkbox("GrayScale", &grayScale);
 
@@ -1460,206 +2220,106 @@ bool HalfToning::RenderGui()
         changed |= ImGui::DragFloat("Rotation B", &rotation.z, 1.0f);
     }
     shouldRecalculateH |= ImGui::Combo("Mask Type", &maskType, "Type0\0Type1\0\0");
-    // shouldRecalculateKernel |= ImGui::SliderFloat("Sigma", &sigma, 1, 10);
 
     changed |= shouldRecalculateH;
     return changed;
 }
-
-void HalfToning::Unload()
-{
-    glDeleteBuffers(1, &HBuffer);
-}
 //
 
 //
 //------------------------------------------------------------------------
 Dithering::Dithering(bool enabled) : ImageProcess("Dithering", "", enabled)
-{  
-    addNoise.density=2;
-    addNoise.intensity=0.05f;
-    threshold.binary=true;
-    threshold.global=true;
-    threshold.globalLower = 0.3f;
-    threshold.globalUpper = 1;
-}
-
-void Dithering::SetUniforms()
-{
-}
-
-bool Dithering::RenderGui()
-{
-    bool changed=false;
-    changed |= addNoise.RenderGui();
-    changed |= threshold.RenderGui();
-    return changed;
-}
-void Dithering::Process(GLuint textureIn, GLuint textureOut, int width, int height)
-{
-    if(tmpTexture.width != width || tmpTexture.height != height || !tmpTexture.loaded)
-    {
-        TextureCreateInfo tci = {};
-        tci.generateMipmaps =false;
-        tci.srgb=true;
-        tci.minFilter = GL_LINEAR;
-        tci.magFilter = GL_LINEAR;        
-        tmpTexture = GL_TextureFloat(width, height, tci);         
-    }
-
-    addNoise.Process(textureIn, tmpTexture.glTex, width, height);
-    threshold.Process(tmpTexture.glTex, textureOut, width, height);
-}
-void Dithering::Unload()
-{
-
-}
-//
-
-//
-//------------------------------------------------------------------------
-Erosion::Erosion(bool enabled) : ImageProcess("Erosion", "shaders/Erosion.glsl", enabled)
-{
-    kernel.resize(maxSize * maxSize);
-    glGenBuffers(1, (GLuint*)&kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, kernel.size() * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);     
-}
+{}
 
-void Erosion::RecalculateKernel()
+void Dithering::BuildTile()
 {
-    int offset = (size - subSize) / 2;
-    float halfSize = (size-1)/2.0f;
-    // normalising the Kernel
-    std::fill(kernel.begin(), kernel.begin() + size*size, 0.0f);
-    if(shape==StructuringElementShape::Circle)
-    {
-        for (int i = 0; i < size; ++i)
-        {
-            for (int j = 0; j < size; ++j)
-            {
-                glm::vec2 coord((float)i - halfSize, (float)j-halfSize);
-                float length = glm::length(coord);
-                int flatInx = (i) * size + (j);
-                if(length <= halfSize)
-                {
-                    kernel[flatInx] = 1;
-                }
-            }
-        }
-    }
-    else if(shape == StructuringElementShape::Diamond)
-    {
-        glm::mat3 transform(1);
-        float cosTheta = cos(glm::radians(45.0f));
-        float sinTheta = sin(glm::radians(45.0f));
-        glm::mat3 rotationMatrix(1);
-        rotationMatrix[0][0] = cosTheta;
-        rotationMatrix[1][0] = -sinTheta;
-        rotationMatrix[0][1] = sinTheta;
-        rotationMatrix[1][1] = cosTheta;
-
-        for (int i = 0; i < size; ++i)
-        {
-            for (int j = 0; j < size; ++j)
-            {
-                glm::vec2 coord((float)i - halfSize, (float)j-halfSize);
-                coord = rotationMatrix * glm::vec3(coord, 1);
-                coord += halfSize;
-                int flatInx = ((int)coord.x) * size + ((int)coord.y);
-                kernel[flatInx] = 1;
-            }
-        }        
-    }
-    else if(shape == StructuringElementShape::Line)
-    {
-        glm::mat3 transform(1);
-        float cosTheta = cos(glm::radians(rotation));
-        float sinTheta = sin(glm::radians(rotation));
-        glm::mat3 rotationMatrix(1);
-        rotationMatrix[0][0] = cosTheta;
-        rotationMatrix[1][0] = -sinTheta;
-        rotationMatrix[0][1] = sinTheta;
-        rotationMatrix[1][1] = cosTheta;
+    if(pattern==0) tile.BuildBayer(bayerOrder);
+    else if(pattern==1) tile.BuildBlueNoise(blueNoiseSize, "resources/BlueNoise" + std::to_string(blueNoiseSize) + ".bin");
+    else tile.BuildClusteredDot(dotSize);
+    tileChanged=false;
+}
 
-        for(int i=0; i<size; i++)
-        {
-            glm::vec2 coord((float)i - halfSize, 0);
-            coord = rotationMatrix * glm::vec3(coord, 1);
-            coord += halfSize;
-            int flatInx = ((int)coord.x) * size + ((int)coord.y);
-            kernel[flatInx] = 1;            
-        }
+bool Dithering::RenderGui()
+{
+    bool changed=false;
+    tileChanged |= ImGui::Combo("Pattern", &pattern, "Bayer\0Blue Noise\0Clustered Dots\0\0");
+    if(pattern==0) tileChanged |= ImGui::SliderInt("Order", &bayerOrder, 1, 6);
+    else if(pattern==2) tileChanged |= ImGui::SliderInt("Dot Size", &dotSize, 2, 32);
+    changed |= tileChanged;
+
+    changed |= ImGui::SliderInt("Levels", &levels, 2, 16);
+    changed |= ImGui::Checkbox("GrayScale", &grayScale);
+    if(grayScale)
+    {
+        changed |= ImGui::DragFloat("Angle", &angles.x, 1.0f);
     }
-    else if(shape == StructuringElementShape::Square)
+    else
     {
-        for(int i=0; i<subSize; i++)
-        {
-            for(int j=0; j<subSize; j++)
-            {
-                glm::ivec2 coord = glm::ivec2(i, j) + glm::ivec2(offset);
-                int flatInx = ((int)coord.x) * size + ((int)coord.y);
-                kernel[flatInx] = 1;            
-            }
-        }
+        changed |= ImGui::DragFloat("Angle R", &angles.x, 1.0f);
+        changed |= ImGui::DragFloat("Angle G", &angles.y, 1.0f);
+        changed |= ImGui::DragFloat("Angle B", &angles.z, 1.0f);
     }
-
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, size * size * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-
-    shouldRecalculateKernel=false;
+    return changed;
 }
 
-void Erosion::SetUniforms()
+void Dithering::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    if(shouldRecalculateKernel) RecalculateKernel();
+    if(tileChanged) BuildTile();
+
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    glUniform1i(glGetUniformLocation(shader, "size"), size);
+    DitherImage(inputData.data(), outputData.data(), width, height, tile, levels, grayScale, angles);
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
+//
 
-bool Erosion::RenderGui()
+//
+//------------------------------------------------------------------------
+Erosion::Erosion(bool enabled) : ImageProcess("Erosion", "", enabled)
 {
-    bool changed=false;
-    shouldRecalculateKernel |= ImGui::DragInt("Size", &size, 2, 1, maxSize);
-    
-    shouldRecalculateKernel |= ImGui::Combo("Shape", (int*)&shape, "Circle\0Diamond\0Line\0Octagon\0Square\0\0");
+    element.BuildMask();
+}
 
-    if(shape == StructuringElementShape::Line)
-    {
-        shouldRecalculateKernel |= ImGui::SliderFloat("Rotation", &rotation, -180, 180);
-    }
-    if(shape == StructuringElementShape::Square)
-    {
-        shouldRecalculateKernel |= ImGui::DragInt("Square Size", &subSize, 1, 1, size);
-    }
+void Erosion::Process(GLuint textureIn, GLuint textureOut, int width, int height)
+{
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    for(int i=0; i<size; i++)
+    //Binary : any non black pixel is in the shape
+    for(size_t i=0; i<inputData.size(); i++)
     {
-        for(int j=0; j<size; j++)
-        {
-            int flatInx = (i) * size + (j);
-            ImGui::PushID(flatInx);
-            ImGui::SetNextItemWidth(20);
-            ImGui::DragFloat("", &kernel[flatInx]);
-            ImGui::PopID();
-            if(j < size-1) ImGui::SameLine();
-        }
+        float value = (inputData[i].r + inputData[i].g + inputData[i].b) > 0 ? 1.0f : 0.0f;
+        inputData[i] = glm::vec4(value, value, value, 1);
     }
-    
+    StructuringElement scaledElement;
+    MorphologyErode(inputData.data(), outputData.data(), width, height, ScaledStructuringElement(*this, element, scaledElement), true);
 
-    changed |= shouldRecalculateKernel;
-    return changed;
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void Erosion::Unload()
+bool Erosion::RenderGui()
 {
-    glDeleteBuffers(1, &kernelBuffer);
+    return RenderStructuringElementGui(element, maxSize);
 }
 //
 
@@ -1806,148 +2466,172 @@ void AddGradient::Unload()
 
 //
 //------------------------------------------------------------------------
-Dilation::Dilation(bool enabled) : ImageProcess("Dilation", "shaders/Dilation.glsl", enabled)
+Dilation::Dilation(bool enabled) : ImageProcess("Dilation", "", enabled)
 {
-    kernel.resize(maxSize * maxSize);
-    glGenBuffers(1, (GLuint*)&kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, kernel.size() * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);     
+    element.BuildMask();
 }
 
-void Dilation::RecalculateKernel()
+void Dilation::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    int offset = (size - subSize) / 2;
-    float halfSize = (size-1)/2.0f;
-    // normalising the Kernel
-    std::fill(kernel.begin(), kernel.begin() + size*size, 0.0f);
-    if(shape==StructuringElementShape::Circle)
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    //Binary : any non black pixel is in the shape
+    for(size_t i=0; i<inputData.size(); i++)
     {
-        for (int i = 0; i < size; ++i)
-        {
-            for (int j = 0; j < size; ++j)
-            {
-                glm::vec2 coord((float)i - halfSize, (float)j-halfSize);
-                float length = glm::length(coord);
-                int flatInx = (i) * size + (j);
-                if(length <= halfSize)
-                {
-                    kernel[flatInx] = 1;
-                }
-            }
-        }
+        float value = (inputData[i].r + inputData[i].g + inputData[i].b) > 0 ? 1.0f : 0.0f;
+        inputData[i] = glm::vec4(value, value, value, 1);
     }
-    else if(shape == StructuringElementShape::Diamond)
-    {
-        glm::mat3 transform(1);
-        float cosTheta = cos(glm::radians(45.0f));
-        float sinTheta = sin(glm::radians(45.0f));
-        glm::mat3 rotationMatrix(1);
-        rotationMatrix[0][0] = cosTheta;
-        rotationMatrix[1][0] = -sinTheta;
-        rotationMatrix[0][1] = sinTheta;
-        rotationMatrix[1][1] = cosTheta;
+    StructuringElement scaledElement;
+    MorphologyDilate(inputData.data(), outputData.data(), width, height, ScaledStructuringElement(*this, element, scaledElement), true);
 
-        for (int i = 0; i < size; ++i)
-        {
-            for (int j = 0; j < size; ++j)
-            {
-                glm::vec2 coord((float)i - halfSize, (float)j-halfSize);
-                coord = rotationMatrix * glm::vec3(coord, 1);
-                coord += halfSize;
-                int flatInx = ((int)coord.x) * size + ((int)coord.y);
-                kernel[flatInx] = 1;
-            }
-        }        
-    }
-    else if(shape == StructuringElementShape::Line)
-    {
-        glm::mat3 transform(1);
-        float cosTheta = cos(glm::radians(rotation));
-        float sinTheta = sin(glm::radians(rotation));
-        glm::mat3 rotationMatrix(1);
-        rotationMatrix[0][0] = cosTheta;
-        rotationMatrix[1][0] = -sinTheta;
-        rotationMatrix[0][1] = sinTheta;
-        rotationMatrix[1][1] = cosTheta;
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-        for(int i=0; i<size; i++)
-        {
-            glm::vec2 coord((float)i - halfSize, 0);
-            coord = rotationMatrix * glm::vec3(coord, 1);
-            coord += halfSize;
-            int flatInx = ((int)coord.x) * size + ((int)coord.y);
-            kernel[flatInx] = 1;            
-        }
-    }
-    else if(shape == StructuringElementShape::Square)
+bool Dilation::RenderGui()
+{
+    return RenderStructuringElementGui(element, maxSize);
+}
+//
+
+//
+//------------------------------------------------------------------------
+Morphology::Morphology(bool enabled) : ImageProcess("Morphology", "", enabled)
+{
+    element.BuildMask();
+}
+
+void Morphology::Process(GLuint textureIn, GLuint textureOut, int width, int height)
+{
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if(binary)
     {
-        for(int i=0; i<subSize; i++)
+        for(size_t i=0; i<inputData.size(); i++)
         {
-            for(int j=0; j<subSize; j++)
-            {
-                glm::ivec2 coord = glm::ivec2(i, j) + glm::ivec2(offset);
-                int flatInx = ((int)coord.x) * size + ((int)coord.y);
-                kernel[flatInx] = 1;            
-            }
+            float value = (inputData[i].r + inputData[i].g + inputData[i].b) > 0 ? 1.0f : 0.0f;
+            inputData[i] = glm::vec4(value, value, value, 1);
         }
     }
+    StructuringElement scaledElement;
+    ApplyMorphology(operation, inputData.data(), outputData.data(), width, height, ScaledStructuringElement(*this, element, scaledElement), binary);
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, size * size * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-
-    shouldRecalculateKernel=false;
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void Dilation::SetUniforms()
+bool Morphology::RenderGui()
 {
-    if(shouldRecalculateKernel) RecalculateKernel();
-
-    glUniform1i(glGetUniformLocation(shader, "size"), size);
+    bool changed=false;
+    changed |= ImGui::Combo("Operation", (int*)&operation, "Erode\0Dilate\0Open\0Close\0Top Hat\0Black Top Hat\0Gradient\0\0");
+    changed |= ImGui::Checkbox("Binary", &binary);
+    changed |= RenderStructuringElementGui(element, maxSize);
+    return changed;
+}
+//
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
+//
+//------------------------------------------------------------------------
+DistanceTransform::DistanceTransform(bool enabled) : ImageProcess("DistanceTransform", "", enabled)
+{
 }
 
-bool Dilation::RenderGui()
+void DistanceTransform::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    bool changed=false;
-    shouldRecalculateKernel |= ImGui::DragInt("Size", &size, 2, 1, maxSize);
-    
-    shouldRecalculateKernel |= ImGui::Combo("Shape", (int*)&shape, "Circle\0Diamond\0Line\0Octagon\0Square\0\0");
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    if(shape == StructuringElementShape::Line)
+    features.resize((size_t)width * height);
+    for(size_t i=0; i<inputData.size(); i++)
     {
-        shouldRecalculateKernel |= ImGui::SliderFloat("Rotation", &rotation, -180, 180);
+        float grayScale = RGBToGray(inputData[i]);
+        features[i] = ((grayScale > threshold) != invert) ? 1 : 0;
     }
-    if(shape == StructuringElementShape::Square)
+
+    if(outputMode == OutputMode::NearestFeature)
     {
-        shouldRecalculateKernel |= ImGui::DragInt("Square Size", &subSize, 1, 1, size);
+        SquaredDistanceTransform(features, width, height, squaredDistances, nearestFeatures);
+        for(size_t i=0; i<outputData.size(); i++)
+        {
+            outputData[i] = (nearestFeatures[i] >= 0) ? inputData[nearestFeatures[i]] : glm::vec4(0);
+            outputData[i].a = 1;
+        }
     }
-
-    for(int i=0; i<size; i++)
+    else
     {
-        for(int j=0; j<size; j++)
+        SquaredDistanceTransform(features, width, height, squaredDistances);
+        bool isSigned = outputMode == OutputMode::SignedDistance;
+        if(isSigned)
         {
-            int flatInx = (i) * size + (j);
-            ImGui::PushID(flatInx);
-            ImGui::SetNextItemWidth(20);
-            ImGui::DragFloat("", &kernel[flatInx]);
-            ImGui::PopID();
-            if(j < size-1) ImGui::SameLine();
+            //Distance of the feature pixels to the background, counted negatively
+            for(size_t i=0; i<features.size(); i++) features[i] = !features[i];
+            SquaredDistanceTransform(features, width, height, innerSquaredDistances);
+        }
+
+        //Pixels that have no feature in the image keep DISTANCE_TRANSFORM_INF, they are left out of the range
+        float range = maxDistance;
+        if(range <= 0)
+        {
+            for(size_t i=0; i<squaredDistances.size(); i++)
+            {
+                if(squaredDistances[i] < DISTANCE_TRANSFORM_INF) range = (std::max)(range, squaredDistances[i]);
+                if(isSigned && innerSquaredDistances[i] < DISTANCE_TRANSFORM_INF) range = (std::max)(range, innerSquaredDistances[i]);
+            }
+            range = (std::max)(std::sqrt(range), 1.0f);
+        }
+
+        for(size_t i=0; i<outputData.size(); i++)
+        {
+            float distance = std::sqrt((std::min)(squaredDistances[i], range * range));
+            float value = distance / range;
+            if(isSigned)
+            {
+                float innerDistance = std::sqrt((std::min)(innerSquaredDistances[i], range * range));
+                value = 0.5f + 0.5f * (distance - innerDistance) / range;
+            }
+            outputData[i] = glm::vec4(value, value, value, 1);
         }
     }
-    
 
-    changed |= shouldRecalculateKernel;
-    return changed;
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void Dilation::Unload()
+bool DistanceTransform::RenderGui()
 {
-    glDeleteBuffers(1, &kernelBuffer);
+    bool changed=false;
+    changed |= ImGui::Combo("Output", (int*)&outputMode, "Distance\0Signed Distance\0Nearest Feature\0\0");
+    changed |= ImGui::SliderFloat("Threshold", &threshold, 0, 1);
+    changed |= ImGui::Checkbox("Invert", &invert);
+    if(outputMode != OutputMode::NearestFeature) changed |= ImGui::DragFloat("Max Distance", &maxDistance, 1, 0, 4096);
+    return changed;
 }
 //
 
@@ -1956,18 +2640,7 @@ void Dilation::Unload()
 AddImage::AddImage(bool enabled, std::string newFileName) : ImageProcess("AddImage", "shaders/AddImage.glsl", enabled)
 {
     this->fileName = newFileName;
-    if(fileName != "") 
-    {
-        TextureCreateInfo tci = {};
-        tci.generateMipmaps =false;
-        tci.minFilter = GL_LINEAR;
-        tci.magFilter = GL_LINEAR;        
-        
-        if(texture.loaded) texture.Unload();
-        texture = GL_TextureFloat(std::string(fileName), tci);
-        aspectRatio = (float)texture.width / (float)texture.height;
-		filenameChanged = false;        
-    }
+    if(this->fileName != "") filenameChanged=true;
 }
 
 
@@ -1978,8 +2651,9 @@ void AddImage::SetUniforms()
     glUniform1f(glGetUniformLocation(shader, "aspectRatio"), aspectRatio);    
 
 
+    //Mip level of the size of the proxy
     glUniform1i(glGetUniformLocation(shader, "textureToAdd"), 2); //program must be active
-    glBindImageTexture(2, texture.glTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindImageTexture(2, texture.glTex, proxyLevel, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
 
     
     
@@ -2002,20 +2676,6 @@ bool AddImage::RenderGui()
         }        
     }
 
-    if(filenameChanged)
-    {
-        TextureCreateInfo tci = {};
-        tci.generateMipmaps =false;
-        tci.minFilter = GL_LINEAR;
-        tci.magFilter = GL_LINEAR;        
-        
-        if(texture.loaded) texture.Unload();
-        texture = GL_TextureFloat(std::string(fileName), tci);
-        
-		changed=true;
-		filenameChanged = false;
-    }
-
     if(ImGui::Button("Set Resolution from this image"))
     {
         imageProcessStack->Resize(texture.width, texture.height);
@@ -2025,8 +2685,22 @@ bool AddImage::RenderGui()
     return changed;
 }
 
+bool AddImage::Update()
+{
+    if(filenameChanged)
+    {
+        RequestTexture(imageProcessStack->imageLoader, loadRequest, fileName);
+        filenameChanged = false;
+    }
+    if(!ReceiveTexture(imageProcessStack->imageLoader, loadRequest, texture)) return false;
+    aspectRatio = (float)texture.width / (float)texture.height;
+    mipmapsBuilt=false;
+    return true;
+}
+
 void AddImage::Unload()
 {
+    imageProcessStack->imageLoader.Release(loadRequest);
     texture.Unload();
 }
 
@@ -2034,12 +2708,24 @@ void AddImage::Process(GLuint textureIn, GLuint textureOut, int width, int heigh
 {
     if(texture.loaded)
     {
-        glm::ivec2 offset = glm::ivec2(width, height) - glm::ivec2(texture.width, texture.height);
+        if(proxyLevel > 0 && !mipmapsBuilt)
+        {
+            glBindTexture(GL_TEXTURE_2D, texture.glTex);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            mipmapsBuilt=true;
+        }
+        glm::ivec2 textureSize = glm::max(glm::ivec2(texture.width, texture.height) >> proxyLevel, glm::ivec2(1));
+        //Centered in the whole image, the textures only hold the part of it from regionOrigin when the stack evaluates a region
+        glm::ivec2 offset = glm::ivec2(imageProcessStack->outputWidth, imageProcessStack->outputHeight) - textureSize;
         offset /=2;
+        offset -= regionOrigin;
+        glm::ivec2 start = glm::max(-offset, glm::ivec2(0));
         glUseProgram(shader);
         SetUniforms();
 
         glUniform2iv(glGetUniformLocation(shader, "offset"), 1, glm::value_ptr(offset)); //program must be active
+        glUniform2iv(glGetUniformLocation(shader, "start"), 1, glm::value_ptr(start)); //program must be active
         
         glUniform1i(glGetUniformLocation(shader, "textureIn"), 0); //program must be active
         glBindImageTexture(0, textureIn, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
@@ -2086,247 +2772,112 @@ bool MultiplyImage::RenderGui()
         {
             fileName = std::string(LoadPath);
             filenameChanged=true;
-        }        
-    }
-    
-    if(filenameChanged)
-    {
-        TextureCreateInfo tci = {};
-        tci.generateMipmaps =false;
-        tci.minFilter = GL_LINEAR;
-        tci.magFilter = GL_LINEAR;        
-        
-        if(texture.loaded) texture.Unload();
-        texture = GL_TextureFloat(std::string(fileName), tci);
-        
-		changed=true;
-		filenameChanged = false;
-    }
-
-    return changed;
-}
-
-void MultiplyImage::Unload()
-{
-    texture.Unload();
-}
-//
-
-//
-//------------------------------------------------------------------------
-GaussianPyramid::GaussianPyramid(bool enabled) : ImageProcess("GaussianPyramid", "shaders/CopyTexture.glsl", enabled)
-{
-    gaussianBlur.size=5;
-    gaussianBlur.sigma=5;
-
-    pyramid.resize(depth);
-    pyramidTmp.resize(depth);
-}
-
-
-void GaussianPyramid::SetUniforms()
-{
-}
-
-bool GaussianPyramid::RenderGui()
-{
-    bool changed=false;
-    depthChanged = ImGui::SliderInt("Depth", &depth, 0, 10);
-    
-    if(depthChanged)
-    {
-        pyramid.resize(depth);
-        pyramidTmp.resize(depth);
-    }
-
-    changed |= ImGui::SliderInt("Output", &output, 0, (int)depth-1);
-
-    changed |= depthChanged;
-    changed |= gaussianBlur.RenderGui();
-    return changed;
-}
-
-void GaussianPyramid::Unload()
-{
-  
-}
-
-void GaussianPyramid::CopyTexture(GLuint textureIn, GLuint textureOut, int width, int height)
-{
- 	glUseProgram(shader);
-	
-    //Bind sampler
-	glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureIn);
-    glUniform1i(glGetUniformLocation(shader, "gradientTexture"), 0);
-    
-    //Bind image
-    glUniform1i(glGetUniformLocation(shader, "textureOut"), 0); //program must be active
-    glBindImageTexture(0, textureOut, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-     
-    glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-	glUseProgram(0);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);   
-}
-
-void GaussianPyramid::Build(GLuint textureIn, int width, int height)
-{
-    if(currentWidth != width || currentHeight != height || depthChanged)
-    {
-        currentWidth = width;
-        currentHeight = height;
-
-        TextureCreateInfo tci = {};
-        tci.generateMipmaps =false;
-        tci.minFilter = GL_LINEAR;
-        tci.magFilter = GL_LINEAR; 
-
-        int levelWidth = width;
-        int levelHeight = height;
-        for(int i=0; i<pyramid.size(); i++)
-        {
-            if(pyramid[i].loaded) pyramid[i].Unload();
-            if(pyramidTmp[i].loaded) pyramidTmp[i].Unload();
-            pyramid[i] = GL_TextureFloat(levelWidth, levelHeight, tci);
-            pyramidTmp[i] = GL_TextureFloat(levelWidth, levelHeight, tci);
-            levelWidth/=2;
-            levelHeight/=2;
-        }
+        }        
     }
+    
+
+    return changed;
+}
 
-  //Copy TextureIn into pyramid[0];
-    CopyTexture(textureIn, pyramid[0].glTex, pyramid[0].width, pyramid[0].height);
-    for(int i=0; i<pyramid.size()-1; i++)
+bool MultiplyImage::Update()
+{
+    if(filenameChanged)
     {
-#if 1
-        gaussianBlur.Process(pyramid[i].glTex, pyramidTmp[i].glTex, pyramid[i].width, pyramid[i].height);
-        CopyTexture(pyramidTmp[i].glTex, pyramid[i+1].glTex, pyramid[i+1].width, pyramid[i+1].height);
-#else
-        CopyTexture(pyramid[i].glTex, pyramid[i+1].glTex, pyramid[i+1].width, pyramid[i+1].height);
-#endif
+        RequestTexture(imageProcessStack->imageLoader, loadRequest, fileName);
+        filenameChanged = false;
     }
+    return ReceiveTexture(imageProcessStack->imageLoader, loadRequest, texture);
 }
 
-void GaussianPyramid::Process(GLuint textureIn, GLuint textureOut, int width, int height)
+void MultiplyImage::Unload()
 {
-    Build(textureIn, width, height);
-    CopyTexture(pyramid[output].glTex, textureOut, width, height);
+    imageProcessStack->imageLoader.Release(loadRequest);
+    texture.Unload();
 }
 //
 
 //
 //------------------------------------------------------------------------
-LaplacianPyramid::LaplacianPyramid(bool enabled) : ImageProcess("LaplacianPyramid", "shaders/SubtractTexture.glsl", enabled)
-{
-    CreateComputeShader("shaders/AddTexture.glsl", &addTextureShader);
-    CreateComputeShader("shaders/ClearTexture.glsl", &clearTextureShader);
-}
-
-
-void LaplacianPyramid::SetUniforms()
-{
-}
+GaussianPyramid::GaussianPyramid(bool enabled) : ImageProcess("GaussianPyramid", "", enabled)
+{}
 
-bool LaplacianPyramid::RenderGui()
+bool GaussianPyramid::RenderGui()
 {
     bool changed=false;
-
-    changed |= gaussianPyramid.RenderGui();
-
-    ImGui::Separator();
-    changed |= ImGui::SliderInt("Laplacian Output", &output, 0, gaussianPyramid.depth-1);
-    changed |= ImGui::Checkbox("Output Reconstruction", &outputReconstruction);
+    changed |= ImGui::SliderInt("Depth", &depth, 1, 10);
+    changed |= ImGui::SliderInt("Output", &output, 0, depth-1);
     return changed;
 }
 
-void LaplacianPyramid::Unload()
+void GaussianPyramid::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-  
-}
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
+    pyramid.BuildGaussian(inputData.data(), width, height, depth);
 
-void LaplacianPyramid::SubtractTexture(GLuint textureA, GLuint textureB, int width, int height)
-{
- 	glUseProgram(shader);
-	
-    //Bind image A
-    glUniform1i(glGetUniformLocation(shader, "textureA"), 0); //program must be active
-    glBindImageTexture(0, textureA, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-     
-    //Bind sampler
-	glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureB);
-    glUniform1i(glGetUniformLocation(shader, "textureB"), 0);
-    
-     
-    glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-	glUseProgram(0);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);   
-}
+    //Displays the level scaled back to the size of the image
+    int level = (std::min)(output, pyramid.numLevels-1);
+    ResampleImage(pyramid.Level(level), pyramid.widths[level], pyramid.heights[level], outputData.data(), width, height, ResampleFilter::Triangle);
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
 
-void LaplacianPyramid::AddTexture(GLuint textureA, GLuint textureB, int width, int height)
-{
- 	glUseProgram(addTextureShader);
-	
-    //Bind image A
-    glUniform1i(glGetUniformLocation(addTextureShader, "textureA"), 0); //program must be active
-    glBindImageTexture(0, textureA, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-     
-    //Bind sampler
-	glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureB);
-    glUniform1i(glGetUniformLocation(addTextureShader, "textureB"), 0);
-    
-     
-    glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-	glUseProgram(0);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);   
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
+//
 
-void LaplacianPyramid::ClearTexture(GLuint texture, int width, int height)
-{
-    glUseProgram(clearTextureShader);
-    glUniform1i(glGetUniformLocation(clearTextureShader, "textureOut"), 0); //program must be active
-    glBindImageTexture(0, texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-    glDispatchCompute(width/32+1, height/32+1, 1);
-    glUseProgram(0);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);     
-}
+//
+//------------------------------------------------------------------------
+LaplacianPyramid::LaplacianPyramid(bool enabled) : ImageProcess("LaplacianPyramid", "", enabled)
+{}
 
-void LaplacianPyramid::Build(GLuint textureIn, int width, int height)
+bool LaplacianPyramid::RenderGui()
 {
-    gaussianPyramid.Build(textureIn, width, height);
+    bool changed=false;
+    changed |= ImGui::SliderInt("Depth", &depth, 1, 10);
 
-    for(int i=0; i<gaussianPyramid.pyramid.size()-1; i++)
-    {
-        SubtractTexture(gaussianPyramid.pyramid[i].glTex, 
-                        gaussianPyramid.pyramid[i+1].glTex, 
-                        gaussianPyramid.pyramid[i].width, 
-                        gaussianPyramid.pyramid[i].height);
-    }
-        
+    ImGui::Separator();
+    changed |= ImGui::SliderInt("Laplacian Output", &output, 0, depth-1);
+    changed |= ImGui::Checkbox("Output Reconstruction", &outputReconstruction);
+    return changed;
 }
 
-
 void LaplacianPyramid::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    Build(textureIn, width, height);
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    pyramid.BuildLaplacian(inputData.data(), width, height, depth);
 
     if(outputReconstruction)
     {
-        ClearTexture(textureOut, width, height);
-        for(int i=gaussianPyramid.depth-1; i>=0; i--)
-        {
-
-            AddTexture(textureOut, gaussianPyramid.pyramid[i].glTex, width, height);
-        }
+        pyramid.Collapse(outputData.data());
     }
     else
     {
-        gaussianPyramid.CopyTexture(gaussianPyramid.pyramid[output].glTex, textureOut, width, height);
+        int level = (std::min)(output, pyramid.numLevels-1);
+        ResampleImage(pyramid.Level(level), pyramid.widths[level], pyramid.heights[level], outputData.data(), width, height, ResampleFilter::Triangle);
     }
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
 
-
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 //
 
@@ -2348,8 +2899,8 @@ void PenDraw::SetUniforms()
         if(paintTexture.loaded) paintTexture.Unload();
         paintTexture = GL_TextureFloat(imageProcessStack->width, imageProcessStack->height, tci);
 
-        paintData.resize(paintTexture.width * paintTexture.height);
-        paintedPixels.resize(paintTexture.width * paintTexture.height, false);
+        paintData.resize((size_t)paintTexture.width * paintTexture.height);
+        paintedPixels.resize((size_t)paintTexture.width * paintTexture.height, false);
     }
 
     glUniform1f(glGetUniformLocation(shader, "multiplier"), 1);    
@@ -2406,7 +2957,7 @@ bool PenDraw::MouseMove(float x, float y)
             if(contourPoints.size()==0 || (contourPoints.size() > 0 && c != contourPoints[contourPoints.size()-1]))
             {
                 contourPoints.push_back(c);
-                paintedPixels[c.y * paintTexture.width + c.x]=true;
+                paintedPixels[(size_t)c.y * paintTexture.width + c.x]=true;
                 paintData[c.y * paintTexture.width + c.x ] = glm::vec4(color,1);
             }
 #endif
@@ -2418,7 +2969,7 @@ bool PenDraw::MouseMove(float x, float y)
                     if((ky*ky + kx+kx) < radius*radius)
                     {
                         glm::ivec2 coord(c.x + kx, c.y + ky);
-                        int inx = coord.y * paintTexture.width + coord.x;
+                        size_t inx = (size_t)coord.y * paintTexture.width + coord.x;
                         paintData[inx] = glm::vec4(color,1);
                     }
                 }
@@ -2464,17 +3015,7 @@ HardComposite::HardComposite(bool enabled, std::string newFileName) : ImageProce
     CreateComputeShader("shaders/HardComposite.glsl", &compositeShader);
     
     this->fileName = newFileName;
-    if(this->fileName != "") 
-    {
-        TextureCreateInfo tci = {};
-        tci.generateMipmaps =false;
-        tci.minFilter = GL_LINEAR;
-        tci.magFilter = GL_LINEAR;        
-        
-        if(texture.loaded) texture.Unload();
-        texture = GL_TextureFloat(std::string(fileName), tci);
-    	filenameChanged = false;        
-    }    
+    if(this->fileName != "") filenameChanged=true;
 }
 
 
@@ -2505,6 +3046,7 @@ void HardComposite::Process(GLuint textureIn, GLuint textureOut, int width, int
     {
         if(doBlur)
         {
+            smoothFilter.imageProcessStack = imageProcessStack;
             smoothFilter.Process(maskTexture.glTex, smoothedMaskTexture.glTex, maskTexture.width, maskTexture.height);
         }
 
@@ -2542,7 +3084,7 @@ void HardComposite::SetUniforms()
         maskTexture = GL_TextureFloat(imageProcessStack->width, imageProcessStack->height, tci);
         smoothedMaskTexture = GL_TextureFloat(imageProcessStack->width, imageProcessStack->height, tci);
 
-        maskData.resize(maskTexture.width * maskTexture.height);
+        maskData.resize((size_t)maskTexture.width * maskTexture.height);
     }
 
     glUniform1i(glGetUniformLocation(shader, "mask"), 2); //program must be active
@@ -2574,19 +3116,6 @@ bool HardComposite::RenderGui()
         }        
     }
     
-    if(filenameChanged)
-    {
-        TextureCreateInfo tci = {};
-        tci.generateMipmaps =false;
-        tci.minFilter = GL_LINEAR;
-        tci.magFilter = GL_LINEAR;        
-        
-        if(texture.loaded) texture.Unload();
-        texture = GL_TextureFloat(std::string(fileName), tci);
-        
-		changed=true;
-		filenameChanged = false;
-    }
 
     changed |= ImGui::Checkbox("Weighted Transition", &doBlur);
     if(doBlur)
@@ -2597,9 +3126,20 @@ bool HardComposite::RenderGui()
     return changed;
 }
 
+bool HardComposite::Update()
+{
+    if(filenameChanged)
+    {
+        RequestTexture(imageProcessStack->imageLoader, loadRequest, fileName);
+        filenameChanged = false;
+    }
+    return ReceiveTexture(imageProcessStack->imageLoader, loadRequest, texture);
+}
+
 
 void HardComposite::Unload()
 {
+    imageProcessStack->imageLoader.Release(loadRequest);
     maskTexture.Unload();
     texture.Unload();
     glDeleteProgram(viewMaskShader);
@@ -2629,7 +3169,7 @@ bool HardComposite::MouseMove(float x, float y)
                     {
                         glm::ivec2 coord(c.x + kx, c.y + ky);
                         if(coord.x <0 || coord.y < 0 || coord.x >= maskTexture.width || coord.y >= maskTexture.height) continue;
-                        int inx = coord.y * maskTexture.width + coord.x;
+                        size_t inx = (size_t)coord.y * maskTexture.width + coord.x;
                         maskData[inx] = adding ? glm::vec4(1,1,1,1) : glm::vec4(0,0,0,1);
                     }
                 }
@@ -2672,13 +3212,13 @@ SeamCarvingResize::SeamCarvingResize(bool enabled) : ImageProcess("SeamCarvingRe
 
 float SeamCarvingResize::CalculateCostAt(glm::ivec2 position, std::vector<glm::vec4> &image, int width, int height)
 {
-    int inx = position.y * width + position.x;
+    int64_t inx = (int64_t)position.y * width + position.x;
     glm::vec4 nextX = (position.x >=0 && position.x < width-2) ?  image[inx+1] : glm::vec4(1e30f);
     glm::vec4 nextY = (position.y >=0 && position.y < height-2) ?  image[inx + width] : glm::vec4(0);
     
-    float currentGrayScale = Color2GrayScale(image[inx]);
-    float nextXGrayScale  =  Color2GrayScale(nextX);
-    float nextYGrayScale  =  Color2GrayScale(nextY); 
+    float currentGrayScale = RGBToGray(image[inx]);
+    float nextXGrayScale  =  RGBToGray(nextX);
+    float nextYGrayScale  =  RGBToGray(nextY); 
 
     float gradX = nextXGrayScale - currentGrayScale;
     float gradY = nextYGrayScale - currentGrayScale;
@@ -2698,17 +3238,16 @@ void SeamCarvingResize::Process(GLuint textureIn, GLuint textureOut, int width,
         if(maskTexture.loaded) maskTexture.Unload();
         maskTexture = GL_TextureFloat(imageProcessStack->width, imageProcessStack->height, tci);
 
-        maskData.resize(maskTexture.width * maskTexture.height);
+        maskData.resize((size_t)maskTexture.width * maskTexture.height);
 
         seams.clear();
         
-        imageData.resize(width * height, glm::vec4(0));
-        originalData.resize(width * height, glm::vec4(0));
-        gradient.resize(width * height, 0);
-        debugData.resize(width * height);
-        costs.resize(width*height, 0);
-        directions.resize(width*height, 0);
-        seamData.resize(width*height, 0);
+        imageData.resize((size_t)width * height, glm::vec4(0));
+        gradient.resize((size_t)width * height, 0);
+        debugData.resize((size_t)width * height);
+        costs.resize((size_t)width*height, 0);
+        directions.resize((size_t)width*height, 0);
+        seamData.resize((size_t)width*height, 0);
 
         numIncreases=0;
         numDecreases=0;
@@ -2741,7 +3280,7 @@ void SeamCarvingResize::Process(GLuint textureIn, GLuint textureOut, int width,
     }
     else
     {
-        //If first iteration, read back original data.
+        //If first iteration, read back original data, straight into the buffer the seams are carved in.
         if(iterations==0)
         {
             glBindTexture(GL_TEXTURE_2D, textureIn);
@@ -2749,9 +3288,8 @@ void SeamCarvingResize::Process(GLuint textureIn, GLuint textureOut, int width,
                             0,
                             GL_RGBA, // GL will convert to this format
                             GL_FLOAT,   // Using this data type per-pixel
-                            originalData.data());
+                            imageData.data());
             glBindTexture(GL_TEXTURE_2D, 0);
-            imageData = originalData;
             currentWidth = width;            
         }
 
@@ -2795,7 +3333,7 @@ void SeamCarvingResize::Process(GLuint textureIn, GLuint textureOut, int width,
                 {
                     int inx = y * (currentWidth+ increase ? -1 : 1 ) + x;
                     float g = (float)costs[inx];
-                    debugData[y * width + x] = glm::vec4(g,g,g,1);
+                    debugData[(size_t)y * width + x] = glm::vec4(g,g,g,1);
                 }
             }*/
         }
@@ -2813,9 +3351,9 @@ void SeamCarvingResize::Process(GLuint textureIn, GLuint textureOut, int width,
                     {
                         for(int x=0; x<currentWidth; x++)
                         {
-                            int inx = y * currentWidth + x;
+                            size_t inx = (size_t)y * currentWidth + x;
                             gradient[inx] = CalculateCostAt(glm::ivec2(x, y), imageData, width, height);
-                            if(seamData[y * width + x]>0) gradient[inx] += 10;
+                            if(seamData[(size_t)y * width + x]>0) gradient[inx] += 10;
                             if(x <=1) gradient[inx]=1e30f;
                             if(x >=currentWidth-2) gradient[inx]=1e30f;
                         }
@@ -2832,8 +3370,8 @@ void SeamCarvingResize::Process(GLuint textureIn, GLuint textureOut, int width,
                     {
                         for(int x=1; x<currentWidth; x++)
                         {
-                            int inx = y * currentWidth + x; 
-                            costs[inx] = gradient[y * currentWidth + x];
+                            int64_t inx = (int64_t)y * currentWidth + x; 
+                            costs[inx] = gradient[(size_t)y * currentWidth + x];
 
                             float topCost = costs[inx-currentWidth];
                             float topLeftCost = costs[inx-currentWidth - 1];
@@ -2874,7 +3412,7 @@ void SeamCarvingResize::Process(GLuint textureIn, GLuint textureOut, int width,
                             assert(newCost >= prevCost);
 
                             float c = (costs[inx] * 0.1f);
-							debugData[y * width + x] = glm::vec4(c,c,c,1);
+							debugData[(size_t)y * width + x] = glm::vec4(c,c,c,1);
                         }
                     }
 
@@ -2884,7 +3422,7 @@ void SeamCarvingResize::Process(GLuint textureIn, GLuint textureOut, int width,
                     for(int x=0; x<currentWidth; x++)
                     {
                         int y = height-1;
-                        int inx = y * currentWidth + x;
+                        size_t inx = (size_t)y * currentWidth + x;
                         float cost = costs[inx];
                         if(cost < lowestCost)
                         {
@@ -2903,7 +3441,7 @@ void SeamCarvingResize::Process(GLuint textureIn, GLuint textureOut, int width,
                     while(true)
                     {
                         seams[seams.size()-1].points[added++] = (currentPoint);
-                        int direction = directions[currentPoint.y * currentWidth + currentPoint.x];
+                        int direction = directions[(size_t)currentPoint.y * currentWidth + currentPoint.x];
                         currentPoint = glm::ivec2(currentPoint.x + direction, currentPoint.y-1);
                         if(currentPoint.y==-1) 
                         {
@@ -2912,21 +3450,18 @@ void SeamCarvingResize::Process(GLuint textureIn, GLuint textureOut, int width,
                     }
 
                     std::vector<glm::ivec2> &points = seams[seams.size()-1].points;
-                    std::vector<glm::vec4> memory(width);
                     for(int i=0; i<points.size(); i++)
                     {
                         glm::ivec2 p = points[i];
-                        int inx = p.y * width + p.x;
+                        size_t inx = (size_t)p.y * width + p.x;
                         if(increase && currentWidth< width)
                         {
                             
                             glm::vec4 color = (imageData[inx-1] + imageData[inx]) * 0.5f;
                             int shiftSize = currentWidth - p.x;
-                            memcpy(&memory[0], &imageData[inx], shiftSize * sizeof(glm::vec4));
-                            memcpy(&imageData[inx+1], &memory[0], shiftSize * sizeof(glm::vec4));
-
-                            memcpy(&memory[0], &maskData[inx], shiftSize * sizeof(glm::vec4));
-                            memcpy(&maskData[inx+1], &memory[0], shiftSize * sizeof(glm::vec4));
+                            //Overlapping, shifted in place
+                            memmove(&imageData[inx+1], &imageData[inx], shiftSize * sizeof(glm::vec4));
+                            memmove(&maskData[inx+1], &maskData[inx], shiftSize * sizeof(glm::vec4));
 
                             seamData[inx]=1;
                             seamData[inx+1]=1;
@@ -2936,8 +3471,8 @@ void SeamCarvingResize::Process(GLuint textureIn, GLuint textureOut, int width,
                         else if(!increase && currentWidth > 0)
                         {
                             int shiftSize = currentWidth - p.x - 1;
-                            memcpy(&imageData[inx], &imageData[inx+1], shiftSize * sizeof(glm::vec4));
-                            memcpy(&maskData[inx], &maskData[inx+1], shiftSize * sizeof(glm::vec4));
+                            memmove(&imageData[inx], &imageData[inx+1], shiftSize * sizeof(glm::vec4));
+                            memmove(&maskData[inx], &maskData[inx+1], shiftSize * sizeof(glm::vec4));
 
                         }
                     }
@@ -3037,7 +3572,7 @@ bool SeamCarvingResize::MouseMove(float x, float y)
                     {
                         glm::ivec2 coord(c.x + kx, c.y + ky);
                         if(coord.x <0 || coord.y < 0 || coord.x >= maskTexture.width || coord.y >= maskTexture.height) continue;
-                        int inx = coord.y * maskTexture.width + coord.x;
+                        size_t inx = (size_t)coord.y * maskTexture.width + coord.x;
                         maskData[inx] = adding ? glm::vec4(1,1,0,0) : glm::vec4(0,0,0,1);
                     }
                 }
@@ -3115,7 +3650,7 @@ std::vector<glm::ivec2> PatchInpainting::CalculateContour(int width, int height)
     {
         for(int x=0; x<width; x++)
         {
-            if(maskData[y * width + x].x != 0)
+            if(maskData[(size_t)y * width + x].x != 0)
             {
                 contourPoints.push_back(
                     {
@@ -3145,7 +3680,7 @@ std::vector<glm::ivec2> PatchInpainting::CalculateContour(int width, int height)
 
 				glm::ivec2 checkCoord = currentPoint->b + directions[dirInx];
 				if(checkCoord.x <=0 || checkCoord.y <=0 || checkCoord.x >= width-1 || checkCoord.y >= height-1) continue;
-				float checkValue = maskData[checkCoord.y * width + checkCoord.x].x;
+				float checkValue = maskData[(size_t)checkCoord.y * width + checkCoord.x].x;
 				if(checkValue>0)
 				{
 					point newPoint = 
@@ -3179,7 +3714,7 @@ std::vector<glm::ivec2> PatchInpainting::CalculateContour(int width, int height)
         {
             for(int x=0; x<width; x++)
             {
-                if(maskData[y * width + x].x>0) result.push_back(glm::ivec2(x, y));
+                if(maskData[(size_t)y * width + x].x>0) result.push_back(glm::ivec2(x, y));
             }
         }
     }
@@ -3202,7 +3737,7 @@ void PatchInpainting::ExtractPatch(std::vector<glm::vec4> &image, int imageWidth
         for(k.x=-size; k.x<=size; k.x++)
         {                
             glm::ivec2 p = position + k;
-            int inx = p.y * imageWidth + p.x;
+            size_t inx = (size_t)p.y * imageWidth + p.x;
             if(p.x >=0 && p.y >=0 && p.x < imageWidth-1 && p.y < imageHeight-1)
             {
                 patch[i] = (image[inx]);
@@ -3239,7 +3774,7 @@ void PatchInpainting::Process(GLuint textureIn, GLuint textureOut, int width, in
         if(maskTexture.loaded) maskTexture.Unload();
         maskTexture = GL_TextureFloat(imageProcessStack->width, imageProcessStack->height, tci);
 
-        maskData.resize(maskTexture.width * maskTexture.height);
+        maskData.resize((size_t)maskTexture.width * maskTexture.height);
     }
     
     if(drawingMask)
@@ -3265,7 +3800,7 @@ void PatchInpainting::Process(GLuint textureIn, GLuint textureOut, int width, in
         
         if(iteration==0)
         {
-            textureData.resize(width * height);
+            textureData.resize((size_t)width * height);
             glBindTexture(GL_TEXTURE_2D, textureIn);
             glGetTexImage (GL_TEXTURE_2D,
                             0,
@@ -3298,7 +3833,7 @@ void PatchInpainting::Process(GLuint textureIn, GLuint textureOut, int width, in
                     for(k.x=-patchSize; k.x<=patchSize; k.x++)
                     {
                         glm::ivec2 c = points[i] + k;
-                        int inx = c.y * width + c.x;
+                        size_t inx = (size_t)c.y * width + c.x;
                         confidence += maskData[inx].y; //Confidence is stored in y. starts with 1
                     }
                 }
@@ -3317,13 +3852,13 @@ void PatchInpainting::Process(GLuint textureIn, GLuint textureOut, int width, in
                     for(k.x=-1; k.x<=1; k.x++)
                     {
                         glm::ivec2 c = points[i] + k;
-                        int inx = c.y * width + c.x;
+                        size_t inx = (size_t)c.y * width + c.x;
                         
                         float weightX = sobelKernel[ky * 3 + kx];
                         float weightY = sobelKernel[kx * 3 + ky];
 
                         glm::vec4 pixelColor = textureData[inx];
-                        float grayScale = (pixelColor.r + pixelColor.g + pixelColor.b) * 0.3333f;
+                        float grayScale = RGBToGray(pixelColor);
                         gradX += grayScale * weightX;         
                         gradY += grayScale * weightY;    
                         
@@ -3386,7 +3921,7 @@ void PatchInpainting::Process(GLuint textureIn, GLuint textureOut, int width, in
                         for(int kx=-patchSize; kx<=patchSize; kx++)
                         {                
                             glm::ivec2 p = c + glm::ivec2(kx, ky);
-                            int inx = p.y * width + p.x;
+                            size_t inx = (size_t)p.y * width + p.x;
                             if(p.x >=0 && p.y >=0 && p.x < width-1 && p.y < height-1)
                             {
                                 if(maskData[inx].x > 0) 
@@ -3413,7 +3948,8 @@ void PatchInpainting::Process(GLuint textureIn, GLuint textureOut, int width, in
                     if(difference < minDifference)
                     {
                         minDifference = difference;
-                        newPatch = currentPatch;
+                        //The best patch so far is kept, its old buffer is reused for the next extraction
+                        std::swap(newPatch, currentPatch);
                     }
                 }
             }
@@ -3427,13 +3963,13 @@ void PatchInpainting::Process(GLuint textureIn, GLuint textureOut, int width, in
 					for(int x=-patchSize; x<=patchSize; x++)
 					{
 						glm::ivec2 outputCoord = patchCenter + glm::ivec2(x, y);
-						int outputInx = outputCoord.y * width + outputCoord.x;
+						size_t outputInx = (size_t)outputCoord.y * width + outputCoord.x;
 						textureData[outputInx] = newPatch[i];
 						// maskData[outputInx].y = pixelConfidence;
 						i++;
 					}
 				}
-				maskData[patchCenter.y * width + patchCenter.x].x =0;
+				maskData[(size_t)patchCenter.y * width + patchCenter.x].x =0;
 				iteration++;
 			}
 
@@ -3442,7 +3978,7 @@ void PatchInpainting::Process(GLuint textureIn, GLuint textureOut, int width, in
             {
                 if(maskData[k].x >0) a[k] += glm::vec4(0,0.5, 0.5, 0);
             }   
-            a[patchCenter.y * width + patchCenter.x] = glm::vec4(0,1,0,1);
+            a[(size_t)patchCenter.y * width + patchCenter.x] = glm::vec4(0,1,0,1);
             glBindTexture(GL_TEXTURE_2D, textureOut);
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, a.data());
             glBindTexture(GL_TEXTURE_2D, 0);
@@ -3571,7 +4107,7 @@ bool PatchInpainting::MouseMove(float x, float y)
                     {
                         glm::ivec2 coord(c.x + kx, c.y + ky);
                         if(coord.x <0 || coord.y < 0 || coord.x >= maskTexture.width || coord.y >= maskTexture.height) continue;
-                        int inx = coord.y * maskTexture.width + coord.x;
+                        size_t inx = (size_t)coord.y * maskTexture.width + coord.x;
                         maskData[inx] = adding ? glm::vec4(1,1,0,0) : glm::vec4(0,0,0,1);
                     }
                 }
@@ -3607,63 +4143,33 @@ bool PatchInpainting::MouseReleased()
 //
 //
 //------------------------------------------------------------------------
-MultiResComposite::MultiResComposite(bool enabled, std::string newFileName) : ImageProcess("MultiResComposite", "shaders/MultiResComposite.glsl", enabled)
+//FNV-1a over the pixel words, hashed in blocks in parallel. Tells whether the input of a process changed since it last ran
+static uint64_t HashPixels(const std::vector<glm::vec4> &pixels)
 {
-    CreateComputeShader("shaders/HardCompositeViewMask.glsl", &viewMaskShader);
-    
-    float sigma = 5;
-    int size = 9;
-    
-    maskPyramid.gaussianBlur.sigma = sigma;
-    maskPyramid.gaussianBlur.size = size;
-    sourcePyramid.gaussianPyramid.gaussianBlur.sigma = sigma;
-    sourcePyramid.gaussianPyramid.gaussianBlur.size = size;
-    destPyramid.gaussianPyramid.gaussianBlur.sigma = sigma;
-    destPyramid.gaussianPyramid.gaussianBlur.size = size;
-
-    this->fileName = newFileName;
-    if(this->fileName != "") 
+    const int blockSize = 1 << 16;
+    int numBlocks = (int)((pixels.size() + blockSize - 1) / blockSize);
+    std::vector<uint64_t> blockHashes(numBlocks);
+    ParallelFor(0, numBlocks, [&](int block)
     {
-        TextureCreateInfo tci = {};
-        tci.generateMipmaps =false;
-        tci.minFilter = GL_LINEAR;
-        tci.magFilter = GL_LINEAR;        
-        
-        if(texture.loaded) texture.Unload();
-        texture = GL_TextureFloat(std::string(fileName), tci);
-    	filenameChanged = false;        
-    }    
+        const uint32_t *words = (const uint32_t*)(pixels.data() + (size_t)block * blockSize);
+        size_t count = 4 * (std::min)((size_t)blockSize, pixels.size() - (size_t)block * blockSize);
+        uint64_t hash = 14695981039346656037ull;
+        for(size_t i=0; i<count; i++) hash = (hash ^ words[i]) * 1099511628211ull;
+        blockHashes[block] = hash;
+    });
+
+    uint64_t hash = 14695981039346656037ull;
+    for(int block=0; block<numBlocks; block++) hash = (hash ^ blockHashes[block]) * 1099511628211ull;
+    return hash;
 }
 
-void MultiResComposite::Reconstruct(GLuint textureOut, GLuint sourceTexture, GLuint destTexture, GLuint mask, int width, int height)
+MultiResComposite::MultiResComposite(bool enabled, std::string newFileName) : ImageProcess("MultiResComposite", "", enabled)
 {
- 	glUseProgram(shader);
-	
-    //Bind image A
-    glUniform1i(glGetUniformLocation(shader, "textureOut"), 0); //program must be active
-    glBindImageTexture(0, textureOut, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-    
-    //Bind sampler
-	glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, sourceTexture);
-    glUniform1i(glGetUniformLocation(shader, "sourceTexture"), 0);
-    
-    //Bind sampler
-	glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, destTexture);
-    glUniform1i(glGetUniformLocation(shader, "destTexture"), 1);
-    
-    //Bind sampler
-	glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, mask);
-    glUniform1i(glGetUniformLocation(shader, "maskTexture"), 2);
-    
-     
-    glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-	glUseProgram(0);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);       
-}
+    CreateComputeShader("shaders/HardCompositeViewMask.glsl", &viewMaskShader);
 
+    this->fileName = newFileName;
+    if(this->fileName != "") filenameChanged=true;
+}
 
 void MultiResComposite::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
@@ -3675,7 +4181,8 @@ void MultiResComposite::Process(GLuint textureIn, GLuint textureOut, int width,
         tci.magFilter = GL_LINEAR; 
         if(maskTexture.loaded) maskTexture.Unload();
         maskTexture = GL_TextureFloat(imageProcessStack->width, imageProcessStack->height, tci);
-        maskData.resize(maskTexture.width * maskTexture.height);
+        maskData.resize((size_t)maskTexture.width * maskTexture.height);
+        maskChanged=true;
     }
 
     if(drawingMask)
@@ -3701,21 +4208,79 @@ void MultiResComposite::Process(GLuint textureIn, GLuint textureOut, int width,
     }
     else
     {
-        sourcePyramid.Build(texture.glTex, texture.width, texture.height);
-        destPyramid.Build(textureIn, width, height);
-        maskPyramid.Build(maskTexture.glTex, maskTexture.width, maskTexture.height);
-        
-        sourcePyramid.ClearTexture(textureOut, width, height);
-        
-        for(int i=sourcePyramid.gaussianPyramid.depth-1; i>=0; i--)
+        inputData.resize((size_t)width * height);
+        outputData.resize((size_t)width * height);
+        glBindTexture(GL_TEXTURE_2D, textureIn);
+        glGetTexImage (GL_TEXTURE_2D,
+                        0,
+                        GL_RGBA, // GL will convert to this format
+                        GL_FLOAT,   // Using this data type per-pixel
+                        inputData.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        //Pyramids are kept between runs, and only rebuilt when what they are made of changes
+        bool layoutChanged = depth != pyramidDepth || blendPyramid.numLevels==0 || blendPyramid.widths[0] != width || blendPyramid.heights[0] != height;
+        pyramidDepth = depth;
+
+        //The source is stretched over the image. Without one the input is blended with itself, through the input pyramid
+        if(sourceImage && (layoutChanged || sourceChanged))
+        {
+            sourceData.resize((size_t)width * height);
+            ResampleImage(sourceImage->pixels.data(), sourceImage->width, sourceImage->height, sourceData.data(), width, height, ResampleFilter::Triangle);
+            sourcePyramid.BuildLaplacian(sourceData.data(), width, height, depth);
+        }
+
+        uint64_t hash = HashPixels(inputData);
+        bool inputChanged = layoutChanged || hash != inputHash;
+        inputHash = hash;
+        if(inputChanged) destPyramid.BuildLaplacian(inputData.data(), width, height, depth);
+
+        std::vector<PyramidRegion> regions;
+        if(inputChanged || sourceChanged || maskChanged)
+        {
+            maskPyramid.BuildGaussian(maskData.data(), maskTexture.width, maskTexture.height, depth);
+            blendPyramid.Allocate(width, height, depth);
+            regions.resize(blendPyramid.numLevels);
+            for(int level=0; level<blendPyramid.numLevels; level++)
+            {
+                regions[level].x1 = blendPyramid.widths[level];
+                regions[level].y1 = blendPyramid.heights[level];
+            }
+        }
+        else if(!maskRegion.Empty())
         {
-            Reconstruct(textureOut, 
-                        sourcePyramid.gaussianPyramid.pyramid[i].glTex,
-                        destPyramid.gaussianPyramid.pyramid[i].glTex,
-                        maskPyramid.pyramid[i].glTex,
-                        width, height);
+            regions = maskPyramid.UpdateGaussian(maskData.data(), maskRegion);
+        }
+        sourceChanged=false;
+        maskChanged=false;
+        maskRegion = PyramidRegion();
 
+        if(regions.size())
+        {
+            //Blends each band with the mask blurred to the same scale, then sums the bands back
+            for(int level=0; level<blendPyramid.numLevels; level++)
+            {
+                const PyramidRegion &region = regions[level];
+                int levelWidth = blendPyramid.widths[level];
+                const glm::vec4 *dest = destPyramid.Level(level);
+                const glm::vec4 *source = sourceImage ? sourcePyramid.Level(level) : dest;
+                const glm::vec4 *mask = maskPyramid.Level(level);
+                glm::vec4 *blend = blendPyramid.Level(level);
+                ParallelForChunks(region.y0, region.y1, [&](int startRow, int endRow)
+                {
+                    for(int y=startRow; y<endRow; y++)
+                    {
+                        size_t row = (size_t)y * levelWidth;
+                        for(size_t i=row + region.x0; i<row + region.x1; i++) blend[i] = mask[i].r * source[i] + (1 - mask[i].r) * dest[i];
+                    }
+                }, 8);
+            }
+            blendPyramid.Collapse(outputData.data(), regions);
         }
+
+        glBindTexture(GL_TEXTURE_2D, textureOut);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
     }
 }
 
@@ -3729,17 +4294,7 @@ bool MultiResComposite::RenderGui()
     bool changed=false;
     selected=true;
     
-    float sigma = maskPyramid.gaussianBlur.sigma;
-    int size = maskPyramid.gaussianBlur.size;
-    changed |= ImGui::SliderFloat("Sigma", &sigma, 0, 10);
-    changed |= ImGui::SliderInt("Size", &size, 3, 21);
-
-    maskPyramid.gaussianBlur.sigma = sigma;
-    maskPyramid.gaussianBlur.size = size;
-    sourcePyramid.gaussianPyramid.gaussianBlur.sigma = sigma;
-    sourcePyramid.gaussianPyramid.gaussianBlur.size = size;
-    destPyramid.gaussianPyramid.gaussianBlur.sigma = sigma;
-    destPyramid.gaussianPyramid.gaussianBlur.size = size;
+    changed |= ImGui::SliderInt("Depth", &depth, 1, 10);
 
     ImGui::Text("Mask");
     changed |= ImGui::Checkbox("Draw Mask", &drawingMask);
@@ -3761,26 +4316,25 @@ bool MultiResComposite::RenderGui()
         }        
     }
 
+    return changed;
+}
+
+bool MultiResComposite::Update()
+{
     if(filenameChanged)
     {
-        TextureCreateInfo tci = {};
-        tci.generateMipmaps =false;
-        tci.minFilter = GL_LINEAR;
-        tci.magFilter = GL_LINEAR;        
-        
-        if(texture.loaded) texture.Unload();
-        texture = GL_TextureFloat(std::string(fileName), tci);
-        
-		changed=true;
-		filenameChanged = false;
+        RequestTexture(imageProcessStack->imageLoader, loadRequest, fileName);
+        filenameChanged = false;
     }
-
-    return changed;
+    if(!ReceiveTexture(imageProcessStack->imageLoader, loadRequest, texture, &sourceImage)) return false;
+    sourceChanged=true;
+    return true;
 }
 
 
 void MultiResComposite::Unload()
 {
+    imageProcessStack->imageLoader.Release(loadRequest);
     maskTexture.Unload();
     texture.Unload();
     glDeleteProgram(viewMaskShader);
@@ -3797,6 +4351,9 @@ bool MultiResComposite::MouseMove(float x, float y)
     {
         glm::vec2 diff = currentMousPos - previousMousPos;
         float diffLength = std::ceil(glm::length(diff));
+        PyramidRegion stroke;
+        stroke.x0 = maskTexture.width;
+        stroke.y0 = maskTexture.height;
         for(float i=0; i<diffLength; i++)
         {
             float t = i / diffLength;
@@ -3810,17 +4367,33 @@ bool MultiResComposite::MouseMove(float x, float y)
                     {
                         glm::ivec2 coord(c.x + kx, c.y + ky);
                         if(coord.x <0 || coord.y < 0 || coord.x >= maskTexture.width || coord.y >= maskTexture.height) continue;
-                        int inx = coord.y * maskTexture.width + coord.x;
+                        size_t inx = (size_t)coord.y * maskTexture.width + coord.x;
                         maskData[inx] = adding ? glm::vec4(1,1,1,1) : glm::vec4(0,0,0,1);
+                        stroke.x0 = (std::min)(stroke.x0, coord.x);
+                        stroke.y0 = (std::min)(stroke.y0, coord.y);
+                        stroke.x1 = (std::max)(stroke.x1, coord.x+1);
+                        stroke.y1 = (std::max)(stroke.y1, coord.y+1);
                     }
                 }
             }
         }
 
 
-        glBindTexture(GL_TEXTURE_2D, maskTexture.glTex);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, maskTexture.width, maskTexture.height, 0, GL_RGBA, GL_FLOAT, maskData.data());
-        glBindTexture(GL_TEXTURE_2D, 0);        
+        //Only the painted rows and columns are sent, and recomposited
+        if(!stroke.Empty())
+        {
+            glBindTexture(GL_TEXTURE_2D, maskTexture.glTex);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, maskTexture.width);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, stroke.x0, stroke.y0, stroke.x1 - stroke.x0, stroke.y1 - stroke.y0, GL_RGBA, GL_FLOAT, maskData.data() + stroke.y0 * maskTexture.width + stroke.x0);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+
+            if(maskRegion.Empty()) maskRegion = stroke;
+            maskRegion.x0 = (std::min)(maskRegion.x0, stroke.x0);
+            maskRegion.y0 = (std::min)(maskRegion.y0, stroke.y0);
+            maskRegion.x1 = (std::max)(maskRegion.x1, stroke.x1);
+            maskRegion.y1 = (std::max)(maskRegion.y1, stroke.y1);
+        }
 
         drawChanged=true;
     }
@@ -3869,26 +4442,27 @@ bool AddColor::RenderGui()
 
 //
 //------------------------------------------------------------------------
-LaplacianOfGaussian::LaplacianOfGaussian(bool enabled) : ImageProcess("LaplacianOfGaussian", "shaders/LaplacianOfGaussian.glsl", enabled)
+LaplacianOfGaussian::LaplacianOfGaussian(bool enabled) : ImageProcess("LaplacianOfGaussian", "", enabled)
 {
     kernel.resize(maxSize * maxSize);
-    glGenBuffers(1, (GLuint*)&kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, kernel.size() * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);     
 }
 
 void LaplacianOfGaussian::RecalculateKernel()
 {
-    int halfSize = (int)std::floor(size / 2.0f);
-    float sigma2 = sigma*sigma;
+    //Same footprint on the proxies, odd sizes stay odd
+    int kernelSize = Scaled(size);
+    if(size % 2 == 1 && kernelSize % 2 == 0) kernelSize++;
+    float kernelSigma = Scaled(sigma, 0.5f);
+    //Second derivatives grow with the square of the reduction
+    float resolutionScale2 = ResolutionScale() * ResolutionScale();
+    int halfSize = (int)std::floor(kernelSize / 2.0f);
+    float sigma2 = kernelSigma*kernelSigma;
     float s = 2.0f * sigma2;
     float sum = 0.0f;
     
     for (int x = -halfSize; x <= halfSize; x++) {
         for (int y = -halfSize; y <= halfSize; y++) {
-            int flatInx = (y + halfSize) * size + (x + halfSize);
+            int flatInx = (y + halfSize) * kernelSize + (x + halfSize);
             float x2 = (float)(x*x);
             float y2 = (float)(y*y);
             
@@ -3896,27 +4470,40 @@ void LaplacianOfGaussian::RecalculateKernel()
             float b = 1 - (x2 + y2) /s;
             float c = exp(-(x2 + y2) / s);
             // float a = (x2 + y2 - s) / (sigma2 * sigma2);
-			kernel[flatInx] = (a * b * c);
+			kernel[flatInx] = (a * b * c) * resolutionScale2;
 
             sum += kernel[flatInx];
         }
     }
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, kernel.size() * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    convolution.SetKernel(kernel.data(), kernelSize, kernelSize);
 
     shouldRecalculateKernel=false;
+    kernelLevel=proxyLevel;
 }
 
-void LaplacianOfGaussian::SetUniforms()
+void LaplacianOfGaussian::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    if(shouldRecalculateKernel) RecalculateKernel();
+    if(shouldRecalculateKernel || kernelLevel != proxyLevel) RecalculateKernel();
 
-    glUniform1i(glGetUniformLocation(shader, "size"), size);
-    
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    //Only the grayscale is filtered
+    ConvertColors(inputData.data(), inputData.data(), inputData.size(), ColorSpace::RGB, ColorSpace::Gray);
+    convolution.Convolve(inputData.data(), outputData.data(), width, height, 1);
+    for(size_t i=0; i<outputData.size(); i++) outputData[i] = glm::vec4(glm::vec3(outputData[i].r), 1);
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 bool LaplacianOfGaussian::RenderGui()
@@ -3926,37 +4513,31 @@ bool LaplacianOfGaussian::RenderGui()
     shouldRecalculateKernel |= ImGui::SliderFloat("Sigma", &sigma, 0, 2);
 
     changed |= shouldRecalculateKernel;
+    changed |= RenderConvolutionGui(convolution);
     return changed;
 }
-
-void LaplacianOfGaussian::Unload()
-{
-    glDeleteBuffers(1, &kernelBuffer);
-}
 //
 
 //
 //------------------------------------------------------------------------
-DifferenceOfGaussians::DifferenceOfGaussians(bool enabled) : ImageProcess("DifferenceOfGaussians", "shaders/DifferenceOfGaussians.glsl", enabled)
+DifferenceOfGaussians::DifferenceOfGaussians(bool enabled) : ImageProcess("DifferenceOfGaussians", "", enabled)
 {
     kernel.resize(maxSize * maxSize);
-    glGenBuffers(1, (GLuint*)&kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, kernel.size() * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);     
 }
 
 void DifferenceOfGaussians::RecalculateKernel()
 {
-    int halfSize = (int)std::floor(size / 2.0f);
+    int kernelSize = Scaled(size);
+    if(size % 2 == 1 && kernelSize % 2 == 0) kernelSize++;
+    int halfSize = (int)std::floor(kernelSize / 2.0f);
 
-    std::vector<float> kernel1(size * size);
+    std::vector<float> kernel1(kernelSize * kernelSize);
     {
-        float s = 2.0f * sigma1;
+        //sigma1 and sigma2 are variances, scaled twice
+        float s = 2.0f * Scaled(Scaled(sigma1));
         for (int x = -halfSize; x <= halfSize; x++) {
             for (int y = -halfSize; y <= halfSize; y++) {
-                int flatInx = (y + halfSize) * size + (x + halfSize);
+                int flatInx = (y + halfSize) * kernelSize + (x + halfSize);
                 float x2 = (float)(x*x);
                 float y2 = (float)(y*y);
                 double num = (exp(-(x2+y2) / s));
@@ -3966,12 +4547,12 @@ void DifferenceOfGaussians::RecalculateKernel()
         }
     }
 
-    std::vector<float> kernel2(size * size);
+    std::vector<float> kernel2(kernelSize * kernelSize);
     {
-       float s = 2.0f * sigma2;
+       float s = 2.0f * Scaled(Scaled(sigma2));
        for (int x = -halfSize; x <= halfSize; x++) {
             for (int y = -halfSize; y <= halfSize; y++) {
-                int flatInx = (y + halfSize) * size + (x + halfSize);
+                int flatInx = (y + halfSize) * kernelSize + (x + halfSize);
                 float x2 = (float)(x*x);
                 float y2 = (float)(y*y);
                 double num = (exp(-(x2+y2) / s));
@@ -3981,235 +4562,134 @@ void DifferenceOfGaussians::RecalculateKernel()
         }
     }
 
-    for(int i=0; i<size * size; i++)
+    for(int i=0; i<kernelSize * kernelSize; i++)
     {
         kernel[i] = kernel2[i]-kernel1[i];
     }
 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, kernel.size() * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    convolution.SetKernel(kernel.data(), kernelSize, kernelSize);
 
     shouldRecalculateKernel=false;
+    kernelLevel=proxyLevel;
 }
 
-void DifferenceOfGaussians::SetUniforms()
-{
-    if(shouldRecalculateKernel) RecalculateKernel();
-
-    glUniform1i(glGetUniformLocation(shader, "size"), size);
-    
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
-}
-
-bool DifferenceOfGaussians::RenderGui()
-{
-    bool changed=false;
-    shouldRecalculateKernel |= ImGui::SliderInt("Size", &size, 1, maxSize);
-    shouldRecalculateKernel |= ImGui::SliderFloat("Sigma", &sigma1, 0, 10);
-    sigma2 = sigma1*2;
-    changed |= shouldRecalculateKernel;
-    return changed;
-}
-
-void DifferenceOfGaussians::Unload()
+void DifferenceOfGaussians::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    glDeleteBuffers(1, &kernelBuffer);
-}
-//
-
-//
-//------------------------------------------------------------------------
-CannyEdgeDetector::CannyEdgeDetector(bool enabled) : ImageProcess("CannyEdgeDetector", "shaders/GaussianBlur.glsl", enabled)
-{
-    kernel.resize(maxSize * maxSize);
-    glGenBuffers(1, (GLuint*)&kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, kernel.size() * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);     
+    if(shouldRecalculateKernel || kernelLevel != proxyLevel) RecalculateKernel();
 
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-   CreateComputeShader("shaders/cannyGradient.glsl", &gradientShader);
-   CreateComputeShader("shaders/cannyEdge.glsl", &edgeShader);
-   CreateComputeShader("shaders/cannyThreshold.glsl", &thresholdShader);
-   CreateComputeShader("shaders/cannyHysteresis.glsl", &hysteresisShader);
-}
-
-void CannyEdgeDetector::RecalculateKernel()
-{
-    int halfSize = (int)std::floor(size / 2.0f);
-    double r, s = 2.0 * sigma * sigma;
-    double sum = 0.0;
-    
-    for (int x = -halfSize; x <= halfSize; x++) {
-        for (int y = -halfSize; y <= halfSize; y++) {
-            int flatInx = (y + halfSize) * size + (x + halfSize);
-            r = (float)sqrt(x * x + y * y);
-			double num = (exp(-(r * r) / s));
-			double denom = (PI * s);
-            kernel[flatInx] =  (float)(num / denom);
-            sum += kernel[flatInx];
-        }
-    }
-
-    // normalising the Kernel
-    for (int i = 0; i < size; ++i)
-    {
-        for (int j = 0; j < size; ++j)
-        {
-            int flatInx = (i) * size + (j);
-            kernel[flatInx] /= (float)sum;
-        }
-    }
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, kernel.size() * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    //Only the grayscale is filtered
+    ConvertColors(inputData.data(), inputData.data(), inputData.size(), ColorSpace::RGB, ColorSpace::Gray);
+    convolution.Convolve(inputData.data(), outputData.data(), width, height, 1);
+    for(size_t i=0; i<outputData.size(); i++) outputData[i] = glm::vec4(glm::vec3(outputData[i].r), 1);
 
-    shouldRecalculateKernel=false;
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void CannyEdgeDetector::SetUniforms()
+bool DifferenceOfGaussians::RenderGui()
 {
-    if(shouldRecalculateKernel) RecalculateKernel();
+    bool changed=false;
+    shouldRecalculateKernel |= ImGui::SliderInt("Size", &size, 1, maxSize);
+    shouldRecalculateKernel |= ImGui::SliderFloat("Sigma", &sigma1, 0, 10);
+    sigma2 = sigma1*2;
+    changed |= shouldRecalculateKernel;
+    changed |= RenderConvolutionGui(convolution);
+    return changed;
+}
+//
 
-    glUniform1i(glGetUniformLocation(shader, "size"), size);
-    
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
+//
+//------------------------------------------------------------------------
+CannyEdgeDetector::CannyEdgeDetector(bool enabled) : ImageProcess("CannyEdgeDetector", "", enabled)
+{
 }
 
 bool CannyEdgeDetector::RenderGui()
 {
     bool changed=false;
-    shouldRecalculateKernel |= ImGui::SliderInt("Size", &size, 1, maxSize);
-    shouldRecalculateKernel |= ImGui::SliderFloat("Sigma", &sigma, 1, 10);
+    changed |= ImGui::SliderFloat("Sigma", &sigma, 0.5f, 10);
     
-    shouldRecalculateKernel |= ImGui::SliderFloat("Low Threshold", &threshold, 0, 0.33f);
+    changed |= ImGui::SliderFloat("Low Threshold", &threshold, 0, 0.33f);
 
     changed |= ImGui::DragInt("Output", &outputStep, 1, 0, 4);
 
-    changed |= shouldRecalculateKernel;
     return changed;
 }
 
 void CannyEdgeDetector::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    if(blurTexture.width != width || blurTexture.height != height || !blurTexture.loaded)
-    {
-        TextureCreateInfo tci = {};
-        tci.generateMipmaps =false;
-        tci.srgb=true;
-        tci.minFilter = GL_LINEAR;
-        tci.magFilter = GL_LINEAR;        
-        blurTexture = GL_TextureFloat(width, height, tci);        
-        gradientTexture = GL_TextureFloat(width, height, tci);        
-        edgeTexture = GL_TextureFloat(width, height, tci);        
-        thresholdTexture = GL_TextureFloat(width, height, tci);        
-    }
-
-	//Blur
-
-	glUseProgram(shader);
-	SetUniforms();
-    glUniform1i(glGetUniformLocation(shader, "textureIn"), 0); //program must be active
-    glBindImageTexture(0, textureIn, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
-	
-    glUniform1i(glGetUniformLocation(shader, "textureOut"), 1); //program must be active
-    glBindImageTexture(1, (outputStep==0) ? textureOut : blurTexture.glTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-    
-    glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);
-	glUseProgram(0);
-
-    if(outputStep==0) return;
-	
-    //Gradient
-    glUseProgram(gradientShader);
-    glUniform1i(glGetUniformLocation(gradientShader, "textureIn"), 0); //program must be active
-    glBindImageTexture(0, blurTexture.glTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
-	
-    glUniform1i(glGetUniformLocation(gradientShader, "textureOut"), 1); //program must be active
-    glBindImageTexture(1, (outputStep==1) ? textureOut : gradientTexture.glTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-    
-    glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);
-	glUseProgram(0);
-	
-    if(outputStep==1) return;
-
-    //Edge
-    glUseProgram(edgeShader);
-    glUniform1i(glGetUniformLocation(edgeShader, "textureIn"), 0); //program must be active
-    glBindImageTexture(0, gradientTexture.glTex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
-	
-    glUniform1i(glGetUniformLocation(edgeShader, "textureOut"), 1); //program must be active
-    glBindImageTexture(1, (outputStep==2) ? textureOut : edgeTexture.glTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-    
-    
-    glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);
-	glUseProgram(0);
-
-    if(outputStep==2) return;
-
-    //Threshold
-    glUseProgram(thresholdShader);
-    glUniform1i(glGetUniformLocation(thresholdShader, "textureIn"), 0); //program must be active
-    glBindImageTexture(0, edgeTexture.glTex , 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
-	
-    glUniform1i(glGetUniformLocation(thresholdShader, "textureOut"), 1); //program must be active
-    glBindImageTexture(1, (outputStep==3) ? textureOut : thresholdTexture.glTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-    
-    glUniform1f(glGetUniformLocation(thresholdShader, "threshold"), threshold); //program must be active
-    
-    glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);
-	glUseProgram(0);
-
-    if(outputStep==3) return;
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    //Histeresis
-    glUseProgram(hysteresisShader);
-    glUniform1i(glGetUniformLocation(hysteresisShader, "textureIn"), 0); //program must be active
-    glBindImageTexture(0, thresholdTexture.glTex , 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
-	
-    glUniform1i(glGetUniformLocation(hysteresisShader, "textureOut"), 1); //program must be active
-    glBindImageTexture(1, textureOut, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
-    
-    glDispatchCompute((width / 32) + 1, (height / 32) + 1, 1);
-    glMemoryBarrier(GL_ALL_BARRIER_BITS);
-	glUseProgram(0);
+    //Blur, gradient, suppression, threshold and hysteresis in one pass
+    edges.Detect(inputData.data(), width, height, Scaled(sigma, 0.5f), threshold, threshold * 3, outputStep==0);
+    ParallelForChunks(0, height, [&](int startRow, int endRow)
+    {
+        for(int y=startRow; y<endRow; y++)
+        {
+            size_t row = (size_t)y * width;
+            for(int x=0; x<width; x++)
+            {
+                size_t i = row + x;
+                uint8_t flag = edges.flags[i];
+                switch(outputStep)
+                {
+                case 0:
+                    outputData[i] = glm::vec4(glm::vec3(edges.blurred[i]), 1);
+                    break;
+                case 1:
+                    outputData[i] = glm::vec4(edges.magnitude[i], edges.angle[i], 0, 1);
+                    break;
+                case 2:
+                    outputData[i] = glm::vec4((flag & CANNY_MAXIMUM) ? glm::vec3(edges.magnitude[i]) : glm::vec3(0), 1);
+                    break;
+                case 3:
+                    outputData[i] = glm::vec4((flag & CANNY_STRONG) ? 1.0f : 0.0f, (flag & CANNY_WEAK) ? 1.0f : 0.0f, 0, 1);
+                    break;
+                default:
+                    outputData[i] = (flag & CANNY_EDGE) ? glm::vec4(1) : glm::vec4(0, 0, 0, 1);
+                    break;
+                }
+                outputData[i].a = 1;
+            }
+        }
+    }, 8);
 
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
+
 void CannyEdgeDetector::Unload()
 {
-    glDeleteProgram(gradientShader);
-    glDeleteProgram(edgeShader);
-    glDeleteProgram(thresholdShader);
-    glDeleteProgram(hysteresisShader);
-    blurTexture.Unload();
-    gradientTexture.Unload();
-    edgeTexture.Unload();
-    thresholdTexture.Unload();
-    
 }
 
 //
 
 //
 //------------------------------------------------------------------------
-ArbitraryFilter::ArbitraryFilter(bool enabled) : ImageProcess("ArbitraryFilter", "shaders/ArbitraryFilter.glsl", enabled)
+ArbitraryFilter::ArbitraryFilter(bool enabled) : ImageProcess("ArbitraryFilter", "", enabled)
 {
     kernel.resize(maxSize * maxSize, 1);
     normalizedKernel.resize(maxSize * maxSize, 1);
-
-    glGenBuffers(1, (GLuint*)&kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-	glBufferData(GL_SHADER_STORAGE_BUFFER, kernel.size() * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
-	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);     
 }
 
 void ArbitraryFilter::RecalculateKernel()
@@ -4228,30 +4708,37 @@ void ArbitraryFilter::RecalculateKernel()
         {
             normalizedKernel[i] = kernel[i] / sum;
         }
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeX * sizeY * sizeof(float), normalizedKernel.data(), GL_DYNAMIC_COPY); 
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        convolution.SetKernel(normalizedKernel.data(), sizeX, sizeY);
     }
     else
     {
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeX * sizeY * sizeof(float), kernel.data(), GL_DYNAMIC_COPY); 
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        convolution.SetKernel(kernel.data(), sizeX, sizeY);
     }
 
     
     shouldRecalculateKernel=false;
 }
 
-void ArbitraryFilter::SetUniforms()
+void ArbitraryFilter::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
     if(shouldRecalculateKernel) RecalculateKernel();
 
-    glUniform1i(glGetUniformLocation(shader, "sizeX"), sizeX);
-    glUniform1i(glGetUniformLocation(shader, "sizeY"), sizeY);
-    
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, kernelBuffer);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, kernelBuffer);
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    convolution.Convolve(inputData.data(), outputData.data(), width, height);
+    for(size_t i=0; i<outputData.size(); i++) outputData[i].a = 1;
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 bool ArbitraryFilter::RenderGui()
@@ -4262,6 +4749,7 @@ bool ArbitraryFilter::RenderGui()
 
     shouldRecalculateKernel |= ImGui::SliderInt("SizeX", &sizeX, 1, maxSize);
     shouldRecalculateKernel |= ImGui::SliderInt("SizeY", &sizeY, 1, maxSize);
+    changed |= RenderConvolutionGui(convolution);
 
     int inx=0;
     for(int y=0; y<sizeY; y++)
@@ -4301,24 +4789,55 @@ bool GammaCorrection::RenderGui()
 
 //
 //------------------------------------------------------------------------
-ColorDistance::ColorDistance(bool enabled) : ImageProcess("ColorDistance", "shaders/ColorDistance.glsl", enabled)
+ColorDistance::ColorDistance(bool enabled) : ImageProcess("ColorDistance", "", enabled)
 {
     
 }
 
-void ColorDistance::SetUniforms()
-{
-    glUniform1f(glGetUniformLocation(shader, "clipDistance"), distance);
-    glUniform3fv(glGetUniformLocation(shader, "clipColor"), 1, glm::value_ptr(color));
-}
-
 bool ColorDistance::RenderGui()
 {
     bool changed=false;
     changed |= ImGui::ColorEdit3("Color", &color[0]);
     changed |= ImGui::DragFloat("Distance", &distance, 0.001f);
+    changed |= RenderColorSpaceGui(space);
+    if(space==ColorSpace::Lab) ImGui::Text("Distance is Delta E");
     return changed;
 }
+
+void ColorDistance::Process(GLuint textureIn, GLuint textureOut, int width, int height)
+{
+    inputData.resize((size_t)width * height);
+    outputData.resize((size_t)width * height);
+    glBindTexture(GL_TEXTURE_2D, textureIn);
+    glGetTexImage (GL_TEXTURE_2D,
+                    0,
+                    GL_RGBA, // GL will convert to this format
+                    GL_FLOAT,   // Using this data type per-pixel
+                    inputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    //Distances are measured in the chosen space, the pixels that are kept keep their color
+    ConvertColors(inputData.data(), outputData.data(), outputData.size(), ColorSpace::RGB, space);
+    glm::vec3 clipColor = ConvertColor(color, ColorSpace::RGB, space);
+    float squaredDistance = distance * distance;
+    ParallelForChunks(0, height, [&](int startRow, int endRow)
+    {
+        for(int y=startRow; y<endRow; y++)
+        {
+            size_t row = (size_t)y * width;
+            for(int x=0; x<width; x++)
+            {
+                size_t i = row + x;
+                bool inside = glm::distance2(glm::vec3(outputData[i]), clipColor) <= squaredDistance;
+                outputData[i] = inside ? glm::vec4(glm::vec3(inputData[i]), 1) : glm::vec4(0, 0, 0, 1);
+            }
+        }
+    }, 8);
+
+    glBindTexture(GL_TEXTURE_2D, textureOut);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, outputData.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 //
 
 //
@@ -4363,33 +4882,15 @@ bool EdgeLinking::RenderGui()
 void EdgeLinking::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
     //Only recompute canny when its params changed. //Output it into textureOut, act as a tmp texture that we'll write again after
+    cannyEdgeDetector->proxyLevel = proxyLevel;
     cannyEdgeDetector->Process(textureIn, textureOut, width, height);
+    const CannyEdges &edges = cannyEdgeDetector->edges;
 
-    //Read back gradient
-    gradientData.resize(width * height, glm::vec4(0));
-    glBindTexture(GL_TEXTURE_2D, cannyEdgeDetector->gradientTexture.glTex);
-    glGetTexImage (GL_TEXTURE_2D,
-                    0,
-                    GL_RGBA, // GL will convert to this format
-                    GL_FLOAT,   // Using this data type per-pixel
-                    gradientData.data());
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    //Read back edges
-    edgeData.resize(width * height, glm::vec4(0));
-    glBindTexture(GL_TEXTURE_2D, textureOut);
-    glGetTexImage (GL_TEXTURE_2D,
-                    0,
-                    GL_RGBA, // GL will convert to this format
-                    GL_FLOAT,   // Using this data type per-pixel
-                    edgeData.data());
-    glBindTexture(GL_TEXTURE_2D, 0);
 
+    int halfWindowSize = Scaled(windowSize)/2;
 
-    int halfWindowSize = windowSize/2;
-
-    linkedEdgeData.resize(width * height);
-    std::fill(linkedEdgeData.begin(), linkedEdgeData.end(), glm::vec4(0));
+    linkedEdgeData.resize((size_t)width * height);
+    std::fill(linkedEdgeData.begin(), linkedEdgeData.end(), glm::vec4(0, 0, 0, 1));
 
     glm::ivec2 pixelCoord;
     for(pixelCoord.y=0; pixelCoord.y<height; pixelCoord.y++)
@@ -4397,18 +4898,18 @@ void EdgeLinking::Process(GLuint textureIn, GLuint textureOut, int width, int he
         for(pixelCoord.x=0; pixelCoord.x<width; pixelCoord.x++)
         {
 
-            int inx = pixelCoord.y * width + pixelCoord.x;
-            float pixelEdge = edgeData[inx].x;
+            size_t inx = (size_t)pixelCoord.y * width + pixelCoord.x;
+            bool pixelEdge = (edges.flags[inx] & CANNY_EDGE) != 0;
             
-            //Copy the edgeData to the output in all cases
-            linkedEdgeData[inx] = edgeData[inx];
+            //Copy the edges to the output in all cases
+            if(pixelEdge) linkedEdgeData[inx] = glm::vec4(1);
 
             if(!doProcess) continue;
             
-            if(pixelEdge>0)
+            if(pixelEdge)
             {
-                float pixelMagnitude = gradientData[inx].x;
-                float pixelAngle = gradientData[inx].y;
+                float pixelMagnitude = edges.magnitude[inx];
+                float pixelAngle = edges.angle[inx];
 
                 glm::ivec2 windowCoord;
                 for(windowCoord.y=-halfWindowSize; windowCoord.y < halfWindowSize; windowCoord.y++)
@@ -4418,13 +4919,12 @@ void EdgeLinking::Process(GLuint textureIn, GLuint textureOut, int width, int he
                         glm::ivec2 coord = pixelCoord + windowCoord;
                         if(coord.x < 0 || coord.y < 0 || coord.x >=width || coord.y >=height)continue;
 
-                        int coordInx = coord.y * width + coord.x;
-                        float windowEdge = edgeData[coordInx].x;
-                        if(windowEdge>0) //If we find another edge in the window
+                        size_t coordInx = (size_t)coord.y * width + coord.x;
+                        if(edges.flags[coordInx] & CANNY_EDGE) //If we find another edge in the window
                         {
 
-                            float windowMagnitude = gradientData[coordInx].x;
-                            float windowAngle = gradientData[coordInx].y;
+                            float windowMagnitude = edges.magnitude[coordInx];
+                            float windowAngle = edges.angle[coordInx];
                             
                             if(std::abs(windowMagnitude - pixelMagnitude) < magnitudeThreshold && std::abs(windowAngle - pixelAngle) < angleThreshold)
                             {
@@ -4490,9 +4990,9 @@ bool RegionGrow::RenderGui()
 
 void RegionGrow::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    inputData.resize(width * height);
-    mask.resize(width * height);
-    tracker.resize(width * height);
+    inputData.resize((size_t)width * height);
+    mask.resize((size_t)width * height);
+    tracker.resize((size_t)width * height);
     std::fill(mask.begin(), mask.end(), glm::vec4(0,0,0,1));
     std::fill(tracker.begin(), tracker.end(), false);
     glBindTexture(GL_TEXTURE_2D, textureIn);
@@ -4508,9 +5008,9 @@ void RegionGrow::Process(GLuint textureIn, GLuint textureOut, int width, int hei
     if(clickedPoint.x >=0) 
     {
         glm::ivec2 clickedPointTextureSpace = glm::ivec2(clickedPoint * glm::vec2(width, height));
-        std::stack<glm::ivec2> pointsToExplore;
+        ArenaStack<glm::ivec2> pointsToExplore = MakeArenaStack<glm::ivec2>(imageProcessStack->arena);
 
-        glm::vec3 currentPointColor = inputData[clickedPointTextureSpace.y * width + clickedPointTextureSpace.x];
+        glm::vec3 currentPointColor = inputData[(size_t)clickedPointTextureSpace.y * width + clickedPointTextureSpace.x];
         
         pointsToExplore.push(clickedPointTextureSpace);
         while(pointsToExplore.size() !=0)
@@ -4526,22 +5026,22 @@ void RegionGrow::Process(GLuint textureIn, GLuint textureOut, int width, int hei
                     glm::ivec2 coord = currentPoint + glm::ivec2(x, y);
 					if (coord.x >= 0 && coord.x < width && coord.y >= 0 && coord.y < height)
 					{
-						glm::vec3 color = inputData[coord.y * width + coord.x];
-						if(glm::distance(color, currentPointColor) < threshold && tracker[coord.y * width + coord.x] == false)
+						glm::vec3 color = inputData[(size_t)coord.y * width + coord.x];
+						if(glm::distance(color, currentPointColor) < threshold && tracker[(size_t)coord.y * width + coord.x] == false)
 						{
 							pointsToExplore.push(coord);
-                            tracker[coord.y * width + coord.x]=true;
+                            tracker[(size_t)coord.y * width + coord.x]=true;
                             if(outputType == OutputType::AddColorToImage)
                             {
-							    inputData[coord.y * width + coord.x] = glm::vec4(1,0,0,1);
+							    inputData[(size_t)coord.y * width + coord.x] = glm::vec4(1,0,0,1);
                             }
                             else if(outputType == OutputType::Mask)
                             {
-                                mask[coord.y * width + coord.x] = glm::vec4(1,1,1,1);
+                                mask[(size_t)coord.y * width + coord.x] = glm::vec4(1,1,1,1);
                             }
                             else if(outputType == OutputType::Isolate)
                             {
-                                mask[coord.y * width + coord.x] = inputData[coord.y * width + coord.x];
+                                mask[(size_t)coord.y * width + coord.x] = inputData[(size_t)coord.y * width + coord.x];
                             }
 						}
 					}
@@ -4588,6 +5088,7 @@ bool KMeansCluster::RenderGui()
     if(ImGui::Button("Process")) shouldProcess=true;
     changed |= ImGui::DragInt("Num Clusters", &numClusters);
     changed |= ImGui::Combo("OutputMode", (int*)&outputMode, "Random Color\0Cluster Color\0GrayScale\0\0");
+    shouldProcess |= RenderColorSpaceGui(space);
 
     changed |= shouldProcess;
     return changed;
@@ -4596,7 +5097,7 @@ bool KMeansCluster::RenderGui()
 
 void KMeansCluster::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    inputData.resize(width * height);
+    inputData.resize((size_t)width * height);
     glBindTexture(GL_TEXTURE_2D, textureIn);
     glGetTexImage (GL_TEXTURE_2D,
                     0,
@@ -4607,20 +5108,26 @@ void KMeansCluster::Process(GLuint textureIn, GLuint textureOut, int width, int
     
     if(shouldProcess)
     {
-        //Initialize the clusters with random positions
-        clusterPositions.resize(numClusters);
-        for(int i=0; i<numClusters; i++)
+        colorData.resize(inputData.size());
+        ConvertColors(inputData.data(), colorData.data(), colorData.size(), ColorSpace::RGB, space);
+
+        //Initialize the clusters with the colors of random pixels, or keep those of the previous frame of a sequence,
+        //which only need a few iterations to follow the changes
+        if(!warmStart || clusterPositions.size() != numClusters)
         {
-            clusterPositions[i] = glm::vec3(
-                (float)rand() / (float)RAND_MAX,
-                (float)rand() / (float)RAND_MAX,
-                (float)rand() / (float)RAND_MAX
-            );
+            clusterPositions.resize(numClusters);
+            for(int i=0; i<numClusters; i++)
+            {
+                size_t pixel = (size_t)(((double)rand() / (double)RAND_MAX) * (double)(colorData.size()-1));
+                clusterPositions[i] = glm::vec3(colorData[pixel]);
+            }
         }
+        warmStart=false;
 
         clusterMapping.resize(numClusters);
+        float scale = ColorSpaceScale(space);
         float totalDiff=100000;
-        while(totalDiff > 0.1f)
+        while(totalDiff > 0.1f * scale * scale)
         {
             //Clear the mapping
             for(int i=0; i<clusterMapping.size(); i++)
@@ -4629,13 +5136,13 @@ void KMeansCluster::Process(GLuint textureIn, GLuint textureOut, int width, int
             }
             
             //Associate each pixel with one cluster
-            for(int i=0; i<inputData.size(); i++)
+            for(size_t i=0; i<inputData.size(); i++)
             {
                 float closestDistance = 1e30f;
                 int closestCluster=0;
                 for(int j=0; j<numClusters; j++)
                 {
-                    glm::vec3 color = glm::vec3(inputData[i]);
+                    glm::vec3 color = glm::vec3(colorData[i]);
                     float distance = glm::distance2(color, clusterPositions[j]);
                     
                     if(distance < closestDistance)
@@ -4651,11 +5158,13 @@ void KMeansCluster::Process(GLuint textureIn, GLuint textureOut, int width, int
             totalDiff = 0;
             for(int i=0; i<numClusters; i++)
             {
+                //Empty clusters stay where they are
+                if(clusterMapping[i].empty()) continue;
                 glm::vec3 average(0);
                 float inverseSize = 1.0f / (float)clusterMapping[i].size();
-                for(int j=0; j<clusterMapping[i].size(); j++)
+                for(size_t j=0; j<clusterMapping[i].size(); j++)
                 {
-                    average += glm::vec3(inputData[clusterMapping[i][j]]) * inverseSize;
+                    average += glm::vec3(colorData[clusterMapping[i][j]]) * inverseSize;
                 }
 
                 float  diff = glm::distance2(clusterPositions[i], average);
@@ -4668,7 +5177,7 @@ void KMeansCluster::Process(GLuint textureIn, GLuint textureOut, int width, int
         {
             glm::vec3 clusterColor(0);
             if(outputMode==OutputMode::ClusterColor)
-                clusterColor = clusterPositions[i];
+                clusterColor = ConvertColor(clusterPositions[i], space, ColorSpace::RGB);
             else if(outputMode==OutputMode::GrayScale)
             {
                 float value = (float)i / (float)numClusters;
@@ -4682,7 +5191,7 @@ void KMeansCluster::Process(GLuint textureIn, GLuint textureOut, int width, int
                     (float)rand() / (float)RAND_MAX
                 );
             }
-            for(int j=0; j<clusterMapping[i].size(); j++)
+            for(size_t j=0; j<clusterMapping[i].size(); j++)
             {
                 // inputData[clusterMapping[i][j]] = glm::vec4(value, value, value, 1);
                 inputData[clusterMapping[i][j]] = glm::vec4(clusterColor, 1);
@@ -4697,6 +5206,13 @@ void KMeansCluster::Process(GLuint textureIn, GLuint textureOut, int width, int
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, inputData.data());
     glBindTexture(GL_TEXTURE_2D, 0);
 }
+
+void KMeansCluster::BeginSequenceFrame(int frame)
+{
+    //Every frame is clustered, not only when asked
+    shouldProcess=true;
+    warmStart = frame > 0;
+}
 //
 //
 
@@ -4775,7 +5291,7 @@ void ErrorDiffusionHalftoning::Process(GLuint textureIn, GLuint textureOut, int
         RecalculateMask();
         shouldRecalculateMask=false;
     }
-    inputData.resize(width * height);
+    inputData.resize((size_t)width * height);
     glBindTexture(GL_TEXTURE_2D, textureIn);
     glGetTexImage (GL_TEXTURE_2D,
                     0,
@@ -4796,9 +5312,9 @@ void ErrorDiffusionHalftoning::Process(GLuint textureIn, GLuint textureOut, int
                 // int sampleX = x;
                 
                 //Get Color
-                int inx = y * width + sampleX;
+                size_t inx = (size_t)y * width + sampleX;
                 glm::vec3 color = inputData[inx];
-                if(grayScale) color = GrayScale2Color(Color2GrayScale(color), 1);
+                if(grayScale) color = GrayScale2Color(RGBToGray(color), 1);
 
                 //quantize
                 glm::vec3 newColor(0);
@@ -4817,11 +5333,11 @@ void ErrorDiffusionHalftoning::Process(GLuint textureIn, GLuint textureOut, int
                 glm::vec3 error = color -  newColor;
 
                 //do the halftoning
-                for(int i=0; i<maskIndices.size(); i++)
+                for(size_t i=0; i<maskIndices.size(); i++)
                 {
                     glm::ivec2 coord = glm::ivec2(sampleX, y) + maskIndices[i];
-                    int maskInx = coord.y * width + coord.x;
-                    if(maskInx <0 || maskInx>inputData.size()) continue;
+                    int64_t maskInx = (int64_t)coord.y * width + coord.x;
+                    if(maskInx <0 || maskInx >= (int64_t)inputData.size()) continue;
                     
                     inputData[maskInx] += glm::vec4(error * mask[i], 0);
                 }
@@ -4961,7 +5477,7 @@ int RegionProperties::GetStartIndex(glm::ivec2 b, glm::ivec2 c)
 
 void RegionProperties::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    inputData.resize(width * height);
+    inputData.resize((size_t)width * height);
     glBindTexture(GL_TEXTURE_2D, textureIn);
     glGetTexImage (GL_TEXTURE_2D,
                     0,
@@ -4971,7 +5487,8 @@ void RegionProperties::Process(GLuint textureIn, GLuint textureOut, int width, i
     glBindTexture(GL_TEXTURE_2D, 0);
     
     //Find all the different regions
-    std::vector<bool> pixelProcessed(width*height, false);
+    ScratchBuffer<uint8_t> pixelProcessed((size_t)width * height);
+    pixelProcessed.Fill(0);
     if(shouldProcess)
     {
 		regions.clear();
@@ -4980,13 +5497,13 @@ void RegionProperties::Process(GLuint textureIn, GLuint textureOut, int width, i
         {
             for(currentPixel.x=0; currentPixel.x<width; currentPixel.x++)
             {
-                int inx = currentPixel.y * width + currentPixel.x;
+                size_t inx = (size_t)currentPixel.y * width + currentPixel.x;
                 if(inputData[inx].r >0 && !pixelProcessed[inx]) //Found a white pixel, and we haven't processed it yet
                 {
-                    Region region = {};
+                    Region region = {glm::uvec2(0), ArenaVector<glm::ivec2>(&imageProcessStack->arena)};
 
                     //Find all the points inside the current region
-                    std::stack<glm::ivec2> pointsToExplore;
+                    ArenaStack<glm::ivec2> pointsToExplore = MakeArenaStack<glm::ivec2>(imageProcessStack->arena);
                     pointsToExplore.push(currentPixel);
                     while(pointsToExplore.size() !=0)
                     {
@@ -4999,17 +5516,17 @@ void RegionProperties::Process(GLuint textureIn, GLuint textureOut, int width, i
                                 glm::ivec2 coord = currentPoint + glm::ivec2(x, y);
                                 if (coord.x >= 0 && coord.x < width && coord.y >= 0 && coord.y < height)
                                 {
-                                    if(inputData[coord.y * width + coord.x].r >0 && !pixelProcessed[coord.y * width + coord.x])
+                                    if(inputData[(size_t)coord.y * width + coord.x].r >0 && !pixelProcessed[(size_t)coord.y * width + coord.x])
                                     {
                                         pointsToExplore.push(coord);
-                                        pixelProcessed[coord.y * width + coord.x]=true;
+                                        pixelProcessed[(size_t)coord.y * width + coord.x]=true;
                                         region.points.push_back(coord);
                                     }
                                 }
                             }
                         }
                     }
-                    regions.push_back(region);
+                    regions.push_back(std::move(region));
                 }
             }
         }
@@ -5026,14 +5543,14 @@ void RegionProperties::Process(GLuint textureIn, GLuint textureOut, int width, i
                 regions[j].boundingBox.maxBB = glm::max(regions[j].points[i],regions[j].boundingBox.maxBB);
             }
 
-            std::vector<point> outlinePoints;
+            ArenaVector<point> outlinePoints(&imageProcessStack->arena);
             //Find the first point
             bool shouldBreak = false;
             for(int y=regions[j].boundingBox.minBB.y; y<regions[j].boundingBox.maxBB.y; y++)
             {
                 for(int x=regions[j].boundingBox.minBB.x; x<regions[j].boundingBox.maxBB.x; x++)
                 {
-                    if(inputData[y * width + x].x != 0)
+                    if(inputData[(size_t)y * width + x].x != 0)
                     {
                         outlinePoints.push_back(
                             {
@@ -5060,7 +5577,7 @@ void RegionProperties::Process(GLuint textureIn, GLuint textureOut, int width, i
                     int dirInx = i % directions.size();
 
                     glm::ivec2 checkCoord = currentPoint->b + directions[dirInx];
-                    float checkValue = inputData[checkCoord.y * width + checkCoord.x].x;
+                    float checkValue = inputData[(size_t)checkCoord.y * width + checkCoord.x].x;
                     if(checkValue>0)
                     {
                         point newPoint = 
@@ -5191,13 +5708,20 @@ void RegionProperties::Process(GLuint textureIn, GLuint textureOut, int width, i
                     //If the 2 distances are close, we're on the skeleton
                     if(sqrt(shortestDistance2) - sqrt(shortestDistance1) <=1)
                     {
-                        inputData[current.y * width + current.x] = glm::vec4(1,0,0,1);
+                        inputData[(size_t)current.y * width + current.x] = glm::vec4(1,0,0,1);
                     }
                 }
                 
             }
         }
 
+        //The regions are kept for the gui, not their points
+        for(int j=0; j<regions.size(); j++)
+        {
+            regions[j].points.clear();
+            regions[j].points.shrink_to_fit();
+        }
+
         shouldProcess=false;
     }
 
@@ -5233,6 +5757,7 @@ bool SuperPixelsCluster::RenderGui()
     changed |= ImGui::DragFloat("C", &C, 0.001f, 0.1f, 1000);
     
     changed |= ImGui::Combo("OutputMode", (int*)&outputMode, "Random Color\0Cluster Color\0GrayScale\0\0");
+    shouldProcess |= RenderColorSpaceGui(space);
     
     changed |= shouldProcess;
     return changed;
@@ -5241,7 +5766,7 @@ bool SuperPixelsCluster::RenderGui()
 
 void SuperPixelsCluster::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    inputData.resize(width * height);
+    inputData.resize((size_t)width * height);
     glBindTexture(GL_TEXTURE_2D, textureIn);
     glGetTexImage (GL_TEXTURE_2D,
                     0,
@@ -5250,10 +5775,13 @@ void SuperPixelsCluster::Process(GLuint textureIn, GLuint textureOut, int width,
                     inputData.data());
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    clusterPositions.clear();
     if(shouldProcess)
     {
-        float totalColorDiff=1000;
+        colorData.resize(inputData.size());
+        ConvertColors(inputData.data(), colorData.data(), colorData.size(), ColorSpace::RGB, space);
+        float scale = ColorSpaceScale(space);
+
+        float totalColorDiff=1000 * scale * scale;
         float totalPositionDiff=1000;
 
         //Assign initial positions
@@ -5261,31 +5789,39 @@ void SuperPixelsCluster::Process(GLuint textureIn, GLuint textureOut, int width,
         glm::ivec2 clusterSize(width / numPerRow, height / numPerRow);
         glm::ivec2 clusterHalfSize = clusterSize / 2;
         int clusterDiagSize = (int)sqrt(clusterSize.x * clusterSize.x + clusterSize.y * clusterSize.y);
-        for(int y=0; y<numPerRow; y++)
+        //Centers of the previous frame of a sequence stay on the same grid cells, they are kept as they are
+        bool keepCenters = warmStart && clusterImageSize == glm::ivec2(width, height) && clusterPositions.size() == numPerRow * numPerRow;
+        warmStart=false;
+        clusterImageSize = glm::ivec2(width, height);
+        if(!keepCenters)
         {
-            for(int x=0; x<numPerRow; x++)
+            clusterPositions.clear();
+            for(int y=0; y<numPerRow; y++)
             {
-                glm::vec2 jitter(
-                    (float)rand() / (float)RAND_MAX - 0.5f,
-                    (float)rand() / (float)RAND_MAX - 0.5f
-                );
-                jitter *= clusterHalfSize;
-                
-                glm::vec2 clusterPosition = glm::vec2(
-                    x * clusterSize.x + clusterHalfSize.x,
-                    y * clusterSize.y + clusterHalfSize.y
-                    ) + jitter;
-                glm::vec3 clusterColor = glm::vec3(inputData[(int)clusterPosition.y * width + (int)clusterPosition.x]);
-                clusterPositions.push_back(
-                    {
-                        clusterColor,
-                        clusterPosition
-                    }
-                );
+                for(int x=0; x<numPerRow; x++)
+                {
+                    glm::vec2 jitter(
+                        (float)rand() / (float)RAND_MAX - 0.5f,
+                        (float)rand() / (float)RAND_MAX - 0.5f
+                    );
+                    jitter *= clusterHalfSize;
+                    
+                    glm::vec2 clusterPosition = glm::vec2(
+                        x * clusterSize.x + clusterHalfSize.x,
+                        y * clusterSize.y + clusterHalfSize.y
+                        ) + jitter;
+                    glm::vec3 clusterColor = glm::vec3(colorData[(int)clusterPosition.y * width + (int)clusterPosition.x]);
+                    clusterPositions.push_back(
+                        {
+                            clusterColor,
+                            clusterPosition
+                        }
+                    );
+                }
             }
         }
 
-        while(totalColorDiff > 0.1f)
+        while(totalColorDiff > 0.1f * scale * scale)
         {
 
 
@@ -5309,8 +5845,8 @@ void SuperPixelsCluster::Process(GLuint textureIn, GLuint textureOut, int width,
                     float minDistance = 1e30f;
                     int clusterInx=0;
 
-                    int inx=  y * width +x;
-                    glm::vec3 pixelColor = inputData[inx];
+                    size_t inx = (size_t)y * width + x;
+                    glm::vec3 pixelColor = colorData[inx];
                     glm::vec2 pixelPosition(x, y);
 
                     glm::ivec2 pixelClusterCoord = glm::ivec2(normalizedCoord.x * numPerRow, normalizedCoord.y * numPerRow);
@@ -5329,7 +5865,7 @@ void SuperPixelsCluster::Process(GLuint textureIn, GLuint textureOut, int width,
                                 positionDistance /= (float)clusterDiagSize;
 
                                 glm::vec3 clusterColor = clusterPositions[i].color;
-                                float colorDistance = glm::distance(clusterColor, pixelColor) / C;
+                                float colorDistance = glm::distance(clusterColor, pixelColor) / (C * scale);
                                 
                                 //Calculate spatial distance
                                 float distance = sqrt(positionDistance * positionDistance + colorDistance * colorDistance);
@@ -5354,15 +5890,16 @@ void SuperPixelsCluster::Process(GLuint textureIn, GLuint textureOut, int width,
                 ClusterData average = {
                     glm::vec3(0), glm::vec2(0)
                 };
+                if(clusterMapping[j].empty()) continue;
                 float inverseSize = 1.0f / (float)clusterMapping[j].size();
-                for(int i=0; i<clusterMapping[j].size(); i++)
+                for(size_t i=0; i<clusterMapping[j].size(); i++)
                 {
-                    int inx = clusterMapping[j][i];
+                    size_t inx = clusterMapping[j][i];
                     glm::vec2 position(
                         inx % width,
                         inx / width
                     );
-                    glm::vec3 color = inputData[inx];
+                    glm::vec3 color = colorData[inx];
 
                     average.color += color * inverseSize;
                     average.position += position * inverseSize;
@@ -5384,7 +5921,7 @@ void SuperPixelsCluster::Process(GLuint textureIn, GLuint textureOut, int width,
             glm::vec3 clusterColor(0);
             if(outputMode == OutputMode::ClusterColor)
             {
-                clusterColor = clusterPos.color;
+                clusterColor = ConvertColor(clusterPos.color, space, ColorSpace::RGB);
             }
             else if(outputMode == OutputMode::RandomColor)
             {
@@ -5399,7 +5936,7 @@ void SuperPixelsCluster::Process(GLuint textureIn, GLuint textureOut, int width,
                 float grayScale = (float)j / (float)numClusters;
                 clusterColor = glm::vec3(grayScale);
             }
-            for(int i=0; i<clusterMapping[j].size(); i++)
+            for(size_t i=0; i<clusterMapping[j].size(); i++)
             {
                 inputData[clusterMapping[j][i]] = glm::vec4(clusterColor,1);
             }
@@ -5414,6 +5951,12 @@ void SuperPixelsCluster::Process(GLuint textureIn, GLuint textureOut, int width,
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, inputData.data());
     glBindTexture(GL_TEXTURE_2D, 0);
 }
+
+void SuperPixelsCluster::BeginSequenceFrame(int frame)
+{
+    shouldProcess=true;
+    warmStart = frame > 0;
+}
 //
 //
 
@@ -5422,7 +5965,6 @@ void SuperPixelsCluster::Process(GLuint textureIn, GLuint textureOut, int width,
 HoughTransform::HoughTransform(bool enabled) : ImageProcess("HoughTransform", "", enabled)
 {
     cannyEdgeDetector = new CannyEdgeDetector(true);
-    cannyEdgeDetector->size=3;
     cannyEdgeDetector->sigma=1;
     cannyEdgeDetector->threshold=0.038f;
 }
@@ -5491,18 +6033,10 @@ void HoughTransform::Process(GLuint textureIn, GLuint textureOut, int width, int
         houghSpace.resize(houghSpaceSize * houghSpaceSize);
         std::fill(houghSpace.begin(), houghSpace.end(), glm::vec4(0,0,0,1));
 
-        //Read back edges
-        edgeData.resize(width * height, glm::vec4(0));
-        glBindTexture(GL_TEXTURE_2D, textureOut);
-        glGetTexImage (GL_TEXTURE_2D,
-                        0,
-                        GL_RGBA, // GL will convert to this format
-                        GL_FLOAT,   // Using this data type per-pixel
-                        edgeData.data());
-        glBindTexture(GL_TEXTURE_2D, 0);
+        const CannyEdges &edges = cannyEdgeDetector->edges;
 
         //Read back color data
-        inputData.resize(width * height, glm::vec4(0));
+        inputData.resize((size_t)width * height, glm::vec4(0));
         glBindTexture(GL_TEXTURE_2D, textureIn);
         glGetTexImage (GL_TEXTURE_2D,
                         0,
@@ -5512,7 +6046,7 @@ void HoughTransform::Process(GLuint textureIn, GLuint textureOut, int width, int
         glBindTexture(GL_TEXTURE_2D, 0);
 
         //Initialize output
-        linesData.resize(width * height);
+        linesData.resize((size_t)width * height);
         std::fill(linesData.begin(), linesData.end(), glm::vec4(0));
 
         //Build the hough space map
@@ -5523,18 +6057,18 @@ void HoughTransform::Process(GLuint textureIn, GLuint textureOut, int width, int
         {
             for(pixelCoord.x=0; pixelCoord.x<width; pixelCoord.x++)
             {
-                int inx = pixelCoord.y * width + pixelCoord.x;
-                float pixelEdge = edgeData[inx].x;
+                size_t inx = (size_t)pixelCoord.y * width + pixelCoord.x;
+                bool pixelEdge = (edges.flags[inx] & CANNY_EDGE) != 0;
                 glm::vec4 pixelColor = inputData[inx];
                 
                 if(addToImage) 
                 {
-                    if(viewEdges) linesData[inx] = edgeData[inx];
+                    if(viewEdges) linesData[inx] = pixelEdge ? glm::vec4(1) : glm::vec4(0, 0, 0, 1);
                     else linesData[inx] = pixelColor;
                 }
 
                 //If we're on an edge
-                if(pixelEdge>0)
+                if(pixelEdge)
                 {
                     for(int t=0; t<houghSpaceSize; t++) //For all angles
                     {
@@ -5621,7 +6155,7 @@ void HoughTransform::Process(GLuint textureIn, GLuint textureOut, int width, int
         }
         
         //Find all the lines in each peak bin
-        for(int i=0; i<peaksMap.size(); i++)
+        for(size_t i=0; i<peaksMap.size(); i++)
         {
             if(peaksMap[i].numVotes>0)
             {
@@ -5630,7 +6164,7 @@ void HoughTransform::Process(GLuint textureIn, GLuint textureOut, int width, int
         }
         
         //Normalize the hough texture for visualization
-        for(int i=0; i<houghSpace.size(); i++)
+        for(size_t i=0; i<houghSpace.size(); i++)
         {
             houghSpace[i].x /= maxVotes;
         }
@@ -5683,7 +6217,7 @@ int PolygonFitting::GetStartIndex(glm::ivec2 b, glm::ivec2 c)
 void PolygonFitting::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
     //Read back color data
-    inputData.resize(width * height, glm::vec4(0));
+    inputData.resize((size_t)width * height, glm::vec4(0));
     glBindTexture(GL_TEXTURE_2D, textureIn);
     glGetTexImage (GL_TEXTURE_2D,
                     0,
@@ -5709,7 +6243,7 @@ void PolygonFitting::Process(GLuint textureIn, GLuint textureOut, int width, int
         glm::ivec2 b;
         glm::ivec2 c;
     };
-    std::vector<point> points;
+    ArenaVector<point> points(&imageProcessStack->arena);
 
     //Find the first point
 	bool shouldBreak = false;
@@ -5717,7 +6251,7 @@ void PolygonFitting::Process(GLuint textureIn, GLuint textureOut, int width, int
     {
         for(int x=0; x<width; x++)
         {
-            if(inputData[y * width + x].x != 0)
+            if(inputData[(size_t)y * width + x].x != 0)
             {
                 points.push_back(
                     {
@@ -5744,7 +6278,7 @@ void PolygonFitting::Process(GLuint textureIn, GLuint textureOut, int width, int
 			int dirInx = i % directions.size();
 
             glm::ivec2 checkCoord = currentPoint->b + directions[dirInx];
-            float checkValue = inputData[checkCoord.y * width + checkCoord.x].x;
+            float checkValue = inputData[(size_t)checkCoord.y * width + checkCoord.x].x;
             if(checkValue>0)
             {
                 point newPoint = 
@@ -5788,8 +6322,8 @@ void PolygonFitting::Process(GLuint textureIn, GLuint textureOut, int width, int
     int A = leftMostInx;
     int B = rightMostInx;
     
-    std::stack<int> finalPoints;
-    std::stack<int> processPoints;
+    ArenaStack<int> finalPoints = MakeArenaStack<int>(imageProcessStack->arena);
+    ArenaStack<int> processPoints = MakeArenaStack<int>(imageProcessStack->arena);
 
     finalPoints.push(B);
     processPoints.push(B);
@@ -5901,6 +6435,8 @@ void OtsuThreshold::SetUniforms()
 bool OtsuThreshold::RenderGui()
 {
     bool changed=false;
+    changed |= RenderHistogramBinsGui(numBins);
+    ImGui::Text("Threshold : %f", threshold);
     return changed;
 }
 
@@ -5908,7 +6444,7 @@ bool OtsuThreshold::RenderGui()
 void OtsuThreshold::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
     //Read back color data
-    inputData.resize(width * height, glm::vec4(0));
+    inputData.resize((size_t)width * height, glm::vec4(0));
     glBindTexture(GL_TEXTURE_2D, textureIn);
     glGetTexImage (GL_TEXTURE_2D,
                     0,
@@ -5917,79 +6453,10 @@ void OtsuThreshold::Process(GLuint textureIn, GLuint textureOut, int width, int
                     inputData.data());
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    std::vector<float> probabilities(255, 0);
-    float globalMean=0;
-    float inverseSize = 1.0f / (float)inputData.size();
-    for(int i=0; i<inputData.size(); i++)
-    {
-        float grayScale = (inputData[i].r + inputData[i].g +inputData[i].b) * 0.33333f;
-        int grayScaleInt = (int)(grayScale * 255.0f);
-        
-        probabilities[grayScaleInt]+= inverseSize;
-        globalMean += inverseSize * grayScale;
-    }
-    
-    float globalVariance=0;
-    for(int i=0; i<inputData.size(); i++)
-    {
-		float grayScale = (inputData[i].r + inputData[i].g + inputData[i].b) * 0.33333f;
-		int grayScaleInt = (int)(grayScale * 255.0f);
-
-        globalVariance += (i - globalMean) * (i - globalMean) * probabilities[grayScaleInt];
-    }
-
-//Test
-#if 1
-    float sum=0;
-    for(int i=0; i<probabilities.size(); i++)
-    {
-        sum += probabilities[i];
-    }
-
-#endif
-
-
-    float maxThreshold=-1;
-    float maxVariance=-1;
-    for(int j=0; j<255; j++)
-    {
-		float p1=0;
-		float p2=0;
-		float m1Mean=0;
-		float m2Mean=0;
-        float currentThreshold = (float)j / (float)255;
-
-		for(int i=0; i<255; i++)
-        {
-            if(i<j)
-            {
-                p1 += probabilities[i];
-                m1Mean += i * probabilities[i];
-            }
-            else
-            {
-                m2Mean += i * probabilities[i];
-            }
-        }
-		m1Mean /= 255.0f;
-		m2Mean /= 255.0f;
-
-        p2 = 1.0f - p1;
-		if (p1 > 0 && p2 > 0)
-		{
-            m1Mean /= (float)p1;
-            m2Mean /= (float)p2;
-
-			float variance = p1 * (m1Mean - globalMean) * (m1Mean - globalMean) + p2 * (m2Mean - globalMean) * (m2Mean - globalMean);
-			variance /= globalVariance;
-			if(variance > maxVariance)
-			{
-				maxVariance = variance;
-				maxThreshold=currentThreshold;
-			}
-		}
-    }
-    threshold=maxThreshold;
+    Histogram histogram;
+    histogram.Compute(inputData.data(), width, height, numBins);
+    threshold = histogram.OtsuThreshold(HISTOGRAM_GRAY, warmStart ? threshold : -1, stability);
+    warmStart=false;
 
 	glUseProgram(shader);
 	SetUniforms();
@@ -6084,8 +6551,8 @@ uint32_t nextPowerOf2(uint32_t input)
 
 void FFTBlur::Process(GLuint textureIn, GLuint textureOut, int width, int height)
 {
-    //Read back from texture
-    std::vector<glm::vec4> textureData(width * height);
+    //Read back from texture, into a buffer that the next evaluation will reuse
+    ScratchBuffer<glm::vec4> textureData((size_t)width * height);
     glBindTexture(GL_TEXTURE_2D, textureIn);
     glGetTexImage (GL_TEXTURE_2D,
                     0,
@@ -6102,17 +6569,17 @@ void FFTBlur::Process(GLuint textureIn, GLuint textureOut, int width, int height
     if(textureDataComplexInRed.size() != correctedWidth * correctedHeight)
     {
         
-        textureDataComplexInRed.resize(correctedWidth * correctedHeight, std::complex<double>(0,0));
-        textureDataComplexInGreen.resize(correctedWidth * correctedHeight, std::complex<double>(0,0));
-        textureDataComplexInBlue.resize(correctedWidth * correctedHeight, std::complex<double>(0,0));
+        textureDataComplexInRed.resize((size_t)correctedWidth * correctedHeight, std::complex<double>(0,0));
+        textureDataComplexInGreen.resize((size_t)correctedWidth * correctedHeight, std::complex<double>(0,0));
+        textureDataComplexInBlue.resize((size_t)correctedWidth * correctedHeight, std::complex<double>(0,0));
 
-        textureDataComplexOutCorrectedRed.resize(correctedWidth * correctedHeight, std::complex<double>(0,0));
-        textureDataComplexOutCorrectedGreen.resize(correctedWidth * correctedHeight, std::complex<double>(0,0));
-        textureDataComplexOutCorrectedBlue.resize(correctedWidth * correctedHeight, std::complex<double>(0,0));
+        textureDataComplexOutCorrectedRed.resize((size_t)correctedWidth * correctedHeight, std::complex<double>(0,0));
+        textureDataComplexOutCorrectedGreen.resize((size_t)correctedWidth * correctedHeight, std::complex<double>(0,0));
+        textureDataComplexOutCorrectedBlue.resize((size_t)correctedWidth * correctedHeight, std::complex<double>(0,0));
         
-        textureDataComplexOutRed.resize(correctedWidth * correctedHeight, std::complex<double>(0,0));
-        textureDataComplexOutGreen.resize(correctedWidth * correctedHeight, std::complex<double>(0,0));
-        textureDataComplexOutBlue.resize(correctedWidth * correctedHeight, std::complex<double>(0,0));
+        textureDataComplexOutRed.resize((size_t)correctedWidth * correctedHeight, std::complex<double>(0,0));
+        textureDataComplexOutGreen.resize((size_t)correctedWidth * correctedHeight, std::complex<double>(0,0));
+        textureDataComplexOutBlue.resize((size_t)correctedWidth * correctedHeight, std::complex<double>(0,0));
     }
 
     //Fill spatial domain data
@@ -6120,11 +6587,11 @@ void FFTBlur::Process(GLuint textureIn, GLuint textureOut, int width, int height
     {
         for(int x=0; x<correctedWidth; x++)
         {
-            int outInx = y * correctedWidth + x;
+            size_t outInx = (size_t)y * correctedWidth + x;
             
             if(x < width && y < height)
             {
-                int inInx = y * width + x;    
+                size_t inInx = (size_t)y * width + x;    
                 textureDataComplexInRed[outInx] = std::complex<double>((double)textureData[inInx].r, 0);
                 textureDataComplexInGreen[outInx] = std::complex<double>((double)textureData[inInx].g, 0);
                 textureDataComplexInBlue[outInx] = std::complex<double>((double)textureData[inInx].b, 0);
@@ -6151,11 +6618,11 @@ void FFTBlur::Process(GLuint textureIn, GLuint textureOut, int width, int height
     {
         for(int x=0; x<correctedWidth; x++)
         {
-            int flatInx = y * correctedWidth + x;
+            size_t flatInx = (size_t)y * correctedWidth + x;
             
             uint32_t correctedX=x, correctedY=y;
             CorrectCoordinates(correctedWidth, correctedHeight, x, y, &correctedX, &correctedY);
-            int correctedInx = correctedY * correctedWidth + correctedX;
+            size_t correctedInx = (size_t)correctedY * correctedWidth + correctedX;
             
             
             textureDataComplexOutCorrectedRed[flatInx] = textureDataComplexOutRed[correctedInx];
@@ -6176,7 +6643,7 @@ void FFTBlur::Process(GLuint textureIn, GLuint textureOut, int width, int height
             {
                 if(x < midPointX -radius || x > midPointX + radius || y < midPointY - radius || y > midPointY + radius)
                 {
-                    int inx = y * correctedWidth + x;
+                    size_t inx = (size_t)y * correctedWidth + x;
                     textureDataComplexOutCorrectedRed[inx]= std::complex<double>(0,0);
                     textureDataComplexOutCorrectedGreen[inx]= std::complex<double>(0,0);
                     textureDataComplexOutCorrectedBlue[inx]= std::complex<double>(0,0);
@@ -6196,7 +6663,7 @@ void FFTBlur::Process(GLuint textureIn, GLuint textureOut, int width, int height
                 glm::ivec2 coord = glm::ivec2(x,y) - glm::ivec2(correctedWidth/2, correctedHeight/2);
                 if(sqrt(coord.x * coord.x + coord.y * coord.y) > radius)
                 {
-                    int inx = y * correctedWidth + x;
+                    size_t inx = (size_t)y * correctedWidth + x;
                     textureDataComplexOutCorrectedRed[inx]= std::complex<double>(0,0);
                     textureDataComplexOutCorrectedGreen[inx]= std::complex<double>(0,0);
                     textureDataComplexOutCorrectedBlue[inx]= std::complex<double>(0,0);
@@ -6219,7 +6686,7 @@ void FFTBlur::Process(GLuint textureIn, GLuint textureOut, int width, int height
                 // if(currendRad > radius)
                 // {
                     // float cutoff = std::min((float)currendRad / (float)radius, 1.0f);
-                    int inx = y * correctedWidth + x;
+                    size_t inx = (size_t)y * correctedWidth + x;
                     textureDataComplexOutCorrectedRed[inx] *= (double)mag;
                     textureDataComplexOutCorrectedGreen[inx] *= (double)mag;
                     textureDataComplexOutCorrectedBlue[inx] *= (double)mag;
@@ -6233,11 +6700,11 @@ void FFTBlur::Process(GLuint textureIn, GLuint textureOut, int width, int height
     {
         for(int x=0; x<correctedWidth; x++)
         {
-            int flatInx = y * correctedWidth + x;
+            size_t flatInx = (size_t)y * correctedWidth + x;
 
             uint32_t correctedX=x, correctedY=y;
             CorrectCoordinates(correctedWidth, correctedHeight, x, y, &correctedX, &correctedY);
-            int correctedInx = correctedY * correctedWidth + correctedX;
+            size_t correctedInx = (size_t)correctedY * correctedWidth + correctedX;
             textureDataComplexOutRed[correctedInx] = textureDataComplexOutCorrectedRed[flatInx];
             textureDataComplexOutGreen[correctedInx] = textureDataComplexOutCorrectedGreen[flatInx];
             textureDataComplexOutBlue[correctedInx] = textureDataComplexOutCorrectedBlue[flatInx];
@@ -6257,12 +6724,12 @@ void FFTBlur::Process(GLuint textureIn, GLuint textureOut, int width, int height
     {
     for(int x=0; x<width; x++)
     {
-        int i = y * (correctedWidth) + x;
+        size_t i = (size_t)y * (correctedWidth) + x;
         float red = (float)textureDataComplexInRed[i].real() / (float)(correctedWidth * correctedHeight);
         float green = (float)textureDataComplexInGreen[i].real() / (float)(correctedWidth * correctedHeight);
         float blue = (float)textureDataComplexInBlue[i].real() / (float)(correctedWidth * correctedHeight);
     
-        int outInx = (y * width + x);
+        size_t outInx = (size_t)y * width + x;
 
 #if 0
         float mag = log2((float)abs(textureDataComplexOutCorrectedRed[i]) / (float)correctedWidth + 1);
@@ -6305,17 +6772,109 @@ ImageLab::ImageLab() {
 
 void ImageLab::SaveImage(std::string FilePath)
 {
-    struct rgba {uint8_t r, g, b, a;};
-    std::vector<rgba> ImageByte(imageProcessStack.outputImage.size());
-    for(int i=0; i<imageProcessStack.outputImage.size(); i++)
+    //Exports are always at full resolution, with all the tiles
+    if(imageProcessStack.proxyLevel > 0 || imageProcessStack.regionEvaluated) outTexture = imageProcessStack.Process(false);
+
+    //The exporter shares the pixels, the stack gets new ones if it is reprocessed while they are written
+    ExportFormat format = ExportFormatFromPath(FilePath);
+    imageExporter.Export(WithExportExtension(FilePath, format), imageProcessStack.outputImage, format, pngCompressionLevel);
+}
+
+void ImageLab::StepSequence()
+{
+    //Frames replace the first enabled image input
+    int inputIndex=-1;
+    AddImage *input=nullptr;
+    for(int i=0; i<imageProcessStack.imageProcesses.size() && input==nullptr; i++)
+    {
+        if(!imageProcessStack.imageProcesses[i]->enabled) continue;
+        input = dynamic_cast<AddImage*>(imageProcessStack.imageProcesses[i]);
+        inputIndex = i;
+    }
+    if(input == nullptr) sequence.Stop();
+
+    //As many frames as fit in a few milliseconds, the loader and the exporter keep working in between
+    auto start = std::chrono::high_resolution_clock::now();
+    while(sequence.Running() && std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() < 30)
+    {
+        int frameIndex=0;
+        std::shared_ptr<const DecodedImage> frame = sequence.NextFrame(frameIndex);
+        if(!frame) break;
+
+        if(frame->width != imageProcessStack.width || frame->height != imageProcessStack.height) imageProcessStack.Resize(frame->width, frame->height);
+        if(input->texture.loaded && input->texture.width == frame->width && input->texture.height == frame->height)
+        {
+            glBindTexture(GL_TEXTURE_2D, input->texture.glTex);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame->width, frame->height, GL_RGBA, GL_FLOAT, frame->pixels.data());
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+        else
+        {
+            TextureCreateInfo tci = {};
+            tci.generateMipmaps =false;
+            tci.minFilter = GL_LINEAR;
+            tci.magFilter = GL_LINEAR;
+            if(input->texture.loaded) input->texture.Unload();
+            input->texture = GL_TextureFloat(frame->width, frame->height, frame->pixels.data(), tci);
+        }
+        input->aspectRatio = (float)frame->width / (float)frame->height;
+        input->mipmapsBuilt=false;
+
+        for(int i=0; i<imageProcessStack.imageProcesses.size(); i++) imageProcessStack.imageProcesses[i]->BeginSequenceFrame(frameIndex);
+        imageProcessStack.MarkChanged(inputIndex);
+        outTexture = imageProcessStack.Process(false);
+        //The exporter shares the output, the next frame is written to other pixels
+        sequence.Submit(imageProcessStack.outputImage);
+    }
+
+    if(!sequence.Running()) imageProcessStack.cacheStages = sequenceCacheStages;
+}
+
+void ImageLab::RenderSequenceGui()
+{
+    if(!ImGui::CollapsingHeader("Sequence")) return;
+
+    if(ImGui::Button("Input folder"))
+    {
+        nfdchar_t *path = 0;
+        if(NFD_PickFolder(NULL, &path) == NFD_OKAY) sequenceInputDirectory = std::string(path);
+    }
+    ImGui::SameLine();
+    ImGui::Text("%s", sequenceInputDirectory.c_str());
+    if(ImGui::Button("Output folder"))
+    {
+        nfdchar_t *path = 0;
+        if(NFD_PickFolder(NULL, &path) == NFD_OKAY) sequenceOutputDirectory = std::string(path);
+    }
+    ImGui::SameLine();
+    ImGui::Text("%s", sequenceOutputDirectory.c_str());
+
+    ImGui::Combo("Format", (int*)&sequenceFormat, "PNG\0QOI\0PPM\0PAM\0PFM\0\0");
+    ImGui::SliderInt("Frames decoded ahead", &sequence.decodeAhead, 1, 16);
+    ImGui::SliderInt("Frames waiting for export", &sequence.maxPendingExports, 1, 8);
+
+    if(!sequence.Running())
+    {
+        if(ImGui::Button("Run sequence") && !sequenceInputDirectory.empty() && !sequenceOutputDirectory.empty())
+        {
+            if(sequence.Start(SequencePipeline::ListFrames(sequenceInputDirectory), sequenceOutputDirectory, sequenceFormat, pngCompressionLevel))
+            {
+                sequenceCacheStages = imageProcessStack.cacheStages;
+                imageProcessStack.cacheStages = false;
+            }
+        }
+    }
+    else if(ImGui::Button("Stop sequence"))
     {
-        ImageByte[i].r = (uint8_t) glm::clamp((int32_t)(imageProcessStack.outputImage[i].r * 255.0f), 0, 255);
-        ImageByte[i].g = (uint8_t) glm::clamp((int32_t)(imageProcessStack.outputImage[i].g * 255.0f), 0, 255);
-        ImageByte[i].b = (uint8_t) glm::clamp((int32_t)(imageProcessStack.outputImage[i].b * 255.0f), 0, 255);
-        ImageByte[i].a = (uint8_t) glm::clamp((int32_t)(imageProcessStack.outputImage[i].a * 255.0f), 0, 255);
+        sequence.Stop();
+        imageProcessStack.cacheStages = sequenceCacheStages;
     }
 
-    int Res = stbi_write_png(FilePath.c_str(), imageProcessStack.width, imageProcessStack.height, 4, ImageByte.data(), imageProcessStack.width * 4);
+    if(sequence.NumFrames() > 0)
+    {
+        ImGui::Text("Frame %d / %d, %.1f fps", sequence.FramesDone(), sequence.NumFrames(), sequence.FramesPerSecond());
+        if(sequence.FramesFailed() > 0) ImGui::Text("%d frames could not be read", sequence.FramesFailed());
+    }
 }
 
 void ImageLab::Load() {
@@ -6384,23 +6943,52 @@ void ImageLab::RenderGUI() {
     if(ImGui::Button("Save Image"))
     {
         nfdchar_t *SavePath = 0;
-        nfdresult_t Result = NFD_SaveDialog(NULL, NULL, &SavePath);
+        nfdresult_t Result = NFD_SaveDialog("png;qoi;ppm;pam;pfm", NULL, &SavePath);
 
         if(Result == NFD_OKAY)
         {
             SaveImage(SavePath);
         }        
     }
+    ImGui::SliderInt("PNG Level", &pngCompressionLevel, 0, 9);
+    ExportResult exportResult;
+    if(imageExporter.Pending() > 0) ImGui::Text("Exporting...");
+    else if(imageExporter.LastResult(exportResult))
+    {
+        if(exportResult.succeeded) ImGui::Text("Exported %s in %.0f ms", exportResult.fileName.c_str(), exportResult.milliseconds);
+        else ImGui::Text("Could not write %s", exportResult.fileName.c_str());
+    }
+    
+    DecodedImageCache &imageCache = imageProcessStack.imageLoader.cache;
+    ImGui::Text("Image cache : %d files, %.1f MB", imageCache.Count(), (float)imageCache.Size() / (1024.0f * 1024.0f));
+
+    RenderSequenceGui();
     
     shouldProcess |= imageProcessStack.RenderGUI();
     ImGui::End();    
 
-    if(shouldProcess || firstFrame)
+    if(sequence.Running())
+    {
+        //Edits apply from the next frame
+        StepSequence();
+    }
+    else if(shouldProcess || firstFrame)
     {
         std::cout << "PROCESSING "<< std::endl;
-        outTexture = imageProcessStack.Process();
+        outTexture = imageProcessStack.Process(!firstFrame);
+        lastEditTime = ImGui::GetTime();
         shouldProcess=false;
     }
+    else if(imageProcessStack.TilesMissing())
+    {
+        //Panning or zooming showed tiles that were not computed
+        outTexture = imageProcessStack.Process(true);
+    }
+    else if(imageProcessStack.proxyLevel > 0 && ImGui::GetTime() - lastEditTime > imageProcessStack.idleDelay)
+    {
+        //Edits stopped, the proxy is replaced by the full resolution render
+        outTexture = imageProcessStack.Process(false);
+    }
     
    
     ////////////////////////////////////////////////////////////////////////////////////
@@ -6430,15 +7018,29 @@ void ImageLab::RenderGUI() {
     }
 
 
+    //Part of the image in the window, the next evaluations compute the tiles under it
+    glm::vec2 viewSize(ImGui::GetWindowContentRegionMax().x - ImGui::GetWindowContentRegionMin().x, ImGui::GetWindowContentRegionMax().y - ImGui::GetWindowContentRegionMin().y);
+    glm::vec2 viewStart = glm::vec2(ImGui::GetScrollX(), ImGui::GetScrollY()) / imageProcessStack.zoomLevel;
+    glm::vec2 viewEnd = viewStart + viewSize / imageProcessStack.zoomLevel;
+    imageProcessStack.view.x0 = (int)std::floor(viewStart.x);
+    imageProcessStack.view.y0 = (int)std::floor(viewStart.y);
+    imageProcessStack.view.x1 = (int)std::ceil(viewEnd.x);
+    imageProcessStack.view.y1 = (int)std::ceil(viewEnd.y);
+
     ImVec2 texSize((float)imageProcessStack.width * imageProcessStack.zoomLevel, (float)imageProcessStack.height * imageProcessStack.zoomLevel);
     ImGui::Image((ImTextureID)outTexture, texSize);
     for(int i=0; i<imageProcessStack.imageProcesses.size(); i++)
     {
         imageProcessStack.imageProcesses[i]->RenderOutputGui();
 
-        shouldProcess |= imageProcessStack.imageProcesses[i]->MouseMove(outputWindowMousePos.x, outputWindowMousePos.y);
-        if(io.MouseClicked[0])  shouldProcess |= imageProcessStack.imageProcesses[i]->MousePressed();
-        if(io.MouseReleased[0]) shouldProcess |= imageProcessStack.imageProcesses[i]->MouseReleased();
+        bool processChanged = imageProcessStack.imageProcesses[i]->MouseMove(outputWindowMousePos.x, outputWindowMousePos.y);
+        if(io.MouseClicked[0])  processChanged |= imageProcessStack.imageProcesses[i]->MousePressed();
+        if(io.MouseReleased[0]) processChanged |= imageProcessStack.imageProcesses[i]->MouseReleased();
+        if(processChanged)
+        {
+            imageProcessStack.MarkChanged(i);
+            shouldProcess=true;
+        }
     }
 
     ImGui::End();
@@ -6449,8 +7051,14 @@ void ImageLab::RenderGUI() {
     ImGui::Begin("Pixel infos");
     glm::vec4 color(0);
 
-    int inx = (int)(outputWindowMousePos.y * imageProcessStack.width + outputWindowMousePos.x);
-    if(inx>=0 && inx < imageProcessStack.outputImage.size())color  = imageProcessStack.outputImage[inx];    
+    //The output may be a proxy of the image
+    if(outputWindowMousePos.x >= 0)
+    {
+        int pixelX = (std::min)((int)outputWindowMousePos.x >> imageProcessStack.proxyLevel, imageProcessStack.outputWidth-1);
+        int pixelY = (std::min)((int)outputWindowMousePos.y >> imageProcessStack.proxyLevel, imageProcessStack.outputHeight-1);
+        int64_t inx = (int64_t)pixelY * imageProcessStack.outputWidth + pixelX;
+        if(inx>=0 && inx < (int64_t)imageProcessStack.outputImage.NumPixels())color  = imageProcessStack.outputImage[inx];    
+    }
 
     ImGui::Text("Mouse Position : %f, %f", outputWindowMousePos.x, outputWindowMousePos.y);
     ImGui::SameLine();
@@ -6,6 +6,27 @@
 #include "GL_Helpers/GL_Mesh.hpp"
 #include "GL_Helpers/GL_Camera.hpp"
 #include "GL_Helpers/GL_Texture.hpp"
+#include "Convolution.hpp"
+#include "RecursiveGaussian.hpp"
+#include "Morphology.hpp"
+#include "Median.hpp"
+#include "SummedAreaTable.hpp"
+#include "Histogram.hpp"
+#include "Canny.hpp"
+#include "DistanceTransform.hpp"
+#include "Resample.hpp"
+#include "Pyramid.hpp"
+#include "Dither.hpp"
+#include "Color.hpp"
+#include "Bilateral.hpp"
+#include "EdgeAware.hpp"
+#include "ImageLoader.hpp"
+#include "ImageExport.hpp"
+#include "StageCache.hpp"
+#include "ImageBuffer.hpp"
+#include "FrameArena.hpp"
+#include "Sequence.hpp"
+#include <algorithm>
 #include <complex>
 
 struct ImDrawList;
@@ -49,6 +70,25 @@ struct Curve
 };
 
 
+//Half open rectangle of pixels [x0, x1) * [y0, y1) of the image
+struct ImageRegion
+{
+    int x0=0, y0=0, x1=0, y1=0;
+    bool Empty() const { return x0 >= x1 || y0 >= y1; }
+    int Width() const { return x1 - x0; }
+    int Height() const { return y1 - y0; }
+    //Grown by margin on each side, kept inside a width * height image
+    ImageRegion Expanded(int margin, int width, int height) const
+    {
+        ImageRegion region;
+        region.x0 = (std::max)(x0 - margin, 0);
+        region.y0 = (std::max)(y0 - margin, 0);
+        region.x1 = (std::min)(x1 + margin, width);
+        region.y1 = (std::min)(y1 + margin, height);
+        return region;
+    }
+};
+
 struct ImageProcess
 {
     ImageProcess(std::string name, std::string shaderFileName, bool enabled);
@@ -60,14 +100,37 @@ struct ImageProcess
         glDeleteProgram(shader);
     }
 
+    //Called every frame, returns true when the process should run again
+    virtual bool Update() {return false;}
     virtual bool MouseMove(float x, float y) {return false;}
     virtual bool MousePressed() {return false;}
     virtual bool MouseReleased() {return false;}
+    //Processes that work in full resolution pixel coordinates (painted masks, seams...) keep the stack at full resolution,
+    //as do the ones that only compute when their Process button is pressed, since the next run would drop their result
+    virtual bool SupportsProxy() {return true;}
     std::string shaderFileName;
     std::string name;
-    GLint shader;
+    GLint shader=0;
+
+    ImageProcessStack *imageProcessStack=nullptr;
 
-    ImageProcessStack *imageProcessStack;
+    //The image is reduced 2^proxyLevel times while it is being edited, parameters in pixels are scaled to it
+    int proxyLevel=0;
+    float ResolutionScale() const { return 1.0f / (float)(1 << proxyLevel); }
+    int Scaled(int size) const { return (size > 0) ? (std::max)(1, (size + (1 << proxyLevel)/2) >> proxyLevel) : size; }
+    float Scaled(float size, float minimum=0) const { return (std::max)(size * ResolutionScale(), minimum); }
+    //Milliseconds per pixel of the last run, to estimate the cost of the next one
+    float costPerPixel=0;
+
+    //Pixels of the input on each side of an output pixel that its value depends on, -1 when it depends on the whole image
+    //or on the position of the pixel. The stack only evaluates regions when all its processes have a footprint
+    virtual int Footprint() {return -1;}
+    //Position in the image of the first pixel of the textures, while the stack evaluates a region
+    glm::ivec2 regionOrigin=glm::ivec2(0);
+
+    //Called before each frame of a sequence runs, frame 0 first. Processes that are coherent over time
+    //start from what they found on the previous frame instead of from scratch
+    virtual void BeginSequenceFrame(int frame) {}
 
     bool enabled=true;
     bool CheckChanges();
@@ -81,22 +144,104 @@ struct ImageProcessStack
     ImageProcessStack();
     void Resize(int width, int height);
     std::vector<ImageProcess*> imageProcesses;
-    GLuint Process();
+    //Interactive evaluations run on the proxy level that fits the latency budget, or on the visible tiles when zoomed in
+    GLuint Process(bool interactive=false);
+    //Runs the stages from firstStage, the input of the first one is in texture0 or texture1 by its parity. Returns the texture of the output
+    GLuint RunStages(const std::vector<ImageProcess*> &activeProcesses, int firstStage, GLuint texture0, GLuint texture1, int textureWidth, int textureHeight, bool storeStages);
+    void ClearTexture(GLuint texture, int textureWidth, int textureHeight);
+    void UpdateHistogram(const ConstImageView &image);
     void AddProcess(ImageProcess* imageProcess);
+    //The process at processIndex and the ones after it run again on the next evaluation, the ones before are read from the stage cache
+    void MarkChanged(int processIndex);
     void RenderHistogram();
     void Unload();
 
     bool RenderGUI();
 
+    //Integral images of a texture, built on the first request and kept until the next stage runs
+    const SummedAreaTable &GetSummedAreaTable(GLuint texture, int width, int height);
+    SummedAreaTable summedAreaTable;
+    GLuint summedAreaTableTexture=0;
+    bool summedAreaTableValid=false;
+    std::vector<glm::vec4> summedAreaTableData;
+
+    //Decodes the files of the image inputs in the background
+    ImageLoader imageLoader;
+
+    //Outputs of the enabled processes of the last evaluation, by position among them
+    StageCache stageCache;
+    bool cacheStages=true;
+    //In MB, past it the least recently used outputs are spilled to disk
+    int stageCacheBudget=512;
+    int firstChangedProcess=0;
+
+    //Proxy used while editing : the smallest reduction by a power of two that is expected to run within latencyBudget ms,
+    //from the cost per pixel of the processes. The full resolution render runs after idleDelay seconds without edits, and before exports
+    int ChooseProxyLevel(const std::vector<ImageProcess*> &activeProcesses, int firstStage);
+    bool proxyMode=true;
+    float latencyBudget=50;
+    float idleDelay=0.5f;
+    int maxProxyLevel=4;
+    //Of the last evaluation
+    int proxyLevel=0;
+    int outputWidth=0;
+    int outputHeight=0;
+    GL_TextureFloat proxyTex0;
+    GL_TextureFloat proxyTex1;
+
+    //Region evaluation : while the view shows a part of the image, edits only compute the tiles of the output that are visible,
+    //from the input region the footprints of the processes need around them. Tiles are kept until a process changes,
+    //so panning only computes the ones it exposes. Off screen tiles are computed by the full resolution render before exports
+    GLuint ProcessRegion(const std::vector<ImageProcess*> &activeProcesses, int firstStage, const ImageRegion &region, int footprint);
+    //Visible tiles that were not computed since the last change
+    bool TilesMissing();
+    //Bounds of the visible tiles that are not valid, empty when there are none
+    ImageRegion MissingTiles();
+    //Fits the tiles and regionTexture to the size of the image
+    void ResizeTiles();
+    bool regionMode=true;
+    int tileSize=128;
+    //Visible part of the image, set by the output window
+    ImageRegion view;
+    //The last evaluation was on a region, the output only holds the valid tiles
+    bool regionEvaluated=false;
+    int tilesX=0, tilesY=0;
+    std::vector<uint8_t> validTiles;
+    //Tiles are copied there as they are computed
+    GL_TextureFloat regionTexture;
+    GL_TextureFloat regionTex0;
+    GL_TextureFloat regionTex1;
+    std::vector<glm::vec4> regionData;
+    //Computed by the last evaluation, with the margin of the footprints
+    ImageRegion lastRegion;
+    ImageRegion lastRegionInput;
+
+    //Time spent in each enabled process during the last evaluation, cached stages did not run
+    struct StageProfile
+    {
+        std::string name;
+        float milliseconds=0;
+        bool cached=false;
+        //Most of the arena the stage used at once
+        size_t arenaBytes=0;
+    };
+    std::vector<StageProfile> profile;
+    float processTime=0;
+
+    Histogram histogram;
     bool histogramR=true, histogramG=true, histogramB=true, histogramGray=false;
     float minValueGray, maxValueGray;
-    GLint histogramShader, resetHistogramShader, renderHistogramShader, clearTextureShader;
+    GLint renderHistogramShader, clearTextureShader;
     GLuint histogramBuffer, boundsBuffer;
     GL_TextureFloat histogramTexture;
 
     glm::vec2 outputGuiStart;
 
-    std::vector<glm::vec4> outputImage;
+    //Temporaries of the CPU processes, reset after every stage
+    FrameArena arena;
+
+    //Shared with the exports still being written, the next evaluation gets its own pixels if they are
+    ImageBuffer outputImage;
 
     bool changed=false;
 
@@ -115,11 +260,17 @@ struct ColorContrastStretch : public ImageProcess
     ColorContrastStretch(bool enabled=true);
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return automatic ? -1 : 0; }
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     glm::vec3 lowerBound = glm::vec3(0);
     glm::vec3 upperBound = glm::vec3(1);
     bool global = false;
     float globalLowerBound=0;
     float globalUpperBound=1;
+    //Bounds set from the histogram of the input
+    bool automatic=false;
+    float clipPercent=1;
+    std::vector<glm::vec4> inputData;
 };
 
 struct GrayScaleContrastStretch : public ImageProcess
@@ -127,6 +278,7 @@ struct GrayScaleContrastStretch : public ImageProcess
     GrayScaleContrastStretch(bool enabled=true);
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 0; }
     float lowerBound = 0;
     float upperBound = 1;
 };
@@ -136,17 +288,33 @@ struct Negative : public ImageProcess
     Negative(bool enabled=true);
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 0; }
 };
 
 struct LocalThreshold : public ImageProcess
 {
     LocalThreshold(bool enabled=true);
-    void SetUniforms() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     bool RenderGui() override;
+    int Footprint() override { return Scaled(size)/2; }
+
+    enum class Method
+    {
+        //Keeps the pixels within one standard deviation of the local mean
+        Deviation=0,
+        //Binary, threshold at mean + k * deviation
+        Niblack=1,
+        //Binary, threshold at mean * (1 + k * (deviation / dynamicRange - 1))
+        Sauvola=2,
+        //Binary, threshold at mean - k
+        Mean=3
+    };
+    Method method = Method::Deviation;
 
     int size=3;
-    float a=1;
-    float b=1;
+    float k=0.2f;
+    float dynamicRange=0.5f;
+    std::vector<glm::vec4> outputData;
 };
 
 struct Threshold : public ImageProcess
@@ -154,6 +322,7 @@ struct Threshold : public ImageProcess
     Threshold(bool enabled=true);
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 0; }
     bool global=false;
     float globalLower = 0;
     float globalUpper = 1;
@@ -167,30 +336,41 @@ struct Quantization : public ImageProcess
     Quantization(bool enabled=true);
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 0; }
     int numLevels=255;
 };
 
 struct Transform : public ImageProcess
 {
     Transform(bool enabled=true);
-    void SetUniforms() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     bool RenderGui() override;
     glm::vec2 translation = glm::vec2(0);
     glm::vec2 scale = glm::vec2(1);
     glm::vec2 shear = glm::vec2(0);
     float theta=0;
-    int interpolation=0;
+    ResampleFilter filter = ResampleFilter::Nearest;
 
     bool flipX=false;
     bool flipY=false;
+
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 };
 
 struct Resampling : public ImageProcess
 {
     Resampling(bool enabled=true);
-    void SetUniforms() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     bool RenderGui() override;
     int pixelSize=1;
+    //Filters used to reduce the image by pixelSize, and to scale it back up
+    ResampleFilter downFilter = ResampleFilter::Box;
+    ResampleFilter upFilter = ResampleFilter::Nearest;
+
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> reducedData;
+    std::vector<glm::vec4> outputData;
 };
 
 struct AddNoise : public ImageProcess
@@ -206,9 +386,11 @@ struct AddNoise : public ImageProcess
 struct SmoothingFilter : public ImageProcess
 {
     SmoothingFilter(bool enabled=true);
-    void SetUniforms() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     bool RenderGui() override;
+    int Footprint() override { return Scaled(size)/2; }
     int size=3;
+    std::vector<glm::vec4> outputData;
 };
 
 struct SharpenFilter : public ImageProcess
@@ -216,6 +398,7 @@ struct SharpenFilter : public ImageProcess
     SharpenFilter(bool enabled=true);
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 1; }
 };
 
 struct SobelFilter : public ImageProcess
@@ -223,6 +406,7 @@ struct SobelFilter : public ImageProcess
     SobelFilter(bool enabled=true);
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 1; }
     bool vertical=true;
 };
 
@@ -230,103 +414,171 @@ struct MedianFilter : public ImageProcess
 {
     MedianFilter(bool enabled=true);
     void SetUniforms() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     bool RenderGui() override;
+    int Footprint() override { return cross ? 2 : Scaled(radius); }
     bool vertical=true;
+    //5 taps cross on the GPU, or square window on the CPU
+    bool cross=false;
+    int radius=2;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
+};
+
+struct BilateralFilter : public ImageProcess
+{
+    BilateralFilter(bool enabled=true);
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
+    bool RenderGui() override;
+    float sigmaSpatial=8;
+    float sigmaRange=0.1f;
+    //Direct evaluation instead of the grid, to compare results and timings
+    bool bruteForce=false;
+    float processTime=0;
+    BilateralGrid grid;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
+};
+
+//Image loaded from a file that steers an edge aware filter, stretched over the processed image.
+//Without a file, the input of the process is its own guide.
+struct GuideImage
+{
+    bool RenderGui();
+    //Returns true when the decoded file arrived
+    bool Update(ImageLoader &loader);
+    const glm::vec4 *Get(const std::vector<glm::vec4> &input, int width, int height);
+    void Unload(ImageLoader &loader);
+
+    std::string fileName;
+    bool filenameChanged=false;
+    std::shared_ptr<ImageLoadRequest> loadRequest;
+    //Pixels of the file, shared with the image cache, then stretched to the image when it changes size
+    std::shared_ptr<const DecodedImage> file;
+    bool guideChanged=true;
+    std::vector<glm::vec4> guideData;
+};
+
+struct GuidedFilter : public ImageProcess
+{
+    GuidedFilter(bool enabled=true);
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
+    bool RenderGui() override;
+    bool Update() override;
+    void Unload() override;
+    int radius=16;
+    float epsilon=0.001f;
+    //Factor the coefficients are fitted at, 1 for the exact filter
+    int subsampling=4;
+    GuideImage guide;
+    GuidedImageFilter filter;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
+};
+
+struct DomainTransformFilter : public ImageProcess
+{
+    DomainTransformFilter(bool enabled=true);
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
+    bool RenderGui() override;
+    bool Update() override;
+    void Unload() override;
+    float sigmaSpatial=20;
+    float sigmaRange=0.2f;
+    int iterations=3;
+    GuideImage guide;
+    DomainTransform filter;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 };
 
 struct MinMaxFilter : public ImageProcess
 {
     MinMaxFilter(bool enabled=true);
-    void SetUniforms() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     bool RenderGui() override;
+    int Footprint() override { return Scaled(size)/2; }
     int size = 3;
     bool doMin=true;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 };
 
 struct GaussianBlur : public ImageProcess
 {
     GaussianBlur(bool enabled=true);
-    void SetUniforms() override;
     bool RenderGui() override;
-    void Unload() override;
-    void RecalculateKernel();
+    int Footprint() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
+    void Blur(const glm::vec4 *input, glm::vec4 *output, int width, int height);
+    //Parameters of filter at the current proxy level
+    void UpdateFilter();
+    //Kernel size of the FIR method
     int size=3;
     float sigma=1;
     int maxSize = 257;
-    std::vector<float> kernel;
-    GLuint kernelBuffer;
-
-    bool shouldRecalculateKernel=true;
+    GaussianFilter filter;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 };
 
 struct HalfToning : public ImageProcess
 {
     HalfToning(bool enabled=true);
-    void SetUniforms() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     bool RenderGui() override;
-    void Unload() override;
     void RecalculateKernel();
     
     float intensity=1;
 
     bool grayScale=true;
     
-    glm::mat3 CalculateTransform(float theta);
-
     glm::vec3 rotation;
-    glm::mat3 transformR;
-    glm::mat3 transformG;
-    glm::mat3 transformB;
 
-    int size=5;
-    std::vector<float> H;
-    GLuint HBuffer;
+    //Screen, a pixel is on where its value plus intensity times the screen is above 1
+    ThresholdTile tile;
     bool shouldRecalculateH=true;
 
     int maskType = 0;
+
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 };
 
 
 struct Dithering : public ImageProcess
 {
     Dithering(bool enabled=true);
-    void SetUniforms() override;
     void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     bool RenderGui() override;
-    void Unload() override;
-    
-    AddNoise addNoise;
-    Threshold threshold;
+    void BuildTile();
+
+    //0 : Bayer, 1 : Blue noise, 2 : Clustered dots
+    int pattern=1;
+    int bayerOrder=3;
+    int blueNoiseSize=64;
+    int dotSize=8;
+    int levels=2;
+    bool grayScale=true;
+    glm::vec3 angles = glm::vec3(0);
+
+    ThresholdTile tile;
+    bool tileChanged=true;
 
-    GL_TextureFloat tmpTexture;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 };
 
 struct Erosion : public ImageProcess
 {
     Erosion(bool enabled=true);
-    void SetUniforms() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     bool RenderGui() override;
-    void Unload() override;
-    void RecalculateKernel();
-    int size=3;
-    int subSize=1;
+    int Footprint() override { return Scaled(element.size)/2; }
     int maxSize = 256;
-    std::vector<float> kernel;
-    
-    enum class StructuringElementShape
-    {
-        Circle = 0,
-        Diamond = 1,
-        Line = 2,
-        Octagon = 3,
-        Square = 5
-    };
-    StructuringElementShape shape = StructuringElementShape::Circle;
-
-    float rotation=0;
-
-    GLuint kernelBuffer;
-    bool shouldRecalculateKernel=true;
+    StructuringElement element;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 };
 
 struct AddGradient : public ImageProcess
@@ -354,29 +606,54 @@ struct AddGradient : public ImageProcess
 struct Dilation : public ImageProcess
 {
     Dilation(bool enabled=true);
-    void SetUniforms() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     bool RenderGui() override;
-    void Unload() override;
-    void RecalculateKernel();
-    int size=3;
-    int subSize=1;
+    int Footprint() override { return Scaled(element.size)/2; }
     int maxSize = 256;
-    std::vector<float> kernel;
-    
-    enum class StructuringElementShape
+    StructuringElement element;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
+};
+
+struct Morphology : public ImageProcess
+{
+    Morphology(bool enabled=true);
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
+    bool RenderGui() override;
+    MorphologyOperation operation = MorphologyOperation::Open;
+    //Thresholds the input to 0 / 1 first, like Erosion and Dilation
+    bool binary=false;
+    int maxSize = 256;
+    StructuringElement element;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
+};
+
+struct DistanceTransform : public ImageProcess
+{
+    DistanceTransform(bool enabled=true);
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
+    bool RenderGui() override;
+
+    enum class OutputMode
     {
-        Circle = 0,
-        Diamond = 1,
-        Line = 2,
-        Octagon = 3,
-        Square = 5
-    };
-    StructuringElementShape shape = StructuringElementShape::Circle;
+        Distance=0,
+        SignedDistance=1,
+        NearestFeature=2
+    } outputMode = OutputMode::Distance;
 
-    float rotation=0;
+    //Features are the pixels whose gray scale is above the threshold, or below it when inverted
+    float threshold=0.5f;
+    bool invert=false;
+    //Distance displayed as white, 0 to use the largest distance in the image
+    float maxDistance=0;
 
-    GLuint kernelBuffer;
-    bool shouldRecalculateKernel=true;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
+    std::vector<uint8_t> features;
+    std::vector<float> squaredDistances;
+    std::vector<float> innerSquaredDistances;
+    std::vector<int64_t> nearestFeatures;
 };
 
 struct AddImage : public ImageProcess
@@ -384,12 +661,17 @@ struct AddImage : public ImageProcess
     AddImage(bool enabled=true, std::string fileName="");
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 0; }
+    bool Update() override;
     void Unload() override;
     void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
 
     std::string fileName;
     GL_TextureFloat texture;
+    //Levels read on proxies
+    bool mipmapsBuilt=false;
     bool filenameChanged=false;
+    std::shared_ptr<ImageLoadRequest> loadRequest;
     float multiplier=1;
     float aspectRatio;
 };
@@ -399,56 +681,43 @@ struct MultiplyImage : public ImageProcess
     MultiplyImage(bool enabled=true, std::string fileName="");
     void SetUniforms() override;
     bool RenderGui() override;
+    bool Update() override;
     void Unload() override;
 
     std::string fileName;
     GL_TextureFloat texture;
     bool filenameChanged=false;
+    std::shared_ptr<ImageLoadRequest> loadRequest;
     float multiplier=1;
 };
 
 struct GaussianPyramid : public ImageProcess
 {
     GaussianPyramid(bool enabled=true);
-    void SetUniforms() override;
     bool RenderGui() override;
-    void Unload() override;
     void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
-    void CopyTexture(GLuint textureIn, GLuint textureOut, int width, int height);
-    void Build(GLuint textureIn, int width, int height);
 
     int depth=5;
-    std::vector<GL_TextureFloat> pyramid;
-    std::vector<GL_TextureFloat> pyramidTmp;
-    // GL_TextureFloat reconstructed;
-    int currentWidth=-1;
-    int currentHeight=-1;
-    GaussianBlur gaussianBlur;
-
-    bool depthChanged;
-
     int output=0;
+    ImagePyramid pyramid;
+
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 };
 
 struct LaplacianPyramid : public ImageProcess
 {
     LaplacianPyramid(bool enabled=true);
-    void SetUniforms() override;
     bool RenderGui() override;
-    void Unload() override;
     void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
-    void SubtractTexture(GLuint textureA, GLuint textureB, int width, int height);
-    void AddTexture(GLuint textureA, GLuint textureB, int width, int height);
-    void ClearTexture(GLuint textureA, int width, int height);
-    void Build(GLuint textureIn, int width, int height);
-
-    GaussianPyramid gaussianPyramid;
 
-    GLint addTextureShader;
-    GLint clearTextureShader;
-    
-    bool outputReconstruction=false;
+    int depth=5;
     int output=0;
+    bool outputReconstruction=false;
+    ImagePyramid pyramid;
+
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 };
 
 struct PenDraw : public ImageProcess
@@ -461,6 +730,7 @@ struct PenDraw : public ImageProcess
     virtual bool MouseMove(float x, float y) override;
     virtual bool MousePressed() override;
     virtual bool MouseReleased() override;
+    bool SupportsProxy() override {return false;}
 
     GL_TextureFloat paintTexture;
     std::vector<glm::vec4> paintData;
@@ -482,11 +752,13 @@ struct HardComposite : public ImageProcess
     HardComposite(bool enabled=true, std::string fileName="");
     void SetUniforms() override;
     bool RenderGui() override;
+    bool Update() override;
     void Unload() override;
     
     virtual bool MouseMove(float x, float y) override;
     virtual bool MousePressed() override;
     virtual bool MouseReleased() override;
+    bool SupportsProxy() override {return false;}
     void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
 
     //Mask
@@ -501,6 +773,7 @@ struct HardComposite : public ImageProcess
     std::string fileName;
     GL_TextureFloat texture;
     bool filenameChanged=false;
+    std::shared_ptr<ImageLoadRequest> loadRequest;
     GLint compositeShader;
 
     //Weighted transition
@@ -524,11 +797,11 @@ struct SeamCarvingResize : public ImageProcess
     virtual bool MouseMove(float x, float y) override;
     virtual bool MousePressed() override;
     virtual bool MouseReleased() override;
+    bool SupportsProxy() override {return false;}
     
 
     float SeamCarvingResize::CalculateCostAt(glm::ivec2 position, std::vector<glm::vec4> &image, int width, int height);
     
-    std::vector<glm::vec4> originalData;
     std::vector<glm::vec4> imageData;
     std::vector<glm::vec4> debugData;
     std::vector<int> seamData;
@@ -581,6 +854,7 @@ struct PatchInpainting : public ImageProcess
     virtual bool MouseMove(float x, float y) override;
     virtual bool MousePressed() override;
     virtual bool MouseReleased() override;
+    bool SupportsProxy() override {return false;}
     void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     bool RenderOutputGui() override;
     
@@ -619,14 +893,15 @@ struct MultiResComposite : public ImageProcess
     MultiResComposite(bool enabled=true, std::string fileName="");
     void SetUniforms() override;
     bool RenderGui() override;
+    bool Update() override;
     void Unload() override;
     
     virtual bool MouseMove(float x, float y) override;
     virtual bool MousePressed() override;
     virtual bool MouseReleased() override;
+    bool SupportsProxy() override {return false;}
     void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
 
-    void Reconstruct(GLuint textureOut, GLuint sourceTexture, GLuint destTexture, GLuint maskTexture, int width, int height);
 
     //Mask
     GL_TextureFloat maskTexture;
@@ -635,17 +910,33 @@ struct MultiResComposite : public ImageProcess
     int radius=25;
     bool drawingMask=false;
     bool adding=true;
-    GaussianPyramid maskPyramid;
+    ImagePyramid maskPyramid;
+    //Pixels painted since the last composite, the whole mask is rebuilt when maskChanged is set
+    PyramidRegion maskRegion;
+    bool maskChanged=true;
 
     //Source texture
     std::string fileName;
     GL_TextureFloat texture;
     bool filenameChanged=false;
-    LaplacianPyramid sourcePyramid;
-    
-    LaplacianPyramid destPyramid;
+    std::shared_ptr<ImageLoadRequest> loadRequest;
+    ImagePyramid sourcePyramid;
+    bool sourceChanged=true;
+    //Decoded pixels of the source file, shared with the image cache
+    std::shared_ptr<const DecodedImage> sourceImage;
+    std::vector<glm::vec4> sourceData;
+
+    //Laplacian pyramid of the input, only rebuilt when the hash of the input changes
+    ImagePyramid destPyramid;
+    uint64_t inputHash=0;
+    std::vector<glm::vec4> inputData;
+
+    //Blended bands, and their sum kept between runs so that mask edits only recompute the pixels they reach
+    ImagePyramid blendPyramid;
+    std::vector<glm::vec4> outputData;
 
     int depth = 5;
+    int pyramidDepth = -1;
 
     bool selected=false;
 
@@ -659,6 +950,7 @@ struct CurveGrading : public ImageProcess
     CurveGrading(bool enabled=true);
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 0; }
     void Unload() override;
 
     Curve redCurve;
@@ -679,77 +971,72 @@ struct AddColor : public ImageProcess
     AddColor(bool enabled=true);
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 0; }
     glm::vec3 color;
 };
 
 struct LaplacianOfGaussian : public ImageProcess
 {
     LaplacianOfGaussian(bool enabled=true);
-    void SetUniforms() override;
     bool RenderGui() override;
-    void Unload() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     void RecalculateKernel();
     int size=9;
     float sigma=1.0f;
     int maxSize = 257;
     std::vector<float> kernel;
-    GLuint kernelBuffer;
+    ConvolutionEngine convolution;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 
     bool shouldRecalculateKernel=true;
+    //Proxy level the kernel was built for
+    int kernelLevel=0;
 };
 
 struct DifferenceOfGaussians : public ImageProcess
 {
     DifferenceOfGaussians(bool enabled=true);
-    void SetUniforms() override;
     bool RenderGui() override;
-    void Unload() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     void RecalculateKernel();
     int size=9;
     float sigma1=1.0f;
     float sigma2=3.0f;
     int maxSize = 257;
     std::vector<float> kernel;
-    GLuint kernelBuffer;
+    ConvolutionEngine convolution;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 
     bool shouldRecalculateKernel=true;
+    //Proxy level the kernel was built for
+    int kernelLevel=0;
 };
 
 struct CannyEdgeDetector : public ImageProcess
 {
     CannyEdgeDetector(bool enabled=true);
-    void SetUniforms() override;
     bool RenderGui() override;
     void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     void Unload() override;
 
-    void RecalculateKernel();
-    int size=3;
     float sigma=1;
-    int maxSize = 257;
     float threshold=0.1f;
-    std::vector<float> kernel;
-    GLuint kernelBuffer;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 
-    GLint gradientShader;
-    GLint edgeShader;
-    GLint thresholdShader;
-    GLint hysteresisShader;
-    GL_TextureFloat blurTexture;
-    GL_TextureFloat gradientTexture;
-    GL_TextureFloat edgeTexture;
-    GL_TextureFloat thresholdTexture;
+    //Gradient and edges of the last processed image
+    CannyEdges edges;
     
     int outputStep=4;
-
-    bool shouldRecalculateKernel=true;
 };
 
 struct ArbitraryFilter : public ImageProcess
 {
     ArbitraryFilter(bool enabled=true);
-    void SetUniforms() override;
     bool RenderGui() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
 
     void RecalculateKernel();
     int sizeX=3;
@@ -759,7 +1046,9 @@ struct ArbitraryFilter : public ImageProcess
     bool normalize=false;
     std::vector<float> kernel;
     std::vector<float> normalizedKernel;
-    GLuint kernelBuffer;
+    ConvolutionEngine convolution;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 
     bool shouldRecalculateKernel=true;
 };
@@ -769,17 +1058,23 @@ struct GammaCorrection : public ImageProcess
     GammaCorrection(bool enabled=true);
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 0; }
     float gamma=2.2f;
 };
 
 struct ColorDistance : public ImageProcess
 {
     ColorDistance(bool enabled=true);
-    void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 0; }
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     
     glm::vec3 color;
     float distance;
+    ColorSpace space = ColorSpace::RGB;
+
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 };
 
 struct EdgeLinking : public ImageProcess
@@ -797,8 +1092,6 @@ struct EdgeLinking : public ImageProcess
 
     bool doProcess=true;
 
-    std::vector<glm::vec4> gradientData;
-    std::vector<glm::vec4> edgeData;
     std::vector<glm::vec4> linkedEdgeData;
 
     float magnitudeThreshold= 0.4f;
@@ -834,6 +1127,8 @@ struct RegionProperties : public ImageProcess
     void SetUniforms() override;
     bool RenderGui() override;
     bool RenderOutputGui() override;
+    //Regions are drawn over the output in full resolution coordinates
+    bool SupportsProxy() override {return false;}
     void Process(GLuint textureIn, GLuint textureOut, int width, int height);
     void Unload() override;
     int GetStartIndex(glm::ivec2 b, glm::ivec2 c);
@@ -841,7 +1136,8 @@ struct RegionProperties : public ImageProcess
     struct Region
     {
         glm::uvec2 center;
-        std::vector<glm::ivec2> points;
+        //On the arena of the stack, only valid while the regions are processed
+        ArenaVector<glm::ivec2> points;
         struct
         {
             glm::ivec2 minBB;
@@ -895,6 +1191,7 @@ struct ErrorDiffusionHalftoning : public ImageProcess
     bool RenderGui() override;
     void Process(GLuint textureIn, GLuint textureOut, int width, int height);
     void Unload() override;
+    bool SupportsProxy() override {return false;}
     void RecalculateMask();
     std::vector<glm::vec4> inputData;
     bool shouldProcess=true;
@@ -916,10 +1213,14 @@ struct KMeansCluster : public ImageProcess
     bool RenderGui() override;
     void Process(GLuint textureIn, GLuint textureOut, int width, int height);
     void Unload() override;
+    bool SupportsProxy() override {return false;}
 
     std::vector<glm::vec4> inputData;
+    //Pixels in the space the clusters are built in
+    std::vector<glm::vec4> colorData;
     std::vector<glm::vec3> clusterPositions;
-    std::vector<std::vector<int>> clusterMapping;
+    std::vector<std::vector<size_t>> clusterMapping;
+    ColorSpace space = ColorSpace::RGB;
 
 
     enum class OutputMode
@@ -934,6 +1235,10 @@ struct KMeansCluster : public ImageProcess
     bool shouldProcess=true;
 
     int numClusters=4;    
+
+    //Frames of a sequence start from the clusters of the previous one
+    void BeginSequenceFrame(int frame) override;
+    bool warmStart=false;
 };
 
 struct SuperPixelsCluster : public ImageProcess
@@ -943,6 +1248,7 @@ struct SuperPixelsCluster : public ImageProcess
     bool RenderGui() override;
     void Process(GLuint textureIn, GLuint textureOut, int width, int height);
     void Unload() override;
+    bool SupportsProxy() override {return false;}
 
     struct ClusterData
     {
@@ -951,8 +1257,11 @@ struct SuperPixelsCluster : public ImageProcess
     };
 
     std::vector<glm::vec4> inputData;
+    //Pixels in the space the clusters are built in
+    std::vector<glm::vec4> colorData;
     std::vector<ClusterData> clusterPositions;
-    std::vector<std::vector<int>> clusterMapping;
+    std::vector<std::vector<size_t>> clusterMapping;
+    ColorSpace space = ColorSpace::RGB;
 
     bool shouldProcess=true;
     float C = 0.1f;
@@ -966,6 +1275,11 @@ struct SuperPixelsCluster : public ImageProcess
     }; 
 
     OutputMode outputMode = OutputMode::ClusterColor;
+
+    //Frames of a sequence start from the centers of the previous one, when it had the same size
+    void BeginSequenceFrame(int frame) override;
+    bool warmStart=false;
+    glm::ivec2 clusterImageSize=glm::ivec2(0);
 };
 
 struct HoughTransform : public ImageProcess
@@ -975,6 +1289,7 @@ struct HoughTransform : public ImageProcess
     bool RenderGui() override;
     void Process(GLuint textureIn, GLuint textureOut, int width, int height);
     void Unload() override;
+    bool SupportsProxy() override {return false;}
 
     CannyEdgeDetector *cannyEdgeDetector;
     bool cannyChanged=true;
@@ -983,7 +1298,6 @@ struct HoughTransform : public ImageProcess
     int houghSpaceSize=750;
     
     std::vector<glm::vec4> houghSpace;
-    std::vector<glm::vec4> edgeData;
     std::vector<glm::vec4> linesData;
     std::vector<glm::vec4> inputData;
 
@@ -1017,7 +1331,13 @@ struct OtsuThreshold : public ImageProcess
     bool RenderGui() override;
     void Process(GLuint textureIn, GLuint textureOut, int width, int height);
     float threshold=1;
+    int numBins=256;
     std::vector<glm::vec4> inputData;
+
+    //Frames of a sequence keep the threshold of the previous one while it stays within stability of the best split
+    void BeginSequenceFrame(int frame) override { warmStart = frame > 0; }
+    bool warmStart=false;
+    float stability=0.02f;
 };
 
 struct Gradient : public ImageProcess
@@ -1025,6 +1345,7 @@ struct Gradient : public ImageProcess
     Gradient(bool enabled=true);
     void SetUniforms() override;
     bool RenderGui() override;
+    int Footprint() override { return 1; }
 
     enum class RenderMode
     {
@@ -1049,15 +1370,24 @@ struct Equalize : public ImageProcess
     void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
     void Unload() override;
     bool color=true;
-    
-    GLuint lutBuffer;
-    GLuint pdfBuffer;
-    GLuint histogramBuffer, boundsBuffer;
+    int numBins=256;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
+};
 
-    GLint resetHistogramShader;
-    GLint histogramShader;
-    GLint buildPdfShader;
-    GLint buildLutShader;
+struct CLAHE : public ImageProcess
+{
+    CLAHE(bool enabled=true);
+    void SetUniforms() override;
+    bool RenderGui() override;
+    void Process(GLuint textureIn, GLuint textureOut, int width, int height) override;
+    bool color=false;
+    int tilesX=8;
+    int tilesY=8;
+    float clipLimit=2;
+    int numBins=256;
+    std::vector<glm::vec4> inputData;
+    std::vector<glm::vec4> outputData;
 };
 
 
@@ -1103,6 +1433,9 @@ public :
     void Unload();
 
     void SaveImage(std::string FilePath);
+    //Runs the decoded frames of the sequence through the stack for a few milliseconds
+    void StepSequence();
+    void RenderSequenceGui();
 
     void MouseMove(float x, float y);
     void LeftClickDown();
@@ -1126,6 +1459,19 @@ private:
     
 
     ImageProcessStack imageProcessStack;
+    ImageExporter imageExporter;
+    int pngCompressionLevel=6;
+
+    //Frames of a directory processed with the stack, the first AddImage is replaced by each of them
+    SequencePipeline sequence{imageProcessStack.imageLoader, imageExporter};
+    std::string sequenceInputDirectory;
+    std::string sequenceOutputDirectory;
+    ExportFormat sequenceFormat=ExportFormat::PNG;
+    //Stage outputs are not kept while a sequence runs, every frame changes the input
+    bool sequenceCacheStages=true;
+
+    //ImGui time of the last evaluation requested by an edit
+    double lastEditTime=0;
 
     bool shouldProcess=true;
     GLuint outTexture;
@@ -0,0 +1,239 @@
+#include "ImageLoader.hpp"
+
+#include <stb_image.h>
+#include <emmintrin.h>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+void ConvertU8ToFloat(const uint8_t *input, float *output, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+    size_t i=0;
+    for(; i+16<=count; i+=16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(input + i));
+        __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        __m128i high = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_ps(output + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+        _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+        _mm_storeu_ps(output + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+        _mm_storeu_ps(output + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+    }
+    for(; i<count; i++) output[i] = (float)input[i] / 255.0f;
+}
+
+void ConvertU16ToFloat(const uint16_t *input, float *output, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.0f / 65535.0f);
+    size_t i=0;
+    for(; i+8<=count; i+=8)
+    {
+        __m128i shorts = _mm_loadu_si128((const __m128i*)(input + i));
+        _mm_storeu_ps(output + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(shorts, zero)), scale));
+        _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(shorts, zero)), scale));
+    }
+    for(; i<count; i++) output[i] = (float)input[i] / 65535.0f;
+}
+
+std::shared_ptr<const DecodedImage> DecodedImageCache::Find(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if(found == index.end()) return nullptr;
+    entries.splice(entries.begin(), entries, found->second);
+    return found->second->second;
+}
+
+void DecodedImageCache::Insert(const std::string &key, const std::shared_ptr<const DecodedImage> &image)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if(found != index.end())
+    {
+        size -= found->second->second->Bytes();
+        entries.erase(found->second);
+    }
+    entries.emplace_front(key, image);
+    index[key] = entries.begin();
+    size += image->Bytes();
+    Evict();
+}
+
+void DecodedImageCache::SetCapacity(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = bytes;
+    Evict();
+}
+
+size_t DecodedImageCache::Size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return size;
+}
+
+int DecodedImageCache::Count()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return (int)entries.size();
+}
+
+//The most recent image stays even when it is larger than the capacity on its own
+void DecodedImageCache::Evict()
+{
+    while(size > capacity && entries.size() > 1)
+    {
+        size -= entries.back().second->Bytes();
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+//A file that was written again gets another key, so its stale decode is never returned
+static std::string CacheKey(const std::string &fileName)
+{
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(fileName, error);
+    if(error) return fileName;
+    return fileName + "|" + std::to_string(time.time_since_epoch().count());
+}
+
+ImageLoader::ImageLoader(int numThreads)
+{
+    for(int i=0; i<(std::max)(numThreads, 1); i++) threads.emplace_back([this]() { Worker(); });
+}
+
+ImageLoader::~ImageLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping=true;
+        for(size_t i=0; i<queue.size(); i++) queue[i]->cancelled = true;
+    }
+    condition.notify_all();
+    for(size_t i=0; i<threads.size(); i++) threads[i].join();
+}
+
+std::shared_ptr<ImageLoadRequest> ImageLoader::Load(const std::string &fileName, bool keepInCache)
+{
+    std::string key = CacheKey(fileName);
+    std::shared_ptr<ImageLoadRequest> request = std::make_shared<ImageLoadRequest>();
+    request->fileName = fileName;
+    request->key = key;
+    request->numRequesters = 1;
+    request->keepInCache = keepInCache;
+
+    std::shared_ptr<const DecodedImage> cached = cache.Find(key);
+    if(cached)
+    {
+        request->image = cached;
+        request->state = ImageLoadState::Done;
+        return request;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = requests.find(key);
+    if(found != requests.end())
+    {
+        std::shared_ptr<ImageLoadRequest> loading = found->second.lock();
+        if(loading && !loading->cancelled && !loading->Finished())
+        {
+            loading->numRequesters++;
+            return loading;
+        }
+    }
+    requests[key] = request;
+    queue.push_back(request);
+    condition.notify_one();
+    return request;
+}
+
+void ImageLoader::Release(const std::shared_ptr<ImageLoadRequest> &request)
+{
+    if(!request) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if(--request->numRequesters > 0) return;
+
+    if(!request->Finished()) request->cancelled = true;
+    auto found = requests.find(request->key);
+    if(found != requests.end() && found->second.lock() == request) requests.erase(found);
+    auto queued = std::find(queue.begin(), queue.end(), request);
+    if(queued != queue.end())
+    {
+        queue.erase(queued);
+        request->state = ImageLoadState::Cancelled;
+    }
+}
+
+void ImageLoader::Worker()
+{
+    while(true)
+    {
+        std::shared_ptr<ImageLoadRequest> request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if(stopping) return;
+            request = queue.front();
+            queue.pop_front();
+        }
+        request->state = ImageLoadState::Decoding;
+        Decode(*request);
+    }
+}
+
+void ImageLoader::Decode(ImageLoadRequest &request)
+{
+    const char *fileName = request.fileName.c_str();
+    int width=0, height=0, nChannels=0;
+    void *data=nullptr;
+    bool hdr = stbi_is_hdr(fileName) != 0;
+    bool wide = !hdr && stbi_is_16_bit(fileName) != 0;
+    if(hdr) data = stbi_loadf(fileName, &width, &height, &nChannels, 4);
+    else if(wide) data = stbi_load_16(fileName, &width, &height, &nChannels, 4);
+    else data = stbi_load(fileName, &width, &height, &nChannels, 4);
+
+    if(data == nullptr)
+    {
+        std::cout << "ImageLoader: ERROR::Failed to load " << request.fileName << std::endl;
+        request.state = ImageLoadState::Failed;
+        return;
+    }
+    if(request.cancelled)
+    {
+        stbi_image_free(data);
+        request.state = ImageLoadState::Cancelled;
+        return;
+    }
+
+    //Converted in bands of rows so that a cancellation does not wait for the whole image
+    std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+    image->pixels.resize((size_t)width * height);
+    float *pixels = &image->pixels[0].x;
+    const int bandSize = 64;
+    for(int y=0; y<height; y+=bandSize)
+    {
+        if(request.cancelled) break;
+        size_t start = (size_t)y * width * 4;
+        size_t count = (size_t)(std::min)(bandSize, height-y) * width * 4;
+        if(hdr) std::copy((const float*)data + start, (const float*)data + start + count, pixels + start);
+        else if(wide) ConvertU16ToFloat((const uint16_t*)data + start, pixels + start, count);
+        else ConvertU8ToFloat((const uint8_t*)data + start, pixels + start, count);
+    }
+    stbi_image_free(data);
+
+    if(request.cancelled)
+    {
+        request.state = ImageLoadState::Cancelled;
+        return;
+    }
+    image->width = width;
+    image->height = height;
+    image->nChannels = nChannels;
+    if(request.keepInCache) cache.Insert(request.key, image);
+    request.image = image;
+    request.state = ImageLoadState::Done;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//Normalized integer channels to floats in [0, 1], 16 bytes or 8 shorts per iteration with SSE
+void ConvertU8ToFloat(const uint8_t *input, float *output, size_t count);
+void ConvertU16ToFloat(const uint16_t *input, float *output, size_t count);
+
+enum class ImageLoadState
+{
+    Pending=0,
+    Decoding=1,
+    Done=2,
+    Failed=3,
+    Cancelled=4
+};
+
+//File decoded to RGBA floats, shared by everything that uses it
+struct DecodedImage
+{
+    int width=0;
+    int height=0;
+    //Channels in the file, before expansion to RGBA
+    int nChannels=0;
+    std::vector<glm::vec4> pixels;
+
+    size_t Bytes() const { return pixels.size() * sizeof(glm::vec4); }
+};
+
+//File being decoded by the loader threads, image can be read once state is Done
+struct ImageLoadRequest
+{
+    std::string fileName;
+    //Path and modification time of the file
+    std::string key;
+    std::atomic<ImageLoadState> state{ImageLoadState::Pending};
+    std::atomic<bool> cancelled{false};
+    //Frames of a sequence are used once, they would only push the other images out of the cache
+    bool keepInCache=true;
+    //Callers of Load that did not release it yet, guarded by the loader
+    int numRequesters=0;
+
+    std::shared_ptr<const DecodedImage> image;
+
+    bool Finished() const { return state >= ImageLoadState::Done; }
+};
+
+//Decoded images by path and modification time, so that reopening a file that did not change is free.
+//Images are shared : evicting the least recently used ones once over capacity only drops the reference of the cache.
+class DecodedImageCache
+{
+public:
+    std::shared_ptr<const DecodedImage> Find(const std::string &key);
+    void Insert(const std::string &key, const std::shared_ptr<const DecodedImage> &image);
+    void SetCapacity(size_t bytes);
+
+    size_t Size();
+    int Count();
+
+private:
+    void Evict();
+
+    std::mutex mutex;
+    //Most recently used first
+    std::list<std::pair<std::string, std::shared_ptr<const DecodedImage>>> entries;
+    std::unordered_map<std::string, decltype(entries)::iterator> index;
+    size_t capacity = (size_t)1 << 30;
+    size_t size=0;
+};
+
+//Decodes image files on a pool of threads, 8, 16 bit and HDR files alike.
+//Files already in the cache complete immediately. Requests for a file that is still being loaded share the same request.
+//Each call to Load is matched by a Release, once the pixels were used or when they are not wanted anymore.
+//When the last requester releases an unfinished request it is cancelled : dropped if not started yet,
+//otherwise decoding stops at the next check and the pixels are freed.
+class ImageLoader
+{
+public:
+    ImageLoader(int numThreads=4);
+    ~ImageLoader();
+
+    std::shared_ptr<ImageLoadRequest> Load(const std::string &fileName, bool keepInCache=true);
+    void Release(const std::shared_ptr<ImageLoadRequest> &request);
+
+    DecodedImageCache cache;
+
+private:
+    void Worker();
+    void Decode(ImageLoadRequest &request);
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::shared_ptr<ImageLoadRequest>> queue;
+    std::unordered_map<std::string, std::weak_ptr<ImageLoadRequest>> requests;
+    std::vector<std::thread> threads;
+    bool stopping=false;
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+//Channels of the pixels of a view, in the order they are stored
+enum class ChannelLayout
+{
+    //glm::vec4
+    RGBA=0,
+    //float
+    Gray=1
+};
+
+//Rows padded to a multiple of alignment bytes, so that SIMD loops can use aligned loads at the start of every row
+inline size_t AlignedRowStride(int width, size_t pixelBytes, size_t alignment=64)
+{
+    size_t bytes = (size_t)width * pixelBytes;
+    return (bytes + alignment-1) / alignment * alignment;
+}
+
+//Pixels of an image that the view does not own : height rows of width pixels, each row rowStride bytes after the previous one.
+//Offsets are 64 bits, so images past 2^31 pixels, crops of larger images and padded rows are all addressed the same way.
+//Pixel is glm::vec4 or float, const for views that are only read.
+template<typename Pixel>
+struct ImageViewT
+{
+    typedef typename std::conditional<std::is_const<Pixel>::value, const uint8_t, uint8_t>::type Byte;
+    static constexpr ChannelLayout layout = std::is_same<typename std::remove_const<Pixel>::type, float>::value ? ChannelLayout::Gray : ChannelLayout::RGBA;
+
+    ImageViewT() = default;
+    //Tightly packed rows
+    ImageViewT(Pixel *pixels, int width, int height) : pixels(pixels), width(width), height(height), rowStride((size_t)width * sizeof(Pixel)) {}
+    ImageViewT(Pixel *pixels, int width, int height, size_t rowStride) : pixels(pixels), width(width), height(height), rowStride(rowStride) {}
+    //Writable views are also read only views
+    template<typename Other, typename = typename std::enable_if<std::is_same<const Other, Pixel>::value && !std::is_same<Other, Pixel>::value>::type>
+    ImageViewT(const ImageViewT<Other> &other) : pixels(other.pixels), width(other.width), height(other.height), rowStride(other.rowStride) {}
+
+    Pixel *Row(int y) const { return (Pixel*)((Byte*)pixels + (int64_t)y * (int64_t)rowStride); }
+    Pixel &At(int x, int y) const { return Row(y)[x]; }
+    //Row clamped to the image, for filters that extend the borders
+    Pixel *ClampedRow(int y) const { return Row((std::min)((std::max)(y, 0), height-1)); }
+
+    //The rows follow each other without padding, the pixels can be used as one array
+    bool IsPacked() const { return rowStride == (size_t)width * sizeof(Pixel); }
+    bool Empty() const { return width <= 0 || height <= 0; }
+    size_t NumPixels() const { return (size_t)(std::max)(width, 0) * (size_t)(std::max)(height, 0); }
+    //Row stride in pixels, when it is a whole number of them
+    size_t PixelStride() const { return rowStride / sizeof(Pixel); }
+
+    //Pixels of [x0, x1) x [y0, y1), sharing the rows of this view
+    ImageViewT Crop(int x0, int y0, int x1, int y1) const
+    {
+        return ImageViewT(Row(y0) + x0, x1 - x0, y1 - y0, rowStride);
+    }
+
+    Pixel *pixels=nullptr;
+    int width=0;
+    int height=0;
+    size_t rowStride=0;
+};
+
+typedef ImageViewT<glm::vec4> ImageView;
+typedef ImageViewT<const glm::vec4> ConstImageView;
+typedef ImageViewT<float> GrayImageView;
+typedef ImageViewT<const float> ConstGrayImageView;
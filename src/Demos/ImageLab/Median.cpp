@@ -0,0 +1,308 @@
+#include "Median.hpp"
+#include "Parallel.hpp"
+#include "ImageBuffer.hpp"
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+//Histograms are indexed by the bits of the half float, 0x3C00 is 1.0
+//Two levels as in Perreault - Hebert : 128 coarse bins of 128 fine bins
+static const int coarseSize = 128;
+static const int fineSize = 128;
+static const int numBins = coarseSize * fineSize;
+static const uint16_t maxBin = 0x3C00;
+
+static uint16_t FloatToBin(float value)
+{
+    if(!(value > 0)) return 0;
+    if(value >= 1) return maxBin;
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+    //Subnormal half float
+    if(exponent <= 0) return (uint16_t)(value * 16777216.0f + 0.5f);
+    uint32_t mantissa = bits & 0x7fffff;
+    uint32_t result = ((uint32_t)exponent << 10) + (mantissa >> 13) + ((mantissa >> 12) & 1);
+    return (uint16_t)(std::min)(result, (uint32_t)maxBin);
+}
+
+static const std::vector<float> &BinValues()
+{
+    static std::vector<float> values = []()
+    {
+        std::vector<float> result(numBins, 1.0f);
+        for(int i=0; i<=maxBin; i++)
+        {
+            int exponent = i >> 10;
+            int mantissa = i & 1023;
+            result[i] = (exponent==0) ? std::ldexp((float)mantissa, -24) : std::ldexp(1.0f + mantissa / 1024.0f, exponent - 15);
+        }
+        return result;
+    }();
+    return values;
+}
+
+//dst += add - sub, on count 16 bit counters (count multiple of 8)
+static void UpdateHistogram(uint16_t *dst, const uint16_t *add, const uint16_t *sub, int count)
+{
+    for(int i=0; i<count; i+=8)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        d = _mm_add_epi16(d, _mm_loadu_si128((const __m128i*)(add + i)));
+        d = _mm_sub_epi16(d, _mm_loadu_si128((const __m128i*)(sub + i)));
+        _mm_storeu_si128((__m128i*)(dst + i), d);
+    }
+}
+
+static void AddHistogram(uint16_t *dst, const uint16_t *add, int count)
+{
+    for(int i=0; i<count; i+=8)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        d = _mm_add_epi16(d, _mm_loadu_si128((const __m128i*)(add + i)));
+        _mm_storeu_si128((__m128i*)(dst + i), d);
+    }
+}
+
+struct MedianHistograms
+{
+    //One histogram per column of the strip and its borders, over the 2 * radius + 1 rows around the current one
+    std::vector<uint16_t> columnCoarse;
+    std::vector<uint16_t> columnFine;
+    //Histogram of the window around the current pixel. Fine bins are updated lazily, when the median falls in their coarse bin
+    std::vector<uint16_t> kernelCoarse;
+    std::vector<uint16_t> kernelFine;
+    std::vector<int> lastUpdate;
+};
+
+static void MedianStrip(const uint16_t *bins, const ImageView &output, int channel, int radius, int x0, int x1, MedianHistograms &histograms)
+{
+    const std::vector<float> &binValues = BinValues();
+    int width = output.width;
+    int height = output.height;
+    int diameter = 2 * radius + 1;
+    int numColumns = x1 - x0 + 2 * radius;
+    int rank = diameter * diameter / 2;
+
+    histograms.columnCoarse.assign((size_t)numColumns * coarseSize, 0);
+    histograms.columnFine.assign((size_t)numColumns * numBins, 0);
+    histograms.kernelCoarse.resize(coarseSize);
+    histograms.kernelFine.resize(numBins);
+    histograms.lastUpdate.resize(coarseSize);
+    uint16_t *columnCoarse = histograms.columnCoarse.data();
+    uint16_t *columnFine = histograms.columnFine.data();
+    uint16_t *kernelCoarse = histograms.kernelCoarse.data();
+    uint16_t *kernelFine = histograms.kernelFine.data();
+
+    std::vector<int> columns(numColumns);
+    for(int c=0; c<numColumns; c++) columns[c] = (std::min)((std::max)(x0 - radius + c, 0), width-1);
+
+    auto AddPixel = [&](int c, uint16_t bin, uint16_t delta)
+    {
+        columnCoarse[(size_t)c * coarseSize + bin / fineSize] += delta;
+        columnFine[(size_t)c * numBins + bin] += delta;
+    };
+
+    for(int y=0; y<height; y++)
+    {
+        if(y==0)
+        {
+            for(int dy=-radius; dy<=radius; dy++)
+            {
+                const uint16_t *row = bins + (size_t)(std::min)((std::max)(dy, 0), height-1) * width;
+                for(int c=0; c<numColumns; c++) AddPixel(c, row[columns[c]], 1);
+            }
+        }
+        else
+        {
+            int removedRow = (std::max)(y - radius - 1, 0);
+            int addedRow = (std::min)(y + radius, height-1);
+            if(removedRow != addedRow)
+            {
+                const uint16_t *removed = bins + (size_t)removedRow * width;
+                const uint16_t *added = bins + (size_t)addedRow * width;
+                for(int c=0; c<numColumns; c++)
+                {
+                    AddPixel(c, removed[columns[c]], (uint16_t)-1);
+                    AddPixel(c, added[columns[c]], 1);
+                }
+            }
+        }
+
+        std::fill(kernelCoarse, kernelCoarse + coarseSize, 0);
+        for(int c=0; c<diameter; c++) AddHistogram(kernelCoarse, columnCoarse + (size_t)c * coarseSize, coarseSize);
+        std::fill(histograms.lastUpdate.begin(), histograms.lastUpdate.end(), -2 * diameter);
+
+        glm::vec4 *outRow = output.Row(y);
+        int previousCoarse=0;
+        for(int x=x0; x<x1; x++)
+        {
+            //The window covers the columns [k, k + diameter - 1]
+            int k = x - x0;
+            if(k > 0) UpdateHistogram(kernelCoarse, columnCoarse + (size_t)(k + diameter-1) * coarseSize, columnCoarse + (size_t)(k-1) * coarseSize, coarseSize);
+
+            //sum is the number of values below the coarse bin. The search starts from the end closest to the previous median
+            int sum=0;
+            int coarse=0;
+            if(previousCoarse < coarseSize/2)
+            {
+                while(sum + kernelCoarse[coarse] <= rank)
+                {
+                    sum += kernelCoarse[coarse];
+                    coarse++;
+                }
+            }
+            else
+            {
+                sum = diameter * diameter;
+                coarse = coarseSize;
+                while(sum > rank)
+                {
+                    coarse--;
+                    sum -= kernelCoarse[coarse];
+                }
+            }
+            previousCoarse = coarse;
+
+            //Bring the fine bins of this coarse bin up to date, incrementally or from scratch when that is cheaper
+            uint16_t *fine = kernelFine + (size_t)coarse * fineSize;
+            int &last = histograms.lastUpdate[coarse];
+            if(2 * (k - last) > diameter)
+            {
+                std::fill(fine, fine + fineSize, 0);
+                for(int c=k; c<k+diameter; c++) AddHistogram(fine, columnFine + (size_t)c * numBins + (size_t)coarse * fineSize, fineSize);
+            }
+            else
+            {
+                for(int c=last+1; c<=k; c++)
+                {
+                    UpdateHistogram(fine, columnFine + (size_t)(c + diameter-1) * numBins + (size_t)coarse * fineSize, columnFine + (size_t)(c-1) * numBins + (size_t)coarse * fineSize, fineSize);
+                }
+            }
+            last = k;
+
+            int bin=0;
+            if(2 * (rank - sum) < kernelCoarse[coarse])
+            {
+                while(sum + fine[bin] <= rank)
+                {
+                    sum += fine[bin];
+                    bin++;
+                }
+            }
+            else
+            {
+                sum += kernelCoarse[coarse];
+                bin = fineSize;
+                while(sum > rank)
+                {
+                    bin--;
+                    sum -= fine[bin];
+                }
+            }
+            outRow[x][channel] = binValues[coarse * fineSize + bin];
+        }
+    }
+}
+
+static inline void Sort2(__m128 &a, __m128 &b)
+{
+    __m128 t = _mm_min_ps(a, b);
+    b = _mm_max_ps(a, b);
+    a = t;
+}
+
+//Median of 9 with 19 compare exchanges (Paeth), on all channels at once
+static void Median3x3(const ConstImageView &input, const ImageView &output)
+{
+    int width = input.width;
+    int height = input.height;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    ParallelForChunks(0, height, [&](int start, int end)
+    {
+        for(int y=start; y<end; y++)
+        {
+            const glm::vec4 *rows[3];
+            for(int i=0; i<3; i++) rows[i] = input.ClampedRow(y + i-1);
+            for(int x=0; x<width; x++)
+            {
+                int xs[3] = {(std::max)(x-1, 0), x, (std::min)(x+1, width-1)};
+                //Clamped to [0, 1] like the bins of the larger radii, so the range does not depend on the radius
+                __m128 p[9];
+                for(int j=0; j<3; j++)
+                    for(int i=0; i<3; i++)
+                        p[j*3+i] = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&rows[j][xs[i]].x), zero), one);
+
+                Sort2(p[1], p[2]); Sort2(p[4], p[5]); Sort2(p[7], p[8]);
+                Sort2(p[0], p[1]); Sort2(p[3], p[4]); Sort2(p[6], p[7]);
+                Sort2(p[1], p[2]); Sort2(p[4], p[5]); Sort2(p[7], p[8]);
+                Sort2(p[0], p[3]); Sort2(p[5], p[8]); Sort2(p[4], p[7]);
+                Sort2(p[3], p[6]); Sort2(p[1], p[4]); Sort2(p[2], p[5]);
+                Sort2(p[4], p[7]); Sort2(p[4], p[2]); Sort2(p[6], p[4]);
+                Sort2(p[4], p[2]);
+
+                glm::vec4 &result = output.At(x, y);
+                _mm_storeu_ps(&result.x, p[4]);
+                result.a = rows[1][x].a;
+            }
+        }
+    }, 8);
+}
+
+void MedianFilterSquare(const ConstImageView &input, const ImageView &output, int radius)
+{
+    if(input.Empty()) return;
+    int width = input.width;
+    int height = input.height;
+    radius = (std::min)((std::max)(radius, 0), MEDIAN_MAX_RADIUS);
+    if(radius==0)
+    {
+        for(int y=0; y<height; y++) std::copy(input.Row(y), input.Row(y) + width, output.Row(y));
+        return;
+    }
+    if(radius==1)
+    {
+        Median3x3(input, output);
+        return;
+    }
+
+    //The bins are packed, whatever the strides of the views
+    size_t count = (size_t)width * height;
+    ScratchBuffer<uint16_t> bins(3 * count);
+    ParallelForChunks(0, height, [&](int start, int end)
+    {
+        for(int y=start; y<end; y++)
+        {
+            const glm::vec4 *inRow = input.Row(y);
+            glm::vec4 *outRow = output.Row(y);
+            size_t rowStart = (size_t)y * width;
+            for(int x=0; x<width; x++)
+            {
+                for(int channel=0; channel<3; channel++) bins[channel * count + rowStart + x] = FloatToBin(inRow[x][channel]);
+                outRow[x].a = inRow[x].a;
+            }
+        }
+    }, 8);
+
+    //Wider strips for larger windows, so that building the window histogram at each row start is amortized
+    int stripWidth = (std::max)(64, 2 * (2 * radius + 1));
+    int numStrips = (width + stripWidth-1) / stripWidth;
+    ParallelForChunks(0, numStrips * 3, [&](int start, int end)
+    {
+        MedianHistograms histograms;
+        for(int task=start; task<end; task++)
+        {
+            int channel = task % 3;
+            int strip = task / 3;
+            int x0 = strip * stripWidth;
+            int x1 = (std::min)(x0 + stripWidth, width);
+            MedianStrip(bins.data() + channel * count, output, channel, radius, x0, x1, histograms);
+        }
+    });
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+
+#define MEDIAN_MAX_RADIUS 50
+
+//Median of each color channel over a (2 * radius + 1) square, borders clamped to edge. Alpha is copied.
+//Radius 1 uses a sorting network, larger radii the constant time algorithm of Perreault and Hebert (2007)
+//on values quantized to half floats, which is exact for 16 bit float textures.
+//Whatever the radius, color values are clamped to [0, 1] and NaN becomes 0.
+//Each channel is processed in parallel strips of columns.
+//The views can be crops or have padded rows, input and output must not overlap.
+void MedianFilterSquare(const ConstImageView &input, const ImageView &output, int radius);
+inline void MedianFilterSquare(const glm::vec4 *input, glm::vec4 *output, int width, int height, int radius)
+{
+    MedianFilterSquare(ConstImageView(input, width, height), ImageView(output, width, height), radius);
+}
@@ -0,0 +1,686 @@
+#include "Morphology.hpp"
+#include "DistanceTransform.hpp"
+#include "Parallel.hpp"
+#include "ImageBuffer.hpp"
+
+#include <xmmintrin.h>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <map>
+
+struct MinOperator
+{
+    __m128 operator()(__m128 a, __m128 b) const { return _mm_min_ps(a, b); }
+};
+
+struct MaxOperator
+{
+    __m128 operator()(__m128 a, __m128 b) const { return _mm_max_ps(a, b); }
+};
+
+//SSE registers from the scratch pool, which aligns them. Containers of __m128 drop its alignment attribute
+class RegisterBuffer
+{
+public:
+    explicit RegisterBuffer(size_t count) : storage(count) {}
+    __m128 *data() { return (__m128*)storage.data(); }
+    __m128 &operator[](size_t i) { return data()[i]; }
+
+private:
+    ScratchBuffer<glm::vec4> storage;
+};
+
+static void CopyImage(const ConstImageView &input, const ImageView &output)
+{
+    if(input.pixels == output.pixels && input.rowStride == output.rowStride) return;
+    ParallelForChunks(0, input.height, [&](int start, int end)
+    {
+        for(int y=start; y<end; y++) std::copy(input.Row(y), input.Row(y) + input.width, output.Row(y));
+    }, 32);
+}
+
+//One pass of the decomposition of a structuring element
+struct MorphologyStep
+{
+    enum class Type
+    {
+        Horizontal,
+        Vertical,
+        //Discrete line of slope |slope| <= 1 along x (or along y if !xMajor)
+        Sloped,
+        //Direct evaluation over a few offsets
+        Offsets
+    };
+    Type type;
+    //Window [-left, length-1-left] along the line
+    int length=1;
+    int left=0;
+    float slope=0;
+    bool xMajor=true;
+    std::vector<glm::ivec2> offsets;
+};
+
+static MorphologyStep LineStep(MorphologyStep::Type type, int length, bool reflect, float slope=0, bool xMajor=true)
+{
+    MorphologyStep step;
+    step.type = type;
+    step.length = length;
+    step.left = (length-1)/2;
+    if(reflect) step.left = length-1 - step.left;
+    step.slope = slope;
+    step.xMajor = xMajor;
+    return step;
+}
+
+static MorphologyStep OffsetsStep(int radius, bool diamond)
+{
+    MorphologyStep step;
+    step.type = MorphologyStep::Type::Offsets;
+    for(int y=-radius; y<=radius; y++)
+    {
+        for(int x=-radius; x<=radius; x++)
+        {
+            if(!diamond || std::abs(x) + std::abs(y) <= radius) step.offsets.push_back(glm::ivec2(x, y));
+        }
+    }
+    return step;
+}
+
+//van Herk / Gil-Werman : line[i] = op(line[i-left], ..., line[i-left+length-1]), ends clamped.
+//The padded line is cut in blocks of length, with a prefix and a suffix accumulation in each block,
+//then each window is covered by the suffix of one block and the prefix of the next.
+//padded and suffix must hold n+length-1 elements.
+template<typename Operator>
+static void LinePass(__m128 *line, int n, int length, int left, __m128 *padded, __m128 *suffix, Operator op)
+{
+    if(length <= 1 && left == 0) return;
+    int paddedLength = n + length - 1;
+    for(int i=0; i<paddedLength; i++) padded[i] = line[(std::min)((std::max)(i - left, 0), n-1)];
+
+    for(int start=0; start<paddedLength; start+=length)
+    {
+        int end = (std::min)(start + length, paddedLength);
+        suffix[end-1] = padded[end-1];
+        for(int i=end-2; i>=start; i--) suffix[i] = op(padded[i], suffix[i+1]);
+        for(int i=start+1; i<end; i++) padded[i] = op(padded[i], padded[i-1]);
+    }
+
+    for(int i=0; i<n; i++) line[i] = op(suffix[i], padded[i + length-1]);
+}
+
+template<typename Operator>
+static void HorizontalPass(const ConstImageView &input, const ImageView &output, int length, int left, Operator op)
+{
+    int width = input.width;
+    int height = input.height;
+    ParallelForChunks(0, height, [&](int start, int end)
+    {
+        RegisterBuffer line(width), padded(width + length), suffix(width + length);
+        for(int y=start; y<end; y++)
+        {
+            const glm::vec4 *inRow = input.Row(y);
+            glm::vec4 *outRow = output.Row(y);
+            for(int x=0; x<width; x++) line[x] = _mm_loadu_ps(&inRow[x].x);
+            LinePass(line.data(), width, length, left, padded.data(), suffix.data(), op);
+            for(int x=0; x<width; x++) _mm_storeu_ps(&outRow[x].x, line[x]);
+        }
+    }, 8);
+}
+
+//Same as LinePass on columns, but on strips of columns so that each step reads and writes contiguous rows
+template<typename Operator>
+static void VerticalPass(const ConstImageView &input, const ImageView &output, int length, int left, Operator op)
+{
+    if(length <= 1 && left == 0)
+    {
+        CopyImage(input, output);
+        return;
+    }
+
+    int width = input.width;
+    int height = input.height;
+    const int stripWidth = 32;
+    int numStrips = (width + stripWidth-1) / stripWidth;
+    int paddedLength = height + length - 1;
+    ParallelForChunks(0, numStrips, [&](int startStrip, int endStrip)
+    {
+        RegisterBuffer padded((size_t)paddedLength * stripWidth), suffix((size_t)paddedLength * stripWidth);
+        for(int strip=startStrip; strip<endStrip; strip++)
+        {
+            int x0 = strip * stripWidth;
+            int count = (std::min)(width - x0, stripWidth);
+
+            for(int i=0; i<paddedLength; i++)
+            {
+                const glm::vec4 *inRow = input.ClampedRow(i - left) + x0;
+                __m128 *row = padded.data() + (size_t)i * stripWidth;
+                for(int x=0; x<count; x++) row[x] = _mm_loadu_ps(&inRow[x].x);
+            }
+
+            for(int start=0; start<paddedLength; start+=length)
+            {
+                int end = (std::min)(start + length, paddedLength);
+                std::copy(padded.data() + (size_t)(end-1) * stripWidth, padded.data() + (size_t)end * stripWidth, suffix.data() + (size_t)(end-1) * stripWidth);
+                for(int i=end-2; i>=start; i--)
+                {
+                    __m128 *s = suffix.data() + (size_t)i * stripWidth;
+                    const __m128 *p = padded.data() + (size_t)i * stripWidth;
+                    for(int x=0; x<count; x++) s[x] = op(p[x], s[x + stripWidth]);
+                }
+                for(int i=start+1; i<end; i++)
+                {
+                    __m128 *p = padded.data() + (size_t)i * stripWidth;
+                    for(int x=0; x<count; x++) p[x] = op(p[x], p[x - stripWidth]);
+                }
+            }
+
+            for(int y=0; y<height; y++)
+            {
+                const __m128 *s = suffix.data() + (size_t)y * stripWidth;
+                const __m128 *p = padded.data() + (size_t)(y + length-1) * stripWidth;
+                glm::vec4 *outRow = output.Row(y) + x0;
+                for(int x=0; x<count; x++) _mm_storeu_ps(&outRow[x].x, op(s[x], p[x]));
+            }
+        }
+    });
+}
+
+//Lines of arbitrary slope (Soille, Breen, Jones 1996) : the image is covered by translated copies of a discrete line,
+//each one is gathered, filtered with LinePass and scattered back. The lines do not overlap so this can work in place.
+template<typename Operator>
+static void SlopedPass(const ConstImageView &input, const ImageView &output, int length, int left, float slope, bool xMajor, Operator op)
+{
+    int width = input.width;
+    int height = input.height;
+    int majorSize = xMajor ? width : height;
+    int minorSize = xMajor ? height : width;
+
+    //Minor coordinate of the line at each major coordinate, relative to the line start
+    std::vector<int> shift(majorSize);
+    for(int i=0; i<majorSize; i++) shift[i] = (int)std::floor(i * slope + 0.5f);
+    int minShift = (std::min)(shift.front(), shift.back());
+    int maxShift = (std::max)(shift.front(), shift.back());
+
+    //Each line starts at minor coordinate t and is kept where t + shift is inside the image
+    int tStart = -maxShift;
+    int tEnd = minorSize - minShift;
+    ParallelForChunks(tStart, tEnd, [&](int start, int end)
+    {
+        RegisterBuffer line(majorSize), padded(majorSize + length), suffix(majorSize + length);
+        std::vector<glm::ivec2> positions(majorSize);
+        for(int t=start; t<end; t++)
+        {
+            //shift is monotonic, so the part of the line inside the image is a single range
+            int first, last;
+            if(slope >= 0)
+            {
+                first = (int)(std::lower_bound(shift.begin(), shift.end(), -t) - shift.begin());
+                last = (int)(std::upper_bound(shift.begin(), shift.end(), minorSize-1-t) - shift.begin());
+            }
+            else
+            {
+                first = (int)(std::lower_bound(shift.begin(), shift.end(), minorSize-1-t, std::greater<int>()) - shift.begin());
+                last = (int)(std::upper_bound(shift.begin(), shift.end(), -t, std::greater<int>()) - shift.begin());
+            }
+            int n = last - first;
+            if(n <= 0) continue;
+
+            for(int i=0; i<n; i++)
+            {
+                int major = first + i;
+                int minor = t + shift[major];
+                positions[i] = xMajor ? glm::ivec2(major, minor) : glm::ivec2(minor, major);
+                line[i] = _mm_loadu_ps(&input.At(positions[i].x, positions[i].y).x);
+            }
+            LinePass(line.data(), n, length, left, padded.data(), suffix.data(), op);
+            for(int i=0; i<n; i++) _mm_storeu_ps(&output.At(positions[i].x, positions[i].y).x, line[i]);
+        }
+    }, 4);
+}
+
+template<typename Operator>
+static void OffsetsPass(const ConstImageView &input, const ImageView &output, const std::vector<glm::ivec2> &offsets, Operator op)
+{
+    int width = input.width;
+    int height = input.height;
+    ParallelForChunks(0, height, [&](int start, int end)
+    {
+        for(int y=start; y<end; y++)
+        {
+            for(int x=0; x<width; x++)
+            {
+                __m128 result = _mm_loadu_ps(&input.At(x, y).x);
+                for(size_t i=0; i<offsets.size(); i++)
+                {
+                    int sx = (std::min)((std::max)(x + offsets[i].x, 0), width-1);
+                    result = op(result, _mm_loadu_ps(&input.ClampedRow(y + offsets[i].y)[sx].x));
+                }
+                _mm_storeu_ps(&output.At(x, y).x, result);
+            }
+        }
+    }, 8);
+}
+
+//Any element as the union of its horizontal segments : each distinct segment is computed once with a horizontal pass,
+//then combined into the output for every row of the element where it appears. Input and output must be different.
+//reflect uses the element mirrored around its center.
+template<typename Operator>
+static void RowSegmentsPass(const ConstImageView &input, const ImageView &output, const std::vector<float> &mask, int size, bool reflect, Operator op)
+{
+    int width = input.width;
+    int height = input.height;
+    int center = (size-1)/2;
+    std::map<std::pair<int, int>, std::vector<int>> segments;
+    for(int y=0; y<size; y++)
+    {
+        int x=0;
+        while(x < size)
+        {
+            if(mask[y * size + x] <= 0) { x++; continue; }
+            int start = x;
+            while(x < size && mask[y * size + x] > 0) x++;
+            if(reflect) segments[std::make_pair(center - (x-1), center - start)].push_back(center - y);
+            else segments[std::make_pair(start - center, x-1 - center)].push_back(y - center);
+        }
+    }
+
+    if(segments.size()==0)
+    {
+        CopyImage(input, output);
+        return;
+    }
+
+    ScratchBuffer<glm::vec4> segmentData((size_t)width * height);
+    ImageView segmentView(segmentData.data(), width, height);
+    bool first=true;
+    for(auto &segment : segments)
+    {
+        int length = segment.first.second - segment.first.first + 1;
+        HorizontalPass(input, segmentView, length, -segment.first.first, op);
+
+        const std::vector<int> &rows = segment.second;
+        ParallelForChunks(0, height, [&](int start, int end)
+        {
+            for(int y=start; y<end; y++)
+            {
+                glm::vec4 *outRow = output.Row(y);
+                for(size_t i=0; i<rows.size(); i++)
+                {
+                    const glm::vec4 *segmentRow = segmentView.ClampedRow(y + rows[i]);
+                    if(first && i==0)
+                    {
+                        std::copy(segmentRow, segmentRow + width, outRow);
+                        continue;
+                    }
+                    for(int x=0; x<width; x++) _mm_storeu_ps(&outRow[x].x, op(_mm_loadu_ps(&outRow[x].x), _mm_loadu_ps(&segmentRow[x].x)));
+                }
+            }
+        }, 8);
+        first=false;
+    }
+}
+
+//Decomposes the element into line passes, returns false if it has to be computed from its mask.
+//reflect decomposes the element mirrored around its center.
+static bool Decompose(const StructuringElement &element, bool reflect, std::vector<MorphologyStep> &steps)
+{
+    int size = (std::max)(element.size, 1);
+    int radius = (size-1)/2;
+    switch (element.shape)
+    {
+    case StructuringElementShape::Square:
+    {
+        int side = (std::min)((std::max)(element.subSize, 1), size);
+        steps.push_back(LineStep(MorphologyStep::Type::Horizontal, side, reflect));
+        steps.push_back(LineStep(MorphologyStep::Type::Vertical, side, reflect));
+        return true;
+    }
+    case StructuringElementShape::Line:
+    {
+        float angle = glm::radians(element.rotation);
+        float c = std::cos(angle);
+        float s = std::sin(angle);
+        if(std::abs(c) >= std::abs(s))
+        {
+            int length = (int)std::floor((size-1) * std::abs(c) + 0.5f) + 1;
+            float slope = s / c;
+            if(std::abs(slope) < 1e-6f) steps.push_back(LineStep(MorphologyStep::Type::Horizontal, length, reflect));
+            else steps.push_back(LineStep(MorphologyStep::Type::Sloped, length, reflect, slope, true));
+        }
+        else
+        {
+            int length = (int)std::floor((size-1) * std::abs(s) + 0.5f) + 1;
+            float slope = c / s;
+            if(std::abs(slope) < 1e-6f) steps.push_back(LineStep(MorphologyStep::Type::Vertical, length, reflect));
+            else steps.push_back(LineStep(MorphologyStep::Type::Sloped, length, reflect, slope, false));
+        }
+        return true;
+    }
+    case StructuringElementShape::Diamond:
+    {
+        //The two diagonals of length a make a diamond of radius a with one pixel out of two,
+        //the plus (a = radius-1) or the diamond of radius 2 (a = radius-2) fills it up to the full radius
+        if(radius==0) return true;
+        if(radius==1)
+        {
+            steps.push_back(OffsetsStep(1, true));
+            return true;
+        }
+        int a = ((radius-1)%2==0) ? radius-1 : radius-2;
+        steps.push_back(LineStep(MorphologyStep::Type::Sloped, a+1, reflect, 1, true));
+        steps.push_back(LineStep(MorphologyStep::Type::Sloped, a+1, reflect, -1, true));
+        steps.push_back(OffsetsStep(radius - a, true));
+        return true;
+    }
+    case StructuringElementShape::Octagon:
+    {
+        //Square of side s dilated by the diagonals of length b, with s ~ b * sqrt(2) for a regular octagon.
+        //b is even so the diagonals are centered, and the square fills the holes between them.
+        int b = (int)((2 * radius + 1) / (2.0f + std::sqrt(2.0f)));
+        b -= b%2;
+        while(b > 0 && 2 * (radius - b) + 1 < 3) b -= 2;
+        int side = 2 * (radius - b) + 1;
+        steps.push_back(LineStep(MorphologyStep::Type::Horizontal, side, reflect));
+        steps.push_back(LineStep(MorphologyStep::Type::Vertical, side, reflect));
+        if(b > 0)
+        {
+            steps.push_back(LineStep(MorphologyStep::Type::Sloped, b+1, reflect, 1, true));
+            steps.push_back(LineStep(MorphologyStep::Type::Sloped, b+1, reflect, -1, true));
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+static void BuildCircleMask(int size, std::vector<float> &mask)
+{
+    int center = (size-1)/2;
+    float radius = (size-1) * 0.5f;
+    mask.assign(size * size, 0);
+    for(int y=0; y<size; y++)
+    {
+        for(int x=0; x<size; x++)
+        {
+            float dx = (float)(x - center);
+            float dy = (float)(y - center);
+            if(dx * dx + dy * dy <= radius * radius) mask[y * size + x] = 1;
+        }
+    }
+}
+
+template<typename Operator>
+static void Apply(ConstImageView input, ImageView output, const StructuringElement &element, bool reflect, Operator op)
+{
+    int width = input.width;
+    int height = input.height;
+    bool inPlace = input.pixels == output.pixels;
+
+    std::vector<MorphologyStep> steps;
+    if(!Decompose(element, reflect, steps))
+    {
+        int size = (std::max)(element.size, 1);
+        std::vector<float> mask;
+        if(element.shape == StructuringElementShape::Custom && (int)element.mask.size() == size * size) mask = element.mask;
+        else BuildCircleMask(size, mask);
+
+        ScratchBuffer<glm::vec4> inputCopy;
+        if(inPlace)
+        {
+            inputCopy.Resize((size_t)width * height);
+            ImageView copyView(inputCopy.data(), width, height);
+            CopyImage(input, copyView);
+            input = copyView;
+        }
+        RowSegmentsPass(input, output, mask, size, reflect, op);
+        return;
+    }
+
+    if(steps.size()==0) CopyImage(input, output);
+
+    //Sloped lines stop at the image borders instead of reading clamped pixels :
+    //they run on a copy of the image with borders extended by the radius of the whole element, then cropped
+    int margin=0;
+    bool sloped=false;
+    for(size_t i=0; i<steps.size(); i++)
+    {
+        const MorphologyStep &step = steps[i];
+        sloped |= step.type == MorphologyStep::Type::Sloped;
+        margin += (std::max)(step.left, step.length-1 - step.left);
+        for(size_t j=0; j<step.offsets.size(); j++) margin = (std::max)(margin, (std::max)(std::abs(step.offsets[j].x), std::abs(step.offsets[j].y)));
+    }
+    ScratchBuffer<glm::vec4> paddedData;
+    ImageView finalOutput = output;
+    if(sloped)
+    {
+        int paddedWidth = width + 2 * margin;
+        int paddedHeight = height + 2 * margin;
+        paddedData.Resize((size_t)paddedWidth * paddedHeight);
+        ImageView paddedView(paddedData.data(), paddedWidth, paddedHeight);
+        ParallelForChunks(0, paddedHeight, [&](int start, int end)
+        {
+            for(int y=start; y<end; y++)
+            {
+                const glm::vec4 *inRow = input.ClampedRow(y - margin);
+                glm::vec4 *outRow = paddedView.Row(y);
+                for(int x=0; x<paddedWidth; x++) outRow[x] = inRow[(std::min)((std::max)(x - margin, 0), width-1)];
+            }
+        }, 8);
+        input = output = paddedView;
+    }
+
+    ScratchBuffer<glm::vec4> tmpData;
+    ConstImageView source = input;
+    for(size_t i=0; i<steps.size(); i++)
+    {
+        const MorphologyStep &step = steps[i];
+        switch (step.type)
+        {
+        case MorphologyStep::Type::Horizontal:
+            HorizontalPass(source, output, step.length, step.left, op);
+            break;
+        case MorphologyStep::Type::Vertical:
+            VerticalPass(source, output, step.length, step.left, op);
+            break;
+        case MorphologyStep::Type::Sloped:
+            CopyImage(source, output);
+            SlopedPass(output, output, step.length, step.left, step.slope, step.xMajor, op);
+            break;
+        case MorphologyStep::Type::Offsets:
+            if(source.pixels == output.pixels)
+            {
+                tmpData.Resize(output.NumPixels());
+                ImageView tmpView(tmpData.data(), output.width, output.height);
+                CopyImage(output, tmpView);
+                source = tmpView;
+            }
+            OffsetsPass(source, output, step.offsets, op);
+            break;
+        }
+        source = output;
+    }
+
+    if(sloped) CopyImage(ConstImageView(output).Crop(margin, margin, margin + width, margin + height), finalOutput);
+}
+
+//Discs on binary images : a pixel is eroded if there is background closer than the radius, dilated if there is foreground.
+//Above this radius the distance transform is cheaper than the segments of the disc
+static const float distanceTransformMinRadius = 4;
+
+static void BinaryDisc(const ConstImageView &input, const ImageView &output, int size, bool erode)
+{
+    int width = input.width;
+    int height = input.height;
+    ScratchBuffer<uint8_t> features((size_t)width * height);
+    ParallelForChunks(0, height, [&](int start, int end)
+    {
+        for(int y=start; y<end; y++)
+        {
+            const glm::vec4 *inRow = input.Row(y);
+            uint8_t *featureRow = features.data() + (size_t)y * width;
+            for(int x=0; x<width; x++) featureRow[x] = erode ? (inRow[x].r <= 0) : (inRow[x].r > 0);
+        }
+    }, 8);
+
+    ScratchBuffer<float> squaredDistances((size_t)width * height);
+    SquaredDistanceTransform(features.data(), GrayImageView(squaredDistances.data(), width, height));
+
+    float radius = (size-1) * 0.5f;
+    float squaredRadius = radius * radius;
+    ParallelForChunks(0, height, [&](int start, int end)
+    {
+        for(int y=start; y<end; y++)
+        {
+            const glm::vec4 *inRow = input.Row(y);
+            glm::vec4 *outRow = output.Row(y);
+            const float *distanceRow = squaredDistances.data() + (size_t)y * width;
+            for(int x=0; x<width; x++)
+            {
+                float value = erode ? (distanceRow[x] > squaredRadius ? 1.0f : 0.0f) : (distanceRow[x] <= squaredRadius ? 1.0f : 0.0f);
+                outRow[x] = glm::vec4(value, value, value, inRow[x].a);
+            }
+        }
+    }, 8);
+}
+
+static bool UseBinaryDisc(const StructuringElement &element, bool binary)
+{
+    return binary && element.shape == StructuringElementShape::Circle && (element.size-1) * 0.5f >= distanceTransformMinRadius;
+}
+
+static void Erode(const ConstImageView &input, const ImageView &output, const StructuringElement &element, bool binary, bool reflect)
+{
+    if(input.Empty()) return;
+    if(UseBinaryDisc(element, binary)) BinaryDisc(input, output, element.size, true);
+    else Apply(input, output, element, reflect, MinOperator());
+}
+
+static void Dilate(const ConstImageView &input, const ImageView &output, const StructuringElement &element, bool binary, bool reflect)
+{
+    if(input.Empty()) return;
+    if(UseBinaryDisc(element, binary)) BinaryDisc(input, output, element.size, false);
+    else Apply(input, output, element, reflect, MaxOperator());
+}
+
+void MorphologyErode(const ConstImageView &input, const ImageView &output, const StructuringElement &element, bool binary)
+{
+    Erode(input, output, element, binary, false);
+}
+
+void MorphologyDilate(const ConstImageView &input, const ImageView &output, const StructuringElement &element, bool binary)
+{
+    Dilate(input, output, element, binary, false);
+}
+
+void ApplyMorphology(MorphologyOperation operation, const ConstImageView &input, const ImageView &output, const StructuringElement &element, bool binary)
+{
+    if(input.Empty()) return;
+    int width = input.width;
+    int height = input.height;
+    size_t count = (size_t)width * height;
+
+    if(operation == MorphologyOperation::Erode)
+    {
+        Erode(input, output, element, binary, false);
+        return;
+    }
+    if(operation == MorphologyOperation::Dilate)
+    {
+        Dilate(input, output, element, binary, false);
+        return;
+    }
+
+    //Compound operations go through an intermediate image.
+    //Openings and closings dilate by the reflected element, so that they are idempotent for asymmetric ones
+    ScratchBuffer<glm::vec4> tmpData(count);
+    ImageView tmpView(tmpData.data(), width, height);
+    switch (operation)
+    {
+    case MorphologyOperation::Open:
+    case MorphologyOperation::TopHat:
+        Erode(input, tmpView, element, binary, false);
+        Dilate(tmpView, tmpView, element, binary, true);
+        break;
+    case MorphologyOperation::Close:
+    case MorphologyOperation::BlackTopHat:
+        Dilate(input, tmpView, element, binary, true);
+        Erode(tmpView, tmpView, element, binary, false);
+        break;
+    case MorphologyOperation::Gradient:
+    {
+        ScratchBuffer<glm::vec4> erodedData(count);
+        Erode(input, ImageView(erodedData.data(), width, height), element, binary, false);
+        Dilate(input, tmpView, element, binary, false);
+        for(size_t i=0; i<count; i++) tmpData[i] -= erodedData[i];
+        break;
+    }
+    default:
+        break;
+    }
+
+    ParallelForChunks(0, height, [&](int start, int end)
+    {
+        for(int y=start; y<end; y++)
+        {
+            const glm::vec4 *inRow = input.Row(y);
+            const glm::vec4 *tmpRow = tmpView.Row(y);
+            glm::vec4 *outRow = output.Row(y);
+            for(int x=0; x<width; x++)
+            {
+                if(operation == MorphologyOperation::TopHat) outRow[x] = glm::vec4(glm::vec3(inRow[x] - tmpRow[x]), inRow[x].a);
+                else if(operation == MorphologyOperation::BlackTopHat) outRow[x] = glm::vec4(glm::vec3(tmpRow[x] - inRow[x]), inRow[x].a);
+                else if(operation == MorphologyOperation::Gradient) outRow[x] = glm::vec4(glm::vec3(tmpRow[x]), inRow[x].a);
+                else outRow[x] = tmpRow[x];
+            }
+        }
+    }, 8);
+}
+
+void MinMaxFilterSquare(const ConstImageView &input, const ImageView &output, int size, bool doMin)
+{
+    if(input.Empty()) return;
+    StructuringElement element;
+    element.shape = StructuringElementShape::Square;
+    element.size = element.subSize = (std::max)(size, 1);
+    if(doMin) Apply(input, output, element, false, MinOperator());
+    else Apply(input, output, element, false, MaxOperator());
+}
+
+void StructuringElement::BuildMask()
+{
+    size = (std::max)(size, 1);
+    if(shape == StructuringElementShape::Custom)
+    {
+        if((int)mask.size() != size * size)
+        {
+            mask.assign(size * size, 0);
+            mask[((size-1)/2) * size + (size-1)/2] = 1;
+        }
+        return;
+    }
+    if(shape == StructuringElementShape::Circle)
+    {
+        BuildCircleMask(size, mask);
+        return;
+    }
+
+    //Dilates an impulse : the output is 1 at center - offset for each offset of the element.
+    //The image is large enough for the borders not to matter.
+    int imageSize = 2 * size + 1;
+    std::vector<glm::vec4> impulse(imageSize * imageSize, glm::vec4(0));
+    impulse[size * imageSize + size] = glm::vec4(1);
+    std::vector<glm::vec4> result(imageSize * imageSize);
+    Apply(ConstImageView(impulse.data(), imageSize, imageSize), ImageView(result.data(), imageSize, imageSize), *this, false, MaxOperator());
+
+    int center = (size-1)/2;
+    mask.assign(size * size, 0);
+    for(int y=0; y<size; y++)
+    {
+        for(int x=0; x<size; x++)
+        {
+            mask[y * size + x] = result[(size - (y - center)) * imageSize + size - (x - center)].r;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+enum class StructuringElementShape
+{
+    Circle=0,
+    Diamond=1,
+    Line=2,
+    Octagon=3,
+    Square=4,
+    Custom=5
+};
+
+enum class MorphologyOperation
+{
+    Erode=0,
+    Dilate=1,
+    Open=2,
+    Close=3,
+    TopHat=4,
+    BlackTopHat=5,
+    Gradient=6
+};
+
+struct StructuringElement
+{
+    //Fills mask with the pixels covered by the element (not for Custom, where the mask is the input)
+    void BuildMask();
+
+    StructuringElementShape shape = StructuringElementShape::Circle;
+    //Extent of the element in pixels
+    int size=3;
+    //Side of the square
+    int subSize=3;
+    //Angle of the line, in degrees
+    float rotation=0;
+    //size * size, mask[y * size + x] > 0 where the element covers the pixel. Centered on (size-1)/2
+    std::vector<float> mask;
+};
+
+//Erosion (minimum) and dilation (maximum) of every channel over the structuring element, borders clamped to edge.
+//Squares and lines are computed with van Herk / Gil-Werman 1D passes (3 comparisons per pixel whatever the length),
+//diamonds and octagons as sequences of lines, other shapes as unions of horizontal segments.
+//If binary is set the input must be 0 or 1 in all channels, and large discs are computed by thresholding a distance transform.
+//The views can be crops or have padded rows, output is either input itself or does not overlap it.
+void MorphologyErode(const ConstImageView &input, const ImageView &output, const StructuringElement &element, bool binary=false);
+void MorphologyDilate(const ConstImageView &input, const ImageView &output, const StructuringElement &element, bool binary=false);
+inline void MorphologyErode(const glm::vec4 *input, glm::vec4 *output, int width, int height, const StructuringElement &element, bool binary=false)
+{
+    MorphologyErode(ConstImageView(input, width, height), ImageView(output, width, height), element, binary);
+}
+inline void MorphologyDilate(const glm::vec4 *input, glm::vec4 *output, int width, int height, const StructuringElement &element, bool binary=false)
+{
+    MorphologyDilate(ConstImageView(input, width, height), ImageView(output, width, height), element, binary);
+}
+
+//Openings, closings, top hats and gradient built on erosion and dilation.
+void ApplyMorphology(MorphologyOperation operation, const ConstImageView &input, const ImageView &output, const StructuringElement &element, bool binary=false);
+inline void ApplyMorphology(MorphologyOperation operation, const glm::vec4 *input, glm::vec4 *output, int width, int height, const StructuringElement &element, bool binary=false)
+{
+    ApplyMorphology(operation, ConstImageView(input, width, height), ImageView(output, width, height), element, binary);
+}
+
+//Minimum or maximum over a size x size square
+void MinMaxFilterSquare(const ConstImageView &input, const ImageView &output, int size, bool doMin);
+inline void MinMaxFilterSquare(const glm::vec4 *input, glm::vec4 *output, int width, int height, int size, bool doMin)
+{
+    MinMaxFilterSquare(ConstImageView(input, width, height), ImageView(output, width, height), size, doMin);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+inline int GetNumThreads()
+{
+    static int numThreads = (std::max)(1, (int)std::thread::hardware_concurrency());
+    return numThreads;
+}
+
+//Splits [start, end) in contiguous chunks and runs function(chunkStart, chunkEnd) on each of them in parallel.
+//The calling thread processes the first chunk.
+template<typename Function>
+void ParallelForChunks(int start, int end, Function function, int minChunkSize=1)
+{
+    int count = end - start;
+    if(count <= 0) return;
+
+    int numChunks = (std::min)(GetNumThreads(), (count + minChunkSize-1) / minChunkSize);
+    if(numChunks <= 1)
+    {
+        function(start, end);
+        return;
+    }
+
+    int chunkSize = (count + numChunks-1) / numChunks;
+    std::vector<std::thread> threads;
+    threads.reserve(numChunks-1);
+    for(int i=1; i<numChunks; i++)
+    {
+        int chunkStart = start + i * chunkSize;
+        int chunkEnd = (std::min)(end, chunkStart + chunkSize);
+        if(chunkStart >= chunkEnd) break;
+        threads.emplace_back([&function, chunkStart, chunkEnd]()
+        {
+            function(chunkStart, chunkEnd);
+        });
+    }
+    function(start, (std::min)(end, start + chunkSize));
+
+    for(size_t i=0; i<threads.size(); i++)
+    {
+        threads[i].join();
+    }
+}
+
+//Runs function(i) for each i in [start, end) in parallel.
+template<typename Function>
+void ParallelFor(int start, int end, Function function, int minChunkSize=1)
+{
+    ParallelForChunks(start, end, [&function](int chunkStart, int chunkEnd)
+    {
+        for(int i=chunkStart; i<chunkEnd; i++) function(i);
+    }, minChunkSize);
+}
@@ -0,0 +1,250 @@
+#include "Pyramid.hpp"
+#include "Parallel.hpp"
+
+#include <xmmintrin.h>
+#include <algorithm>
+
+static inline __m128 Load(const glm::vec4 &v) { return _mm_loadu_ps(&v.x); }
+
+void PyramidReduce(const ConstImageView &input, const ImageView &output, const PyramidRegion &region)
+{
+    if(region.Empty()) return;
+    int width = input.width;
+    //Input columns read by the region
+    int firstColumn = (std::max)(2*region.x0 - 2, 0);
+    int lastColumn = (std::min)(2*region.x1, width-1);
+    const __m128 one = _mm_set1_ps(1.0f / 16.0f);
+    const __m128 four = _mm_set1_ps(4.0f / 16.0f);
+    const __m128 six = _mm_set1_ps(6.0f / 16.0f);
+    ParallelForChunks(region.y0, region.y1, [&](int startRow, int endRow)
+    {
+        //Vertically blurred input row, padded by 2 pixels on each side
+        std::vector<glm::vec4> row(width + 4);
+        for(int y=startRow; y<endRow; y++)
+        {
+            const glm::vec4 *rows[5];
+            for(int i=0; i<5; i++) rows[i] = input.ClampedRow(2*y + i - 2);
+            for(int x=firstColumn; x<=lastColumn; x++)
+            {
+                __m128 sum = _mm_mul_ps(_mm_add_ps(Load(rows[0][x]), Load(rows[4][x])), one);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_add_ps(Load(rows[1][x]), Load(rows[3][x])), four));
+                sum = _mm_add_ps(sum, _mm_mul_ps(Load(rows[2][x]), six));
+                _mm_storeu_ps(&row[x+2].x, sum);
+            }
+            if(firstColumn==0) row[0] = row[1] = row[2];
+            if(lastColumn==width-1) row[width+2] = row[width+3] = row[width+1];
+
+            glm::vec4 *outRow = output.Row(y);
+            for(int x=region.x0; x<region.x1; x++)
+            {
+                const glm::vec4 *center = row.data() + 2*x + 2;
+                __m128 sum = _mm_mul_ps(_mm_add_ps(Load(center[-2]), Load(center[2])), one);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_add_ps(Load(center[-1]), Load(center[1])), four));
+                sum = _mm_add_ps(sum, _mm_mul_ps(Load(center[0]), six));
+                _mm_storeu_ps(&outRow[x].x, sum);
+            }
+        }
+    }, 8);
+}
+
+void PyramidExpand(const ConstImageView &input, const ImageView &output, float weight, bool accumulate, const PyramidRegion &region)
+{
+    if(region.Empty()) return;
+    int inputWidth = input.width;
+    //Input columns read by the region
+    int firstColumn = (std::max)(region.x0/2 - 1, 0);
+    int lastColumn = (std::min)((region.x1-1)/2 + 1, inputWidth-1);
+    //Only every other output pixel is an input sample, so the kernel splits into [1 6 1] / 8 on them and [4 4] / 8 between them
+    const __m128 one = _mm_set1_ps(1.0f / 8.0f);
+    const __m128 six = _mm_set1_ps(6.0f / 8.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 outputWeight = _mm_set1_ps(weight);
+    ParallelForChunks(region.y0, region.y1, [&](int startRow, int endRow)
+    {
+        //Vertically interpolated input row, padded by 1 pixel on each side
+        std::vector<glm::vec4> row(inputWidth + 2);
+        for(int y=startRow; y<endRow; y++)
+        {
+            int k = y/2;
+            const glm::vec4 *above = input.ClampedRow(k-1);
+            const glm::vec4 *center = input.Row(k);
+            const glm::vec4 *below = input.ClampedRow(k+1);
+            if(y % 2 == 0)
+            {
+                for(int x=firstColumn; x<=lastColumn; x++)
+                {
+                    __m128 sum = _mm_mul_ps(_mm_add_ps(Load(above[x]), Load(below[x])), one);
+                    _mm_storeu_ps(&row[x+1].x, _mm_add_ps(sum, _mm_mul_ps(Load(center[x]), six)));
+                }
+            }
+            else
+            {
+                for(int x=firstColumn; x<=lastColumn; x++) _mm_storeu_ps(&row[x+1].x, _mm_mul_ps(_mm_add_ps(Load(center[x]), Load(below[x])), half));
+            }
+            if(firstColumn==0) row[0] = row[1];
+            if(lastColumn==inputWidth-1) row[inputWidth+1] = row[inputWidth];
+
+            glm::vec4 *outRow = output.Row(y);
+            for(int x=region.x0; x<region.x1; x++)
+            {
+                const glm::vec4 *sample = row.data() + x/2 + 1;
+                __m128 value;
+                if(x % 2 == 0) value = _mm_add_ps(_mm_mul_ps(_mm_add_ps(Load(sample[-1]), Load(sample[1])), one), _mm_mul_ps(Load(sample[0]), six));
+                else value = _mm_mul_ps(_mm_add_ps(Load(sample[0]), Load(sample[1])), half);
+                value = _mm_mul_ps(value, outputWeight);
+                if(accumulate) value = _mm_add_ps(value, Load(outRow[x]));
+                _mm_storeu_ps(&outRow[x].x, value);
+            }
+        }
+    }, 8);
+}
+
+static PyramidRegion Union(const PyramidRegion &a, const PyramidRegion &b)
+{
+    if(a.Empty()) return b;
+    if(b.Empty()) return a;
+    PyramidRegion result;
+    result.x0 = (std::min)(a.x0, b.x0);
+    result.y0 = (std::min)(a.y0, b.y0);
+    result.x1 = (std::max)(a.x1, b.x1);
+    result.y1 = (std::max)(a.y1, b.y1);
+    return result;
+}
+
+static PyramidRegion Clamp(PyramidRegion region, int width, int height)
+{
+    region.x0 = (std::max)(region.x0, 0);
+    region.y0 = (std::max)(region.y0, 0);
+    region.x1 = (std::min)(region.x1, width);
+    region.y1 = (std::min)(region.y1, height);
+    return region;
+}
+
+//Pixels of the reduced level that read the changed pixels [x0, x1) of the level below, through taps 2x-2 to 2x+2
+static PyramidRegion ReducedRegion(const PyramidRegion &region, int width, int height)
+{
+    if(region.Empty()) return PyramidRegion();
+    PyramidRegion result;
+    result.x0 = (std::max)(region.x0 - 1, 0) / 2;
+    result.y0 = (std::max)(region.y0 - 1, 0) / 2;
+    result.x1 = (region.x1 + 1) / 2 + 1;
+    result.y1 = (region.y1 + 1) / 2 + 1;
+    return Clamp(result, width, height);
+}
+
+//Pixels of the expanded level that read the changed pixels [x0, x1) of the level above, through samples x/2-1 to x/2+1
+static PyramidRegion ExpandedRegion(const PyramidRegion &region, int width, int height)
+{
+    if(region.Empty()) return PyramidRegion();
+    PyramidRegion result;
+    result.x0 = 2 * region.x0 - 2;
+    result.y0 = 2 * region.y0 - 2;
+    result.x1 = 2 * region.x1 + 2;
+    result.y1 = 2 * region.y1 + 2;
+    return Clamp(result, width, height);
+}
+
+static void CopyRegion(const ConstImageView &input, const ImageView &output, const PyramidRegion &region)
+{
+    for(int y=region.y0; y<region.y1; y++)
+    {
+        std::copy(input.Row(y) + region.x0, input.Row(y) + region.x1, output.Row(y) + region.x0);
+    }
+}
+
+void ImagePyramid::Allocate(int width, int height, int numLevels)
+{
+    int levels=1;
+    for(int w=width, h=height; levels<numLevels && (w > 1 || h > 1); levels++)
+    {
+        w = (w+1)/2;
+        h = (h+1)/2;
+    }
+    //Same layout as the previous build, the arena is reused as is
+    if(this->numLevels==levels && widths[0]==width && heights[0]==height) return;
+
+    this->numLevels = levels;
+    widths.resize(levels);
+    heights.resize(levels);
+    offsets.resize(levels);
+    size_t size=0;
+    for(int level=0; level<levels; level++)
+    {
+        widths[level] = width;
+        heights[level] = height;
+        offsets[level] = size;
+        size += (size_t)width * height;
+        width = (width+1)/2;
+        height = (height+1)/2;
+    }
+    arena.resize(size);
+}
+
+void ImagePyramid::BuildGaussian(const ConstImageView &input, int numLevels)
+{
+    Allocate(input.width, input.height, numLevels);
+    PyramidRegion whole;
+    whole.x1 = input.width;
+    whole.y1 = input.height;
+    CopyRegion(input, LevelView(0), whole);
+    for(int level=1; level<this->numLevels; level++)
+    {
+        PyramidReduce(Level(level-1), widths[level-1], heights[level-1], Level(level));
+    }
+}
+
+void ImagePyramid::BuildLaplacian(const ConstImageView &input, int numLevels)
+{
+    BuildGaussian(input, numLevels);
+    //Finest first, so that G(i+1) is still intact when level i is computed
+    for(int level=0; level<this->numLevels-1; level++)
+    {
+        PyramidExpand(Level(level+1), widths[level], heights[level], Level(level), -1, true);
+    }
+}
+
+std::vector<PyramidRegion> ImagePyramid::UpdateGaussian(const ConstImageView &input, const PyramidRegion &region)
+{
+    std::vector<PyramidRegion> regions(numLevels);
+    regions[0] = Clamp(region, widths[0], heights[0]);
+    CopyRegion(input, LevelView(0), regions[0]);
+    for(int level=1; level<numLevels; level++)
+    {
+        regions[level] = ReducedRegion(regions[level-1], widths[level], heights[level]);
+        PyramidReduce(Level(level-1), widths[level-1], heights[level-1], Level(level), regions[level]);
+    }
+    return regions;
+}
+
+void ImagePyramid::Collapse(const ImageView &output)
+{
+    std::vector<PyramidRegion> regions(numLevels);
+    for(int level=0; level<numLevels; level++)
+    {
+        regions[level].x1 = widths[level];
+        regions[level].y1 = heights[level];
+    }
+    Collapse(output, regions);
+}
+
+void ImagePyramid::Collapse(const ImageView &output, const std::vector<PyramidRegion> &regions)
+{
+    //A level changes where its band changed, and where it reads the changed pixels of the level above
+    std::vector<PyramidRegion> dirty(regions);
+    for(int level=numLevels-2; level>=0; level--)
+    {
+        dirty[level] = Union(dirty[level], ExpandedRegion(dirty[level+1], widths[level], heights[level]));
+    }
+
+    //Coarse levels are collapsed in a copy so that the pyramid stays usable
+    if(numLevels > 1) collapsed.resize(arena.size() - offsets[1]);
+    auto CollapsedLevel = [&](int level)
+    {
+        return (level==0) ? output : ImageView(collapsed.data() + (offsets[level] - offsets[1]), widths[level], heights[level]);
+    };
+    for(int level=numLevels-1; level>=0; level--)
+    {
+        CopyRegion(LevelView(level), CollapsedLevel(level), dirty[level]);
+        if(level < numLevels-1) PyramidExpand(CollapsedLevel(level+1), CollapsedLevel(level), 1, true, dirty[level]);
+    }
+}
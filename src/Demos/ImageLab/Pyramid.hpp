@@ -0,0 +1,82 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+//Half open rectangle of pixels [x0, x1) * [y0, y1)
+struct PyramidRegion
+{
+    int x0=0, y0=0, x1=0, y1=0;
+    bool Empty() const { return x0 >= x1 || y0 >= y1; }
+};
+
+//Blurs with the 5 taps binomial kernel [1 4 6 4 1] / 16 and keeps every other pixel, in one pass.
+//output is (width+1)/2 * (height+1)/2, borders are clamped. Only computes the output pixels inside region.
+//The views can be crops or have padded rows, input and output must not overlap.
+void PyramidReduce(const ConstImageView &input, const ImageView &output, const PyramidRegion &region);
+inline void PyramidReduce(const glm::vec4 *input, int width, int height, glm::vec4 *output, const PyramidRegion &region)
+{
+    PyramidReduce(ConstImageView(input, width, height), ImageView(output, (width+1)/2, (height+1)/2), region);
+}
+inline void PyramidReduce(const glm::vec4 *input, int width, int height, glm::vec4 *output)
+{
+    PyramidRegion region;
+    region.x1 = (width+1)/2;
+    region.y1 = (height+1)/2;
+    PyramidReduce(input, width, height, output, region);
+}
+
+//Inverse of PyramidReduce : upsamples input to the width * height of output and interpolates with the same kernel, in one pass.
+//input is (width+1)/2 * (height+1)/2. Writes output = weight * expanded, or adds it to output when accumulate is set.
+//Only computes the output pixels inside region.
+void PyramidExpand(const ConstImageView &input, const ImageView &output, float weight, bool accumulate, const PyramidRegion &region);
+inline void PyramidExpand(const glm::vec4 *input, int width, int height, glm::vec4 *output, float weight, bool accumulate, const PyramidRegion &region)
+{
+    PyramidExpand(ConstImageView(input, (width+1)/2, (height+1)/2), ImageView(output, width, height), weight, accumulate, region);
+}
+inline void PyramidExpand(const glm::vec4 *input, int width, int height, glm::vec4 *output, float weight=1, bool accumulate=false)
+{
+    PyramidRegion region;
+    region.x1 = width;
+    region.y1 = height;
+    PyramidExpand(input, width, height, output, weight, accumulate, region);
+}
+
+//Gaussian or Laplacian pyramid (Burt - Adelson). All the levels live one after the other in a single buffer,
+//which is kept from one build to the next as long as the size and the number of levels do not change.
+struct ImagePyramid
+{
+    //Number of levels is limited so that the smallest one is at least 1 pixel wide
+    void Allocate(int width, int height, int numLevels);
+
+    //The input and output views can be crops or have padded rows, the levels are packed
+    void BuildGaussian(const ConstImageView &input, int numLevels);
+    void BuildGaussian(const glm::vec4 *input, int width, int height, int numLevels) { BuildGaussian(ConstImageView(input, width, height), numLevels); }
+    //Level i is G(i) - Expand(G(i+1)), the last level is the smallest gaussian level
+    void BuildLaplacian(const ConstImageView &input, int numLevels);
+    void BuildLaplacian(const glm::vec4 *input, int width, int height, int numLevels) { BuildLaplacian(ConstImageView(input, width, height), numLevels); }
+    //Rebuilds the gaussian pyramid after the pixels of input inside region changed, input being the whole image.
+    //Returns the pixels that changed at each level.
+    std::vector<PyramidRegion> UpdateGaussian(const ConstImageView &input, const PyramidRegion &region);
+    std::vector<PyramidRegion> UpdateGaussian(const glm::vec4 *input, const PyramidRegion &region) { return UpdateGaussian(ConstImageView(input, widths[0], heights[0]), region); }
+
+    //Sums a laplacian pyramid back into a width * height image
+    void Collapse(const ImageView &output);
+    void Collapse(glm::vec4 *output) { Collapse(ImageView(output, widths[0], heights[0])); }
+    //Same, when only the pixels in regions[level] changed since the last collapse into output
+    void Collapse(const ImageView &output, const std::vector<PyramidRegion> &regions);
+    void Collapse(glm::vec4 *output, const std::vector<PyramidRegion> &regions) { Collapse(ImageView(output, widths[0], heights[0]), regions); }
+
+    glm::vec4 *Level(int level) { return arena.data() + offsets[level]; }
+    const glm::vec4 *Level(int level) const { return arena.data() + offsets[level]; }
+    ImageView LevelView(int level) { return ImageView(Level(level), widths[level], heights[level]); }
+    ConstImageView LevelView(int level) const { return ConstImageView(Level(level), widths[level], heights[level]); }
+
+    int numLevels=0;
+    std::vector<int> widths;
+    std::vector<int> heights;
+    std::vector<size_t> offsets;
+    std::vector<glm::vec4> arena;
+    //Coarse levels summed by the last Collapse, kept for the next partial one
+    std::vector<glm::vec4> collapsed;
+};
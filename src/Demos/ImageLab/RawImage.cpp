@@ -0,0 +1,376 @@
+#include "RawImage.hpp"
+#include "Parallel.hpp"
+
+#include <emmintrin.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void ConvertFloatToHalf(const float *input, uint16_t *output, size_t count)
+{
+    //Rounding and denormals as in F. Giesen, "float_to_half_fast3_rtne", on 4 lanes
+    const __m128i signMask = _mm_set1_epi32((int)0x80000000u);
+    const __m128i infinity = _mm_set1_epi32(255 << 23);
+    //Smallest float that overflows a half
+    const __m128i halfOverflow = _mm_set1_epi32(((127 + 16) << 23) - 1);
+    //Below this, adding the magic number leaves the denormal half in the low bits
+    const __m128i denormalLimit = _mm_set1_epi32(113 << 23);
+    const __m128i denormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    //((15 - 127) << 23) + 0xfff, written unsigned since shifting a negative value is undefined
+    const __m128i rebias = _mm_set1_epi32((int)0xC8000FFFu);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i halfInfinity = _mm_set1_epi32(0x7c00);
+    const __m128i halfQuietNaN = _mm_set1_epi32(0x0200);
+
+    auto Convert4 = [&](__m128 values)
+    {
+        __m128i bits = _mm_castps_si128(values);
+        __m128i sign = _mm_and_si128(bits, signMask);
+        bits = _mm_xor_si128(bits, sign);
+
+        __m128 denormalSum = _mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(denormalMagic));
+        __m128i denormal = _mm_sub_epi32(_mm_castps_si128(denormalSum), denormalMagic);
+
+        __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(bits, 13), one);
+        __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(bits, rebias), mantissaOdd), 13);
+
+        __m128i isDenormal = _mm_cmplt_epi32(bits, denormalLimit);
+        __m128i result = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+
+        __m128i isOverflow = _mm_cmpgt_epi32(bits, halfOverflow);
+        __m128i isNaN = _mm_cmpgt_epi32(bits, infinity);
+        __m128i overflow = _mm_or_si128(halfInfinity, _mm_and_si128(isNaN, halfQuietNaN));
+        result = _mm_or_si128(_mm_and_si128(isOverflow, overflow), _mm_andnot_si128(isOverflow, result));
+        result = _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+        //Sign extended so that the signed pack keeps the 16 bits as they are
+        return _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+    };
+
+    size_t i=0;
+    for(; i+8<=count; i+=8)
+    {
+        __m128i low = Convert4(_mm_loadu_ps(input + i));
+        __m128i high = Convert4(_mm_loadu_ps(input + i + 4));
+        _mm_storeu_si128((__m128i*)(output + i), _mm_packs_epi32(low, high));
+    }
+    if(i < count)
+    {
+        float remaining[8] = {};
+        uint16_t converted[8];
+        memcpy(remaining, input + i, (count - i) * sizeof(float));
+        __m128i low = Convert4(_mm_loadu_ps(remaining));
+        __m128i high = Convert4(_mm_loadu_ps(remaining + 4));
+        _mm_storeu_si128((__m128i*)converted, _mm_packs_epi32(low, high));
+        memcpy(output + i, converted, (count - i) * sizeof(uint16_t));
+    }
+}
+
+void ConvertHalfToFloat(const uint16_t *input, float *output, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i magnitudeMask = _mm_set1_epi32(0x7fff);
+    const __m128i signMask = _mm_set1_epi32(0x8000);
+    const __m128i exponentMask = _mm_set1_epi32(0x7c00 << 13);
+    const __m128i rebias = _mm_set1_epi32((127 - 15) << 23);
+    const __m128i infinityRebias = _mm_set1_epi32((128 - 16) << 23);
+    const __m128i denormalBias = _mm_set1_epi32(1 << 23);
+    const __m128i denormalMagic = _mm_set1_epi32(113 << 23);
+
+    auto Convert4 = [&](__m128i halves)
+    {
+        __m128i bits = _mm_slli_epi32(_mm_and_si128(halves, magnitudeMask), 13);
+        __m128i exponent = _mm_and_si128(bits, exponentMask);
+        bits = _mm_add_epi32(bits, rebias);
+
+        __m128i isSpecial = _mm_cmpeq_epi32(exponent, exponentMask);
+        bits = _mm_add_epi32(bits, _mm_and_si128(isSpecial, infinityRebias));
+
+        //Denormals are renormalized by the float subtraction
+        __m128i isDenormal = _mm_cmpeq_epi32(exponent, zero);
+        __m128 denormal = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, denormalBias)), _mm_castsi128_ps(denormalMagic));
+        bits = _mm_or_si128(_mm_and_si128(isDenormal, _mm_castps_si128(denormal)), _mm_andnot_si128(isDenormal, bits));
+
+        bits = _mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(halves, signMask), 16));
+        return _mm_castsi128_ps(bits);
+    };
+
+    size_t i=0;
+    for(; i+8<=count; i+=8)
+    {
+        __m128i halves = _mm_loadu_si128((const __m128i*)(input + i));
+        _mm_storeu_ps(output + i, Convert4(_mm_unpacklo_epi16(halves, zero)));
+        _mm_storeu_ps(output + i + 4, Convert4(_mm_unpackhi_epi16(halves, zero)));
+    }
+    if(i < count)
+    {
+        uint16_t remaining[8] = {};
+        float converted[8];
+        memcpy(remaining, input + i, (count - i) * sizeof(uint16_t));
+        __m128i halves = _mm_loadu_si128((const __m128i*)remaining);
+        _mm_storeu_ps(converted, Convert4(_mm_unpacklo_epi16(halves, zero)));
+        _mm_storeu_ps(converted + 4, Convert4(_mm_unpackhi_epi16(halves, zero)));
+        memcpy(output + i, converted, (count - i) * sizeof(float));
+    }
+}
+
+//
+//------------------------------------------------------------------------
+static const char rawMagic[8] = {'I', 'M', 'L', 'A', 'B', 'R', 'A', 'W'};
+static const uint32_t rawVersion = 1;
+static const uint64_t rawDataAlignment = 65536;
+
+struct RawImageHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t layout;
+    uint32_t tileSize;
+    uint64_t dataOffset;
+    uint64_t dataBytes;
+    uint8_t reserved[16];
+};
+static_assert(sizeof(RawImageHeader) == 64, "Raw image header is 64 bytes");
+
+size_t RawImageInfo::DataBytes() const
+{
+    if(layout==RawLayout::Tiles) return (size_t)TilesX() * TilesY() * TileBytes();
+    return (size_t)width * height * PixelBytes();
+}
+
+static bool WriteHeader(std::ofstream &file, const RawImageInfo &info)
+{
+    RawImageHeader header = {};
+    memcpy(header.magic, rawMagic, sizeof(rawMagic));
+    header.version = rawVersion;
+    header.width = info.width;
+    header.height = info.height;
+    header.format = (uint32_t)info.format;
+    header.layout = (uint32_t)info.layout;
+    header.tileSize = (info.layout==RawLayout::Tiles) ? info.tileSize : 0;
+    //Aligned for the allocation granularity of Windows mappings, which is larger than pages
+    header.dataOffset = rawDataAlignment;
+    header.dataBytes = info.DataBytes();
+    file.write((const char*)&header, sizeof(header));
+
+    std::vector<char> padding(rawDataAlignment - sizeof(header), 0);
+    file.write(padding.data(), padding.size());
+    return (bool)file;
+}
+
+bool WriteRawImageData(const std::string &fileName, const RawImageInfo &info, const void *data)
+{
+    std::ofstream file(fileName, std::ios::binary);
+    if(!file || !WriteHeader(file, info)) return false;
+    file.write((const char*)data, info.DataBytes());
+    return (bool)file;
+}
+
+bool WriteRawImage(const std::string &fileName, const RawImageInfo &info, const glm::vec4 *pixels)
+{
+    std::ofstream file(fileName, std::ios::binary);
+    if(!file || !WriteHeader(file, info)) return false;
+
+    //One band of rows at a time : a row of tiles, or as many rows as fit in about 4 MB
+    size_t pixelBytes = info.PixelBytes();
+    bool tiled = info.layout==RawLayout::Tiles;
+    int bandHeight = tiled ? info.tileSize : (std::max)(1, (int)(((size_t)4 << 20) / ((size_t)info.width * pixelBytes)));
+    size_t bandBytes = tiled ? info.TilesX() * info.TileBytes() : (size_t)bandHeight * info.width * pixelBytes;
+    std::vector<uint8_t> band(bandBytes);
+    for(int y0=0; y0<info.height; y0+=bandHeight)
+    {
+        int y1 = (std::min)(y0 + bandHeight, info.height);
+        if(tiled) std::fill(band.begin(), band.end(), (uint8_t)0);
+        ParallelForChunks(y0, y1, [&](int startRow, int endRow)
+        {
+            for(int y=startRow; y<endRow; y++)
+            {
+                const float *inRow = &pixels[(size_t)y * info.width].x;
+                //Each row of the image is cut in tile rows, contiguous in the row layout
+                int segmentWidth = tiled ? info.tileSize : info.width;
+                for(int x=0; x<info.width; x+=segmentWidth)
+                {
+                    int count = (std::min)(segmentWidth, info.width - x);
+                    uint8_t *out = tiled ?
+                        band.data() + (size_t)(x / info.tileSize) * info.TileBytes() + (size_t)(y - y0) * info.tileSize * pixelBytes :
+                        band.data() + (size_t)(y - y0) * info.width * pixelBytes;
+                    if(info.format==RawPixelFormat::F32) memcpy(out, inRow + (size_t)x * 4, (size_t)count * pixelBytes);
+                    else ConvertFloatToHalf(inRow + (size_t)x * 4, (uint16_t*)out, (size_t)count * 4);
+                }
+            }
+        }, 16);
+        file.write((const char*)band.data(), tiled ? bandBytes : (size_t)(y1 - y0) * info.width * pixelBytes);
+    }
+    return (bool)file;
+}
+
+//
+//------------------------------------------------------------------------
+MappedRawImage::~MappedRawImage()
+{
+    Close();
+}
+
+MappedRawImage::MappedRawImage(MappedRawImage &&other)
+{
+    *this = std::move(other);
+}
+
+MappedRawImage &MappedRawImage::operator=(MappedRawImage &&other)
+{
+    if(this == &other) return *this;
+    Close();
+    info = other.info;
+    mapping = other.mapping;
+    data = other.data;
+    mappingSize = other.mappingSize;
+#ifdef _WIN32
+    file = other.file;
+    fileMapping = other.fileMapping;
+    other.file = nullptr;
+    other.fileMapping = nullptr;
+#endif
+    other.mapping = nullptr;
+    other.data = nullptr;
+    other.mappingSize = 0;
+    return *this;
+}
+
+bool MappedRawImage::Open(const std::string &fileName)
+{
+    Close();
+#ifdef _WIN32
+    file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        file = nullptr;
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx((HANDLE)file, &size);
+    mappingSize = (size_t)size.QuadPart;
+    fileMapping = mappingSize > 0 ? CreateFileMappingA((HANDLE)file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    if(fileMapping != NULL) mapping = (const uint8_t*)MapViewOfFile((HANDLE)fileMapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    int file = open(fileName.c_str(), O_RDONLY);
+    if(file < 0) return false;
+    struct stat status;
+    if(fstat(file, &status) == 0 && status.st_size > 0)
+    {
+        mappingSize = (size_t)status.st_size;
+        void *address = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, file, 0);
+        if(address != MAP_FAILED) mapping = (const uint8_t*)address;
+    }
+    //The mapping keeps its own reference to the file
+    close(file);
+#endif
+    if(mapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    RawImageHeader header;
+    bool valid = mappingSize >= sizeof(header);
+    if(valid)
+    {
+        memcpy(&header, mapping, sizeof(header));
+        valid = memcmp(header.magic, rawMagic, sizeof(rawMagic))==0 && header.version==rawVersion &&
+                header.format <= (uint32_t)RawPixelFormat::F16 && header.layout <= (uint32_t)RawLayout::Tiles &&
+                (header.layout==(uint32_t)RawLayout::Rows || header.tileSize > 0);
+    }
+    if(valid)
+    {
+        info.width = header.width;
+        info.height = header.height;
+        info.format = (RawPixelFormat)header.format;
+        info.layout = (RawLayout)header.layout;
+        info.tileSize = (info.layout==RawLayout::Tiles) ? (int)header.tileSize : info.tileSize;
+        valid = header.dataBytes == info.DataBytes() && header.dataOffset + header.dataBytes <= mappingSize;
+    }
+    if(!valid)
+    {
+        Close();
+        return false;
+    }
+    data = mapping + header.dataOffset;
+    return true;
+}
+
+void MappedRawImage::Close()
+{
+#ifdef _WIN32
+    if(mapping != nullptr) UnmapViewOfFile(mapping);
+    if(fileMapping != nullptr) CloseHandle((HANDLE)fileMapping);
+    if(file != nullptr) CloseHandle((HANDLE)file);
+    fileMapping = nullptr;
+    file = nullptr;
+#else
+    if(mapping != nullptr) munmap((void*)mapping, mappingSize);
+#endif
+    mapping = nullptr;
+    data = nullptr;
+    mappingSize = 0;
+    info = RawImageInfo();
+}
+
+void MappedRawImage::Read(int x0, int y0, int x1, int y1, glm::vec4 *output) const
+{
+    if(!IsOpen()) return;
+    x0 = (std::max)(x0, 0);
+    y0 = (std::max)(y0, 0);
+    x1 = (std::min)(x1, info.width);
+    y1 = (std::min)(y1, info.height);
+    if(x1 <= x0 || y1 <= y0) return;
+
+    size_t pixelBytes = info.PixelBytes();
+    int outputWidth = x1 - x0;
+    bool tiled = info.layout==RawLayout::Tiles;
+    ParallelForChunks(y0, y1, [&](int startRow, int endRow)
+    {
+        for(int y=startRow; y<endRow; y++)
+        {
+            float *outRow = &output[(size_t)(y - y0) * outputWidth].x;
+            for(int x=x0; x<x1;)
+            {
+                //Up to the end of the tile, or of the region in the row layout
+                const uint8_t *in;
+                int count;
+                if(tiled)
+                {
+                    int tileX = x / info.tileSize;
+                    int localX = x - tileX * info.tileSize;
+                    in = Tile(tileX, y / info.tileSize) + ((size_t)(y % info.tileSize) * info.tileSize + localX) * pixelBytes;
+                    count = (std::min)(info.tileSize - localX, x1 - x);
+                }
+                else
+                {
+                    in = Row(y) + (size_t)x * pixelBytes;
+                    count = x1 - x;
+                }
+                float *out = outRow + (size_t)(x - x0) * 4;
+                if(info.format==RawPixelFormat::F32) memcpy(out, in, (size_t)count * pixelBytes);
+                else ConvertHalfToFloat((const uint16_t*)in, out, (size_t)count * 4);
+                x += count;
+            }
+        }
+    }, 16);
+}
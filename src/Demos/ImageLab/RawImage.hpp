@@ -0,0 +1,86 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//Half floats are the format of the textures of the stack, so they round trip exactly through it
+enum class RawPixelFormat
+{
+    F32=0,
+    F16=1
+};
+
+//Rows : the whole image row by row.
+//Tiles : square tiles one after the other, row by row inside each tile. Tiles on the right and bottom edges are padded to the full size
+enum class RawLayout
+{
+    Rows=0,
+    Tiles=1
+};
+
+//Floats to half floats rounding to nearest even, and back, 4 values per iteration with SSE2.
+//Infinities and NaNs are kept, values too small for a half become denormals or zero
+void ConvertFloatToHalf(const float *input, uint16_t *output, size_t count);
+void ConvertHalfToFloat(const uint16_t *input, float *output, size_t count);
+
+//RGBA pixels, always 4 channels
+struct RawImageInfo
+{
+    int width=0;
+    int height=0;
+    RawPixelFormat format=RawPixelFormat::F16;
+    RawLayout layout=RawLayout::Rows;
+    int tileSize=64;
+
+    size_t PixelBytes() const { return (format==RawPixelFormat::F32) ? 16 : 8; }
+    int TilesX() const { return (width + tileSize-1) / tileSize; }
+    int TilesY() const { return (height + tileSize-1) / tileSize; }
+    size_t TileBytes() const { return (size_t)tileSize * tileSize * PixelBytes(); }
+    size_t DataBytes() const;
+};
+
+//File : a 64 bytes header, then the pixels from a 64 KB aligned offset so that they can be mapped and used in place.
+//data is already in the format and layout of info
+bool WriteRawImageData(const std::string &fileName, const RawImageInfo &info, const void *data);
+//Converts and lays out the pixels one band of rows at a time
+bool WriteRawImage(const std::string &fileName, const RawImageInfo &info, const glm::vec4 *pixels);
+
+//Raw image file mapped read only, the pixels are read from the page cache without being copied.
+//Pages are loaded on first access and can be dropped by the system, so a large file costs no resident memory until it is read
+class MappedRawImage
+{
+public:
+    MappedRawImage() = default;
+    ~MappedRawImage();
+    MappedRawImage(const MappedRawImage&) = delete;
+    MappedRawImage &operator=(const MappedRawImage&) = delete;
+    MappedRawImage(MappedRawImage &&other);
+    MappedRawImage &operator=(MappedRawImage &&other);
+
+    //False when the file cannot be mapped or is not a valid raw image
+    bool Open(const std::string &fileName);
+    void Close();
+    bool IsOpen() const { return mapping != nullptr; }
+
+    const RawImageInfo &Info() const { return info; }
+    //Pixels in the format and layout of the file
+    const void *Data() const { return data; }
+    //Rows layout only
+    const uint8_t *Row(int y) const { return data + (size_t)y * info.width * info.PixelBytes(); }
+    //Tiles layout only
+    const uint8_t *Tile(int tileX, int tileY) const { return data + ((size_t)tileY * info.TilesX() + tileX) * info.TileBytes(); }
+
+    //Pixels of [x0, x1) x [y0, y1) to floats, in parallel, rows of x1 - x0 pixels in output
+    void Read(int x0, int y0, int x1, int y1, glm::vec4 *output) const;
+
+private:
+    RawImageInfo info;
+    const uint8_t *mapping=nullptr;
+    const uint8_t *data=nullptr;
+    size_t mappingSize=0;
+#ifdef _WIN32
+    void *file=nullptr;
+    void *fileMapping=nullptr;
+#endif
+};
@@ -0,0 +1,225 @@
+#include "RecursiveGaussian.hpp"
+#include "Parallel.hpp"
+
+#include <xmmintrin.h>
+#include <cmath>
+#include <algorithm>
+
+struct RecursiveCoefficients
+{
+    float b;
+    float a1, a2, a3;
+    //Triggs - Sdika matrix for the backward pass initial conditions
+    float M[9];
+};
+
+//Young, van Vliet, Recursive Gabor filtering (2002)
+static RecursiveCoefficients ComputeCoefficients(float sigma)
+{
+    double s = (std::max)(0.5, (double)sigma);
+    double q = (s >= 2.5) ? (0.98711 * s - 0.96330) : (3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * s));
+    double q2 = q*q;
+    double q3 = q2*q;
+
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double a1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+    double a2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+    double a3 = (0.422205 * q3) / b0;
+
+    RecursiveCoefficients result;
+    result.b = (float)(1.0 - (a1 + a2 + a3));
+    result.a1 = (float)a1;
+    result.a2 = (float)a2;
+    result.a3 = (float)a3;
+
+    double scale = 1.0 / ((1.0 + a1 - a2 + a3) * (1.0 - a1 - a2 - a3) * (1.0 + a2 + (a1 - a3) * a3));
+    result.M[0] = (float)(scale * (-a3 * a1 + 1.0 - a3 * a3 - a2));
+    result.M[1] = (float)(scale * (a3 + a1) * (a2 + a3 * a1));
+    result.M[2] = (float)(scale * a3 * (a1 + a3 * a2));
+    result.M[3] = (float)(scale * (a1 + a3 * a2));
+    result.M[4] = (float)(-scale * (a2 - 1.0) * (a2 + a3 * a1));
+    result.M[5] = (float)(-scale * a3 * (a3 * a1 + a3 * a3 + a2 - 1.0));
+    result.M[6] = (float)(scale * (a3 * a1 + a2 + a1 * a1 - a2 * a2));
+    result.M[7] = (float)(scale * (a1 * a2 + a3 * a2 * a2 - a1 * a3 * a3 - a3 * a3 * a3 - a3 * a2 + a3));
+    result.M[8] = (float)(scale * a3 * (a1 + a3 * a2));
+    return result;
+}
+
+//Filters count pixels spaced by stride, from input to output (can be the same)
+static void FilterLine(const glm::vec4 *input, glm::vec4 *output, int count, int stride, const RecursiveCoefficients &c)
+{
+    __m128 b = _mm_set1_ps(c.b);
+    __m128 a1 = _mm_set1_ps(c.a1);
+    __m128 a2 = _mm_set1_ps(c.a2);
+    __m128 a3 = _mm_set1_ps(c.a3);
+
+    __m128 first = _mm_loadu_ps(&input[0].x);
+    __m128 last = _mm_loadu_ps(&input[(size_t)(count-1) * stride].x);
+
+    //Causal pass, the signal is constant before the first sample
+    __m128 w1 = first, w2 = first, w3 = first;
+    for(int n=0; n<count; n++)
+    {
+        __m128 x = _mm_loadu_ps(&input[(size_t)n * stride].x);
+        __m128 w = _mm_add_ps(_mm_mul_ps(b, x), _mm_add_ps(_mm_mul_ps(a1, w1), _mm_add_ps(_mm_mul_ps(a2, w2), _mm_mul_ps(a3, w3))));
+        _mm_storeu_ps(&output[(size_t)n * stride].x, w);
+        w3 = w2; w2 = w1; w1 = w;
+    }
+
+    //Anti causal pass, initialized as if the signal stayed constant after the last sample
+    __m128 u0 = _mm_sub_ps(w1, last);
+    __m128 u1 = _mm_sub_ps(w2, last);
+    __m128 u2 = _mm_sub_ps(w3, last);
+    auto Row = [&](int i)
+    {
+        __m128 v = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(c.M[i*3+0]), u0), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(c.M[i*3+1]), u1), _mm_mul_ps(_mm_set1_ps(c.M[i*3+2]), u2)));
+        return _mm_add_ps(_mm_mul_ps(b, v), last);
+    };
+    __m128 y1 = Row(0), y2 = Row(1), y3 = Row(2);
+    _mm_storeu_ps(&output[(size_t)(count-1) * stride].x, y1);
+    for(int n=count-2; n>=0; n--)
+    {
+        __m128 w = _mm_loadu_ps(&output[(size_t)n * stride].x);
+        __m128 y = _mm_add_ps(_mm_mul_ps(b, w), _mm_add_ps(_mm_mul_ps(a1, y1), _mm_add_ps(_mm_mul_ps(a2, y2), _mm_mul_ps(a3, y3))));
+        _mm_storeu_ps(&output[(size_t)n * stride].x, y);
+        y3 = y2; y2 = y1; y1 = y;
+    }
+}
+
+void RecursiveGaussianBlur(const ConstImageView &input, const ImageView &output, float sigmaX, float sigmaY)
+{
+    if(input.Empty()) return;
+    int width = input.width;
+    int height = input.height;
+    RecursiveCoefficients cx = ComputeCoefficients(sigmaX);
+    RecursiveCoefficients cy = ComputeCoefficients(sigmaY);
+
+    //Rows
+    ParallelFor(0, height, [&](int y)
+    {
+        FilterLine(input.Row(y), output.Row(y), width, 1, cx);
+    }, 8);
+
+    //Columns, processed in strips so that each step reads and writes contiguous rows
+    const int stripWidth = 64;
+    int numStrips = (width + stripWidth-1) / stripWidth;
+    ParallelFor(0, numStrips, [&](int strip)
+    {
+        int x0 = strip * stripWidth;
+        int x1 = (std::min)(width, x0 + stripWidth);
+        int count = x1 - x0;
+
+        __m128 b = _mm_set1_ps(cy.b);
+        __m128 a1 = _mm_set1_ps(cy.a1);
+        __m128 a2 = _mm_set1_ps(cy.a2);
+        __m128 a3 = _mm_set1_ps(cy.a3);
+
+        glm::vec4 first[stripWidth], last[stripWidth];
+        std::copy(output.Row(0) + x0, output.Row(0) + x1, first);
+        std::copy(output.Row(height-1) + x0, output.Row(height-1) + x1, last);
+
+        //Causal pass
+        for(int y=0; y<height; y++)
+        {
+            glm::vec4 *row = output.Row(y) + x0;
+            const glm::vec4 *r1 = (y>=1) ? output.Row(y-1) + x0 : first;
+            const glm::vec4 *r2 = (y>=2) ? output.Row(y-2) + x0 : first;
+            const glm::vec4 *r3 = (y>=3) ? output.Row(y-3) + x0 : first;
+            for(int x=0; x<count; x++)
+            {
+                __m128 v = _mm_mul_ps(b, _mm_loadu_ps(&row[x].x));
+                v = _mm_add_ps(v, _mm_mul_ps(a1, _mm_loadu_ps(&r1[x].x)));
+                v = _mm_add_ps(v, _mm_mul_ps(a2, _mm_loadu_ps(&r2[x].x)));
+                v = _mm_add_ps(v, _mm_mul_ps(a3, _mm_loadu_ps(&r3[x].x)));
+                _mm_storeu_ps(&row[x].x, v);
+            }
+        }
+
+        //Anti causal pass initial conditions : the last row and 2 virtual rows after it
+        glm::vec4 tail[3][stripWidth];
+        for(int x=0; x<count; x++)
+        {
+            int inx = x0 + x;
+            glm::vec4 u0 = output.At(inx, height-1) - last[x];
+            glm::vec4 u1 = ((height>=2) ? output.At(inx, height-2) : first[x]) - last[x];
+            glm::vec4 u2 = ((height>=3) ? output.At(inx, height-3) : first[x]) - last[x];
+            for(int i=0; i<3; i++)
+            {
+                tail[i][x] = cy.b * (cy.M[i*3+0] * u0 + cy.M[i*3+1] * u1 + cy.M[i*3+2] * u2) + last[x];
+            }
+        }
+        std::copy(tail[0], tail[0] + count, output.Row(height-1) + x0);
+
+        auto Row = [&](int y) -> const glm::vec4*
+        {
+            return (y < height) ? output.Row(y) + x0 : tail[y - height + 1];
+        };
+
+        //Anti causal pass
+        for(int y=height-2; y>=0; y--)
+        {
+            glm::vec4 *row = output.Row(y) + x0;
+            const glm::vec4 *r1 = Row(y+1);
+            const glm::vec4 *r2 = Row(y+2);
+            const glm::vec4 *r3 = Row(y+3);
+            for(int x=0; x<count; x++)
+            {
+                __m128 v = _mm_mul_ps(b, _mm_loadu_ps(&row[x].x));
+                v = _mm_add_ps(v, _mm_mul_ps(a1, _mm_loadu_ps(&r1[x].x)));
+                v = _mm_add_ps(v, _mm_mul_ps(a2, _mm_loadu_ps(&r2[x].x)));
+                v = _mm_add_ps(v, _mm_mul_ps(a3, _mm_loadu_ps(&r3[x].x)));
+                _mm_storeu_ps(&row[x].x, v);
+            }
+        }
+    });
+}
+
+int GaussianFilter::Radius() const
+{
+    bool recursive = (method == GaussianMethod::Recursive) || (method == GaussianMethod::Auto && sigma >= recursiveMinSigma);
+    if(recursive) return (int)std::ceil(6 * sigma);
+    int size = firSize > 0 ? firSize : 2 * (int)std::ceil(3 * sigma) + 1;
+    return size/2;
+}
+
+void GaussianFilter::Blur(const glm::vec4 *input, glm::vec4 *output, int width, int height)
+{
+    lastMethod = method;
+    if(method == GaussianMethod::Auto)
+    {
+        lastMethod = (sigma >= recursiveMinSigma) ? GaussianMethod::Recursive : GaussianMethod::FIR;
+    }
+
+    if(lastMethod == GaussianMethod::Recursive)
+    {
+        RecursiveGaussianBlur(input, output, width, height, sigma, sigma);
+        return;
+    }
+
+    int size = firSize > 0 ? firSize : 2 * (int)std::ceil(3 * sigma) + 1;
+    std::vector<float> row(size);
+    int halfSize = size/2;
+    float sum=0;
+    for(int i=0; i<size; i++)
+    {
+        float x = (float)(i - halfSize);
+        row[i] = std::exp(-(x*x) / (2 * sigma * sigma));
+        sum += row[i];
+    }
+    kernel.resize(size * size);
+    for(int j=0; j<size; j++)
+    {
+        for(int i=0; i<size; i++)
+        {
+            kernel[j * size + i] = (row[j] / sum) * (row[i] / sum);
+        }
+    }
+    convolution.SetKernel(kernel.data(), size, size);
+
+    if(input == output)
+    {
+        tmpData.assign(input, input + (size_t)width * height);
+        input = tmpData.data();
+    }
+    convolution.Convolve(input, output, width, height, 4);
+}
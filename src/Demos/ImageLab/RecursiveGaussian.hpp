@@ -0,0 +1,46 @@
+#pragma once
+#include "Convolution.hpp"
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+enum class GaussianMethod
+{
+    Auto=0,
+    Recursive=1,
+    FIR=2
+};
+
+//Third order recursive gaussian (Young - van Vliet), applied separably forward and backward on rows then columns.
+//Borders are clamped to edge, the backward pass uses the Triggs - Sdika initial conditions.
+//The cost per pixel does not depend on sigma. The views can be crops or have padded rows, output can be input.
+void RecursiveGaussianBlur(const ConstImageView &input, const ImageView &output, float sigmaX, float sigmaY);
+inline void RecursiveGaussianBlur(const glm::vec4 *input, glm::vec4 *output, int width, int height, float sigmaX, float sigmaY)
+{
+    RecursiveGaussianBlur(ConstImageView(input, width, height), ImageView(output, width, height), sigmaX, sigmaY);
+}
+
+//Gaussian blur that uses the recursive filter for large sigmas, and a separable FIR kernel for small ones
+//where the recursive approximation is less accurate.
+struct GaussianFilter
+{
+    void Blur(const glm::vec4 *input, glm::vec4 *output, int width, int height);
+    //Pixels on each side of an output pixel that contribute to it with the current parameters.
+    //The response of the recursive filter never ends, past 6 sigma it is below the precision of half floats
+    int Radius() const;
+
+    GaussianMethod method = GaussianMethod::Auto;
+    float sigma = 1;
+    //Size of the FIR kernel, 0 to derive it from sigma
+    int firSize = 0;
+    //Below this sigma, Auto uses the FIR kernel
+    float recursiveMinSigma = 2.0f;
+
+    //Method used by the last call to Blur
+    GaussianMethod lastMethod = GaussianMethod::Recursive;
+
+private:
+    ConvolutionEngine convolution;
+    std::vector<float> kernel;
+    std::vector<glm::vec4> tmpData;
+};
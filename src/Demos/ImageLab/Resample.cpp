@@ -0,0 +1,298 @@
+#include "Resample.hpp"
+#include "Parallel.hpp"
+#include "ImageBuffer.hpp"
+
+#include <xmmintrin.h>
+#include <algorithm>
+#include <cmath>
+
+static const float PI_F = 3.14159265359f;
+
+static float FilterSupport(ResampleFilter filter)
+{
+    switch(filter)
+    {
+    case ResampleFilter::Triangle: return 1;
+    case ResampleFilter::Bicubic: return 2;
+    case ResampleFilter::Lanczos3: return 3;
+    default: return 0.5f;
+    }
+}
+
+static float Sinc(float x)
+{
+    if(std::abs(x) < 1e-5f) return 1;
+    x *= PI_F;
+    return std::sin(x) / x;
+}
+
+static float FilterValue(ResampleFilter filter, float x)
+{
+    x = std::abs(x);
+    switch(filter)
+    {
+    case ResampleFilter::Triangle:
+        return (x < 1) ? 1 - x : 0;
+    case ResampleFilter::Bicubic:
+        //Catmull-Rom (Keys, a = -0.5)
+        if(x < 1) return (1.5f * x - 2.5f) * x * x + 1;
+        if(x < 2) return ((-0.5f * x + 2.5f) * x - 4) * x + 2;
+        return 0;
+    case ResampleFilter::Lanczos3:
+        return (x < 3) ? Sinc(x) * Sinc(x / 3) : 0;
+    default:
+        return (x < 0.5f) ? 1.0f : 0.0f;
+    }
+}
+
+void ResampleWeights::Build(int inputSize, int outputSize, ResampleFilter filter)
+{
+    this->outputSize = outputSize;
+    start.resize(outputSize);
+    count.resize(outputSize);
+    double scale = (double)outputSize / (double)inputSize;
+
+    if(filter == ResampleFilter::Nearest)
+    {
+        maxTaps = 1;
+        weights.assign(outputSize, 1.0f);
+        for(int i=0; i<outputSize; i++)
+        {
+            start[i] = (std::min)((int)((i + 0.5) / scale), inputSize-1);
+            count[i] = 1;
+        }
+        return;
+    }
+
+    //The filter covers filterScale input samples per unit when downscaling
+    double filterScale = (std::max)(1.0, 1.0 / scale);
+    double support = FilterSupport(filter) * filterScale;
+    maxTaps = (std::min)((int)std::floor(2 * support) + 2, inputSize);
+    weights.assign((size_t)outputSize * maxTaps, 0);
+    for(int i=0; i<outputSize; i++)
+    {
+        double center = (i + 0.5) / scale - 0.5;
+        int low = (int)std::ceil(center - support);
+        int high = (int)std::floor(center + support);
+        int first = (std::min)((std::max)(low, 0), inputSize-1);
+        int last = (std::min)((std::max)(high, 0), inputSize-1);
+        start[i] = first;
+        count[i] = last - first + 1;
+
+        float *w = weights.data() + (size_t)i * maxTaps;
+        float sum=0;
+        for(int j=low; j<=high; j++)
+        {
+            float value = FilterValue(filter, (float)((j - center) / filterScale));
+            w[(std::min)((std::max)(j, 0), inputSize-1) - first] += value;
+            sum += value;
+        }
+        if(std::abs(sum) < 1e-6f)
+        {
+            //Can only happen for a box narrower than the sample spacing
+            std::fill(w, w + maxTaps, 0.0f);
+            start[i] = (std::min)((std::max)((int)std::floor(center + 0.5), 0), inputSize-1);
+            count[i] = 1;
+            w[0] = 1;
+            continue;
+        }
+        for(int k=0; k<count[i]; k++) w[k] /= sum;
+    }
+}
+
+static void HorizontalPass(const ConstImageView &input, const ImageView &output, const ResampleWeights &weights)
+{
+    int outputWidth = weights.outputSize;
+    ParallelForChunks(0, input.height, [&](int startRow, int endRow)
+    {
+        for(int y=startRow; y<endRow; y++)
+        {
+            const glm::vec4 *inRow = input.Row(y);
+            glm::vec4 *outRow = output.Row(y);
+            for(int x=0; x<outputWidth; x++)
+            {
+                const glm::vec4 *source = inRow + weights.start[x];
+                const float *w = weights.weights.data() + (size_t)x * weights.maxTaps;
+                __m128 sum = _mm_setzero_ps();
+                for(int k=0; k<weights.count[x]; k++)
+                {
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&source[k].x), _mm_set1_ps(w[k])));
+                }
+                _mm_storeu_ps(&outRow[x].x, sum);
+            }
+        }
+    }, 8);
+}
+
+static void VerticalPass(const ConstImageView &input, const ImageView &output, const ResampleWeights &weights)
+{
+    int width = input.width;
+    int outputHeight = weights.outputSize;
+    ParallelForChunks(0, outputHeight, [&](int startRow, int endRow)
+    {
+        for(int y=startRow; y<endRow; y++)
+        {
+            __m128 *outRow = (__m128*)output.Row(y);
+            const float *w = weights.weights.data() + (size_t)y * weights.maxTaps;
+            //One input row at a time, so that the reads stay sequential
+            for(int k=0; k<weights.count[y]; k++)
+            {
+                const glm::vec4 *inRow = input.Row(weights.start[y] + k);
+                __m128 weight = _mm_set1_ps(w[k]);
+                for(int x=0; x<width; x++)
+                {
+                    __m128 value = _mm_mul_ps(_mm_loadu_ps(&inRow[x].x), weight);
+                    _mm_storeu_ps((float*)(outRow + x), (k==0) ? value : _mm_add_ps(_mm_loadu_ps((float*)(outRow + x)), value));
+                }
+            }
+        }
+    }, 8);
+}
+
+void ResampleImage(const ConstImageView &input, const ImageView &output, ResampleFilter filter)
+{
+    if(input.Empty() || output.Empty()) return;
+    int inputWidth = input.width;
+    int inputHeight = input.height;
+    int outputWidth = output.width;
+    int outputHeight = output.height;
+    bool scaleX = inputWidth != outputWidth;
+    bool scaleY = inputHeight != outputHeight;
+    if(!scaleX && !scaleY)
+    {
+        for(int y=0; y<inputHeight; y++) std::copy(input.Row(y), input.Row(y) + inputWidth, output.Row(y));
+        return;
+    }
+
+    ResampleWeights weightsX, weightsY;
+    if(scaleX) weightsX.Build(inputWidth, outputWidth, filter);
+    if(scaleY) weightsY.Build(inputHeight, outputHeight, filter);
+    if(!scaleY)
+    {
+        HorizontalPass(input, output, weightsX);
+        return;
+    }
+    if(!scaleX)
+    {
+        VerticalPass(input, output, weightsY);
+        return;
+    }
+
+    //Number of taps of each order, the intermediate image is the input scaled along the first axis
+    double horizontalFirst = (double)inputHeight * outputWidth * weightsX.maxTaps + (double)outputWidth * outputHeight * weightsY.maxTaps;
+    double verticalFirst = (double)inputWidth * outputHeight * weightsY.maxTaps + (double)outputWidth * outputHeight * weightsX.maxTaps;
+    int tmpWidth = (horizontalFirst <= verticalFirst) ? outputWidth : inputWidth;
+    int tmpHeight = (horizontalFirst <= verticalFirst) ? inputHeight : outputHeight;
+    //Rows of the intermediate image start on cache lines, so threads writing neighbouring rows never share one
+    const size_t cacheLine = 64;
+    size_t tmpStride = AlignedRowStride(tmpWidth, sizeof(glm::vec4), cacheLine);
+    ScratchBuffer<glm::vec4> tmp((tmpStride * tmpHeight + cacheLine) / sizeof(glm::vec4));
+    glm::vec4 *tmpPixels = (glm::vec4*)(((uintptr_t)tmp.data() + cacheLine-1) & ~(uintptr_t)(cacheLine-1));
+    ImageView tmpView(tmpPixels, tmpWidth, tmpHeight, tmpStride);
+    if(horizontalFirst <= verticalFirst)
+    {
+        HorizontalPass(input, tmpView, weightsX);
+        VerticalPass(tmpView, output, weightsY);
+    }
+    else
+    {
+        VerticalPass(input, tmpView, weightsY);
+        HorizontalPass(tmpView, output, weightsX);
+    }
+}
+
+void WarpAffine(const ConstImageView &inputView, const ImageView &output, const glm::mat3 &outputToInput, ResampleFilter filter, glm::vec4 border)
+{
+    if(inputView.Empty() || output.Empty()) return;
+    ConstImageView input = inputView;
+    int inputWidth = input.width;
+    int inputHeight = input.height;
+    int outputWidth = output.width;
+    int outputHeight = output.height;
+    glm::mat3 transform = outputToInput;
+
+    //Input pixels covered by one output pixel along each input axis
+    float footprintX = (std::max)(std::abs(transform[0][0]), std::abs(transform[1][0]));
+    float footprintY = (std::max)(std::abs(transform[0][1]), std::abs(transform[1][1]));
+    std::vector<glm::vec4> reduced;
+    if(filter != ResampleFilter::Nearest && (footprintX > 1.01f || footprintY > 1.01f))
+    {
+        int reducedWidth = (std::max)(1, (int)std::round(inputWidth / (std::max)(footprintX, 1.0f)));
+        int reducedHeight = (std::max)(1, (int)std::round(inputHeight / (std::max)(footprintY, 1.0f)));
+        reduced.resize((size_t)reducedWidth * reducedHeight);
+        ImageView reducedView(reduced.data(), reducedWidth, reducedHeight);
+        ResampleImage(input, reducedView, filter);
+
+        //Pixel centers of the reduced image : u' = (u + 0.5) * reducedWidth / inputWidth - 0.5
+        glm::mat3 toReduced(1);
+        toReduced[0][0] = (float)reducedWidth / (float)inputWidth;
+        toReduced[1][1] = (float)reducedHeight / (float)inputHeight;
+        toReduced[2][0] = 0.5f * toReduced[0][0] - 0.5f;
+        toReduced[2][1] = 0.5f * toReduced[1][1] - 0.5f;
+        transform = toReduced * transform;
+        input = reducedView;
+        inputWidth = reducedWidth;
+        inputHeight = reducedHeight;
+    }
+
+    int radius = (filter == ResampleFilter::Nearest || filter == ResampleFilter::Box) ? 0 : (int)FilterSupport(filter);
+    //Filter sampled every 1/tableResolution of a pixel, the weights are normalized afterwards anyway
+    const int tableResolution = 1024;
+    std::vector<float> table(radius * tableResolution + 2);
+    for(size_t i=0; i<table.size(); i++) table[i] = FilterValue(filter, (float)i / (float)tableResolution);
+    double stepU = transform[0][0];
+    double stepV = transform[0][1];
+    ParallelForChunks(0, outputHeight, [&](int startRow, int endRow)
+    {
+        float weightsX[8], weightsY[8];
+        for(int y=startRow; y<endRow; y++)
+        {
+            glm::vec4 *outRow = output.Row(y);
+            double u = (double)transform[1][0] * y + transform[2][0];
+            double v = (double)transform[1][1] * y + transform[2][1];
+            for(int x=0; x<outputWidth; x++, u += stepU, v += stepV)
+            {
+                if(u < -0.5 || v < -0.5 || u >= inputWidth - 0.5 || v >= inputHeight - 0.5)
+                {
+                    outRow[x] = border;
+                    continue;
+                }
+
+                if(radius==0)
+                {
+                    int ix = (std::min)((int)(u + 0.5), inputWidth-1);
+                    int iy = (std::min)((int)(v + 0.5), inputHeight-1);
+                    outRow[x] = input.At(ix, iy);
+                    continue;
+                }
+
+                int baseX = (int)std::floor(u) - radius + 1;
+                int baseY = (int)std::floor(v) - radius + 1;
+                int taps = 2 * radius;
+                float sumX=0, sumY=0;
+                for(int k=0; k<taps; k++)
+                {
+                    weightsX[k] = table[(int)(std::abs(baseX + k - u) * tableResolution + 0.5)];
+                    weightsY[k] = table[(int)(std::abs(baseY + k - v) * tableResolution + 0.5)];
+                    sumX += weightsX[k];
+                    sumY += weightsY[k];
+                }
+
+                __m128 sum = _mm_setzero_ps();
+                for(int j=0; j<taps; j++)
+                {
+                    int iy = (std::min)((std::max)(baseY + j, 0), inputHeight-1);
+                    const glm::vec4 *inRow = input.Row(iy);
+                    __m128 rowSum = _mm_setzero_ps();
+                    for(int k=0; k<taps; k++)
+                    {
+                        int ix = (std::min)((std::max)(baseX + k, 0), inputWidth-1);
+                        rowSum = _mm_add_ps(rowSum, _mm_mul_ps(_mm_loadu_ps(&inRow[ix].x), _mm_set1_ps(weightsX[k])));
+                    }
+                    sum = _mm_add_ps(sum, _mm_mul_ps(rowSum, _mm_set1_ps(weightsY[j])));
+                }
+                _mm_storeu_ps(&outRow[x].x, _mm_mul_ps(sum, _mm_set1_ps(1.0f / (sumX * sumY))));
+            }
+        }
+    }, 8);
+}
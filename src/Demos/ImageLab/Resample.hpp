@@ -0,0 +1,47 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+enum class ResampleFilter
+{
+    Nearest=0,
+    Box=1,
+    Triangle=2,
+    Bicubic=3,
+    Lanczos3=4
+};
+
+//Contributions of the input samples to each output sample along one axis, with the filter widened by the
+//downscaling factor so that minification is alias free. Taps outside the input are folded onto the edge samples.
+struct ResampleWeights
+{
+    void Build(int inputSize, int outputSize, ResampleFilter filter);
+
+    int outputSize=0;
+    //Stride of weights
+    int maxTaps=0;
+    //Output sample i reads count[i] inputs from start[i], weighted by weights[i * maxTaps + k]
+    std::vector<int> start;
+    std::vector<int> count;
+    std::vector<float> weights;
+};
+
+//Scales the image to outputWidth * outputHeight in two separable passes, choosing the order that does the least work.
+//Passes run on rows in parallel and accumulate the 4 channels of a pixel at once with SSE.
+//The views can be crops or have padded rows, input and output must not overlap.
+void ResampleImage(const ConstImageView &input, const ImageView &output, ResampleFilter filter);
+inline void ResampleImage(const glm::vec4 *input, int inputWidth, int inputHeight, glm::vec4 *output, int outputWidth, int outputHeight, ResampleFilter filter)
+{
+    ResampleImage(ConstImageView(input, inputWidth, inputHeight), ImageView(output, outputWidth, outputHeight), filter);
+}
+
+//Resamples the image through an affine map : the output pixel (x, y) reads the input at outputToInput * (x, y, 1),
+//pixel centers being at integer coordinates. Input coordinates are stepped incrementally along each row.
+//When the map shrinks the image, the input is first downscaled with ResampleImage so that the warp does not alias.
+//Pixels that fall outside of the input get border.
+void WarpAffine(const ConstImageView &input, const ImageView &output, const glm::mat3 &outputToInput, ResampleFilter filter, glm::vec4 border=glm::vec4(0, 0, 0, 1));
+inline void WarpAffine(const glm::vec4 *input, int inputWidth, int inputHeight, glm::vec4 *output, int outputWidth, int outputHeight, const glm::mat3 &outputToInput, ResampleFilter filter, glm::vec4 border=glm::vec4(0, 0, 0, 1))
+{
+    WarpAffine(ConstImageView(input, inputWidth, inputHeight), ImageView(output, outputWidth, outputHeight), outputToInput, filter, border);
+}
@@ -0,0 +1,142 @@
+#include "Sequence.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+SequencePipeline::SequencePipeline(ImageLoader &loader, ImageExporter &exporter) : loader(loader), exporter(exporter)
+{
+}
+
+SequencePipeline::~SequencePipeline()
+{
+    Stop();
+}
+
+std::vector<std::string> SequencePipeline::ListFrames(const std::string &directory)
+{
+    //Formats stb_image decodes
+    static const char *extensions[] = {"png", "jpg", "jpeg", "bmp", "tga", "gif", "psd", "hdr", "pic", "ppm", "pgm"};
+
+    std::vector<std::string> frames;
+    std::error_code error;
+    for(const auto &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if(!entry.is_regular_file(error)) continue;
+        std::string extension = entry.path().extension().string();
+        if(extension.empty()) continue;
+        extension = extension.substr(1);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower(c); });
+        for(const char *supported : extensions)
+        {
+            if(extension == supported)
+            {
+                frames.push_back(entry.path().string());
+                break;
+            }
+        }
+    }
+    //Numbered frames are expected to be zero padded
+    std::sort(frames.begin(), frames.end());
+    return frames;
+}
+
+bool SequencePipeline::Start(const std::vector<std::string> &inputs, const std::string &outputDirectory, ExportFormat format, int pngLevel)
+{
+    Stop();
+    if(inputs.empty()) return false;
+    std::error_code error;
+    std::filesystem::create_directories(outputDirectory, error);
+
+    this->inputs = inputs;
+    this->outputDirectory = outputDirectory;
+    this->format = format;
+    this->pngLevel = pngLevel;
+    nextRequest=0;
+    nextFrame=0;
+    currentFrame=-1;
+    framesDone=0;
+    framesFailed=0;
+    lastFramesPerSecond=0;
+    running=true;
+    startTime = std::chrono::high_resolution_clock::now();
+    Fill();
+    return true;
+}
+
+void SequencePipeline::Stop()
+{
+    for(auto &request : decoding) loader.Release(request);
+    decoding.clear();
+    if(running) Finish();
+}
+
+void SequencePipeline::Finish()
+{
+    float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count();
+    lastFramesPerSecond = (seconds > 0) ? (float)framesDone / seconds : 0;
+    running=false;
+    currentFrame=-1;
+}
+
+float SequencePipeline::FramesPerSecond() const
+{
+    if(!running) return lastFramesPerSecond;
+    float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count();
+    return (seconds > 0) ? (float)framesDone / seconds : 0;
+}
+
+void SequencePipeline::Fill()
+{
+    while(nextRequest < (int)inputs.size() && (int)decoding.size() < (std::max)(decodeAhead, 1))
+    {
+        //Not cached, each frame is used once
+        decoding.push_back(loader.Load(inputs[nextRequest], false));
+        nextRequest++;
+    }
+}
+
+std::shared_ptr<const DecodedImage> SequencePipeline::NextFrame(int &frameIndex)
+{
+    if(!running) return nullptr;
+    //A frame whose output was not submitted has no output
+    currentFrame=-1;
+
+    while(!decoding.empty() && decoding.front()->Finished())
+    {
+        std::shared_ptr<ImageLoadRequest> request = decoding.front();
+        if(request->state == ImageLoadState::Done)
+        {
+            //The frame waits in the loader, still decoded, until the exporter catches up
+            if(exporter.Pending() >= (std::max)(maxPendingExports, 1)) return nullptr;
+
+            std::shared_ptr<const DecodedImage> image = request->image;
+            decoding.pop_front();
+            loader.Release(request);
+            currentFrame = nextFrame++;
+            frameIndex = currentFrame;
+            Fill();
+            return image;
+        }
+
+        decoding.pop_front();
+        loader.Release(request);
+        nextFrame++;
+        framesFailed++;
+        Fill();
+    }
+
+    if(decoding.empty() && nextRequest >= (int)inputs.size()) Finish();
+    return nullptr;
+}
+
+void SequencePipeline::Submit(ImageBuffer output)
+{
+    if(currentFrame < 0) return;
+    std::filesystem::path fileName = std::filesystem::path(outputDirectory) / std::filesystem::path(inputs[currentFrame]).stem();
+    fileName += std::string(".") + ExportFormatExtension(format);
+    exporter.Export(fileName.string(), std::move(output), format, pngLevel);
+    currentFrame=-1;
+    framesDone++;
+    if(decoding.empty() && nextRequest >= (int)inputs.size()) Finish();
+}
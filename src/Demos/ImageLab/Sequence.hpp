@@ -0,0 +1,69 @@
+#pragma once
+#include "ImageLoader.hpp"
+#include "ImageExport.hpp"
+#include "ImageBuffer.hpp"
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Frames of a sequence going through the stack one after the other. The loader threads decode the next frames while the stack
+//processes the current one, and the exporter encodes the previous ones, so decoding, processing and encoding overlap.
+//Both sides are bounded : no more than decodeAhead frames are decoded ahead, and a frame is only handed out while fewer than
+//maxPendingExports outputs are waiting to be written, so memory stays flat however long the sequence is.
+class SequencePipeline
+{
+public:
+    SequencePipeline(ImageLoader &loader, ImageExporter &exporter);
+    ~SequencePipeline();
+
+    //Image files of directory that the loader can decode, sorted by name
+    static std::vector<std::string> ListFrames(const std::string &directory);
+
+    //Outputs are written to outputDirectory, named as their input with the extension of format. False when there is nothing to run
+    bool Start(const std::vector<std::string> &inputs, const std::string &outputDirectory, ExportFormat format, int pngLevel);
+    //Frames not handed out yet are dropped, outputs already submitted are still written
+    void Stop();
+    bool Running() const { return running; }
+
+    //Next frame in order once it is decoded and the exporter has room for its output, nullptr otherwise.
+    //Frames that cannot be decoded are skipped. Its output is expected through Submit before the next call
+    std::shared_ptr<const DecodedImage> NextFrame(int &frameIndex);
+    //Output of the frame returned by the last NextFrame, shared with the exporter
+    void Submit(ImageBuffer output);
+
+    int NumFrames() const { return (int)inputs.size(); }
+    int FramesDone() const { return framesDone; }
+    int FramesFailed() const { return framesFailed; }
+    //Since Start, including the frames still being written
+    float FramesPerSecond() const;
+
+    int decodeAhead=4;
+    int maxPendingExports=2;
+
+private:
+    //Keeps decodeAhead requests in flight
+    void Fill();
+    void Finish();
+
+    ImageLoader &loader;
+    ImageExporter &exporter;
+
+    std::vector<std::string> inputs;
+    std::string outputDirectory;
+    ExportFormat format=ExportFormat::PNG;
+    int pngLevel=6;
+
+    //Requests of the frames from nextFrame on, in order
+    std::deque<std::shared_ptr<ImageLoadRequest>> decoding;
+    int nextRequest=0;
+    int nextFrame=0;
+    //Handed out and waiting for its output
+    int currentFrame=-1;
+    int framesDone=0;
+    int framesFailed=0;
+    bool running=false;
+    std::chrono::high_resolution_clock::time_point startTime;
+    float lastFramesPerSecond=0;
+};
@@ -0,0 +1,150 @@
+#include "StageCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+StageCache::StageCache()
+{
+    std::error_code error;
+    directory = std::filesystem::temp_directory_path(error).string();
+    if(error) directory = ".";
+}
+
+StageCache::~StageCache()
+{
+    Invalidate(0);
+}
+
+void StageCache::SetDirectory(const std::string &directory)
+{
+    //Files already spilled stay where they are until dropped
+    this->directory = directory;
+}
+
+void StageCache::SetBudget(size_t bytes)
+{
+    budget = bytes;
+    Spill(-1);
+}
+
+int StageCache::NumResident() const
+{
+    int count=0;
+    for(const Entry &entry : entries) if(entry.valid && entry.fileName.empty()) count++;
+    return count;
+}
+
+int StageCache::NumSpilled() const
+{
+    int count=0;
+    for(const Entry &entry : entries) if(entry.valid && !entry.fileName.empty()) count++;
+    return count;
+}
+
+void StageCache::Drop(Entry &entry)
+{
+    if(!entry.fileName.empty())
+    {
+        //Unmapped first, Windows does not remove mapped files
+        entry.mapped.Close();
+        std::error_code error;
+        std::filesystem::remove(entry.fileName, error);
+        spilledBytes -= (size_t)entry.width * entry.height * 4 * sizeof(uint16_t);
+        entry.fileName.clear();
+    }
+    residentBytes -= entry.pixels.size() * sizeof(uint16_t);
+    std::vector<uint16_t>().swap(entry.pixels);
+    entry.valid = false;
+}
+
+uint16_t *StageCache::Store(int stage, int width, int height)
+{
+    if(stage >= (int)entries.size()) entries.resize(stage+1);
+    Entry &entry = entries[stage];
+    if(!entry.fileName.empty()) Drop(entry);
+
+    //Resident buffers are reused as is when the size does not change
+    size_t count = (size_t)width * height * 4;
+    residentBytes -= entry.pixels.size() * sizeof(uint16_t);
+    entry.pixels.resize(count);
+    residentBytes += count * sizeof(uint16_t);
+    entry.valid = true;
+    entry.width = width;
+    entry.height = height;
+    entry.lastUse = ++useCounter;
+
+    Spill(stage);
+    return entry.pixels.data();
+}
+
+const uint16_t *StageCache::Find(int stage, int width, int height)
+{
+    if(stage < 0 || stage >= (int)entries.size()) return nullptr;
+    Entry &entry = entries[stage];
+    if(!entry.valid || entry.width != width || entry.height != height) return nullptr;
+    entry.lastUse = ++useCounter;
+    if(entry.fileName.empty()) return entry.pixels.data();
+
+    if(!entry.mapped.IsOpen() && !entry.mapped.Open(entry.fileName))
+    {
+        Drop(entry);
+        return nullptr;
+    }
+    return (const uint16_t*)entry.mapped.Data();
+}
+
+void StageCache::Invalidate(int firstStage)
+{
+    for(int stage=(std::max)(firstStage, 0); stage<(int)entries.size(); stage++)
+    {
+        if(entries[stage].valid) Drop(entries[stage]);
+    }
+}
+
+void StageCache::Spill(int keepStage)
+{
+    while(residentBytes > budget)
+    {
+        int oldest=-1;
+        for(int stage=0; stage<(int)entries.size(); stage++)
+        {
+            const Entry &entry = entries[stage];
+            if(stage==keepStage || !entry.valid || !entry.fileName.empty()) continue;
+            if(oldest < 0 || entry.lastUse < entries[oldest].lastUse) oldest = stage;
+        }
+        //Entries that cannot be written stay in memory
+        if(oldest < 0 || !SpillEntry(oldest)) break;
+    }
+}
+
+bool StageCache::SpillEntry(int stage)
+{
+    //Unique per cache so that several instances can share the directory
+    static std::random_device random;
+    static const unsigned int instanceId = random();
+    char name[64];
+    snprintf(name, sizeof(name), "ImageLab_%08x_%p_%d.raw", instanceId, (void*)this, stage);
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::string fileName = (std::filesystem::path(directory) / name).string();
+
+    Entry &entry = entries[stage];
+    RawImageInfo info;
+    info.width = entry.width;
+    info.height = entry.height;
+    info.format = RawPixelFormat::F16;
+    info.layout = RawLayout::Rows;
+    if(!WriteRawImageData(fileName, info, entry.pixels.data()))
+    {
+        std::filesystem::remove(fileName, error);
+        return false;
+    }
+
+    entry.fileName = fileName;
+    residentBytes -= entry.pixels.size() * sizeof(uint16_t);
+    spilledBytes += entry.pixels.size() * sizeof(uint16_t);
+    std::vector<uint16_t>().swap(entry.pixels);
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "RawImage.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Outputs of the stages of the last evaluation of a stack, as half float RGBA like the textures they are read from.
+//They stay in memory up to a budget, past it the least recently used ones are spilled to raw files and mapped back when needed,
+//so a long stack on a large image only keeps a few intermediates resident.
+class StageCache
+{
+public:
+    StageCache();
+    ~StageCache();
+
+    //Spill files are written there, the system temporary directory by default
+    void SetDirectory(const std::string &directory);
+    void SetBudget(size_t bytes);
+
+    //Buffer of width * height * 4 halves to write the output of stage into, valid until the next call to Store.
+    //Stores may spill other stages, never the one being stored
+    uint16_t *Store(int stage, int width, int height);
+    //Output of stage, resident or mapped, nullptr when it is not cached at that size
+    const uint16_t *Find(int stage, int width, int height);
+    //Drops stage and all the ones after it
+    void Invalidate(int firstStage);
+
+    size_t ResidentBytes() const { return residentBytes; }
+    size_t SpilledBytes() const { return spilledBytes; }
+    int NumResident() const;
+    int NumSpilled() const;
+
+private:
+    struct Entry
+    {
+        bool valid=false;
+        int width=0;
+        int height=0;
+        uint64_t lastUse=0;
+        std::vector<uint16_t> pixels;
+        //Set once spilled, pixels is empty then
+        std::string fileName;
+        MappedRawImage mapped;
+    };
+    void Drop(Entry &entry);
+    void Spill(int keepStage);
+    bool SpillEntry(int stage);
+
+    std::vector<Entry> entries;
+    std::string directory;
+    size_t budget = (size_t)512 << 20;
+    size_t residentBytes=0;
+    size_t spilledBytes=0;
+    uint64_t useCounter=0;
+};
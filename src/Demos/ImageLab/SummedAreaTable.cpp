@@ -0,0 +1,171 @@
+#include "SummedAreaTable.hpp"
+#include "Parallel.hpp"
+#include "Color.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void SummedAreaTable::Build(const ConstImageView &image)
+{
+    int width = image.width;
+    int height = image.height;
+    this->width = width;
+    this->height = height;
+    numTilesX = (width + tileSize-1) >> tileShift;
+    numTilesY = (height + tileSize-1) >> tileShift;
+
+    tileSum.resize((size_t)width * height);
+    tileSquaredSum.resize((size_t)width * height);
+    aboveSum.assign((size_t)numTilesY * width, glm::dvec4(0));
+    aboveSquaredSum.assign((size_t)numTilesY * width, 0);
+    leftSum.assign((size_t)numTilesX * height, glm::dvec4(0));
+    leftSquaredSum.assign((size_t)numTilesX * height, 0);
+    cornerSum.assign((size_t)numTilesX * numTilesY, glm::dvec4(0));
+    cornerSquaredSum.assign((size_t)numTilesX * numTilesY, 0);
+
+    //Sums within each tile, accumulated in double and rounded once.
+    //The last row and column of a tile go to the tiles below and on the right
+    ParallelFor(0, numTilesX * numTilesY, [&](int tile)
+    {
+        int tx = tile % numTilesX;
+        int ty = tile / numTilesX;
+        int x0 = tx << tileShift;
+        int y0 = ty << tileShift;
+        int x1 = (std::min)(x0 + tileSize, width);
+        int y1 = (std::min)(y0 + tileSize, height);
+
+        glm::dvec4 columnSum[tileSize];
+        double columnSquaredSum[tileSize];
+        for(int i=0; i<tileSize; i++)
+        {
+            columnSum[i] = glm::dvec4(0);
+            columnSquaredSum[i] = 0;
+        }
+        for(int y=y0; y<y1; y++)
+        {
+            const glm::vec4 *inRow = image.Row(y);
+            glm::vec4 *sumRow = tileSum.data() + (size_t)y * width;
+            float *squaredRow = tileSquaredSum.data() + (size_t)y * width;
+            glm::dvec4 rowSum(0);
+            double rowSquaredSum=0;
+            for(int x=x0; x<x1; x++)
+            {
+                double gray = RGBToGray(inRow[x]);
+                rowSum += glm::dvec4(inRow[x].r, inRow[x].g, inRow[x].b, gray);
+                rowSquaredSum += gray * gray;
+                columnSum[x-x0] += rowSum;
+                columnSquaredSum[x-x0] += rowSquaredSum;
+                sumRow[x] = glm::vec4(columnSum[x-x0]);
+                squaredRow[x] = (float)columnSquaredSum[x-x0];
+            }
+            if(tx+1 < numTilesX)
+            {
+                leftSum[(size_t)(tx+1) * height + y] = columnSum[x1-1-x0];
+                leftSquaredSum[(size_t)(tx+1) * height + y] = columnSquaredSum[x1-1-x0];
+            }
+        }
+        if(ty+1 < numTilesY)
+        {
+            for(int x=x0; x<x1; x++)
+            {
+                aboveSum[(size_t)(ty+1) * width + x] = columnSum[x-x0];
+                aboveSquaredSum[(size_t)(ty+1) * width + x] = columnSquaredSum[x-x0];
+            }
+        }
+    });
+
+    //Then accumulate the tiles down and right
+    ParallelForChunks(0, width, [&](int start, int end)
+    {
+        for(int ty=2; ty<numTilesY; ty++)
+        {
+            for(int x=start; x<end; x++)
+            {
+                aboveSum[(size_t)ty * width + x] += aboveSum[(size_t)(ty-1) * width + x];
+                aboveSquaredSum[(size_t)ty * width + x] += aboveSquaredSum[(size_t)(ty-1) * width + x];
+            }
+        }
+    }, 64);
+    ParallelForChunks(0, height, [&](int start, int end)
+    {
+        for(int tx=2; tx<numTilesX; tx++)
+        {
+            for(int y=start; y<end; y++)
+            {
+                leftSum[(size_t)tx * height + y] += leftSum[(size_t)(tx-1) * height + y];
+                leftSquaredSum[(size_t)tx * height + y] += leftSquaredSum[(size_t)(tx-1) * height + y];
+            }
+        }
+    }, 64);
+    for(int ty=1; ty<numTilesY; ty++)
+    {
+        int y = (ty << tileShift) - 1;
+        for(int tx=0; tx<numTilesX; tx++)
+        {
+            cornerSum[(size_t)ty * numTilesX + tx] = cornerSum[(size_t)(ty-1) * numTilesX + tx] + leftSum[(size_t)tx * height + y];
+            cornerSquaredSum[(size_t)ty * numTilesX + tx] = cornerSquaredSum[(size_t)(ty-1) * numTilesX + tx] + leftSquaredSum[(size_t)tx * height + y];
+        }
+    }
+}
+
+glm::dvec4 SummedAreaTable::PrefixSum(int x, int y) const
+{
+    if(x < 0 || y < 0) return glm::dvec4(0);
+    int tx = x >> tileShift;
+    int ty = y >> tileShift;
+    return cornerSum[(size_t)ty * numTilesX + tx] + aboveSum[(size_t)ty * width + x] + leftSum[(size_t)tx * height + y] + glm::dvec4(tileSum[(size_t)y * width + x]);
+}
+
+double SummedAreaTable::PrefixSquaredSum(int x, int y) const
+{
+    if(x < 0 || y < 0) return 0;
+    int tx = x >> tileShift;
+    int ty = y >> tileShift;
+    return cornerSquaredSum[(size_t)ty * numTilesX + tx] + aboveSquaredSum[(size_t)ty * width + x] + leftSquaredSum[(size_t)tx * height + y] + (double)tileSquaredSum[(size_t)y * width + x];
+}
+
+glm::dvec4 SummedAreaTable::Sum(int x0, int y0, int x1, int y1) const
+{
+    x0 = (std::max)(x0, 0); y0 = (std::max)(y0, 0);
+    x1 = (std::min)(x1, width-1); y1 = (std::min)(y1, height-1);
+    if(x1 < x0 || y1 < y0) return glm::dvec4(0);
+    return PrefixSum(x1, y1) - PrefixSum(x0-1, y1) - PrefixSum(x1, y0-1) + PrefixSum(x0-1, y0-1);
+}
+
+double SummedAreaTable::SquaredGraySum(int x0, int y0, int x1, int y1) const
+{
+    x0 = (std::max)(x0, 0); y0 = (std::max)(y0, 0);
+    x1 = (std::min)(x1, width-1); y1 = (std::min)(y1, height-1);
+    if(x1 < x0 || y1 < y0) return 0;
+    return PrefixSquaredSum(x1, y1) - PrefixSquaredSum(x0-1, y1) - PrefixSquaredSum(x1, y0-1) + PrefixSquaredSum(x0-1, y0-1);
+}
+
+int SummedAreaTable::Count(int x0, int y0, int x1, int y1) const
+{
+    x0 = (std::max)(x0, 0); y0 = (std::max)(y0, 0);
+    x1 = (std::min)(x1, width-1); y1 = (std::min)(y1, height-1);
+    if(x1 < x0 || y1 < y0) return 0;
+    return (x1 - x0 + 1) * (y1 - y0 + 1);
+}
+
+glm::vec4 SummedAreaTable::Mean(int x0, int y0, int x1, int y1) const
+{
+    int count = Count(x0, y0, x1, y1);
+    if(count==0) return glm::vec4(0);
+    return glm::vec4(Sum(x0, y0, x1, y1) / (double)count);
+}
+
+void SummedAreaTable::MeanAndGrayDeviation(int x0, int y0, int x1, int y1, glm::vec4 &mean, float &grayDeviation) const
+{
+    int count = Count(x0, y0, x1, y1);
+    if(count==0)
+    {
+        mean = glm::vec4(0);
+        grayDeviation = 0;
+        return;
+    }
+    glm::dvec4 m = Sum(x0, y0, x1, y1) / (double)count;
+    double variance = SquaredGraySum(x0, y0, x1, y1) / (double)count - m.w * m.w;
+    mean = glm::vec4(m);
+    grayDeviation = (float)std::sqrt((std::max)(variance, 0.0));
+}
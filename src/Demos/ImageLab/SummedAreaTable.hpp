@@ -0,0 +1,46 @@
+#pragma once
+#include "ImageView.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+//Integral images of the RGB channels, with the gray scale (average of RGB) in w, and of the squared gray scale.
+//Any rectangle sum, mean or standard deviation costs a few lookups whatever its size.
+//Per pixel, only the sums within its tile of tileSize x tileSize pixels are stored, as floats that stay small whatever the image size.
+//The sums over the tiles above and on the left are kept in double precision per row and column of tiles, so large images do not drift.
+struct SummedAreaTable
+{
+    void Build(const ConstImageView &image);
+    void Build(const glm::vec4 *data, int width, int height) { Build(ConstImageView(data, width, height)); }
+
+    //Rectangles are [x0, x1] x [y0, y1], clipped to the image
+    glm::dvec4 Sum(int x0, int y0, int x1, int y1) const;
+    double SquaredGraySum(int x0, int y0, int x1, int y1) const;
+    int Count(int x0, int y0, int x1, int y1) const;
+    glm::vec4 Mean(int x0, int y0, int x1, int y1) const;
+    void MeanAndGrayDeviation(int x0, int y0, int x1, int y1, glm::vec4 &mean, float &grayDeviation) const;
+
+    static const int tileShift = 4;
+    static const int tileSize = 1 << tileShift;
+
+    int width=0;
+    int height=0;
+    int numTilesX=0;
+    int numTilesY=0;
+    //width * height, sums over the pixels of the tile from its first row and column up to the pixel
+    std::vector<glm::vec4> tileSum;
+    std::vector<float> tileSquaredSum;
+    //numTilesY * width, sums over all the rows above the tile of its columns up to x
+    std::vector<glm::dvec4> aboveSum;
+    std::vector<double> aboveSquaredSum;
+    //numTilesX * height, sums over all the columns on the left of the tile of its rows up to y
+    std::vector<glm::dvec4> leftSum;
+    std::vector<double> leftSquaredSum;
+    //numTilesX * numTilesY, sums over everything above and on the left of the tile
+    std::vector<glm::dvec4> cornerSum;
+    std::vector<double> cornerSquaredSum;
+
+private:
+    //Sums over [0, x] x [0, y], 0 when x or y is negative
+    glm::dvec4 PrefixSum(int x, int y) const;
+    double PrefixSquaredSum(int x, int y) const;
+};
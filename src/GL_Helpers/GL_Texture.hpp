@@ -29,36 +29,14 @@ public:
         if(createInfo.flip) stbi_set_flip_vertically_on_load(true);  
         // data = stbi_loadf(filename.c_str(), &width, &height, &nChannels, 0);
         
+        //Normalized bytes are converted to floats by GL on upload
         uint8_t* charData = stbi_load(filename.c_str(), &width, &height, &nChannels, 4);
-        if(charData)
-        {
-            data = (glm::vec4*)malloc(width * height * sizeof(glm::vec4));
-            for(int i=0; i<width * height; i++)
-            {
-                data[i].r = (float)charData[i * 4 + 0] / 255.0f;
-                data[i].g = (float)charData[i * 4 + 1] / 255.0f;
-                data[i].b = (float)charData[i * 4 + 2] / 255.0f;
-                data[i].a = (float)charData[i * 4 + 3] / 255.0f;
-            }
-        }
-
-#if 0
-        for(int y=0; y<height; y++)
-        {
-            for(int x=0; x<height; x++)
-            {
-                int inx = y * width + x;
-                std::cout << data[inx].x << " ";
-            }
-            std::cout << std::endl;
-        }
-#endif
-
-        stbi_image_free(charData);
+        if(createInfo.flip) stbi_set_flip_vertically_on_load(false);  
 
-        if (data)
+        if (charData)
         {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, data);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, charData);
+            stbi_image_free(charData);
         }
         else
         {
@@ -76,6 +54,23 @@ public:
         loaded = true;        
     }
     
+    //From pixels decoded elsewhere, which are not kept
+    GL_TextureFloat(int width, int height, const glm::vec4 *pixels, TextureCreateInfo createInfo) : width(width), height(height), nChannels(4) {
+        glGenTextures(1, &glTex);
+        glBindTexture(GL_TEXTURE_2D, glTex);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, pixels);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, createInfo.wrapS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, createInfo.wrapT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, createInfo.minFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, createInfo.magFilter);
+        if(createInfo.generateMipmaps) glGenerateMipmap(GL_TEXTURE_2D);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        loaded = true;
+        data = nullptr;
+    }
+
     GL_TextureFloat(int width, int height, TextureCreateInfo createInfo) : width(width), height(height) {
         glGenTextures(1, &glTex);
         glBindTexture(GL_TEXTURE_2D, glTex);